@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <omp.h>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexIVFPQFastScan.h>
+#include <faiss/utils/random.h>
+#include <faiss/utils/utils.h>
+
+/************************
+ * Compares the search time and recall of IndexIVFPQ and IndexIVFPQFastScan
+ * for 4, 6 and 8-bit PQ. Both indexes use the same trained coarse quantizer
+ * and product quantizer, so the difference is the scan of the lists: float
+ * look-up tables for IndexIVFPQ, 8-bit quantized tables and the SIMD
+ * kernels of pq4_fast_scan.h / pq8_fast_scan.h for the fast-scan index.
+ */
+
+namespace {
+
+using idx_t = faiss::idx_t;
+
+double recall_at(
+        size_t nq,
+        int k,
+        const idx_t* I,
+        const idx_t* gt,
+        int rank) {
+    size_t n = 0;
+    for (size_t i = 0; i < nq; i++) {
+        for (int j = 0; j < rank; j++) {
+            if (I[i * k + j] == gt[i]) {
+                n++;
+                break;
+            }
+        }
+    }
+    return n / double(nq);
+}
+
+} // namespace
+
+int main() {
+    int d = 64;
+    size_t nb = 200 * 1000;
+    size_t nt = 50 * 1000;
+    size_t nq = 1000;
+    size_t nlist = 1024;
+    int M = 32;
+    int k = 10;
+    int nrun = 3;
+    std::vector<float> data((nb + nq) * d);
+    float* xb = data.data();
+    float* xq = data.data() + nb * d;
+    faiss::rand_smooth_vectors(nb + nq, d, data.data(), 1234);
+
+    std::vector<idx_t> gt(nq);
+    {
+        faiss::IndexFlatL2 flat(d);
+        flat.add(nb, xb);
+        std::vector<float> D(nq);
+        flat.search(nq, xq, 1, D.data(), gt.data());
+    }
+
+    printf("nb=%zd nq=%zd d=%d nlist=%zd M=%d threads=%d\n",
+           nb,
+           nq,
+           d,
+           nlist,
+           M,
+           omp_get_max_threads());
+
+    for (int nbits : {4, 6, 8}) {
+        faiss::IndexFlatL2 quantizer(d);
+        faiss::IndexIVFPQ ivfpq(&quantizer, d, nlist, M, nbits);
+        ivfpq.by_residual = false;
+        ivfpq.train(nt, xb);
+        faiss::IndexIVFPQFastScan fastscan(ivfpq, 32);
+        ivfpq.add(nb, xb);
+        fastscan.add(nb, xb);
+
+        for (int nprobe : {8, 32}) {
+            faiss::Index* indexes[2] = {&ivfpq, &fastscan};
+            const char* names[2] = {"IVFPQ", "IVFPQFastScan"};
+            for (int i = 0; i < 2; i++) {
+                auto index = dynamic_cast<faiss::IndexIVF*>(indexes[i]);
+                index->nprobe = nprobe;
+                std::vector<float> D(nq * k);
+                std::vector<idx_t> I(nq * k);
+                double best = 1e30;
+                for (int run = 0; run < nrun; run++) {
+                    double t0 = faiss::getmillisecs();
+                    index->search(nq, xq, k, D.data(), I.data());
+                    best = std::min(best, faiss::getmillisecs() - t0);
+                }
+                printf("nbits=%d nprobe=%2d %-14s %8.3f ms/query "
+                       "R@1=%.3f R@10=%.3f\n",
+                       nbits,
+                       nprobe,
+                       names[i],
+                       best / nq,
+                       recall_at(nq, k, I.data(), gt.data(), 1),
+                       recall_at(nq, k, I.data(), gt.data(), 10));
+            }
+        }
+    }
+    return 0;
+}
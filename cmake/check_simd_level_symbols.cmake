@@ -0,0 +1,55 @@
+# Copyright (c) Facebook, Inc. and its affiliates.
+# All rights reserved.
+#
+# This source code is licensed under the BSD-style license found in the
+# LICENSE file in the root directory of this source tree.
+
+# Checks that the objects compiled for a SIMD level (FAISS_OPT_LEVEL=dd)
+# define no external symbol that the generic objects may also define: the
+# linker would keep either copy, so generic code could end up running
+# instructions that the CPU does not support.
+#
+# The allowed symbols are the specializations for the level, the symbols in
+# the per-level inline namespace and the compiler's personality reference.
+#
+# Usage: cmake -DNM=<nm> -DLEVEL=<AVX2|AVX512> -DOBJECTS=<obj|obj|...>
+#              -P check_simd_level_symbols.cmake
+
+string(REPLACE "|" ";" objects "${OBJECTS}")
+if(LEVEL STREQUAL "AVX2")
+  set(level_value 1)
+elseif(LEVEL STREQUAL "AVX512")
+  set(level_value 2)
+else()
+  message(FATAL_ERROR "unknown SIMD level ${LEVEL}")
+endif()
+
+set(leaks "")
+foreach(object ${objects})
+  execute_process(
+    COMMAND ${NM} -g --defined-only ${object}
+    OUTPUT_VARIABLE symbols
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${NM} failed on ${object}")
+  endif()
+  string(REPLACE "\n" ";" symbols "${symbols}")
+  foreach(line ${symbols})
+    string(REGEX REPLACE "^.* " "" symbol "${line}")
+    if(symbol STREQUAL "" OR
+       symbol MATCHES "simd_${LEVEL}" OR
+       symbol MATCHES "9SIMDLevelE${level_value}E" OR
+       symbol MATCHES "^DW\\.ref\\.")
+      continue()
+    endif()
+    string(APPEND leaks "  ${object}: ${symbol}\n")
+  endforeach()
+endforeach()
+
+if(NOT leaks STREQUAL "")
+  message(FATAL_ERROR
+    "symbols of the ${LEVEL} objects that are not specific to the level:\n"
+    "${leaks}"
+    "Enclose them in FAISS_SIMD_NAMESPACE_BEGIN/END or define them in a "
+    "generic object.")
+endif()
@@ -8,15 +8,28 @@
 #include <faiss/IVFlib.h>
 #include <omp.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
 
 #include <faiss/IndexAdditiveQuantizer.h>
 #include <faiss/IndexIVFAdditiveQuantizer.h>
+#include <faiss/IndexIVFFastScan.h>
+#include <faiss/IndexIVFFlat.h>
 #include <faiss/IndexIVFIndependentQuantizer.h>
+#include <faiss/IndexIVFPQR.h>
 #include <faiss/IndexPreTransform.h>
 #include <faiss/IndexRefine.h>
 #include <faiss/MetaIndexes.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/index_io.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/hamming.h>
 #include <faiss/utils/utils.h>
@@ -519,5 +532,327 @@ void ivf_residual_add_from_flat_codes(
     index->ntotal += nb;
 }
 
+/*************************************************************
+ * Streaming addition
+ *************************************************************/
+
+VecsFileReader::VecsFileReader(const char* fname, bool bvecs)
+        : fname(fname), bvecs(bvecs) {
+    f = fopen(fname, "rb");
+    FAISS_THROW_IF_NOT_FMT(
+            f, "could not open %s for reading: %s", fname, strerror(errno));
+    int32_t dim;
+    if (fread(&dim, sizeof(dim), 1, f) == 1) {
+        if (dim <= 0 || dim > (1 << 20)) {
+            fclose(f);
+            FAISS_THROW_FMT("%s: invalid dimension %d", fname, dim);
+        }
+        d = dim;
+    }
+    rewind(f);
+}
+
+size_t VecsFileReader::read(size_t n, float* x) {
+    size_t record_size = sizeof(int32_t) + d * (bvecs ? 1 : sizeof(float));
+    buf.resize(n * record_size);
+    size_t nr = fread(buf.data(), record_size, n, f);
+    FAISS_THROW_IF_NOT_FMT(
+            !ferror(f), "read error in %s: %s", fname.c_str(), strerror(errno));
+
+    for (size_t i = 0; i < nr; i++) {
+        const uint8_t* rec = buf.data() + i * record_size;
+        int32_t dim;
+        memcpy(&dim, rec, sizeof(dim));
+        FAISS_THROW_IF_NOT_FMT(
+                dim == d,
+                "%s: vector %zd has dimension %d instead of %zd",
+                fname.c_str(),
+                i,
+                dim,
+                d);
+        rec += sizeof(dim);
+        if (bvecs) {
+            for (size_t j = 0; j < d; j++) {
+                x[i * d + j] = rec[j];
+            }
+        } else {
+            memcpy(x + i * d, rec, d * sizeof(float));
+        }
+    }
+    return nr;
+}
+
+VecsFileReader::~VecsFileReader() {
+    fclose(f);
+}
+
+namespace {
+
+/// queue between two stages of the pipeline
+template <class T>
+struct BoundedQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<T> queue;
+    size_t capacity;
+    bool closed = false;
+
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    /// waits for a free slot, returns false if the queue is closed
+    bool push(T x) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return queue.size() < capacity || closed; });
+        if (closed) {
+            return false;
+        }
+        queue.push_back(std::move(x));
+        cv.notify_all();
+        return true;
+    }
+
+    /// waits for an element, returns false if the queue is closed and empty
+    bool pop(T& x) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return !queue.empty() || closed; });
+        if (queue.empty()) {
+            return false;
+        }
+        x = std::move(queue.front());
+        queue.pop_front();
+        cv.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        cv.notify_all();
+    }
+};
+
+struct StreamBatch {
+    size_t n = 0;
+    std::vector<float> x;
+    std::vector<idx_t> list_nos;
+    std::vector<uint8_t> codes;
+};
+
+using StreamBatchPtr = std::unique_ptr<StreamBatch>;
+
+/** add n encoded vectors to the inverted lists, with one add_entries per
+ * list (this matters for OnDiskInvertedLists). ids = ntotal + i if xids
+ * is nullptr */
+void add_grouped_by_list(
+        IndexIVF* ivf,
+        size_t n,
+        const idx_t* list_nos,
+        const uint8_t* codes,
+        const idx_t* xids) {
+    ivf->direct_map.check_can_add(xids);
+    size_t code_size = ivf->code_size;
+    std::vector<size_t> perm(n);
+    std::iota(perm.begin(), perm.end(), 0);
+    std::stable_sort(perm.begin(), perm.end(), [&](size_t a, size_t b) {
+        return list_nos[a] < list_nos[b];
+    });
+
+    DirectMapAdd dm_adder(ivf->direct_map, n, xids);
+    std::vector<idx_t> ids;
+    std::vector<uint8_t> list_codes;
+    for (size_t i0 = 0; i0 < n;) {
+        idx_t list_no = list_nos[perm[i0]];
+        size_t i1 = i0 + 1;
+        while (i1 < n && list_nos[perm[i1]] == list_no) {
+            i1++;
+        }
+        if (list_no < 0) {
+            for (size_t i = i0; i < i1; i++) {
+                dm_adder.add(perm[i], -1, 0);
+            }
+            i0 = i1;
+            continue;
+        }
+        ids.resize(i1 - i0);
+        list_codes.resize((i1 - i0) * code_size);
+        for (size_t i = i0; i < i1; i++) {
+            size_t j = perm[i];
+            ids[i - i0] = xids ? xids[j] : ivf->ntotal + j;
+            memcpy(list_codes.data() + (i - i0) * code_size,
+                   codes + j * code_size,
+                   code_size);
+        }
+        size_t ofs = ivf->invlists->add_entries(
+                list_no, i1 - i0, ids.data(), list_codes.data());
+        for (size_t i = i0; i < i1; i++) {
+            dm_adder.add(perm[i], list_no, ofs + i - i0);
+        }
+        i0 = i1;
+    }
+    ivf->ntotal += n;
+}
+
+} // anonymous namespace
+
+size_t streaming_add(
+        Index* index,
+        VectorStreamReader& reader,
+        const StreamingAddParams& params) {
+    IndexPreTransform* pt = dynamic_cast<IndexPreTransform*>(index);
+    IndexIVF* ivf = dynamic_cast<IndexIVF*>(pt ? pt->index : index);
+    FAISS_THROW_IF_NOT_MSG(
+            ivf, "index should be an IndexIVF or a pre-transformed IndexIVF");
+    // the vectors are added with encode_vectors + add_entries, which
+    // bypasses the add_core / add_with_ids of these index types
+    FAISS_THROW_IF_NOT_MSG(
+            !dynamic_cast<IndexIVFPQR*>(ivf) &&
+                    !dynamic_cast<IndexIVFFlatDedup*>(ivf) &&
+                    !dynamic_cast<IndexIVFFastScan*>(ivf),
+            "streaming_add not supported for IndexIVFPQR, "
+            "IndexIVFFlatDedup and IVF fast-scan indexes");
+    FAISS_THROW_IF_NOT(index->is_trained);
+    FAISS_THROW_IF_NOT_FMT(
+            reader.d == index->d,
+            "reader dimension %zd != index dimension %d",
+            reader.d,
+            index->d);
+    FAISS_THROW_IF_NOT(params.queue_size > 0);
+    FAISS_THROW_IF_NOT_MSG(
+            params.shard_size == 0 || !params.shard_prefix.empty(),
+            "shard_prefix is required with shard_size");
+    size_t d = index->d;
+
+    // batches in flight: the ones in the queues + one per stage
+    size_t nbatch = 2 * params.queue_size + 3;
+    size_t bytes_per_vector = (d + ivf->d) * sizeof(float) +
+            2 * sizeof(idx_t) + ivf->code_size;
+    size_t bs = params.batch_size;
+    if (params.max_memory > 0) {
+        bs = std::min(bs, params.max_memory / (nbatch * bytes_per_vector));
+    }
+    FAISS_THROW_IF_NOT_MSG(bs > 0, "batch_size or max_memory too small");
+
+    BoundedQueue<StreamBatchPtr> to_encode(params.queue_size);
+    BoundedQueue<StreamBatchPtr> to_add(params.queue_size);
+    std::exception_ptr read_error, encode_error, add_error;
+
+    // stage 1: read
+    std::thread read_thread([&]() {
+        try {
+            for (;;) {
+                StreamBatchPtr b(new StreamBatch());
+                b->x.resize(bs * d);
+                b->n = reader.read(bs, b->x.data());
+                if (b->n == 0) {
+                    break;
+                }
+                b->x.resize(b->n * d);
+                if (!to_encode.push(std::move(b))) {
+                    break;
+                }
+            }
+        } catch (...) {
+            read_error = std::current_exception();
+        }
+        to_encode.close();
+    });
+
+    // stage 3: append to the inverted lists, and write the shards
+    size_t nadd = 0;
+    std::thread add_thread([&]() {
+        idx_t id0 = ivf->ntotal;
+        size_t shard_no = 0, shard_ntotal = 0;
+        std::vector<idx_t> ids;
+        auto write_shard = [&]() {
+            index->ntotal = ivf->ntotal;
+            std::string fname = params.shard_prefix +
+                    std::to_string(shard_no) + ".index";
+            if (params.verbose) {
+                printf("streaming_add: writing %zd vectors to %s\n",
+                       shard_ntotal,
+                       fname.c_str());
+            }
+            write_index(index, fname.c_str());
+            index->reset();
+            shard_no++;
+            shard_ntotal = 0;
+        };
+        try {
+            StreamBatchPtr b;
+            while (to_add.pop(b)) {
+                for (size_t i0 = 0; i0 < b->n;) {
+                    size_t n = b->n - i0;
+                    const idx_t* xids = nullptr;
+                    if (params.shard_size > 0) {
+                        // the ids continue across shards
+                        n = std::min(n, params.shard_size - shard_ntotal);
+                        ids.resize(n);
+                        std::iota(ids.begin(), ids.end(), id0 + nadd);
+                        xids = ids.data();
+                    }
+                    add_grouped_by_list(
+                            ivf,
+                            n,
+                            b->list_nos.data() + i0,
+                            b->codes.data() + i0 * ivf->code_size,
+                            xids);
+                    nadd += n;
+                    shard_ntotal += n;
+                    i0 += n;
+                    if (shard_ntotal == params.shard_size) {
+                        write_shard();
+                    }
+                }
+                if (params.verbose) {
+                    printf("streaming_add: %zd vectors added\n", nadd);
+                }
+            }
+            if (shard_ntotal > 0 && params.shard_size > 0) {
+                write_shard();
+            }
+        } catch (...) {
+            add_error = std::current_exception();
+            to_add.close();
+        }
+        index->ntotal = ivf->ntotal;
+    });
+
+    // stage 2: transform, assign and encode, in the calling thread
+    try {
+        StreamBatchPtr b;
+        while (to_encode.pop(b)) {
+            size_t n = b->n;
+            const float* xt = pt ? pt->apply_chain(n, b->x.data())
+                                 : b->x.data();
+            std::unique_ptr<const float[]> del(
+                    xt == b->x.data() ? nullptr : xt);
+            b->list_nos.resize(n);
+            ivf->quantizer->assign(n, xt, b->list_nos.data());
+            b->codes.resize(n * ivf->code_size);
+            ivf->encode_vectors(
+                    n, xt, b->list_nos.data(), b->codes.data());
+            std::vector<float>().swap(b->x);
+            if (!to_add.push(std::move(b))) {
+                break;
+            }
+        }
+    } catch (...) {
+        encode_error = std::current_exception();
+    }
+    // wake up the reader if it is blocked because of an error downstream
+    to_encode.close();
+    to_add.close();
+
+    read_thread.join();
+    add_thread.join();
+
+    for (auto& err : {read_error, encode_error, add_error}) {
+        if (err) {
+            std::rethrow_exception(err);
+        }
+    }
+    return nadd;
+}
+
 } // namespace ivflib
 } // namespace faiss
@@ -15,6 +15,8 @@
  */
 
 #include <faiss/IndexIVF.h>
+#include <cstdio>
+#include <string>
 #include <vector>
 
 namespace faiss {
@@ -167,6 +169,73 @@ void ivf_residual_add_from_flat_codes(
         const uint8_t* codes,
         int64_t code_size = -1);
 
+/*************************************************************
+ * Streaming addition
+ *************************************************************/
+
+/// source of vectors for streaming_add
+struct VectorStreamReader {
+    size_t d = 0; ///< dimension of the vectors
+
+    /** read up to n vectors to x (size n * d). Returns the number of
+     * vectors read, 0 at the end of the stream. */
+    virtual size_t read(size_t n, float* x) = 0;
+
+    virtual ~VectorStreamReader() {}
+};
+
+/** reads the vectors of an .fvecs or .bvecs file (each vector is
+ * prefixed with its dimension as an int32, the components are floats or
+ * uint8s). */
+struct VecsFileReader : VectorStreamReader {
+    FILE* f = nullptr;
+    std::string fname;
+    bool bvecs;
+    std::vector<uint8_t> buf; ///< raw records of the last read
+
+    VecsFileReader(const char* fname, bool bvecs = false);
+
+    size_t read(size_t n, float* x) override;
+
+    ~VecsFileReader() override;
+};
+
+struct StreamingAddParams {
+    /// number of vectors processed at a time by each stage
+    size_t batch_size = 65536;
+    /** if > 0, reduce batch_size so that the pipeline buffers take at
+     * most max_memory bytes. This does not include the inverted lists:
+     * use an OnDiskInvertedLists or shards to bound them as well. */
+    size_t max_memory = 0;
+    /// number of batches that can wait between two stages
+    int queue_size = 2;
+    /** if > 0, write the index to shard_prefix + shard number + ".index"
+     * every shard_size vectors, and empty it. The ids of the shards are
+     * disjoint. */
+    size_t shard_size = 0;
+    std::string shard_prefix;
+    bool verbose = false;
+};
+
+/** Add the vectors of reader to an IndexIVF, or an IndexPreTransform on
+ * top of an IndexIVF, without loading them all in RAM. The ids are
+ * sequential from index->ntotal.
+ *
+ * The stages run concurrently on successive batches, connected by bounded
+ * queues: read (one thread), pre-transform + coarse assignment + encoding
+ * (calling thread, parallelized by OpenMP), append to the inverted lists,
+ * grouped by list (one thread).
+ *
+ * The index types with their own add_core / add_with_ids (IndexIVFPQR,
+ * IndexIVFFlatDedup, IVF fast-scan) are not supported.
+ *
+ * @return number of vectors added
+ */
+size_t streaming_add(
+        Index* index,
+        VectorStreamReader& reader,
+        const StreamingAddParams& params = StreamingAddParams());
+
 } // namespace ivflib
 } // namespace faiss
 
@@ -18,6 +18,8 @@
 
 namespace faiss {
 
+SearchParameters::~SearchParameters() = default;
+
 Index::~Index() = default;
 
 void Index::train(idx_t /*n*/, const float* /*x*/) {
@@ -55,6 +55,7 @@ namespace faiss {
 struct IDSelector;
 struct RangeSearchResult;
 struct DistanceComputer;
+struct SearchTrace;
 
 /** Parent class for the optional search paramenters.
  *
@@ -64,8 +65,10 @@ struct DistanceComputer;
 struct SearchParameters {
     /// if non-null, only these IDs will be considered during search.
     IDSelector* sel = nullptr;
+    /// if non-null, per-query timings are recorded there (SearchTrace.h)
+    SearchTrace* trace = nullptr;
     /// make sure we can dynamic_cast this
-    virtual ~SearchParameters() {}
+    virtual ~SearchParameters();
 };
 
 /** Abstract structure for an index, supports adding vectors and searching
@@ -0,0 +1,412 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexDiskGraph.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
+
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexNSG.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/async_io.h>
+#include <faiss/impl/code_distance/code_distance.h>
+#include <faiss/utils/distances.h>
+
+namespace faiss {
+
+DiskGraphStats diskgraph_stats;
+
+namespace {
+
+const uint32_t disk_graph_magic = 0x30524744; // "DGR0"
+
+// contents of the header sector
+struct DiskGraphHeader {
+    uint32_t magic;
+    int32_t d;
+    int64_t ntotal;
+    int32_t R;
+    int32_t entry_point;
+    uint64_t node_size;
+};
+
+/// buffer aligned on sectors, as required by O_DIRECT
+struct SectorBuffer {
+    uint8_t* data = nullptr;
+
+    explicit SectorBuffer(size_t size) {
+        int ret = posix_memalign(
+                (void**)&data, IndexDiskGraph::sector_size, size);
+        FAISS_THROW_IF_NOT_MSG(ret == 0, "could not allocate buffer");
+        memset(data, 0, size);
+    }
+
+    ~SectorBuffer() {
+        free(data);
+    }
+};
+
+struct Candidate {
+    float dis;
+    IndexDiskGraph::storage_idx_t id;
+    bool expanded;
+
+    bool operator<(const Candidate& other) const {
+        return dis < other.dis;
+    }
+};
+
+} // anonymous namespace
+
+IndexDiskGraph::IndexDiskGraph(
+        int d,
+        size_t pq_M,
+        size_t pq_nbits,
+        MetricType metric)
+        : Index(d, metric), pq(d, pq_M, pq_nbits) {
+    FAISS_THROW_IF_NOT(
+            metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    is_trained = false;
+}
+
+IndexDiskGraph::IndexDiskGraph() {}
+
+IndexDiskGraph::~IndexDiskGraph() {}
+
+void IndexDiskGraph::train(idx_t n, const float* x) {
+    pq.train(n, x);
+    is_trained = true;
+}
+
+void IndexDiskGraph::add(idx_t, const float*) {
+    FAISS_THROW_MSG("IndexDiskGraph: use build() to add vectors");
+}
+
+size_t IndexDiskGraph::node_read_size() const {
+    return (node_size + sector_size - 1) / sector_size * sector_size;
+}
+
+size_t IndexDiskGraph::node_read_offset(idx_t i) const {
+    if (node_size <= sector_size) {
+        size_t nodes_per_sector = sector_size / node_size;
+        return sector_size * (1 + i / nodes_per_sector);
+    }
+    return sector_size + i * node_read_size();
+}
+
+size_t IndexDiskGraph::node_offset_in_block(idx_t i) const {
+    if (node_size <= sector_size) {
+        size_t nodes_per_sector = sector_size / node_size;
+        return (i % nodes_per_sector) * node_size;
+    }
+    return 0;
+}
+
+void IndexDiskGraph::build(const Index* graph_index, const char* fname) {
+    FAISS_THROW_IF_NOT(is_trained);
+    FAISS_THROW_IF_NOT(graph_index->d == d);
+    FAISS_THROW_IF_NOT(graph_index->metric_type == metric_type);
+    reset();
+
+    idx_t n = graph_index->ntotal;
+    std::vector<storage_idx_t> graph;
+    int new_R;
+    storage_idx_t new_entry_point;
+    if (auto ihnsw = dynamic_cast<const IndexHNSW*>(graph_index)) {
+        const HNSW& hnsw = ihnsw->hnsw;
+        FAISS_THROW_IF_NOT(hnsw.levels.size() == size_t(n));
+        FAISS_THROW_IF_NOT_MSG(
+                ihnsw->ndeleted == 0, "the index has deleted vectors");
+        new_R = hnsw.nb_neighbors(0);
+        graph.resize(n * new_R);
+        for (idx_t i = 0; i < n; i++) {
+            size_t begin, end;
+            hnsw.neighbor_range(i, 0, &begin, &end);
+            memcpy(graph.data() + i * new_R,
+                   hnsw.neighbors.data() + begin,
+                   sizeof(storage_idx_t) * new_R);
+        }
+        new_entry_point = hnsw.entry_point;
+    } else if (auto insg = dynamic_cast<const IndexNSG*>(graph_index)) {
+        const NSG& nsg = insg->nsg;
+        FAISS_THROW_IF_NOT_MSG(nsg.is_built, "the graph is not built");
+        new_R = nsg.final_graph->K;
+        graph.assign(
+                nsg.final_graph->data, nsg.final_graph->data + n * new_R);
+        new_entry_point = nsg.enterpoint;
+    } else {
+        FAISS_THROW_MSG("IndexDiskGraph: unsupported graph index type");
+    }
+
+    R = new_R;
+    node_size = sizeof(float) * d + sizeof(int32_t) * (1 + R);
+
+    FILE* f = fopen(fname, "wb");
+    FAISS_THROW_IF_NOT_FMT(
+            f,
+            "could not open %s for writing: %s",
+            fname,
+            strerror(errno));
+
+    // header
+    std::vector<uint8_t> block(std::max(node_read_size(), sector_size));
+    DiskGraphHeader header = {
+            disk_graph_magic, d, n, R, new_entry_point, node_size};
+    memcpy(block.data(), &header, sizeof(header));
+    bool ok = fwrite(block.data(), 1, sector_size, f) == sector_size;
+
+    // nodes, by chunks of vectors
+    codes.resize(n * pq.code_size);
+    size_t bs = 65536;
+    std::vector<float> xb;
+    size_t block_offset = sector_size;
+    memset(block.data(), 0, block.size());
+    for (idx_t i0 = 0; i0 < n && ok; i0 += bs) {
+        idx_t i1 = std::min(n, idx_t(i0 + bs));
+        xb.resize((i1 - i0) * d);
+        graph_index->reconstruct_n(i0, i1 - i0, xb.data());
+        pq.compute_codes(
+                xb.data(), codes.data() + i0 * pq.code_size, i1 - i0);
+        for (idx_t i = i0; i < i1; i++) {
+            if (node_read_offset(i) != block_offset) {
+                ok = ok &&
+                        fwrite(block.data(), 1, node_read_size(), f) ==
+                                node_read_size();
+                memset(block.data(), 0, block.size());
+                block_offset = node_read_offset(i);
+            }
+            uint8_t* node = block.data() + node_offset_in_block(i);
+            memcpy(node, xb.data() + (i - i0) * d, sizeof(float) * d);
+            const storage_idx_t* neighbors = graph.data() + i * R;
+            storage_idx_t* out = (storage_idx_t*)(node + sizeof(float) * d +
+                                                  sizeof(int32_t));
+            int32_t nn = 0;
+            for (int j = 0; j < R; j++) {
+                if (neighbors[j] >= 0) {
+                    out[nn++] = neighbors[j];
+                }
+            }
+            memcpy(node + sizeof(float) * d, &nn, sizeof(nn));
+        }
+    }
+    if (n > 0) {
+        ok = ok &&
+                fwrite(block.data(), 1, node_read_size(), f) ==
+                        node_read_size();
+    }
+    ok = fclose(f) == 0 && ok;
+    FAISS_THROW_IF_NOT_FMT(
+            ok, "write error in %s: %s", fname, strerror(errno));
+
+    ntotal = n;
+    entry_point = new_entry_point;
+    filename = fname;
+    open_file();
+}
+
+void IndexDiskGraph::open_file() {
+    reader.reset(new AsyncFileReader(filename, io_threads, direct_io));
+    SectorBuffer buf(sector_size);
+    AsyncFileReader::Request req = {0, sector_size, buf.data};
+    reader->read(1, &req);
+    DiskGraphHeader header;
+    memcpy(&header, buf.data, sizeof(header));
+    FAISS_THROW_IF_NOT_FMT(
+            header.magic == disk_graph_magic && header.d == d &&
+                    header.ntotal == ntotal && header.R == R &&
+                    header.node_size == node_size,
+            "%s does not match the index",
+            filename.c_str());
+}
+
+void IndexDiskGraph::search(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params_in) const {
+    FAISS_THROW_IF_NOT(k > 0);
+    FAISS_THROW_IF_NOT_MSG(reader || ntotal == 0, "the file is not open");
+    int L = search_L, W = beam_width;
+    if (params_in) {
+        auto params = dynamic_cast<const SearchParametersDiskGraph*>(params_in);
+        FAISS_THROW_IF_NOT_MSG(params, "params type invalid");
+        L = params->search_L;
+        W = params->beam_width;
+    }
+    L = std::max(L, int(k));
+    FAISS_THROW_IF_NOT(W > 0);
+
+    size_t nhops = 0, nreads = 0;
+    std::mutex exception_mutex;
+    std::string exception_string;
+
+#pragma omp parallel if (n > 1) reduction(+ : nhops, nreads)
+    {
+        std::vector<float> table(pq.M * pq.ksub);
+        SectorBuffer buf(W * node_read_size());
+        std::vector<AsyncFileReader::Request> requests(W);
+        std::vector<Candidate> candidates;
+        std::vector<storage_idx_t> beam;
+        std::vector<std::pair<float, idx_t>> results;
+        std::unordered_set<storage_idx_t> visited;
+
+#pragma omp for
+        for (idx_t q = 0; q < n; q++) {
+            const float* xq = x + q * d;
+            float* D = distances + q * k;
+            idx_t* I = labels + q * k;
+            std::fill(D, D + k, std::numeric_limits<float>::infinity());
+            std::fill(I, I + k, -1);
+            if (ntotal == 0) {
+                continue;
+            }
+            try {
+                // smaller is better for both metrics
+                if (metric_type == METRIC_L2) {
+                    pq.compute_distance_table(xq, table.data());
+                } else {
+                    pq.compute_inner_prod_table(xq, table.data());
+                    for (float& t : table) {
+                        t = -t;
+                    }
+                }
+                auto pq_distance = [&](storage_idx_t id) {
+                    const uint8_t* code = codes.data() + id * pq.code_size;
+                    return pq.nbits == 8
+                            ? distance_single_code<PQDecoder8>(
+                                      pq.M, pq.nbits, table.data(), code)
+                            : distance_single_code<PQDecoderGeneric>(
+                                      pq.M, pq.nbits, table.data(), code);
+                };
+
+                candidates.clear();
+                visited.clear();
+                results.clear();
+                visited.insert(entry_point);
+                candidates.push_back(
+                        {pq_distance(entry_point), entry_point, false});
+
+                for (;;) {
+                    beam.clear();
+                    for (Candidate& c : candidates) {
+                        if (!c.expanded) {
+                            c.expanded = true;
+                            beam.push_back(c.id);
+                            if (beam.size() == size_t(W)) {
+                                break;
+                            }
+                        }
+                    }
+                    if (beam.empty()) {
+                        break;
+                    }
+                    for (size_t j = 0; j < beam.size(); j++) {
+                        requests[j] = {
+                                node_read_offset(beam[j]),
+                                node_read_size(),
+                                buf.data + j * node_read_size()};
+                    }
+                    reader->read(beam.size(), requests.data());
+                    nhops++;
+                    nreads += beam.size();
+
+                    for (size_t j = 0; j < beam.size(); j++) {
+                        const uint8_t* node = buf.data +
+                                j * node_read_size() +
+                                node_offset_in_block(beam[j]);
+                        const float* v = (const float*)node;
+                        float dis = metric_type == METRIC_L2
+                                ? fvec_L2sqr(xq, v, d)
+                                : -fvec_inner_product(xq, v, d);
+                        results.emplace_back(dis, beam[j]);
+
+                        int32_t nn;
+                        memcpy(&nn, node + sizeof(float) * d, sizeof(nn));
+                        const storage_idx_t* neighbors =
+                                (const storage_idx_t*)(node +
+                                                       sizeof(float) * d +
+                                                       sizeof(nn));
+                        for (int32_t l = 0; l < nn; l++) {
+                            storage_idx_t nb = neighbors[l];
+                            if (!visited.insert(nb).second) {
+                                continue;
+                            }
+                            Candidate c = {pq_distance(nb), nb, false};
+                            if (candidates.size() >= size_t(L) &&
+                                !(c < candidates.back())) {
+                                continue;
+                            }
+                            candidates.insert(
+                                    std::upper_bound(
+                                            candidates.begin(),
+                                            candidates.end(),
+                                            c),
+                                    c);
+                            if (candidates.size() > size_t(L)) {
+                                candidates.pop_back();
+                            }
+                        }
+                    }
+                }
+
+                // rerank with the exact distances
+                size_t nres = std::min(size_t(k), results.size());
+                std::partial_sort(
+                        results.begin(), results.begin() + nres, results.end());
+                for (size_t j = 0; j < nres; j++) {
+                    D[j] = metric_type == METRIC_L2 ? results[j].first
+                                                    : -results[j].first;
+                    I[j] = results[j].second;
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                exception_string = e.what();
+            }
+        }
+    }
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
+
+    diskgraph_stats.nq += n;
+    diskgraph_stats.nhops += nhops;
+    diskgraph_stats.nreads += nreads;
+}
+
+void IndexDiskGraph::reconstruct(idx_t key, float* recons) const {
+    FAISS_THROW_IF_NOT(key >= 0 && key < ntotal);
+    FAISS_THROW_IF_NOT_MSG(reader, "the file is not open");
+    SectorBuffer buf(node_read_size());
+    AsyncFileReader::Request req = {
+            node_read_offset(key), node_read_size(), buf.data};
+    reader->read(1, &req);
+    memcpy(recons,
+           buf.data + node_offset_in_block(key),
+           sizeof(float) * d);
+}
+
+void IndexDiskGraph::reset() {
+    reader.reset();
+    codes.clear();
+    filename.clear();
+    ntotal = 0;
+    entry_point = -1;
+    node_size = 0;
+}
+
+} // namespace faiss
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <faiss/Index.h>
+#include <faiss/impl/ProductQuantizer.h>
+#include <faiss/impl/platform_macros.h>
+
+namespace faiss {
+
+struct AsyncFileReader;
+
+struct SearchParametersDiskGraph : SearchParameters {
+    int search_L = 64;
+    int beam_width = 4;
+
+    ~SearchParametersDiskGraph() {}
+};
+
+/** Graph index whose full-precision vectors and adjacency lists are
+ * stored on disk, in the spirit of DiskANN:
+ *
+ * DiskANN: Fast Accurate Billion-point Nearest Neighbor Search on a
+ * Single Node, Subramanya et al., NeurIPS'19
+ *
+ * The graph is taken from an IndexHNSW (level 0) or an IndexNSG, see
+ * build(). Each node is stored in a record of node_size bytes: its vector
+ * (d floats), its number of neighbors (int32) and R neighbor ids (int32).
+ * The file is made of 4 KiB sectors: the first one is a header, then each
+ * sector holds sector_size / node_size nodes, or each node takes whole
+ * sectors if it is larger than a sector. A node is read with a single
+ * aligned read.
+ *
+ * The PQ codes of the vectors stay in memory and guide a beam search:
+ * at each step, the beam_width closest candidates that have not been
+ * expanded are read with one batch of parallel reads, their exact
+ * distances are computed from the full vectors, and their neighbors are
+ * added to the candidates with their PQ distances. The results are the
+ * expanded nodes with the smallest exact distances.
+ */
+struct IndexDiskGraph : Index {
+    using storage_idx_t = int32_t;
+
+    static constexpr size_t sector_size = 4096;
+
+    /// quantizer for the in-memory codes
+    ProductQuantizer pq;
+
+    /// in-memory PQ codes, size ntotal * pq.code_size
+    std::vector<uint8_t> codes;
+
+    /// file with the vectors and the graph
+    std::string filename;
+
+    /// max nb of neighbors per node
+    int R = 0;
+
+    /// where the search starts
+    storage_idx_t entry_point = -1;
+
+    /// size of a node record in the file
+    size_t node_size = 0;
+
+    /// length of the candidate list during search
+    int search_L = 64;
+
+    /// nb of nodes expanded (and read) at each search step
+    int beam_width = 4;
+
+    /// nb of I/O threads, 0 = synchronous reads
+    int io_threads = 16;
+
+    /// open the file with O_DIRECT (bypasses the page cache)
+    bool direct_io = false;
+
+    IndexDiskGraph(
+            int d,
+            size_t pq_M,
+            size_t pq_nbits = 8,
+            MetricType metric = METRIC_L2);
+
+    IndexDiskGraph();
+
+    /// trains the PQ
+    void train(idx_t n, const float* x) override;
+
+    /// not supported, use build()
+    void add(idx_t n, const float* x) override;
+
+    /** Write the vectors and the graph of graph_index (an IndexHNSW or
+     * an IndexNSG, whose storage supports reconstruct) to fname, encode
+     * the vectors with the PQ and open the file for search.
+     */
+    void build(const Index* graph_index, const char* fname);
+
+    /// (re)open the file, called by build() and read_index()
+    void open_file();
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    /// reads the vector from disk
+    void reconstruct(idx_t key, float* recons) const override;
+
+    void reset() override;
+
+    /// nb of bytes read per node
+    size_t node_read_size() const;
+
+    /// offset of the block read for node i
+    size_t node_read_offset(idx_t i) const;
+
+    /// offset of node i within its block
+    size_t node_offset_in_block(idx_t i) const;
+
+    ~IndexDiskGraph() override;
+
+    std::unique_ptr<AsyncFileReader> reader;
+};
+
+struct DiskGraphStats {
+    size_t nq = 0;     ///< nb of queries
+    size_t nhops = 0;  ///< nb of batches of reads
+    size_t nreads = 0; ///< nb of nodes read
+
+    void reset() {
+        nq = nhops = nreads = 0;
+    }
+};
+
+// global var that collects them all
+FAISS_API extern DiskGraphStats diskgraph_stats;
+
+} // namespace faiss
@@ -24,6 +24,7 @@
 #include <faiss/utils/utils.h>
 
 #include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/impl/pq8_fast_scan.h>
 #include <faiss/impl/simd_result_handlers.h>
 #include <faiss/utils/quantize_lut.h>
 
@@ -35,13 +36,18 @@ inline size_t roundup(size_t a, size_t b) {
     return (a + b - 1) / b * b;
 }
 
+// size of the packed codes for n vectors (multiple of bbs)
+inline size_t packed_codes_size(const IndexFastScan& index, size_t n) {
+    return index.nbits == 4 ? n * index.M2 / 2 : n * index.M2;
+}
+
 void IndexFastScan::init_fastscan(
         int d,
         size_t M_2,
         size_t nbits_2,
         MetricType metric,
         int bbs) {
-    FAISS_THROW_IF_NOT(nbits_2 == 4);
+    FAISS_THROW_IF_NOT(nbits_2 >= 4 && nbits_2 <= 8);
     FAISS_THROW_IF_NOT(bbs % 32 == 0);
     this->d = d;
     this->M = M_2;
@@ -85,34 +91,50 @@ void IndexFastScan::add(idx_t n, const float* x) {
     compute_codes(tmp_codes.get(), n, x);
 
     ntotal2 = roundup(ntotal + n, bbs);
-    size_t new_size = ntotal2 * M2 / 2; // assume nbits = 4
+    size_t new_size = packed_codes_size(*this, ntotal2);
     size_t old_size = codes.size();
     if (new_size > old_size) {
         codes.resize(new_size);
         memset(codes.get() + old_size, 0, new_size - old_size);
     }
 
-    pq4_pack_codes_range(
-            tmp_codes.get(), M, ntotal, ntotal + n, bbs, M2, codes.get());
+    if (nbits == 4) {
+        pq4_pack_codes_range(
+                tmp_codes.get(), M, ntotal, ntotal + n, bbs, M2, codes.get());
+    } else {
+        pq8_pack_codes_range(
+                tmp_codes.get(),
+                M,
+                nbits,
+                ntotal,
+                ntotal + n,
+                bbs,
+                M2,
+                codes.get());
+    }
 
     ntotal += n;
 }
 
 CodePacker* IndexFastScan::get_CodePacker() const {
-    return new CodePackerPQ4(M, bbs);
+    if (nbits == 4) {
+        return new CodePackerPQ4(M, bbs);
+    } else {
+        return new CodePackerPQ8(M, nbits, bbs);
+    }
 }
 
 size_t IndexFastScan::remove_ids(const IDSelector& sel) {
     idx_t j = 0;
     std::vector<uint8_t> buffer(code_size);
-    CodePackerPQ4 packer(M, bbs);
+    std::unique_ptr<CodePacker> packer(get_CodePacker());
     for (idx_t i = 0; i < ntotal; i++) {
         if (sel.is_member(i)) {
             // should be removed
         } else {
             if (i > j) {
-                packer.unpack_1(codes.data(), i, buffer.data());
-                packer.pack_1(buffer.data(), j, codes.data());
+                packer->unpack_1(codes.data(), i, buffer.data());
+                packer->pack_1(buffer.data(), j, codes.data());
             }
             j++;
         }
@@ -121,7 +143,7 @@ size_t IndexFastScan::remove_ids(const IDSelector& sel) {
     if (nremove > 0) {
         ntotal = j;
         ntotal2 = roundup(ntotal, bbs);
-        size_t new_size = ntotal2 * M2 / 2;
+        size_t new_size = packed_codes_size(*this, ntotal2);
         codes.resize(new_size);
     }
     return nremove;
@@ -144,13 +166,13 @@ void IndexFastScan::merge_from(Index& otherIndex, idx_t add_id) {
     check_compatible_for_merge(otherIndex);
     IndexFastScan* other = static_cast<IndexFastScan*>(&otherIndex);
     ntotal2 = roundup(ntotal + other->ntotal, bbs);
-    codes.resize(ntotal2 * M2 / 2);
+    codes.resize(packed_codes_size(*this, ntotal2));
     std::vector<uint8_t> buffer(code_size);
-    CodePackerPQ4 packer(M, bbs);
+    std::unique_ptr<CodePacker> packer(get_CodePacker());
 
     for (int i = 0; i < other->ntotal; i++) {
-        packer.unpack_1(other->codes.data(), i, buffer.data());
-        packer.pack_1(buffer.data(), ntotal + i, codes.data());
+        packer->unpack_1(other->codes.data(), i, buffer.data());
+        packer->pack_1(buffer.data(), ntotal + i, codes.data());
     }
     ntotal += other->ntotal;
     other->reset();
@@ -298,7 +320,7 @@ void IndexFastScan::search_dispatch_implem(
     int impl = implem;
 
     if (impl == 0) {
-        if (bbs == 32) {
+        if (bbs == 32 && nbits == 4) {
             impl = 12;
         } else {
             impl = 14;
@@ -308,12 +330,21 @@ void IndexFastScan::search_dispatch_implem(
         }
     }
 
+    // the codes of more than 4 bits are only scanned by implem 14 and 15
+    if (nbits != 4 && impl >= 12 && impl <= 17) {
+        impl = 14 + impl % 2;
+    }
+
+    FAISS_THROW_IF_NOT_MSG(
+            impl < 16 || impl > 17 || pq4_has_512bit_kernels(),
+            "implem 16 and 17 require the 512-bit kernels");
+
     if (implem == 1) {
         FAISS_THROW_MSG("not implemented");
     } else if (implem == 2 || implem == 3 || implem == 4) {
         FAISS_THROW_IF_NOT(orig_codes != nullptr);
         search_implem_234<Cfloat>(n, x, k, distances, labels, scaler);
-    } else if (impl >= 12 && impl <= 15) {
+    } else if (impl >= 12 && impl <= 17) {
         FAISS_THROW_IF_NOT(ntotal < INT_MAX);
         int nt = std::min(omp_get_max_threads(), int(n));
         if (nt < 2) {
@@ -524,7 +555,11 @@ void IndexFastScan::search_implem_14(
     }
 
     AlignedTable<uint8_t> LUT(n * dim12);
-    pq4_pack_LUT(n, M2, quantized_dis_tables.get(), LUT.get());
+    if (nbits == 4) {
+        pq4_pack_LUT(n, M2, quantized_dis_tables.get(), LUT.get());
+    } else {
+        pq8_pack_LUT(n, M2, ksub, quantized_dis_tables.get(), LUT.get());
+    }
 
     std::unique_ptr<RH> handler(
             make_knn_handler<C>(impl, n, k, ntotal, distances, labels));
@@ -533,8 +568,22 @@ void IndexFastScan::search_implem_14(
 
     if (skip & 4) {
         // pass
+    } else if (nbits != 4) {
+        pq8_accumulate_loop(
+                n,
+                ntotal2,
+                bbs,
+                M2,
+                ksub,
+                codes.get(),
+                LUT.get(),
+                *handler.get(),
+                scaler);
     } else {
-        pq4_accumulate_loop(
+        // 16 and 17 are 14 and 15 with the 512-bit kernels
+        auto accumulate_loop =
+                impl >= 16 ? pq4_accumulate_loop_512 : pq4_accumulate_loop;
+        accumulate_loop(
                 n,
                 ntotal2,
                 bbs,
@@ -567,11 +616,8 @@ template void IndexFastScan::search_dispatch_implem<false>(
 
 void IndexFastScan::reconstruct(idx_t key, float* recons) const {
     std::vector<uint8_t> code(code_size, 0);
-    BitstringWriter bsw(code.data(), code_size);
-    for (size_t m = 0; m < M; m++) {
-        uint8_t c = pq4_get_packed_element(codes.data(), bbs, M2, key, m);
-        bsw.write(c, nbits);
-    }
+    std::unique_ptr<CodePacker> packer(get_CodePacker());
+    packer->unpack_1(codes.data(), key, code.data());
     sa_decode(1, code.data(), recons);
 }
 
@@ -15,7 +15,8 @@ namespace faiss {
 struct CodePacker;
 struct NormTableScaler;
 
-/** Fast scan version of IndexPQ and IndexAQ. Works for 4-bit PQ and AQ for now.
+/** Fast scan version of IndexPQ and IndexAQ. Works for 4-bit PQ and AQ, and
+ * for 5 to 8-bit PQ (then implem 12, 13, 16, 17 fall back to 14, 15).
  *
  * The codes are not stored sequentially but grouped in blocks of size bbs.
  * This makes it possible to compute distances quickly with SIMD instructions.
@@ -27,6 +28,9 @@ struct NormTableScaler;
  * 13: same with reservoir accumulator to store results
  * 14: no qbs with heap accumulator
  * 15: no qbs with reservoir accumulator
+ * 16, 17: same as 14, 15 with 512-bit kernels that process 64 codes per
+ *         shuffle (requires an AVX512 build, or the AVX512 level with
+ *         dynamic dispatch, see pq4_has_512bit_kernels(); throws otherwise)
  */
 struct IndexFastScan : Index {
     // implementation to select
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexFlat16.h>
+
+#include <vector>
+
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/distances_16bit.h>
+
+namespace faiss {
+
+IndexFlat16::IndexFlat16(idx_t d, bool bf16, MetricType metric)
+        : IndexFlatCodes(sizeof(uint16_t) * d, d, metric), bf16(bf16) {}
+
+void IndexFlat16::search(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params) const {
+    const IDSelector* sel = params ? params->sel : nullptr;
+    FAISS_THROW_IF_NOT(k > 0);
+
+    if (metric_type == METRIC_INNER_PRODUCT) {
+        if (bf16) {
+            knn_inner_product_bf16(
+                    x, get_xb16(), d, n, ntotal, k, distances, labels, sel);
+        } else {
+            knn_inner_product_fp16(
+                    x, get_xb16(), d, n, ntotal, k, distances, labels, sel);
+        }
+    } else if (metric_type == METRIC_L2) {
+        if (bf16) {
+            knn_L2sqr_bf16(
+                    x,
+                    get_xb16(),
+                    d,
+                    n,
+                    ntotal,
+                    k,
+                    distances,
+                    labels,
+                    nullptr,
+                    sel);
+        } else {
+            knn_L2sqr_fp16(
+                    x,
+                    get_xb16(),
+                    d,
+                    n,
+                    ntotal,
+                    k,
+                    distances,
+                    labels,
+                    nullptr,
+                    sel);
+        }
+    } else {
+        // other metrics: decode the vectors
+        IndexFlatCodes::search(n, x, k, distances, labels, params);
+    }
+}
+
+namespace {
+
+struct Flat16Dis : FlatCodesDistanceComputer {
+    const IndexFlat16& storage;
+    Float16QueryDistance qd;
+    std::vector<float> tmp;
+
+    explicit Flat16Dis(const IndexFlat16& storage)
+            : FlatCodesDistanceComputer(
+                      storage.codes.data(),
+                      storage.code_size),
+              storage(storage),
+              qd(storage.d, storage.bf16, storage.metric_type),
+              tmp(storage.d) {}
+
+    void set_query(const float* x) override {
+        qd.set_query(x);
+    }
+
+    float distance_to_code(const uint8_t* code) final {
+        return qd((const uint16_t*)code);
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        storage.sa_decode(1, codes + i * code_size, tmp.data());
+        const uint16_t* yj = (const uint16_t*)(codes + j * code_size);
+        size_t d = storage.d;
+        if (storage.metric_type == METRIC_INNER_PRODUCT) {
+            return storage.bf16 ? fvec_inner_product_bf16(tmp.data(), yj, d)
+                                : fvec_inner_product_fp16(tmp.data(), yj, d);
+        } else {
+            return storage.bf16 ? fvec_L2sqr_bf16(tmp.data(), yj, d)
+                                : fvec_L2sqr_fp16(tmp.data(), yj, d);
+        }
+    }
+};
+
+} // namespace
+
+FlatCodesDistanceComputer* IndexFlat16::get_FlatCodesDistanceComputer() const {
+    if (metric_type == METRIC_L2 || metric_type == METRIC_INNER_PRODUCT) {
+        return new Flat16Dis(*this);
+    }
+    return IndexFlatCodes::get_FlatCodesDistanceComputer();
+}
+
+void IndexFlat16::sa_encode(idx_t n, const float* x, uint8_t* bytes) const {
+    if (bf16) {
+        fvec_to_bf16(x, (uint16_t*)bytes, n * d);
+    } else {
+        fvec_to_fp16(x, (uint16_t*)bytes, n * d);
+    }
+}
+
+void IndexFlat16::sa_decode(idx_t n, const uint8_t* bytes, float* x) const {
+    if (bf16) {
+        bf16_to_fvec((const uint16_t*)bytes, x, n * d);
+    } else {
+        fp16_to_fvec((const uint16_t*)bytes, x, n * d);
+    }
+}
+
+} // namespace faiss
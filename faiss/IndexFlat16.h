@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <faiss/IndexFlatCodes.h>
+
+namespace faiss {
+
+/** Index that stores the vectors in a 16-bit floating point format (fp16
+ * or bf16) and performs exhaustive search. The storage is half that of
+ * IndexFlat and the search converts the components to float on the fly,
+ * see utils/distances_16bit.h.
+ *
+ * bf16 keeps the dynamic range of float with 8 bits of mantissa, fp16 has
+ * 11 bits of mantissa but a limited range (max 65504).
+ */
+struct IndexFlat16 : IndexFlatCodes {
+    /// vectors stored in bf16, otherwise fp16
+    bool bf16 = false;
+
+    explicit IndexFlat16(
+            idx_t d,
+            bool bf16 = false,
+            MetricType metric = METRIC_L2);
+
+    IndexFlat16() {}
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    // get pointer to the 16-bit data
+    const uint16_t* get_xb16() const {
+        return (const uint16_t*)codes.data();
+    }
+
+    FlatCodesDistanceComputer* get_FlatCodesDistanceComputer() const override;
+
+    void sa_encode(idx_t n, const float* x, uint8_t* bytes) const override;
+
+    void sa_decode(idx_t n, const uint8_t* bytes, float* x) const override;
+};
+
+struct IndexFlatFP16 : IndexFlat16 {
+    explicit IndexFlatFP16(idx_t d, MetricType metric = METRIC_L2)
+            : IndexFlat16(d, false, metric) {}
+    IndexFlatFP16() {}
+};
+
+struct IndexFlatBF16 : IndexFlat16 {
+    explicit IndexFlatBF16(idx_t d, MetricType metric = METRIC_L2)
+            : IndexFlat16(d, true, metric) {}
+    IndexFlatBF16() {
+        bf16 = true;
+    }
+};
+
+} // namespace faiss
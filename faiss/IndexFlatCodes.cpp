@@ -101,14 +101,16 @@ CodePacker* IndexFlatCodes::get_CodePacker() const {
 }
 
 void IndexFlatCodes::permute_entries(const idx_t* perm) {
+    // the codes may be a view, they are only read
+    const auto& old_codes = codes;
     std::vector<uint8_t> new_codes(codes.size());
 
     for (idx_t i = 0; i < ntotal; i++) {
         memcpy(new_codes.data() + i * code_size,
-               codes.data() + perm[i] * code_size,
+               old_codes.data() + perm[i] * code_size,
                code_size);
     }
-    std::swap(codes, new_codes);
+    codes = std::move(new_codes);
 }
 
 namespace {
@@ -9,6 +9,7 @@
 
 #include <faiss/Index.h>
 #include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/maybe_owned_vector.h>
 #include <vector>
 
 namespace faiss {
@@ -20,8 +21,9 @@ struct CodePacker;
 struct IndexFlatCodes : Index {
     size_t code_size;
 
-    /// encoded dataset, size ntotal * code_size
-    std::vector<uint8_t> codes;
+    /// encoded dataset, size ntotal * code_size. May be a view on a
+    /// memory-mapped file (see IO_FLAG_MMAP_IFC)
+    MaybeOwnedVector<uint8_t> codes;
 
     IndexFlatCodes();
 
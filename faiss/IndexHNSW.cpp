@@ -30,7 +30,9 @@
 #include <faiss/IndexIVFPQ.h>
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
 #include <faiss/impl/ResultHandler.h>
+#include <faiss/impl/SearchTrace.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/random.h>
 #include <faiss/utils/sorting.h>
@@ -57,6 +59,63 @@ DistanceComputer* storage_distance_computer(const Index* storage) {
     }
 }
 
+/// distance computer on a compacted storage: vector i of the graph is
+/// vector storage_ids[i] of the storage
+struct RemappedDistanceComputer : DistanceComputer {
+    std::unique_ptr<DistanceComputer> basedis;
+    const idx_t* storage_ids;
+
+    RemappedDistanceComputer(
+            DistanceComputer* basedis,
+            const idx_t* storage_ids)
+            : basedis(basedis), storage_ids(storage_ids) {}
+
+    void set_query(const float* x) override {
+        basedis->set_query(x);
+    }
+
+    float operator()(idx_t i) override {
+        return (*basedis)(storage_ids[i]);
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        return basedis->symmetric_dis(storage_ids[i], storage_ids[j]);
+    }
+};
+
+/// the FlatCodesDistanceComputer in a (maybe negated) distance computer
+FlatCodesDistanceComputer* get_flat_codes_dis(DistanceComputer* dis) {
+    if (auto ndis = dynamic_cast<NegativeDistanceComputer*>(dis)) {
+        dis = ndis->basedis;
+    }
+    return dynamic_cast<FlatCodesDistanceComputer*>(dis);
+}
+
+/// in online mode, the storage is read under the lock of the additions
+DistanceComputer* online_storage_distance_computer(const IndexHNSW& index) {
+    if (!index.hnsw.online) {
+        return storage_distance_computer(index.storage);
+    }
+    std::lock_guard<std::mutex> guard(index.hnsw.online->add_mutex);
+    return storage_distance_computer(index.storage);
+}
+
+/// distance computer used for search. When the codes are interleaved with
+/// the level-0 graph, the codes are read from there
+DistanceComputer* search_distance_computer(const IndexHNSW& index) {
+    DistanceComputer* dis = online_storage_distance_computer(index);
+    const HNSW& hnsw = index.hnsw;
+    if (hnsw.level0_code_size > 0) {
+        FlatCodesDistanceComputer* fdis = get_flat_codes_dis(dis);
+        FAISS_THROW_IF_NOT_MSG(
+                fdis && fdis->code_size == hnsw.level0_code_size,
+                "interleaved codes do not match the storage");
+        fdis->codes = hnsw.interleaved_codes();
+        fdis->code_size = hnsw.level0_block_size;
+    }
+    return dis;
+}
+
 void hnsw_add_vertices(
         IndexHNSW& index_hnsw,
         size_t n0,
@@ -206,6 +265,116 @@ void hnsw_add_vertices(
     }
 }
 
+/// add vertices in online mode: the storage and level tables are appended
+/// to under a lock, then the vertices are linked concurrently with other
+/// additions and searches
+void hnsw_add_vertices_online(IndexHNSW& index_hnsw, size_t n, const float* x) {
+    HNSW& hnsw = index_hnsw.hnsw;
+    HNSWOnlineState& online = *hnsw.online;
+    if (n == 0) {
+        return;
+    }
+
+    size_t n0;
+    {
+        std::lock_guard<std::mutex> guard(online.add_mutex);
+        n0 = index_hnsw.ntotal;
+        FAISS_THROW_IF_NOT_FMT(
+                n0 + n <= online.capacity,
+                "adding %zd vectors to %zd exceeds the online capacity %zd",
+                n,
+                n0,
+                online.capacity);
+        FAISS_ASSERT(hnsw.levels.size() == n0);
+
+        size_t nneighbors = hnsw.offsets.back();
+        for (size_t i = 0; i < n; i++) {
+            int pt_level = hnsw.random_level();
+            hnsw.levels.push_back(pt_level + 1);
+            nneighbors += hnsw.cum_nb_neighbors(pt_level + 1);
+        }
+        if (nneighbors > online.neighbors_capacity) {
+            hnsw.levels.resize(n0);
+            FAISS_THROW_FMT(
+                    "neighbor table full (%zd > %zd entries), "
+                    "increase the online capacity",
+                    nneighbors,
+                    online.neighbors_capacity);
+        }
+
+        // the new vertices are not reachable until they are linked
+        index_hnsw.storage->add(n, x);
+        hnsw.prepare_level_tab(n, true);
+        index_hnsw.ntotal = index_hnsw.storage->ntotal;
+        online.ntotal.store(index_hnsw.ntotal, std::memory_order_release);
+    }
+
+#pragma omp parallel if (n > 100)
+    {
+        VisitedTable vt(online.capacity);
+        std::unique_ptr<DistanceComputer> dis(
+                online_storage_distance_computer(index_hnsw));
+
+#pragma omp for schedule(static)
+        for (int64_t i = 0; i < n; i++) {
+            storage_idx_t pt_id = n0 + i;
+            int pt_level = hnsw.levels[pt_id] - 1;
+            dis->set_query(x + i * index_hnsw.d);
+            hnsw.add_with_locks(
+                    *dis,
+                    pt_level,
+                    pt_id,
+                    online.locks,
+                    vt,
+                    index_hnsw.keep_max_size_level0 && (pt_level == 0));
+        }
+    }
+}
+
+/// visited table for a search with queue size ef. Vertices added in online
+/// mode during the search must fit.
+VisitedTable make_visited_table(const IndexHNSW& index, int ef) {
+    size_t size =
+            index.hnsw.online ? index.hnsw.online->capacity : index.ntotal;
+    return VisitedTable(size, VisitedTable::choose_mode(size, ef));
+}
+
+/// search parameters that exclude the deleted vectors from the results
+struct DeletedFilter {
+    SearchParametersHNSW params;
+    std::unique_ptr<IDSelectorBitmap> sel_deleted;
+    std::unique_ptr<IDSelectorNot> sel_not_deleted;
+    std::unique_ptr<IDSelectorAnd> sel_and;
+
+    /// returns the parameters to use for the search
+    const SearchParametersHNSW* apply(
+            const IndexHNSW& index,
+            const SearchParametersHNSW* params_in) {
+        if (index.ndeleted == 0) {
+            return params_in;
+        }
+        if (params_in) {
+            params = *params_in;
+        } else {
+            const HNSW& hnsw = index.hnsw;
+            params.efSearch = hnsw.efSearch;
+            params.check_relative_distance = hnsw.check_relative_distance;
+            params.bounded_queue = hnsw.search_bounded_queue;
+        }
+        sel_deleted = std::make_unique<IDSelectorBitmap>(
+                index.deleted.size(), index.deleted.data());
+        sel_not_deleted = std::make_unique<IDSelectorNot>(sel_deleted.get());
+        if (params.sel) {
+            sel_and = std::make_unique<IDSelectorAnd>(
+                    params.sel, sel_not_deleted.get());
+            params.sel = sel_and.get();
+        } else {
+            params.sel = sel_not_deleted.get();
+        }
+        return &params;
+    }
+};
+
 } // namespace
 
 /**************************************************************
@@ -255,33 +424,46 @@ void hnsw_search(
         FAISS_THROW_IF_NOT_MSG(params, "params type invalid");
         efSearch = params->efSearch;
     }
+    DeletedFilter deleted_filter;
+    params = deleted_filter.apply(*index, params);
     size_t n1 = 0, n2 = 0, ndis = 0, nhops = 0;
 
     idx_t check_period = InterruptCallback::get_period_hint(
             hnsw.max_level * index->d * efSearch);
 
+    SearchTrace* trace = params_in ? params_in->trace : nullptr;
+    SearchTraceScope trace_scope(trace, n);
+
     for (idx_t i0 = 0; i0 < n; i0 += check_period) {
         idx_t i1 = std::min(i0 + check_period, n);
 
 #pragma omp parallel if (i1 - i0 > 1)
         {
-            VisitedTable vt(index->ntotal);
+            VisitedTable vt = make_visited_table(*index, efSearch);
             typename BlockResultHandler::SingleResultHandler res(bres);
 
             std::unique_ptr<DistanceComputer> dis(
-                    storage_distance_computer(index->storage));
+                    search_distance_computer(*index));
 
 #pragma omp for reduction(+ : n1, n2, ndis, nhops) schedule(guided)
             for (idx_t i = i0; i < i1; i++) {
+                QueryTraceTimer timer(trace ? &trace->queries[i] : nullptr);
                 res.begin(i);
                 dis->set_query(x + i * index->d);
+                timer.step(QueryTrace::lut);
 
                 HNSWStats stats = hnsw.search(*dis, res, vt, params);
+                timer.step(QueryTrace::scan);
                 n1 += stats.n1;
                 n2 += stats.n2;
                 ndis += stats.ndis;
                 nhops += stats.nhops;
                 res.end();
+                timer.step(QueryTrace::heap);
+                if (timer.qt) {
+                    timer.qt->nlist += stats.nhops;
+                    timer.qt->ndis += stats.ndis;
+                }
             }
         }
         InterruptCallback::check();
@@ -338,6 +520,10 @@ void IndexHNSW::add(idx_t n, const float* x) {
             storage,
             "Please use IndexHNSWFlat (or variants) instead of IndexHNSW directly");
     FAISS_THROW_IF_NOT(is_trained);
+    if (hnsw.online) {
+        hnsw_add_vertices_online(*this, n, x);
+        return;
+    }
     int n0 = ntotal;
     storage->add(n, x);
     ntotal = storage->ntotal;
@@ -349,6 +535,298 @@ void IndexHNSW::reset() {
     hnsw.reset();
     storage->reset();
     ntotal = 0;
+    deleted.clear();
+    ndeleted = 0;
+    free_slots.clear();
+}
+
+/**************************************************************
+ * Deletion
+ **************************************************************/
+
+size_t IndexHNSW::mark_deleted(const IDSelector& sel) {
+    FAISS_THROW_IF_NOT_MSG(
+            !hnsw.online, "deletion is not supported in online mode");
+    if (deleted.size() < (ntotal + 7) / 8) {
+        deleted.resize((ntotal + 7) / 8, 0);
+    }
+    size_t nmarked = 0;
+    for (idx_t i = 0; i < ntotal; i++) {
+        if (!is_deleted(i) && sel.is_member(i)) {
+            deleted[i / 8] |= 1 << (i % 8);
+            nmarked++;
+        }
+    }
+    ndeleted += nmarked;
+    return nmarked;
+}
+
+size_t IndexHNSW::repair_deleted() {
+    return repair_deleted(nullptr);
+}
+
+size_t IndexHNSW::repair_deleted(const idx_t* storage_ids) {
+    FAISS_THROW_IF_NOT_MSG(
+            !hnsw.online, "deletion is not supported in online mode");
+    std::vector<bool> is_free(ntotal);
+    for (idx_t i : free_slots) {
+        is_free[i] = true;
+    }
+    std::vector<storage_idx_t> to_detach;
+    for (idx_t i = 0; i < ntotal; i++) {
+        if (is_deleted(i) && !is_free[i]) {
+            to_detach.push_back(i);
+        }
+    }
+    if (to_detach.empty()) {
+        return 0;
+    }
+    // the lists are written in the parallel region, where throwing is not
+    // possible
+    FAISS_THROW_IF_NOT_MSG(
+            hnsw.neighbors.is_owned,
+            "cannot repair a graph that is not owned (eg. memory-mapped)");
+    hnsw.clear_interleaved_level_0();
+    // read the tables through const references, the levels and offsets
+    // may still be views
+    const auto& levels = hnsw.levels;
+    const auto& offsets = hnsw.offsets;
+    const auto& neighbors = hnsw.neighbors;
+
+    // replace the deleted neighbors of each vertex with their own
+    // neighbors, and prune the result as when building. Only the lists of
+    // non-deleted vertices are written, and only the lists of deleted
+    // vertices are read from other vertices, so the loop is parallel.
+    for (int level = 0; level <= hnsw.max_level; level++) {
+#pragma omp parallel
+        {
+            std::unique_ptr<DistanceComputer> dis(
+                    storage_distance_computer(storage));
+            if (storage_ids) {
+                dis.reset(new RemappedDistanceComputer(
+                        dis.release(), storage_ids));
+            }
+            std::unordered_set<storage_idx_t> seen;
+
+#pragma omp for schedule(dynamic, 1024)
+            for (idx_t i = 0; i < ntotal; i++) {
+                if (is_deleted(i) || levels[i] <= level) {
+                    continue;
+                }
+                size_t begin, end;
+                hnsw.neighbor_range(i, level, &begin, &end);
+                bool has_deleted = false;
+                for (size_t j = begin; j < end; j++) {
+                    storage_idx_t v1 = neighbors[j];
+                    if (v1 < 0) {
+                        break;
+                    }
+                    if (is_deleted(v1)) {
+                        has_deleted = true;
+                        break;
+                    }
+                }
+                if (!has_deleted) {
+                    continue;
+                }
+
+                std::priority_queue<NodeDistFarther> candidates;
+                seen.clear();
+                seen.insert(i);
+                auto add_candidate = [&](storage_idx_t v) {
+                    if (!is_deleted(v) && seen.insert(v).second) {
+                        candidates.emplace(dis->symmetric_dis(i, v), v);
+                    }
+                };
+                for (size_t j = begin; j < end; j++) {
+                    storage_idx_t v1 = neighbors[j];
+                    if (v1 < 0) {
+                        break;
+                    }
+                    if (!is_deleted(v1)) {
+                        add_candidate(v1);
+                        continue;
+                    }
+                    size_t begin1, end1;
+                    hnsw.neighbor_range(v1, level, &begin1, &end1);
+                    for (size_t j1 = begin1; j1 < end1; j1++) {
+                        storage_idx_t v2 = neighbors[j1];
+                        if (v2 < 0) {
+                            break;
+                        }
+                        add_candidate(v2);
+                    }
+                }
+
+                std::vector<NodeDistFarther> shrunk_list;
+                HNSW::shrink_neighbor_list(
+                        *dis, candidates, shrunk_list, end - begin);
+
+                for (size_t j = begin; j < end; j++) {
+                    if (j - begin < shrunk_list.size())
+                        hnsw.neighbors[j] = shrunk_list[j - begin].id;
+                    else
+                        hnsw.neighbors[j] = -1;
+                }
+            }
+        }
+    }
+
+    // detach the deleted vertices
+    for (storage_idx_t i : to_detach) {
+        size_t begin = offsets[i], end = offsets[i + 1];
+        for (size_t j = begin; j < end; j++) {
+            hnsw.neighbors[j] = -1;
+        }
+        free_slots.push_back(i);
+    }
+
+    // elect a new entry point if needed
+    if (hnsw.entry_point >= 0 && is_deleted(hnsw.entry_point)) {
+        hnsw.entry_point = -1;
+        hnsw.max_level = -1;
+        for (idx_t i = 0; i < ntotal; i++) {
+            if (!is_deleted(i) && levels[i] - 1 > hnsw.max_level) {
+                hnsw.max_level = levels[i] - 1;
+                hnsw.entry_point = i;
+            }
+        }
+    }
+
+    return to_detach.size();
+}
+
+void IndexHNSW::add_reuse_slots(idx_t n, const float* x, idx_t* ids) {
+    FAISS_THROW_IF_NOT_MSG(
+            !hnsw.online, "deletion is not supported in online mode");
+    FAISS_THROW_IF_NOT(is_trained);
+    idx_t nreuse = std::min(n, idx_t(free_slots.size()));
+
+    if (nreuse > 0) {
+        auto flat_storage = dynamic_cast<IndexFlatCodes*>(storage);
+        FAISS_THROW_IF_NOT_MSG(
+                flat_storage,
+                "reusing slots requires an IndexFlatCodes storage");
+        if (auto storage_l2 = dynamic_cast<IndexFlatL2*>(storage)) {
+            storage_l2->clear_l2norms();
+        }
+        hnsw.clear_interleaved_level_0();
+
+        // overwrite the codes of the free slots
+        size_t code_size = flat_storage->code_size;
+        uint8_t* codes = flat_storage->codes.get_owned().data();
+        std::vector<uint8_t> new_codes(nreuse * code_size);
+        flat_storage->sa_encode(nreuse, x, new_codes.data());
+        for (idx_t i = 0; i < nreuse; i++) {
+            idx_t slot = free_slots.back();
+            free_slots.pop_back();
+            ids[i] = slot;
+            memcpy(codes + slot * code_size,
+                   new_codes.data() + i * code_size,
+                   code_size);
+            deleted[slot / 8] &= ~(1 << (slot % 8));
+        }
+        ndeleted -= nreuse;
+
+        // link them, the slots keep their level
+        std::vector<omp_lock_t> locks(ntotal);
+        for (idx_t i = 0; i < ntotal; i++) {
+            omp_init_lock(&locks[i]);
+        }
+        VisitedTable vt(ntotal);
+        std::unique_ptr<DistanceComputer> dis(
+                storage_distance_computer(storage));
+        for (idx_t i = 0; i < nreuse; i++) {
+            storage_idx_t pt_id = ids[i];
+            int pt_level = hnsw.levels[pt_id] - 1;
+            dis->set_query(x + i * d);
+            hnsw.add_with_locks(
+                    *dis,
+                    pt_level,
+                    pt_id,
+                    locks,
+                    vt,
+                    keep_max_size_level0 && (pt_level == 0));
+        }
+        for (idx_t i = 0; i < ntotal; i++) {
+            omp_destroy_lock(&locks[i]);
+        }
+    }
+
+    if (nreuse < n) {
+        idx_t n0 = ntotal;
+        add(n - nreuse, x + nreuse * d);
+        for (idx_t i = nreuse; i < n; i++) {
+            ids[i] = n0 + i - nreuse;
+        }
+    }
+}
+
+void IndexHNSW::compact_deleted() {
+    if (ndeleted == 0) {
+        return;
+    }
+    // the checks of repair_deleted, done before anything is modified
+    FAISS_THROW_IF_NOT_MSG(
+            !hnsw.online, "deletion is not supported in online mode");
+    FAISS_THROW_IF_NOT_MSG(
+            hnsw.neighbors.is_owned || free_slots.size() == size_t(ndeleted),
+            "cannot repair a graph that is not owned (eg. memory-mapped)");
+
+    // the remaining vectors first, then the deleted ones
+    std::vector<idx_t> perm;
+    perm.reserve(ntotal);
+    for (idx_t i = 0; i < ntotal; i++) {
+        if (!is_deleted(i)) {
+            perm.push_back(i);
+        }
+    }
+    idx_t nremain = perm.size();
+    for (idx_t i = 0; i < ntotal; i++) {
+        if (is_deleted(i)) {
+            perm.push_back(i);
+        }
+    }
+
+    // the storage keeps the order of the remaining vectors. It is compacted
+    // first so that a storage that does not support removal leaves the
+    // graph untouched
+    IDSelectorBitmap sel(deleted.size(), deleted.data());
+    size_t nremove = storage->remove_ids(sel);
+    FAISS_THROW_IF_NOT(nremove == ntotal - nremain);
+
+    // the graph is repaired with the remaining vectors at their new ids
+    std::vector<idx_t> storage_ids(ntotal, -1);
+    for (idx_t i = 0; i < nremain; i++) {
+        storage_ids[perm[i]] = i;
+    }
+    repair_deleted(storage_ids.data());
+
+    hnsw.permute_entries(perm.data());
+    hnsw.levels.resize(nremain);
+    hnsw.offsets.resize(nremain + 1);
+    hnsw.neighbors.resize(hnsw.offsets.back());
+    ntotal = nremain;
+
+    deleted.clear();
+    ndeleted = 0;
+    free_slots.clear();
+}
+
+size_t IndexHNSW::remove_ids(const IDSelector& sel) {
+    idx_t ntotal0 = ntotal;
+    // if the compaction fails, the marks are restored
+    std::vector<uint8_t> deleted0 = deleted;
+    idx_t ndeleted0 = ndeleted;
+    mark_deleted(sel);
+    try {
+        compact_deleted();
+    } catch (...) {
+        deleted = std::move(deleted0);
+        ndeleted = ndeleted0;
+        throw;
+    }
+    return ntotal0 - ntotal;
 }
 
 void IndexHNSW::reconstruct(idx_t key, float* recons) const {
@@ -356,6 +834,7 @@ void IndexHNSW::reconstruct(idx_t key, float* recons) const {
 }
 
 void IndexHNSW::shrink_level_0_neighbors(int new_size) {
+    hnsw.clear_interleaved_level_0();
 #pragma omp parallel
     {
         std::unique_ptr<DistanceComputer> dis(
@@ -411,8 +890,8 @@ void IndexHNSW::search_level_0(
         params = dynamic_cast<const SearchParametersHNSW*>(params_in);
         FAISS_THROW_IF_NOT_MSG(params, "params type invalid");
     }
-
-    storage_idx_t ntotal = hnsw.levels.size();
+    DeletedFilter deleted_filter;
+    params = deleted_filter.apply(*this, params);
 
     using RH = HeapBlockResultHandler<HNSW::C>;
     RH bres(n, distances, labels, k);
@@ -420,9 +899,10 @@ void IndexHNSW::search_level_0(
 #pragma omp parallel
     {
         std::unique_ptr<DistanceComputer> qdis(
-                storage_distance_computer(storage));
+                search_distance_computer(*this));
         HNSWStats search_stats;
-        VisitedTable vt(ntotal);
+        VisitedTable vt = make_visited_table(
+                *this, params ? params->efSearch : hnsw.efSearch);
         RH::SingleResultHandler res(bres);
 
 #pragma omp for
@@ -460,6 +940,7 @@ void IndexHNSW::init_level_0_from_knngraph(
         const float* D,
         const idx_t* I) {
     int dest_size = hnsw.nb_neighbors(0);
+    hnsw.clear_interleaved_level_0();
 
 #pragma omp parallel for
     for (idx_t i = 0; i < ntotal; i++) {
@@ -498,6 +979,7 @@ void IndexHNSW::init_level_0_from_entry_points(
         int n,
         const storage_idx_t* points,
         const storage_idx_t* nearests) {
+    hnsw.clear_interleaved_level_0();
     std::vector<omp_lock_t> locks(ntotal);
     for (int i = 0; i < ntotal; i++)
         omp_init_lock(&locks[i]);
@@ -535,6 +1017,7 @@ void IndexHNSW::init_level_0_from_entry_points(
 }
 
 void IndexHNSW::reorder_links() {
+    hnsw.clear_interleaved_level_0();
     int M = hnsw.nb_neighbors(0);
 
 #pragma omp parallel
@@ -606,11 +1089,70 @@ void IndexHNSW::link_singletons() {
 }
 
 void IndexHNSW::permute_entries(const idx_t* perm) {
+    // hnsw.permute_entries drops the interleaved level 0
     auto flat_storage = dynamic_cast<IndexFlatCodes*>(storage);
     FAISS_THROW_IF_NOT_MSG(
             flat_storage, "don't know how to permute this index");
+    FAISS_THROW_IF_NOT_MSG(!hnsw.online, "not supported in online mode");
     flat_storage->permute_entries(perm);
     hnsw.permute_entries(perm);
+    if (ndeleted > 0) {
+        // vectors may have been added after the last mark_deleted
+        std::vector<uint8_t> new_deleted((ntotal + 7) / 8);
+        std::vector<idx_t> imap(ntotal);
+        for (idx_t i = 0; i < ntotal; i++) {
+            imap[perm[i]] = i;
+            if (is_deleted(perm[i])) {
+                new_deleted[i / 8] |= 1 << (i % 8);
+            }
+        }
+        deleted = std::move(new_deleted);
+        for (idx_t& slot : free_slots) {
+            slot = imap[slot];
+        }
+    }
+}
+
+void IndexHNSW::set_interleaved_level_0(bool with_codes) {
+    FAISS_THROW_IF_NOT(hnsw.levels.size() == ntotal);
+    FAISS_THROW_IF_NOT_MSG(
+            !hnsw.online,
+            "the interleaved level 0 is not supported in online mode");
+    if (!with_codes) {
+        hnsw.build_interleaved_level_0(nullptr, 0);
+        return;
+    }
+    auto flat_storage = dynamic_cast<const IndexFlatCodes*>(storage);
+    FAISS_THROW_IF_NOT_MSG(
+            flat_storage, "interleaved codes require an IndexFlatCodes storage");
+    std::unique_ptr<DistanceComputer> dis(storage_distance_computer(storage));
+    FlatCodesDistanceComputer* fdis = get_flat_codes_dis(dis.get());
+    FAISS_THROW_IF_NOT_MSG(
+            fdis && fdis->codes == flat_storage->codes.data() &&
+                    fdis->code_size == flat_storage->code_size,
+            "storage distance computer does not read the flat codes");
+    hnsw.build_interleaved_level_0(
+            flat_storage->codes.data(), flat_storage->code_size);
+}
+
+void IndexHNSW::set_online_mode(idx_t capacity) {
+    if (capacity == 0) {
+        hnsw.set_online(0);
+        return;
+    }
+    FAISS_THROW_IF_NOT(hnsw.levels.size() == ntotal);
+    auto flat_storage = dynamic_cast<IndexFlatCodes*>(storage);
+    FAISS_THROW_IF_NOT_MSG(
+            flat_storage, "online mode requires an IndexFlatCodes storage");
+    FAISS_THROW_IF_NOT(capacity >= ntotal);
+    // cached norms would not be updated by the additions
+    if (auto storage_l2 = dynamic_cast<IndexFlatL2*>(storage)) {
+        storage_l2->clear_l2norms();
+    }
+    // the codes must not move when vectors are added
+    flat_storage->codes.to_owned();
+    flat_storage->codes.reserve(capacity * flat_storage->code_size);
+    hnsw.set_online(capacity);
 }
 
 DistanceComputer* IndexHNSW::get_distance_computer() const {
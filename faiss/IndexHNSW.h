@@ -46,6 +46,17 @@ struct IndexHNSW : Index {
     // used when GpuIndexCagra::copyFrom(IndexHNSWCagra*) is invoked.
     bool keep_max_size_level0 = false;
 
+    /// bitmap of the vectors marked as deleted (see mark_deleted), empty
+    /// if there are none
+    std::vector<uint8_t> deleted;
+
+    /// number of vectors marked as deleted
+    idx_t ndeleted = 0;
+
+    /// deleted vectors that have been detached from the graph by
+    /// repair_deleted, their slots can be reused by add_reuse_slots
+    std::vector<idx_t> free_slots;
+
     explicit IndexHNSW(int d = 0, int M = 32, MetricType metric = METRIC_L2);
     explicit IndexHNSW(Index* storage, int M = 32);
 
@@ -76,6 +87,50 @@ struct IndexHNSW : Index {
 
     void reset() override;
 
+    /** Remove the selected vectors and renumber the remaining ones, as
+     * for other indexes. The graph is repaired around the removed
+     * vectors, so this is much cheaper than a rebuild. Vectors previously
+     * marked as deleted are removed as well.
+     */
+    size_t remove_ids(const IDSelector& sel) override;
+
+    /** Mark vectors as deleted (tombstones). They are not returned by
+     * searches anymore but the graph still goes through them, and the
+     * ids of the other vectors do not change.
+     *
+     * @return number of vectors that were not already deleted
+     */
+    size_t mark_deleted(const IDSelector& sel);
+
+    bool is_deleted(idx_t i) const {
+        return size_t(i / 8) < deleted.size() && (deleted[i / 8] >> (i % 8)) & 1;
+    }
+
+    /** Reconnect the neighbors of the deleted vectors to each other and
+     * detach the deleted vectors from the graph. This can be run
+     * periodically to keep the recall stable under heavy churn. The slots
+     * of the detached vectors are added to free_slots.
+     *
+     * @return number of vectors detached
+     */
+    size_t repair_deleted();
+
+    /** same, with vector i of the graph read from the storage at
+     * storage_ids[i] (used by compact_deleted, where the storage is
+     * compacted before the graph)
+     */
+    size_t repair_deleted(const idx_t* storage_ids);
+
+    /** Add vectors in the free slots left by repair_deleted, the vectors
+     * that do not fit are appended as in add().
+     *
+     * @param ids  output ids of the vectors, size n
+     */
+    void add_reuse_slots(idx_t n, const float* x, idx_t* ids);
+
+    /// remove the deleted vectors and renumber the remaining ones
+    void compact_deleted();
+
     void shrink_level_0_neighbors(int size);
 
     /** Perform search only on level 0, given the starting points for
@@ -112,6 +167,31 @@ struct IndexHNSW : Index {
 
     void permute_entries(const idx_t* perm);
 
+    /** Build a cache-friendly copy of level 0 for search, where each
+     * vertex's level-0 neighbors and (if with_codes) its code are stored
+     * in a single 64-byte aligned block, see HNSW::level0_blocks. With
+     * codes, this duplicates the storage codes, and requires a storage
+     * that is an IndexFlatCodes.
+     *
+     * The copy is dropped when the index is modified, call this again
+     * after adding vectors or loading the index.
+     */
+    void set_interleaved_level_0(bool with_codes = true);
+
+    /** Switch to online mode, where add() and search() can be called
+     * concurrently from different threads, eg. one thread ingests vectors
+     * while others serve queries. Vectors are searchable as soon as add()
+     * has linked them into the graph, there is no global writer lock.
+     *
+     * The storage (an IndexFlatCodes) and the graph tables are reserved
+     * for capacity vectors so that additions do not move them, adding
+     * beyond capacity throws. Other modifications of the index must not
+     * run concurrently with searches. capacity = 0 switches back to the
+     * offline mode. While additions run, read the number of vectors from
+     * hnsw.online->ntotal rather than from ntotal.
+     */
+    void set_online_mode(idx_t capacity);
+
     DistanceComputer* get_distance_computer() const override;
 };
 
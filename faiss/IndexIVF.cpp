@@ -20,6 +20,8 @@
 #include <limits>
 #include <memory>
 
+#include <faiss/utils/distances.h>
+#include <faiss/utils/distances_fused/distances_fused.h>
 #include <faiss/utils/hamming.h>
 #include <faiss/utils/utils.h>
 
@@ -28,6 +30,7 @@
 #include <faiss/impl/CodePacker.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
+#include <faiss/impl/SearchTrace.h>
 
 namespace faiss {
 
@@ -319,6 +322,7 @@ void IndexIVF::search(
         std::unique_ptr<float[]> coarse_dis(new float[n * nprobe]);
 
         double t0 = getmillisecs();
+        uint64_t c0 = ivf_stats->query_traces ? get_cycles() : 0;
         quantizer->search(
                 n,
                 x,
@@ -328,7 +332,20 @@ void IndexIVF::search(
                 params ? params->quantizer_params : nullptr);
 
         double t1 = getmillisecs();
+        uint64_t c1 = ivf_stats->query_traces ? get_cycles() : 0;
         invlists->prefetch_lists(idx.get(), n * nprobe);
+        if (ivf_stats->query_traces) {
+            SearchTrace::add_block(
+                    ivf_stats->query_traces,
+                    n,
+                    QueryTrace::coarse_quantization,
+                    c1 - c0);
+            SearchTrace::add_block(
+                    ivf_stats->query_traces,
+                    n,
+                    QueryTrace::io_wait,
+                    get_cycles() - c1);
+        }
 
         search_preassigned(
                 n,
@@ -346,6 +363,9 @@ void IndexIVF::search(
         ivf_stats->search_time += t2 - t0;
     };
 
+    SearchTrace* trace = params ? params->trace : nullptr;
+    SearchTraceScope trace_scope(trace, n);
+
     if ((parallel_mode & ~PARALLEL_MODE_NO_HEAP_INIT) == 0) {
         int nt = std::min(omp_get_max_threads(), int(n));
         std::vector<IndexIVFStats> stats(nt);
@@ -357,6 +377,9 @@ void IndexIVF::search(
             IndexIVFStats local_stats;
             idx_t i0 = n * slice / nt;
             idx_t i1 = n * (slice + 1) / nt;
+            if (trace) {
+                stats[slice].query_traces = trace->queries.data() + i0;
+            }
             if (i1 > i0) {
                 try {
                     sub_search_func(
@@ -383,7 +406,12 @@ void IndexIVF::search(
     } else {
         // handle parallelization at level below (or don't run in parallel at
         // all)
-        sub_search_func(n, x, distances, labels, &indexIVF_stats);
+        IndexIVFStats stats;
+        if (trace) {
+            stats.query_traces = trace->queries.data();
+        }
+        sub_search_func(n, x, distances, labels, &stats);
+        indexIVF_stats.add(stats);
     }
 }
 
@@ -426,6 +454,14 @@ void IndexIVF::search_preassigned(
 
     size_t nlistv = 0, ndis = 0, nheap = 0;
 
+    // per-query traces, filled in only by the query-major parallel modes
+    SearchTrace* trace = params ? params->trace : nullptr;
+    QueryTrace* query_traces = ivf_stats ? ivf_stats->query_traces : nullptr;
+    SearchTraceScope trace_scope(query_traces ? nullptr : trace, n);
+    if (!query_traces && trace) {
+        query_traces = trace->queries.data();
+    }
+
     using HeapForIP = CMin<float, idx_t>;
     using HeapForL2 = CMax<float, idx_t>;
 
@@ -450,13 +486,63 @@ void IndexIVF::search_preassigned(
                      : pmode == 1 ? nprobe > 1
                                   : nprobe * n > 1);
 
+    // for the list-major mode: the (query, probe) pairs of each list
+    // in CSR format, and the order in which the lists are scanned
+    std::vector<size_t> list_lims;
+    std::vector<idx_t> list_probes;
+    std::vector<idx_t> list_order;
+    std::unique_ptr<std::mutex[]> query_locks;
+
+    if (pmode == 4) {
+        FAISS_THROW_IF_NOT_MSG(
+                !invlists->use_iterator,
+                "parallel_mode 4 not supported for iterable inverted lists");
+        list_lims.resize(nlist + 1, 0);
+        for (idx_t ij = 0; ij < n * nprobe; ij++) {
+            idx_t key = keys[ij];
+            if (key < 0) {
+                continue;
+            }
+            FAISS_THROW_IF_NOT_FMT(
+                    key < (idx_t)nlist,
+                    "Invalid key=%" PRId64 " nlist=%zd\n",
+                    key,
+                    nlist);
+            list_lims[key + 1]++;
+        }
+        for (size_t l = 0; l < nlist; l++) {
+            list_lims[l + 1] += list_lims[l];
+        }
+        list_probes.resize(list_lims[nlist]);
+        std::vector<size_t> ofs(list_lims.begin(), list_lims.end() - 1);
+        for (idx_t ij = 0; ij < n * nprobe; ij++) {
+            if (keys[ij] >= 0) {
+                list_probes[ofs[keys[ij]]++] = ij;
+            }
+        }
+        // largest amount of work first, for a better load balancing
+        std::vector<size_t> work(nlist);
+        for (size_t l = 0; l < nlist; l++) {
+            size_t nq_l = list_lims[l + 1] - list_lims[l];
+            if (nq_l > 0) {
+                work[l] = nq_l * invlists->list_size(l);
+                list_order.push_back(l);
+            }
+        }
+        std::sort(
+                list_order.begin(),
+                list_order.end(),
+                [&work](idx_t a, idx_t b) { return work[a] > work[b]; });
+        query_locks.reset(new std::mutex[n]);
+    }
+
     void* inverted_list_context =
             params ? params->inverted_list_context : nullptr;
 
 #pragma omp parallel if (do_parallel) reduction(+ : nlistv, ndis, nheap)
     {
         std::unique_ptr<InvertedListScanner> scanner(
-                get_InvertedListScanner(store_pairs, sel));
+                get_InvertedListScanner(store_pairs, sel, params));
 
         /*****************************************************
          * Depending on parallel_mode, there are two possible ways
@@ -499,11 +585,14 @@ void IndexIVF::search_preassigned(
 
         // single list scan using the current scanner (with query
         // set porperly) and storing results in simi and idxi
+        QueryTraceTimer no_trace(nullptr);
+
         auto scan_one_list = [&](idx_t key,
                                  float coarse_dis_i,
                                  float* simi,
                                  idx_t* idxi,
-                                 idx_t list_size_max) {
+                                 idx_t list_size_max,
+                                 QueryTraceTimer& timer) {
             if (key < 0) {
                 // not enough centroids for multiprobe
                 return (size_t)0;
@@ -520,6 +609,7 @@ void IndexIVF::search_preassigned(
             }
 
             scanner->set_list(key, coarse_dis_i);
+            timer.step(QueryTrace::lut);
 
             nlistv++;
 
@@ -529,9 +619,11 @@ void IndexIVF::search_preassigned(
 
                     std::unique_ptr<InvertedListsIterator> it(
                             invlists->get_iterator(key, inverted_list_context));
+                    timer.step(QueryTrace::io_wait);
 
                     nheap += scanner->iterate_codes(
                             it.get(), simi, idxi, k, list_size);
+                    timer.step(QueryTrace::scan);
 
                     return list_size;
                 } else {
@@ -551,6 +643,7 @@ void IndexIVF::search_preassigned(
                                 invlists, key);
                         ids = sids->get();
                     }
+                    timer.step(QueryTrace::io_wait);
 
                     if (selr) { // IDSelectorRange
                         // restrict search to a section of the inverted list
@@ -567,6 +660,7 @@ void IndexIVF::search_preassigned(
 
                     nheap += scanner->scan_codes(
                             list_size, codes, ids, simi, idxi, k);
+                    timer.step(QueryTrace::scan);
 
                     return list_size;
                 }
@@ -591,13 +685,18 @@ void IndexIVF::search_preassigned(
                 }
 
                 // loop over queries
+                QueryTraceTimer timer(
+                        query_traces ? query_traces + i : nullptr);
                 scanner->set_query(x + i * d);
+                timer.step(QueryTrace::lut);
                 float* simi = distances + i * k;
                 idx_t* idxi = labels + i * k;
 
                 init_result(simi, idxi);
+                timer.step(QueryTrace::heap);
 
                 idx_t nscan = 0;
+                size_t nlistv0 = nlistv;
 
                 // loop over probes
                 for (size_t ik = 0; ik < nprobe; ik++) {
@@ -606,7 +705,8 @@ void IndexIVF::search_preassigned(
                             coarse_dis[i * nprobe + ik],
                             simi,
                             idxi,
-                            max_codes - nscan);
+                            max_codes - nscan,
+                            timer);
                     if (nscan >= max_codes) {
                         break;
                     }
@@ -614,6 +714,11 @@ void IndexIVF::search_preassigned(
 
                 ndis += nscan;
                 reorder_result(simi, idxi);
+                timer.step(QueryTrace::heap);
+                if (timer.qt) {
+                    timer.qt->nlist += nlistv - nlistv0;
+                    timer.qt->ndis += nscan;
+                }
 
                 if (InterruptCallback::is_interrupted()) {
                     interrupt = true;
@@ -635,7 +740,8 @@ void IndexIVF::search_preassigned(
                             coarse_dis[i * nprobe + ik],
                             local_dis.data(),
                             local_idx.data(),
-                            unlimited_list_size);
+                            unlimited_list_size,
+                            no_trace);
 
                     // can't do the test on max_codes
                 }
@@ -676,7 +782,8 @@ void IndexIVF::search_preassigned(
                         coarse_dis[ij],
                         local_dis.data(),
                         local_idx.data(),
-                        unlimited_list_size);
+                        unlimited_list_size,
+                        no_trace);
 #pragma omp critical
                 {
                     add_local_results(
@@ -690,6 +797,176 @@ void IndexIVF::search_preassigned(
             for (int64_t i = 0; i < n; i++) {
                 reorder_result(distances + i * k, labels + i * k);
             }
+        } else if (pmode == 4) {
+            // the lists are scanned by tiles of tile_bytes. The tile loop
+            // is the outer loop, so that each tile is read from memory once
+            // and stays in cache while it is compared with all the queries
+            // of the list
+            const size_t tile_bytes = 256 * 1024;
+            std::vector<float> local_dis;
+            std::vector<idx_t> local_idx;
+            std::vector<idx_t> qnos;
+            std::vector<float> qcoarse_dis;
+            // compares a tile with all the queries at once, if the index
+            // has one
+            std::unique_ptr<InvertedListBlockScanner> block_scanner(
+                    get_InvertedListBlockScanner(store_pairs, sel, params));
+            // otherwise, when a list has several tiles, each query has its
+            // own scanner, so that set_query and set_list (eg. the IVFPQ
+            // look-up tables) run once per (query, list) pair
+            std::vector<std::unique_ptr<InvertedListScanner>> query_scanners;
+
+#pragma omp for
+            for (idx_t i = 0; i < n; i++) {
+                init_result(distances + i * k, labels + i * k);
+            }
+
+#pragma omp for schedule(dynamic)
+            for (idx_t lo = 0; lo < (idx_t)list_order.size(); lo++) {
+                if (interrupt) {
+                    continue;
+                }
+                idx_t key = list_order[lo];
+                if (invlists->is_empty(key, inverted_list_context)) {
+                    continue;
+                }
+                const idx_t* probes = list_probes.data() + list_lims[key];
+                size_t nq_l = list_lims[key + 1] - list_lims[key];
+
+                try {
+                    size_t list_size = invlists->list_size(key);
+                    InvertedLists::ScopedCodes scodes(invlists, key);
+                    const uint8_t* codes = scodes.get();
+
+                    std::unique_ptr<InvertedLists::ScopedIds> sids;
+                    const idx_t* ids = nullptr;
+
+                    if (!store_pairs) {
+                        sids = std::make_unique<InvertedLists::ScopedIds>(
+                                invlists, key);
+                        ids = sids->get();
+                    }
+
+                    if (selr) { // IDSelectorRange
+                        size_t jmin, jmax;
+                        selr->find_sorted_ids_bounds(
+                                list_size, ids, &jmin, &jmax);
+                        list_size = jmax - jmin;
+                        codes += jmin * code_size;
+                        ids += jmin;
+                    }
+
+                    local_dis.resize(nq_l * k);
+                    local_idx.resize(nq_l * k);
+                    for (size_t qi = 0; qi < nq_l; qi++) {
+                        if (metric_type == METRIC_INNER_PRODUCT) {
+                            heap_heapify<HeapForIP>(
+                                    k, &local_dis[qi * k], &local_idx[qi * k]);
+                        } else {
+                            heap_heapify<HeapForL2>(
+                                    k, &local_dis[qi * k], &local_idx[qi * k]);
+                        }
+                    }
+
+                    if (block_scanner) {
+                        qnos.resize(nq_l);
+                        qcoarse_dis.resize(nq_l);
+                        for (size_t qi = 0; qi < nq_l; qi++) {
+                            qnos[qi] = probes[qi] / nprobe;
+                            qcoarse_dis[qi] = coarse_dis[probes[qi]];
+                        }
+                        block_scanner->set_list(
+                                key, nq_l, x, qnos.data(), qcoarse_dis.data());
+                        size_t tile_size =
+                                std::max(tile_bytes / code_size, size_t(1));
+                        for (size_t j0 = 0; j0 < list_size; j0 += tile_size) {
+                            size_t j1 = std::min(j0 + tile_size, list_size);
+                            nheap += block_scanner->scan_codes(
+                                    j1 - j0,
+                                    j0,
+                                    codes + j0 * code_size,
+                                    ids ? ids + j0 : nullptr,
+                                    local_dis.data(),
+                                    local_idx.data(),
+                                    k);
+                        }
+                    } else {
+                        // store_pairs needs the offsets in the whole list
+                        size_t tile_size = store_pairs
+                                ? list_size
+                                : std::max(tile_bytes / code_size, size_t(1));
+                        bool one_tile = list_size <= tile_size;
+                        while (!one_tile && query_scanners.size() < nq_l) {
+                            query_scanners.emplace_back(get_InvertedListScanner(
+                                    store_pairs, sel, params));
+                        }
+                        auto set_query_list = [&](InvertedListScanner* sc,
+                                                  size_t qi) {
+                            idx_t ij = probes[qi];
+                            sc->set_query(x + (ij / nprobe) * d);
+                            sc->set_list(key, coarse_dis[ij]);
+                        };
+                        if (one_tile) {
+                            InvertedListScanner* sc = scanner.get();
+                            for (size_t qi = 0; qi < nq_l; qi++) {
+                                set_query_list(sc, qi);
+                                nheap += sc->scan_codes(
+                                        list_size,
+                                        codes,
+                                        ids,
+                                        &local_dis[qi * k],
+                                        &local_idx[qi * k],
+                                        k);
+                            }
+                        } else {
+                            for (size_t qi = 0; qi < nq_l; qi++) {
+                                set_query_list(query_scanners[qi].get(), qi);
+                            }
+                            for (size_t j0 = 0; j0 < list_size;
+                                 j0 += tile_size) {
+                                size_t j1 = std::min(j0 + tile_size, list_size);
+                                for (size_t qi = 0; qi < nq_l; qi++) {
+                                    nheap += query_scanners[qi]->scan_codes(
+                                            j1 - j0,
+                                            codes + j0 * code_size,
+                                            ids ? ids + j0 : nullptr,
+                                            &local_dis[qi * k],
+                                            &local_idx[qi * k],
+                                            k);
+                                }
+                            }
+                        }
+                    }
+
+                    // merge into the result heaps of the queries
+                    for (size_t qi = 0; qi < nq_l; qi++) {
+                        idx_t i = probes[qi] / nprobe;
+                        std::lock_guard<std::mutex> lock(query_locks[i]);
+                        add_local_results(
+                                &local_dis[qi * k],
+                                &local_idx[qi * k],
+                                distances + i * k,
+                                labels + i * k);
+                    }
+                    nlistv += nq_l;
+                    ndis += nq_l * list_size;
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    exception_string =
+                            demangle_cpp_symbol(typeid(e).name()) + "  " +
+                            e.what();
+                    interrupt = true;
+                }
+
+                if (InterruptCallback::is_interrupted()) {
+                    interrupt = true;
+                }
+            }
+
+#pragma omp for
+            for (idx_t i = 0; i < n; i++) {
+                reorder_result(distances + i * k, labels + i * k);
+            }
         } else {
             FAISS_THROW_FMT("parallel_mode %d not supported\n", pmode);
         }
@@ -797,7 +1074,7 @@ void IndexIVF::range_search_preassigned(
     {
         RangeSearchPartialResult pres(result);
         std::unique_ptr<InvertedListScanner> scanner(
-                get_InvertedListScanner(store_pairs, sel));
+                get_InvertedListScanner(store_pairs, sel, params));
         FAISS_THROW_IF_NOT(scanner.get());
         all_pres[omp_get_thread_num()] = &pres;
 
@@ -913,10 +1190,18 @@ void IndexIVF::range_search_preassigned(
 
 InvertedListScanner* IndexIVF::get_InvertedListScanner(
         bool /*store_pairs*/,
-        const IDSelector* /* sel */) const {
+        const IDSelector* /* sel */,
+        const IVFSearchParameters* /* params */) const {
     FAISS_THROW_MSG("get_InvertedListScanner not implemented");
 }
 
+InvertedListBlockScanner* IndexIVF::get_InvertedListBlockScanner(
+        bool /*store_pairs*/,
+        const IDSelector* /* sel */,
+        const IVFSearchParameters* /* params */) const {
+    return nullptr;
+}
+
 void IndexIVF::reconstruct(idx_t key, float* recons) const {
     idx_t lo = direct_map.get(key);
     reconstruct_from_offset(lo_listno(lo), lo_offset(lo), recons);
@@ -1257,6 +1542,8 @@ IndexIVF::~IndexIVF() {
     }
 }
 
+SearchParametersIVF::~SearchParametersIVF() = default;
+
 /*************************************************************************
  * IndexIVFStats
  *************************************************************************/
@@ -1384,4 +1671,113 @@ void InvertedListScanner::iterate_codes_range(
     }
 }
 
+/*************************************************************************
+ * InvertedListBlockScannerFloat
+ *************************************************************************/
+
+InvertedListBlockScannerFloat::InvertedListBlockScannerFloat(
+        size_t d,
+        MetricType metric,
+        bool store_pairs,
+        const IDSelector* sel)
+        : InvertedListBlockScanner(store_pairs, sel), d(d), metric(metric) {
+    FAISS_THROW_IF_NOT(
+            metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    keep_max = is_similarity_metric(metric);
+}
+
+namespace {
+
+template <class C>
+size_t scan_tile_float(
+        InvertedListBlockScannerFloat& bs,
+        size_t n,
+        size_t j0,
+        const float* y,
+        const idx_t* ids,
+        float* distances,
+        idx_t* labels,
+        size_t k) {
+    size_t nq = bs.accu0.size();
+    size_t d = bs.d;
+    const float* xq = bs.xq.data();
+    size_t nup = 0;
+
+    // the fused kernels keep the k best codes of the tile for each query,
+    // which are then added to the heaps of the queries. This does not work
+    // with a selector, that must be applied before.
+    if (!bs.sel) {
+        bs.tile_dis.resize(nq * k);
+        bs.tile_ids.resize(nq * k);
+        HeapBlockResultHandler<C> res(
+                nq, bs.tile_dis.data(), bs.tile_ids.data(), k);
+        bool done;
+        if constexpr (C::is_max) {
+            done = exhaustive_L2sqr_fused_heap(xq, y, d, nq, n, res, nullptr);
+        } else {
+            done = exhaustive_inner_product_fused_heap(xq, y, d, nq, n, res);
+        }
+        if (done) {
+            for (size_t q = 0; q < nq; q++) {
+                float* simi = distances + q * k;
+                idx_t* idxi = labels + q * k;
+                // the tile results are sorted, best first
+                for (size_t r = 0; r < k; r++) {
+                    idx_t j = bs.tile_ids[q * k + r];
+                    float dis = bs.accu0[q] + bs.tile_dis[q * k + r];
+                    if (j < 0 || !C::cmp(simi[0], dis)) {
+                        break;
+                    }
+                    idx_t id = bs.store_pairs ? lo_build(bs.list_no, j0 + j)
+                                              : ids[j];
+                    heap_replace_top<C>(k, simi, idxi, dis, id);
+                    nup++;
+                }
+            }
+            return nup;
+        }
+    }
+
+    // each code is loaded once and compared with all the queries
+    for (size_t j = 0; j < n; j++) {
+        if (bs.sel && !bs.sel->is_member(ids[j])) {
+            continue;
+        }
+        const float* yj = y + j * d;
+        for (size_t q = 0; q < nq; q++) {
+            float* simi = distances + q * k;
+            float dis = bs.accu0[q] +
+                    (C::is_max ? fvec_L2sqr(xq + q * d, yj, d)
+                               : fvec_inner_product(xq + q * d, yj, d));
+            if (C::cmp(simi[0], dis)) {
+                idx_t id = bs.store_pairs ? lo_build(bs.list_no, j0 + j)
+                                          : ids[j];
+                heap_replace_top<C>(k, simi, labels + q * k, dis, id);
+                nup++;
+            }
+        }
+    }
+    return nup;
+}
+
+} // namespace
+
+size_t InvertedListBlockScannerFloat::scan_codes(
+        size_t n,
+        size_t j0,
+        const uint8_t* codes,
+        const idx_t* ids,
+        float* distances,
+        idx_t* labels,
+        size_t k) {
+    const float* y = decode_tile(n, codes);
+    if (metric == METRIC_INNER_PRODUCT) {
+        return scan_tile_float<CMin<float, idx_t>>(
+                *this, n, j0, y, ids, distances, labels, k);
+    } else {
+        return scan_tile_float<CMax<float, idx_t>>(
+                *this, n, j0, y, ids, distances, labels, k);
+    }
+}
+
 } // namespace faiss
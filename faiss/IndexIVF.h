@@ -75,14 +75,16 @@ struct SearchParametersIVF : SearchParameters {
     /// context object to pass to InvertedLists
     void* inverted_list_context = nullptr;
 
-    virtual ~SearchParametersIVF() {}
+    virtual ~SearchParametersIVF();
 };
 
 // the new convention puts the index type after SearchParameters
 using IVFSearchParameters = SearchParametersIVF;
 
 struct InvertedListScanner;
+struct InvertedListBlockScanner;
 struct IndexIVFStats;
+struct QueryTrace;
 struct CodePacker;
 
 struct IndexIVFInterface : Level1Quantizer {
@@ -186,6 +188,11 @@ struct IndexIVF : Index, IndexIVFInterface {
      * 1: parallelize over inverted lists
      * 2: parallelize over both
      * 3: split over queries with a finer granularity
+     * 4: list-major: each inverted list is scanned once for all the
+     *    queries that probe it (parallelized over lists), which is
+     *    more cache-friendly for large query batches. IndexIVFFlat and
+     *    IndexIVFScalarQuantizer compare each tile of a list with all the
+     *    queries in a blocked kernel (see InvertedListBlockScanner)
      *
      * PARALLEL_MODE_NO_HEAP_INIT: binary or with the previous to
      * prevent the heap to be initialized and finalized
@@ -311,11 +318,22 @@ struct IndexIVF : Index, IndexIVFInterface {
 
     /** Get a scanner for this index (store_pairs means ignore labels)
      *
-     * The default search implementation uses this to compute the distances
+     * The default search implementation uses this to compute the distances.
+     * params are the search parameters, that can have index-specific fields
      */
     virtual InvertedListScanner* get_InvertedListScanner(
             bool store_pairs = false,
-            const IDSelector* sel = nullptr) const;
+            const IDSelector* sel = nullptr,
+            const IVFSearchParameters* params = nullptr) const;
+
+    /** Get a scanner that compares a tile of codes with a block of queries
+     * at once, used by parallel_mode 4. The default returns nullptr, then
+     * the queries are scanned one by one with get_InvertedListScanner.
+     */
+    virtual InvertedListBlockScanner* get_InvertedListBlockScanner(
+            bool store_pairs = false,
+            const IDSelector* sel = nullptr,
+            const IVFSearchParameters* params = nullptr) const;
 
     /** reconstruct a vector. Works only if maintain_direct_map is set to 1 or 2
      */
@@ -527,6 +545,95 @@ struct InvertedListScanner {
     virtual ~InvertedListScanner() {}
 };
 
+/** Scans an inverted list for all the queries that probe it (parallel_mode
+ * 4). The list is scanned by tiles, and each tile is compared with all the
+ * queries while it is in cache.
+ */
+struct InvertedListBlockScanner {
+    idx_t list_no = -1;    ///< remember current list
+    bool keep_max = false; ///< keep maximum instead of minimum
+    /// store positions in invlists rather than labels
+    bool store_pairs;
+
+    /// search in this subset of ids
+    const IDSelector* sel;
+
+    InvertedListBlockScanner(
+            bool store_pairs = false,
+            const IDSelector* sel = nullptr)
+            : store_pairs(store_pairs), sel(sel) {}
+
+    /** the following codes come from this list and are compared with the
+     * queries x + qnos[i] * d, whose distances to the list centroid are
+     * coarse_dis[i]
+     */
+    virtual void set_list(
+            idx_t list_no,
+            size_t nq,
+            const float* x,
+            const idx_t* qnos,
+            const float* coarse_dis) = 0;
+
+    /** scan a tile of codes and update the heaps of the queries
+     *
+     * @param n      number of codes to scan
+     * @param j0     offset of the tile in the list (for store_pairs)
+     * @param codes  codes to scan (n * code_size)
+     * @param ids        corresponding ids (ignored if store_pairs)
+     * @param distances  heap distances of the queries (size nq * k)
+     * @param labels     heap labels of the queries (size nq * k)
+     * @param k          heap size
+     * @return number of heap updates performed
+     */
+    virtual size_t scan_codes(
+            size_t n,
+            size_t j0,
+            const uint8_t* codes,
+            const idx_t* ids,
+            float* distances,
+            idx_t* labels,
+            size_t k) = 0;
+
+    virtual ~InvertedListBlockScanner() {}
+};
+
+/** Block scanner for codes that decode to float vectors (IndexIVFFlat,
+ * IndexIVFScalarQuantizer). The distances between a tile and the queries
+ * are computed by the fused kernels of distances_fused.h when they are
+ * available, or code by code for all the queries otherwise.
+ */
+struct InvertedListBlockScannerFloat : InvertedListBlockScanner {
+    size_t d;
+    MetricType metric;
+
+    /// queries of the current list (size nq * d), set by set_list
+    std::vector<float> xq;
+    /// added to the distances of each query (size nq)
+    std::vector<float> accu0;
+
+    InvertedListBlockScannerFloat(
+            size_t d,
+            MetricType metric,
+            bool store_pairs,
+            const IDSelector* sel);
+
+    /// decode n codes, the result is valid until the next call
+    virtual const float* decode_tile(size_t n, const uint8_t* codes) = 0;
+
+    size_t scan_codes(
+            size_t n,
+            size_t j0,
+            const uint8_t* codes,
+            const idx_t* ids,
+            float* distances,
+            idx_t* labels,
+            size_t k) override;
+
+    /// per-tile result heaps of the fused kernels
+    std::vector<float> tile_dis;
+    std::vector<idx_t> tile_ids;
+};
+
 // whether to check that coarse quantizers are the same
 FAISS_API extern bool check_compatible_for_merge_expensive_check;
 
@@ -538,6 +645,10 @@ struct IndexIVFStats {
     double quantization_time; // time spent quantizing vectors (in ms)
     double search_time;       // time spent searching lists (in ms)
 
+    /// if non-null, the per-query traces of the searched queries. This is
+    /// set by IndexIVF::search for each slice of queries, not aggregated
+    QueryTrace* query_traces = nullptr;
+
     IndexIVFStats() {
         reset();
     }
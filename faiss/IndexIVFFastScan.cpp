@@ -20,7 +20,9 @@
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/LookupTableScaler.h>
+#include <faiss/impl/SearchTrace.h>
 #include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/impl/pq8_fast_scan.h>
 #include <faiss/impl/simd_result_handlers.h>
 #include <faiss/invlists/BlockInvertedLists.h>
 #include <faiss/utils/distances.h>
@@ -62,14 +64,14 @@ void IndexIVFFastScan::init_fastscan(
         MetricType /* metric */,
         int bbs) {
     FAISS_THROW_IF_NOT(bbs % 32 == 0);
-    FAISS_THROW_IF_NOT(nbits == 4);
+    FAISS_THROW_IF_NOT(nbits >= 4 && nbits <= 8);
 
     this->M = M;
     this->nbits = nbits;
     this->bbs = bbs;
     ksub = (1 << nbits);
     M2 = roundup(M, 2);
-    code_size = M2 / 2;
+    code_size = (M * nbits + 7) / 8;
 
     is_trained = false;
     replace_invlists(new BlockInvertedLists(nlist, get_CodePacker()), true);
@@ -173,14 +175,26 @@ void IndexIVFFastScan::add_with_ids(
                    flat_codes.data() + order[i] * code_size,
                    code_size);
         }
-        pq4_pack_codes_range(
-                list_codes.data(),
-                M,
-                list_size,
-                list_size + i1 - i0,
-                bbs,
-                M2,
-                bil->codes[list_no].data());
+        if (nbits == 4) {
+            pq4_pack_codes_range(
+                    list_codes.data(),
+                    M,
+                    list_size,
+                    list_size + i1 - i0,
+                    bbs,
+                    M2,
+                    bil->codes[list_no].data());
+        } else {
+            pq8_pack_codes_range(
+                    list_codes.data(),
+                    M,
+                    nbits,
+                    list_size,
+                    list_size + i1 - i0,
+                    bbs,
+                    M2,
+                    bil->codes[list_no].data());
+        }
 
         i0 = i1;
     }
@@ -189,7 +203,11 @@ void IndexIVFFastScan::add_with_ids(
 }
 
 CodePacker* IndexIVFFastScan::get_CodePacker() const {
-    return new CodePackerPQ4(M, bbs);
+    if (nbits == 4) {
+        return new CodePackerPQ4(M, bbs);
+    } else {
+        return new CodePackerPQ8(M, nbits, bbs);
+    }
 }
 
 /*********************************************************
@@ -515,6 +533,20 @@ void IndexIVFFastScan::search_dispatch_implem(
         }
     }
 
+    // the codes of more than 4 bits are only scanned by implem 10 and 11
+    if (nbits != 4 && impl % 100 >= 12 && impl % 100 <= 17) {
+        impl -= impl % 100 - 10 - impl % 2;
+    }
+
+    // 16 and 17 are 10 and 11 with the 512-bit kernels
+    bool kernel_512 = impl % 100 == 16 || impl % 100 == 17;
+    if (kernel_512) {
+        FAISS_THROW_IF_NOT_MSG(
+                pq4_has_512bit_kernels(),
+                "implem 16 and 17 require the 512-bit kernels");
+        impl -= 6;
+    }
+
     bool multiple_threads =
             n > 1 && impl >= 10 && impl <= 13 && omp_get_max_threads() > 1;
     if (impl >= 100) {
@@ -522,15 +554,31 @@ void IndexIVFFastScan::search_dispatch_implem(
         impl -= 100;
     }
 
+    // the queries are processed by blocks, so the LUT computation, scanning
+    // and heap updates are all counted in the scan stage
+    SearchTrace* trace = params ? params->trace : nullptr;
+    SearchTraceScope trace_scope(trace, n);
+    QueryTrace* query_traces = trace ? trace->queries.data() : nullptr;
+    bool traced_by_slice = false;
+
     CoarseQuantizedWithBuffer cq(cq_in);
     cq.nprobe = nprobe;
 
+    uint64_t t0 = query_traces ? get_cycles() : 0;
     if (!cq.done() && !multiple_threads) {
         // we do the coarse quantization here execpt when search is
         // sliced over threads (then it is more efficient to have each thread do
         // its own coarse quantization)
         cq.quantize(quantizer, n, x, quantizer_params);
+        uint64_t t1 = query_traces ? get_cycles() : 0;
         invlists->prefetch_lists(cq.ids, n * cq.nprobe);
+        if (query_traces) {
+            SearchTrace::add_block(
+                    query_traces, n, QueryTrace::coarse_quantization, t1 - t0);
+            t0 = get_cycles();
+            SearchTrace::add_block(
+                    query_traces, n, QueryTrace::io_wait, t0 - t1);
+        }
     }
 
     if (impl == 1) {
@@ -586,7 +634,7 @@ void IndexIVFFastScan::search_dispatch_implem(
                 );
                 search_implem_10(
                         n, x, *handler.get(), cq,
-                        &ndis, &nlist_visited, scaler, params);
+                        &ndis, &nlist_visited, scaler, params, kernel_512);
             }
             // clang-format on
         } else {
@@ -598,6 +646,8 @@ void IndexIVFFastScan::search_dispatch_implem(
                 search_implem_14(
                         n, x, k, distances, labels, cq, impl, scaler, params);
             } else {
+                // each slice records its own coarse quantization and scan
+                traced_by_slice = true;
 #pragma omp parallel for reduction(+ : ndis, nlist_visited)
                 for (int slice = 0; slice < nslice; slice++) {
                     idx_t i0 = n * slice / nslice;
@@ -605,8 +655,20 @@ void IndexIVFFastScan::search_dispatch_implem(
                     float* dis_i = distances + i0 * k;
                     idx_t* lab_i = labels + i0 * k;
                     CoarseQuantizedSlice cq_i(cq, i0, i1);
+                    QueryTrace* qt_i =
+                            query_traces ? query_traces + i0 : nullptr;
+                    uint64_t t_i = qt_i ? get_cycles() : 0;
                     if (!cq_i.done()) {
                         cq_i.quantize_slice(quantizer, x, quantizer_params);
+                        if (qt_i) {
+                            uint64_t t1_i = get_cycles();
+                            SearchTrace::add_block(
+                                    qt_i,
+                                    i1 - i0,
+                                    QueryTrace::coarse_quantization,
+                                    t1_i - t_i);
+                            t_i = t1_i;
+                        }
                     }
                     std::unique_ptr<RH> handler(make_knn_handler(
                             is_max, impl, i1 - i0, k, dis_i, lab_i, sel));
@@ -618,9 +680,17 @@ void IndexIVFFastScan::search_dispatch_implem(
                     } else {
                         search_implem_10(
                                 i1 - i0, x + i0 * d, *handler.get(),
-                                cq_i, &ndis, &nlist_visited, scaler, params);
+                                cq_i, &ndis, &nlist_visited, scaler, params,
+                                kernel_512);
                     }
                     // clang-format on
+                    if (qt_i) {
+                        SearchTrace::add_block(
+                                qt_i,
+                                i1 - i0,
+                                QueryTrace::scan,
+                                get_cycles() - t_i);
+                    }
                 }
             }
         }
@@ -630,6 +700,11 @@ void IndexIVFFastScan::search_dispatch_implem(
     } else {
         FAISS_THROW_FMT("implem %d does not exist", implem);
     }
+
+    if (query_traces && !traced_by_slice) {
+        SearchTrace::add_block(
+                query_traces, n, QueryTrace::scan, get_cycles() - t0);
+    }
 }
 
 void IndexIVFFastScan::range_search_dispatch_implem(
@@ -662,6 +737,19 @@ void IndexIVFFastScan::range_search_dispatch_implem(
         }
     }
 
+    // the codes of more than 4 bits are only scanned by implem 10
+    if (nbits != 4 && (impl % 100 == 12 || impl % 100 == 16)) {
+        impl -= impl % 100 - 10;
+    }
+
+    bool kernel_512 = impl % 100 == 16;
+    if (kernel_512) {
+        FAISS_THROW_IF_NOT_MSG(
+                pq4_has_512bit_kernels(),
+                "implem 16 and 17 require the 512-bit kernels");
+        impl -= 6;
+    }
+
     CoarseQuantizedWithBuffer cq(cq_in);
 
     bool multiple_threads =
@@ -692,7 +780,15 @@ void IndexIVFFastScan::range_search_dispatch_implem(
                     n, x, *handler.get(), cq, &ndis, &nlist_visited, scaler);
         } else if (impl == 10) {
             search_implem_10(
-                    n, x, *handler.get(), cq, &ndis, &nlist_visited, scaler);
+                    n,
+                    x,
+                    *handler.get(),
+                    cq,
+                    &ndis,
+                    &nlist_visited,
+                    scaler,
+                    params,
+                    kernel_512);
         } else {
             FAISS_THROW_FMT("Range search implem %d not implemented", impl);
         }
@@ -741,7 +837,8 @@ void IndexIVFFastScan::range_search_dispatch_implem(
                             &ndis,
                             &nlist_visited,
                             scaler,
-                            params);
+                            params,
+                            kernel_512);
                 }
             }
             pres.finalize();
@@ -913,7 +1010,8 @@ void IndexIVFFastScan::search_implem_10(
         size_t* ndis_out,
         size_t* nlist_out,
         const NormTableScaler* scaler,
-        const IVFSearchParameters* params) const {
+        const IVFSearchParameters* params,
+        bool kernel_512) const {
     size_t dim12 = ksub * M2;
     AlignedTable<uint8_t> dis_tables;
     AlignedTable<uint16_t> biases;
@@ -923,6 +1021,10 @@ void IndexIVFFastScan::search_implem_10(
 
     bool single_LUT = !lookup_table_is_3d();
 
+    // for 4 bits, the LUT of a single query is already in the packed order
+    AlignedTable<uint8_t> packed_LUT(nbits == 4 ? 0 : dim12);
+    const uint8_t* packed_from = nullptr;
+
     size_t ndis = 0;
     int qmap1[1];
 
@@ -961,15 +1063,34 @@ void IndexIVFFastScan::search_implem_10(
             handler.ntotal = ls;
             handler.id_map = ids.get();
 
-            pq4_accumulate_loop(
-                    1,
-                    roundup(ls, bbs),
-                    bbs,
-                    M2,
-                    codes.get(),
-                    LUT,
-                    handler,
-                    scaler);
+            if (nbits == 4) {
+                auto accumulate_loop = kernel_512 ? pq4_accumulate_loop_512
+                                                  : pq4_accumulate_loop;
+                accumulate_loop(
+                        1,
+                        roundup(ls, bbs),
+                        bbs,
+                        M2,
+                        codes.get(),
+                        LUT,
+                        handler,
+                        scaler);
+            } else {
+                if (LUT != packed_from) {
+                    pq8_pack_LUT(1, M2, ksub, LUT, packed_LUT.get());
+                    packed_from = LUT;
+                }
+                pq8_accumulate_loop(
+                        1,
+                        roundup(ls, bbs),
+                        bbs,
+                        M2,
+                        ksub,
+                        codes.get(),
+                        packed_LUT.get(),
+                        handler,
+                        scaler);
+            }
 
             ndis++;
         }
@@ -1342,12 +1463,8 @@ void IndexIVFFastScan::reconstruct_from_offset(
     // unpack codes
     InvertedLists::ScopedCodes list_codes(invlists, list_no);
     std::vector<uint8_t> code(code_size, 0);
-    BitstringWriter bsw(code.data(), code_size);
-    for (size_t m = 0; m < M; m++) {
-        uint8_t c =
-                pq4_get_packed_element(list_codes.get(), bbs, M2, offset, m);
-        bsw.write(c, nbits);
-    }
+    std::unique_ptr<CodePacker> packer(get_CodePacker());
+    packer->unpack_1(list_codes.get(), offset, code.data());
     sa_decode(1, code.data(), recons);
 
     // add centroid to it
@@ -1369,15 +1486,11 @@ void IndexIVFFastScan::reconstruct_orig_invlists() {
         InvertedLists::ScopedIds ids(invlists, list_no);
         size_t list_size = orig_invlists->list_size(list_no);
         std::vector<uint8_t> code(code_size, 0);
+        std::unique_ptr<CodePacker> packer(get_CodePacker());
 
         for (size_t offset = 0; offset < list_size; offset++) {
             // unpack codes
-            BitstringWriter bsw(code.data(), code_size);
-            for (size_t m = 0; m < M; m++) {
-                uint8_t c =
-                        pq4_get_packed_element(codes.get(), bbs, M2, offset, m);
-                bsw.write(c, nbits);
-            }
+            packer->unpack_1(codes.get(), offset, code.data());
 
             // get id
             idx_t id = ids.get()[offset];
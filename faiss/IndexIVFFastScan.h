@@ -17,7 +17,8 @@ namespace faiss {
 struct NormTableScaler;
 struct SIMDResultHandlerToFloat;
 
-/** Fast scan version of IVFPQ and IVFAQ. Works for 4-bit PQ/AQ for now.
+/** Fast scan version of IVFPQ and IVFAQ. Works for 4-bit PQ/AQ, and for 5 to
+ * 8-bit PQ (then implem 12 to 17 fall back to 10, 11).
  *
  * The codes in the inverted lists are not stored sequentially but
  * grouped in blocks of size bbs. This makes it possible to very quickly
@@ -33,8 +34,11 @@ struct SIMDResultHandlerToFloat;
  * 13: idem, collect results in reservoir
  * 14: internally multithreaded implem over nq * nprobe
  * 15: same with reservoir
+ * 16, 17: same as 10, 11 with 512-bit kernels that process 64 codes per
+ *         shuffle (requires an AVX512 build, or the AVX512 level with
+ *         dynamic dispatch, see pq4_has_512bit_kernels(); throws otherwise)
  *
- * For range search, only 10 and 12 are supported.
+ * For range search, only 10, 12 and 16 are supported.
  * add 100 to the implem to force single-thread scanning (the coarse quantizer
  * may still use multiple threads).
  */
@@ -193,7 +197,8 @@ struct IndexIVFFastScan : IndexIVF {
             size_t* ndis_out,
             size_t* nlist_out,
             const NormTableScaler* scaler,
-            const IVFSearchParameters* params = nullptr) const;
+            const IVFSearchParameters* params = nullptr,
+            bool kernel_512 = false) const;
 
     void search_implem_12(
             idx_t n,
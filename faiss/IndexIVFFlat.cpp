@@ -219,11 +219,35 @@ InvertedListScanner* get_InvertedListScanner1(
     }
 }
 
+/// the codes are the vectors, the queries are compared with them directly
+struct IVFFlatBlockScanner : InvertedListBlockScannerFloat {
+    using InvertedListBlockScannerFloat::InvertedListBlockScannerFloat;
+
+    void set_list(
+            idx_t list_no,
+            size_t nq,
+            const float* x,
+            const idx_t* qnos,
+            const float* /* coarse_dis */) override {
+        this->list_no = list_no;
+        xq.resize(nq * d);
+        for (size_t i = 0; i < nq; i++) {
+            memcpy(xq.data() + i * d, x + qnos[i] * d, sizeof(float) * d);
+        }
+        accu0.assign(nq, 0);
+    }
+
+    const float* decode_tile(size_t /* n */, const uint8_t* codes) override {
+        return (const float*)codes;
+    }
+};
+
 } // anonymous namespace
 
 InvertedListScanner* IndexIVFFlat::get_InvertedListScanner(
         bool store_pairs,
-        const IDSelector* sel) const {
+        const IDSelector* sel,
+        const IVFSearchParameters*) const {
     if (sel) {
         return get_InvertedListScanner1<true>(this, store_pairs, sel);
     } else {
@@ -231,6 +255,16 @@ InvertedListScanner* IndexIVFFlat::get_InvertedListScanner(
     }
 }
 
+InvertedListBlockScanner* IndexIVFFlat::get_InvertedListBlockScanner(
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters*) const {
+    if (metric_type != METRIC_L2 && metric_type != METRIC_INNER_PRODUCT) {
+        return nullptr;
+    }
+    return new IVFFlatBlockScanner(d, metric_type, store_pairs, sel);
+}
+
 void IndexIVFFlat::reconstruct_from_offset(
         int64_t list_no,
         int64_t offset,
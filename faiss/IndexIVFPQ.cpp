@@ -16,6 +16,7 @@
 #include <cstdio>
 
 #include <algorithm>
+#include <unordered_map>
 
 #include <faiss/utils/Heap.h>
 #include <faiss/utils/distances.h>
@@ -32,11 +33,14 @@
 #include <faiss/impl/IDSelector.h>
 
 #include <faiss/impl/ProductQuantizer.h>
+#include <faiss/impl/SearchTrace.h>
 
 #include <faiss/impl/code_distance/code_distance.h>
 
 namespace faiss {
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 /*****************************************
  * IndexIVFPQ implementation
  ******************************************/
@@ -55,6 +59,7 @@ IndexIVFPQ::IndexIVFPQ(
     by_residual = true;
     use_precomputed_table = 0;
     scan_table_threshold = 0;
+    lut_batch_size = 0;
 
     polysemous_training = nullptr;
     do_polysemous_training = false;
@@ -469,8 +474,65 @@ void IndexIVFPQ::precompute_table() {
             verbose);
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
+/* The scanners are compiled once per SIMD level, see utils/simd_levels.h.
+ * IndexIVFPQ::get_InvertedListScanner dispatches to them. */
+
+namespace index_ivfpq {
+
+/** Look-up tables computed beforehand for a batch of queries (see
+ * IndexIVFPQ::lut_batch_size).
+ *
+ * The query tables are computed in a single call for the whole batch, which
+ * uses one GEMM per sub-quantizer when the sub-vectors are large enough.
+ *
+ * For L2 residual search without precomputed tables, the list-specific term
+ * ||p||^2 + 2 <c, p> (the same as in the type-1 precomputed table) is
+ * computed for the lists probed by several queries of the batch. Then each
+ * of these queries only needs a fvec_madd per list instead of computing its
+ * residual table from scratch.
+ */
+struct IVFPQBatchTables {
+    const float* x;
+    size_t n, d;
+    size_t table_size; // pq.M * pq.ksub
+
+    // size n * table_size
+    std::vector<float> query_tables;
+
+    // list number -> index of its table in list_tables
+    std::unordered_map<idx_t, size_t> list_map;
+    std::vector<float> list_tables;
+
+    IVFPQBatchTables(
+            const IndexIVFPQ& ivfpq,
+            size_t n,
+            const float* x,
+            const idx_t* keys,
+            size_t nprobe);
+
+    /// table of query qi, nullptr if qi is not a query of the batch
+    const float* query_table(const float* qi) const;
+
+    /// list-specific table, nullptr if it was not computed
+    const float* list_table(idx_t key) const;
+};
+
+template <SIMDLevel>
+InvertedListScanner* get_InvertedListScanner(
+        const IndexIVFPQ& index,
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters* params,
+        const IVFPQBatchTables* batch_tables);
+
+} // namespace index_ivfpq
+
 namespace {
 
+using index_ivfpq::IVFPQBatchTables;
+
 #define TIC t0 = get_cycles()
 #define TOC get_cycles() - t0
 
@@ -497,6 +559,9 @@ struct QueryTables {
     int use_precomputed_table;
     int polysemous_ht;
 
+    // tables computed beforehand for a batch of queries, may be null
+    const IVFPQBatchTables* batch_tables;
+
     // pre-allocated data buffers
     float *sim_table, *sim_table_2;
     float *residual_vec, *decoded_vec;
@@ -509,14 +574,23 @@ struct QueryTables {
 
     explicit QueryTables(
             const IndexIVFPQ& ivfpq,
-            const IVFSearchParameters* params)
+            const IVFSearchParameters* params,
+            const IVFPQBatchTables* batch_tables = nullptr)
             : ivfpq(ivfpq),
+              params(params),
               d(ivfpq.d),
               pq(ivfpq.pq),
               metric_type(ivfpq.metric_type),
               by_residual(ivfpq.by_residual),
-              use_precomputed_table(ivfpq.use_precomputed_table) {
-        mem.resize(pq.ksub * pq.M * 2 + d * 2);
+              use_precomputed_table(ivfpq.use_precomputed_table),
+              batch_tables(batch_tables),
+              // sized here rather than with resize, whose instantiations
+              // would be shared with the generic objects, see
+              // FAISS_SIMD_NAMESPACE_BEGIN
+              mem(pq.ksub * pq.M * 2 + d * 2),
+              sim_table_ptrs(pq.M),
+              q_code(pq.code_size),
+              init_list_cycles(0) {
         sim_table = mem.data();
         sim_table_2 = sim_table + pq.ksub * pq.M;
         residual_vec = sim_table_2 + pq.ksub * pq.M;
@@ -528,11 +602,6 @@ struct QueryTables {
                     dynamic_cast<const IVFPQSearchParameters*>(params)) {
             polysemous_ht = ivfpq_params->polysemous_ht;
         }
-        if (polysemous_ht != 0) {
-            q_code.resize(pq.code_size);
-        }
-        init_list_cycles = 0;
-        sim_table_ptrs.resize(pq.M);
     }
 
     /*****************************************************
@@ -542,9 +611,14 @@ struct QueryTables {
     // field specific to query
     const float* qi;
 
+    // table of the query in batch_tables, if any
+    const float* batch_query_table;
+
     // query-specific initialization
     void init_query(const float* qi) {
         this->qi = qi;
+        batch_query_table =
+                batch_tables ? batch_tables->query_table(qi) : nullptr;
         if (metric_type == METRIC_INNER_PRODUCT)
             init_query_IP();
         else
@@ -555,17 +629,32 @@ struct QueryTables {
 
     void init_query_IP() {
         // precompute some tables specific to the query qi
-        pq.compute_inner_prod_table(qi, sim_table);
+        if (batch_query_table) {
+            copy_batch_query_table(sim_table);
+        } else {
+            pq.compute_inner_prod_table(qi, sim_table);
+        }
     }
 
     void init_query_L2() {
         if (!by_residual) {
-            pq.compute_distance_table(qi, sim_table);
+            if (batch_query_table) {
+                copy_batch_query_table(sim_table);
+            } else {
+                pq.compute_distance_table(qi, sim_table);
+            }
+        } else if (batch_query_table) {
+            // also used with the list tables of the batch
+            copy_batch_query_table(sim_table_2);
         } else if (use_precomputed_table) {
             pq.compute_inner_prod_table(qi, sim_table_2);
         }
     }
 
+    void copy_batch_query_table(float* table) const {
+        memcpy(table, batch_query_table, sizeof(float) * pq.M * pq.ksub);
+    }
+
     /*****************************************************
      * When inverted list is known: prepare computations
      *****************************************************/
@@ -635,7 +724,22 @@ struct QueryTables {
     float precompute_list_tables_L2() {
         float dis0 = 0;
 
-        if (use_precomputed_table == 0 || use_precomputed_table == -1) {
+        const float* batch_list_table = batch_query_table && !polysemous_ht
+                ? batch_tables->list_table(key)
+                : nullptr;
+
+        if (batch_list_table) {
+            // same as with the type-1 precomputed table
+            dis0 = coarse_dis;
+
+            fvec_madd(
+                    pq.M * pq.ksub,
+                    batch_list_table,
+                    -2.0,
+                    sim_table_2,
+                    sim_table);
+
+        } else if (use_precomputed_table == 0 || use_precomputed_table == -1) {
             ivfpq.quantizer->compute_residual(qi, residual_vec, key);
             pq.compute_distance_table(residual_vec, sim_table);
 
@@ -812,8 +916,11 @@ struct IVFPQScannerT : QueryTables {
     const IDType* list_ids;
     size_t list_size;
 
-    IVFPQScannerT(const IndexIVFPQ& ivfpq, const IVFSearchParameters* params)
-            : QueryTables(ivfpq, params) {
+    IVFPQScannerT(
+            const IndexIVFPQ& ivfpq,
+            const IVFSearchParameters* params,
+            const IVFPQBatchTables* batch_tables = nullptr)
+            : QueryTables(ivfpq, params, batch_tables) {
         assert(METRIC_TYPE == metric_type);
     }
 
@@ -1043,7 +1150,7 @@ struct IVFPQScannerT : QueryTables {
             size_t ncode,
             const uint8_t* codes,
             SearchResultType& res) const {
-        int ht = ivfpq.polysemous_ht;
+        int ht = polysemous_ht;
         size_t n_hamming_pass = 0;
 
         int code_size = pq.code_size;
@@ -1196,8 +1303,13 @@ struct IVFPQScanner : IVFPQScannerT<idx_t, METRIC_TYPE, PQDecoder>,
             const IndexIVFPQ& ivfpq,
             bool store_pairs,
             int precompute_mode,
-            const IDSelector* sel)
-            : IVFPQScannerT<idx_t, METRIC_TYPE, PQDecoder>(ivfpq, nullptr),
+            const IDSelector* sel,
+            const IVFSearchParameters* params,
+            const IVFPQBatchTables* batch_tables)
+            : IVFPQScannerT<idx_t, METRIC_TYPE, PQDecoder>(
+                      ivfpq,
+                      params,
+                      batch_tables),
               precompute_mode(precompute_mode),
               sel(sel) {
         this->store_pairs = store_pairs;
@@ -1284,19 +1396,21 @@ template <class PQDecoder, bool use_sel>
 InvertedListScanner* get_InvertedListScanner1(
         const IndexIVFPQ& index,
         bool store_pairs,
-        const IDSelector* sel) {
+        const IDSelector* sel,
+        const IVFSearchParameters* params,
+        const IVFPQBatchTables* batch_tables) {
     if (index.metric_type == METRIC_INNER_PRODUCT) {
         return new IVFPQScanner<
                 METRIC_INNER_PRODUCT,
                 CMin<float, idx_t>,
                 PQDecoder,
-                use_sel>(index, store_pairs, 2, sel);
+                use_sel>(index, store_pairs, 2, sel, params, batch_tables);
     } else if (index.metric_type == METRIC_L2) {
         return new IVFPQScanner<
                 METRIC_L2,
                 CMax<float, idx_t>,
                 PQDecoder,
-                use_sel>(index, store_pairs, 2, sel);
+                use_sel>(index, store_pairs, 2, sel, params, batch_tables);
     }
     return nullptr;
 }
@@ -1305,32 +1419,249 @@ template <bool use_sel>
 InvertedListScanner* get_InvertedListScanner2(
         const IndexIVFPQ& index,
         bool store_pairs,
-        const IDSelector* sel) {
+        const IDSelector* sel,
+        const IVFSearchParameters* params,
+        const IVFPQBatchTables* batch_tables) {
     if (index.pq.nbits == 8) {
         return get_InvertedListScanner1<PQDecoder8, use_sel>(
-                index, store_pairs, sel);
+                index, store_pairs, sel, params, batch_tables);
     } else if (index.pq.nbits == 16) {
         return get_InvertedListScanner1<PQDecoder16, use_sel>(
-                index, store_pairs, sel);
+                index, store_pairs, sel, params, batch_tables);
     } else {
         return get_InvertedListScanner1<PQDecoderGeneric, use_sel>(
-                index, store_pairs, sel);
+                index, store_pairs, sel, params, batch_tables);
     }
 }
 
 } // anonymous namespace
 
-InvertedListScanner* IndexIVFPQ::get_InvertedListScanner(
+template <>
+InvertedListScanner* index_ivfpq::get_InvertedListScanner<
+        FAISS_THIS_SIMD_LEVEL>(
+        const IndexIVFPQ& index,
         bool store_pairs,
-        const IDSelector* sel) const {
+        const IDSelector* sel,
+        const IVFSearchParameters* params,
+        const IVFPQBatchTables* batch_tables) {
     if (sel) {
-        return get_InvertedListScanner2<true>(*this, store_pairs, sel);
+        return get_InvertedListScanner2<true>(
+                index, store_pairs, sel, params, batch_tables);
     } else {
-        return get_InvertedListScanner2<false>(*this, store_pairs, sel);
+        return get_InvertedListScanner2<false>(
+                index, store_pairs, sel, params, batch_tables);
     }
-    return nullptr;
 }
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
+namespace index_ivfpq {
+
+IVFPQBatchTables::IVFPQBatchTables(
+        const IndexIVFPQ& ivfpq,
+        size_t n,
+        const float* x,
+        const idx_t* keys,
+        size_t nprobe)
+        : x(x), n(n), d(ivfpq.d) {
+    const ProductQuantizer& pq = ivfpq.pq;
+    table_size = pq.M * pq.ksub;
+    query_tables.resize(n * table_size);
+
+    if (ivfpq.metric_type == METRIC_L2 && !ivfpq.by_residual) {
+        pq.compute_distance_tables(n, x, query_tables.data());
+    } else {
+        pq.compute_inner_prod_tables(n, x, query_tables.data());
+    }
+
+    // the list tables assume that the coarse distance is ||x - c||^2
+    if (ivfpq.metric_type != METRIC_L2 || !ivfpq.by_residual ||
+        ivfpq.quantizer->metric_type != METRIC_L2 ||
+        (ivfpq.use_precomputed_table != 0 &&
+         ivfpq.use_precomputed_table != -1)) {
+        return;
+    }
+
+    // lists probed by at least 2 queries, the most shared ones first
+    std::unordered_map<idx_t, size_t> nprobed;
+    for (size_t i = 0; i < n * nprobe; i++) {
+        if (keys[i] >= 0) {
+            nprobed[keys[i]]++;
+        }
+    }
+    std::vector<std::pair<size_t, idx_t>> shared;
+    for (const auto& it : nprobed) {
+        if (it.second >= 2) {
+            shared.emplace_back(it.second, it.first);
+        }
+    }
+    // bound the memory use by the one of the query tables
+    if (shared.size() > n) {
+        std::partial_sort(
+                shared.begin(),
+                shared.begin() + n,
+                shared.end(),
+                std::greater<std::pair<size_t, idx_t>>());
+        shared.resize(n);
+    }
+    size_t nl = shared.size();
+    if (nl == 0) {
+        return;
+    }
+
+    std::vector<float> centroids(nl * d);
+    for (size_t i = 0; i < nl; i++) {
+        list_map[shared[i].second] = i;
+        ivfpq.quantizer->reconstruct(
+                shared[i].second, centroids.data() + i * d);
+    }
+    list_tables.resize(nl * table_size);
+    pq.compute_inner_prod_tables(nl, centroids.data(), list_tables.data());
+
+    // squared norms of the PQ centroids
+    std::vector<float> r_norms(table_size);
+    for (int m = 0; m < pq.M; m++) {
+        for (int j = 0; j < pq.ksub; j++) {
+            r_norms[m * pq.ksub + j] =
+                    fvec_norm_L2sqr(pq.get_centroids(m, j), pq.dsub);
+        }
+    }
+    for (size_t i = 0; i < nl; i++) {
+        float* tab = list_tables.data() + i * table_size;
+        fvec_madd(table_size, r_norms.data(), 2.0, tab, tab);
+    }
+}
+
+const float* IVFPQBatchTables::query_table(const float* qi) const {
+    if (qi < x || qi >= x + n * d || (qi - x) % d != 0) {
+        return nullptr;
+    }
+    return query_tables.data() + (qi - x) / d * table_size;
+}
+
+const float* IVFPQBatchTables::list_table(idx_t key) const {
+    auto it = list_map.find(key);
+    if (it == list_map.end()) {
+        return nullptr;
+    }
+    return list_tables.data() + it->second * table_size;
+}
+
+} // namespace index_ivfpq
+
+namespace {
+
+/// passes the tables of a batch to IndexIVFPQ::get_InvertedListScanner
+struct IVFPQBatchSearchParameters : IVFPQSearchParameters {
+    const IVFPQBatchTables* batch_tables = nullptr;
+};
+
+} // anonymous namespace
+
+InvertedListScanner* IndexIVFPQ::get_InvertedListScanner(
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters* params) const {
+    const index_ivfpq::IVFPQBatchTables* batch_tables = nullptr;
+    if (auto batch_params =
+                dynamic_cast<const IVFPQBatchSearchParameters*>(params)) {
+        batch_tables = batch_params->batch_tables;
+    }
+    DISPATCH_SIMDLevel(
+            index_ivfpq::get_InvertedListScanner,
+            *this,
+            store_pairs,
+            sel,
+            params,
+            batch_tables);
+}
+
+void IndexIVFPQ::search_preassigned(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        const idx_t* keys,
+        const float* coarse_dis,
+        float* distances,
+        idx_t* labels,
+        bool store_pairs,
+        const IVFSearchParameters* params,
+        IndexIVFStats* ivf_stats) const {
+    // the batched tables are not used with polysemous filtering
+    int ht = polysemous_ht;
+    auto ivfpq_params = dynamic_cast<const IVFPQSearchParameters*>(params);
+    if (ivfpq_params) {
+        ht = ivfpq_params->polysemous_ht;
+    }
+    if (lut_batch_size == 0 || n <= 1 || ht != 0) {
+        IndexIVF::search_preassigned(
+                n,
+                x,
+                k,
+                keys,
+                coarse_dis,
+                distances,
+                labels,
+                store_pairs,
+                params,
+                ivf_stats);
+        return;
+    }
+
+    idx_t nprobe = params ? params->nprobe : this->nprobe;
+    nprobe = std::min((idx_t)nlist, nprobe);
+    FAISS_THROW_IF_NOT(nprobe > 0);
+
+    // the search parameters of the batches, with the same nprobe and max_codes
+    IVFPQBatchSearchParameters batch_params;
+    if (ivfpq_params) {
+        static_cast<IVFPQSearchParameters&>(batch_params) = *ivfpq_params;
+    } else if (params) {
+        static_cast<IVFSearchParameters&>(batch_params) = *params;
+    } else {
+        batch_params.max_codes = max_codes;
+    }
+    batch_params.nprobe = nprobe;
+
+    // the traces are handled here because the batches are searched separately
+    SearchTrace* trace = params ? params->trace : nullptr;
+    QueryTrace* query_traces = ivf_stats ? ivf_stats->query_traces : nullptr;
+    SearchTraceScope trace_scope(query_traces ? nullptr : trace, n);
+    if (!query_traces && trace) {
+        query_traces = trace->queries.data();
+    }
+
+    IndexIVFStats stats;
+    for (idx_t i0 = 0; i0 < n; i0 += lut_batch_size) {
+        idx_t i1 = std::min(i0 + (idx_t)lut_batch_size, n);
+        IVFPQBatchTables batch_tables(
+                *this, i1 - i0, x + i0 * d, keys + i0 * nprobe, nprobe);
+        batch_params.batch_tables = &batch_tables;
+
+        IndexIVFStats batch_stats;
+        batch_stats.query_traces = query_traces ? query_traces + i0 : nullptr;
+        IndexIVF::search_preassigned(
+                i1 - i0,
+                x + i0 * d,
+                k,
+                keys + i0 * nprobe,
+                coarse_dis + i0 * nprobe,
+                distances + i0 * k,
+                labels + i0 * k,
+                store_pairs,
+                &batch_params,
+                &batch_stats);
+        stats.add(batch_stats);
+    }
+
+    if (ivf_stats == nullptr) {
+        ivf_stats = &indexIVF_stats;
+    }
+    ivf_stats->add(stats);
+}
+
+IVFPQSearchParameters::~IVFPQSearchParameters() = default;
+
 IndexIVFPQStats indexIVFPQ_stats;
 
 void IndexIVFPQStats::reset() {
@@ -1341,6 +1672,7 @@ IndexIVFPQ::IndexIVFPQ() {
     // initialize some runtime values
     use_precomputed_table = 0;
     scan_table_threshold = 0;
+    lut_batch_size = 0;
     do_polysemous_training = false;
     polysemous_ht = 0;
     polysemous_training = nullptr;
@@ -1388,4 +1720,6 @@ size_t IndexIVFPQ::find_duplicates(idx_t* dup_ids, size_t* lims) const {
     return ngroup;
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
@@ -23,7 +23,7 @@ struct IVFPQSearchParameters : IVFSearchParameters {
     size_t scan_table_threshold; ///< use table computation or on-the-fly?
     int polysemous_ht;           ///< Hamming thresh for polysemous filtering
     IVFPQSearchParameters() : scan_table_threshold(0), polysemous_ht(0) {}
-    ~IVFPQSearchParameters() {}
+    ~IVFPQSearchParameters() override;
 };
 
 FAISS_API extern size_t precomputed_table_max_bytes;
@@ -41,6 +41,14 @@ struct IndexIVFPQ : IndexIVF {
     size_t scan_table_threshold; ///< use table computation or on-the-fly?
     int polysemous_ht;           ///< Hamming thresh for polysemous filtering
 
+    /** if > 0, search_preassigned processes the queries by batches of this
+     * size and computes the look-up tables of a batch at once. When the L2
+     * residual tables are not precomputed, the list-specific part of the
+     * tables is also shared between the queries of the batch that probe the
+     * same list. Not used with polysemous filtering.
+     */
+    size_t lut_batch_size;
+
     /** Precompute table that speed up query preprocessing at some
      * memory cost (used only for by_residual with L2 metric)
      */
@@ -65,6 +73,18 @@ struct IndexIVFPQ : IndexIVF {
             uint8_t* codes,
             bool include_listnos = false) const override;
 
+    void search_preassigned(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            const idx_t* assign,
+            const float* centroid_dis,
+            float* distances,
+            idx_t* labels,
+            bool store_pairs,
+            const IVFSearchParameters* params = nullptr,
+            IndexIVFStats* stats = nullptr) const override;
+
     void sa_decode(idx_t n, const uint8_t* bytes, float* x) const override;
 
     void add_core(
@@ -134,7 +154,8 @@ struct IndexIVFPQ : IndexIVF {
 
     InvertedListScanner* get_InvertedListScanner(
             bool store_pairs,
-            const IDSelector* sel) const override;
+            const IDSelector* sel,
+            const IVFSearchParameters* params) const override;
 
     /// build precomputed table
     void precompute_table();
@@ -24,6 +24,7 @@
 #include <faiss/invlists/BlockInvertedLists.h>
 
 #include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/impl/pq8_fast_scan.h>
 #include <faiss/impl/simd_result_handlers.h>
 #include <faiss/utils/quantize_lut.h>
 
@@ -63,7 +64,7 @@ IndexIVFPQFastScan::IndexIVFPQFastScan(const IndexIVFPQ& orig, int bbs)
                   orig.pq.code_size,
                   orig.metric_type),
           pq(orig.pq) {
-    FAISS_THROW_IF_NOT(orig.pq.nbits == 4);
+    FAISS_THROW_IF_NOT(orig.pq.nbits >= 4 && orig.pq.nbits <= 8);
 
     init_fastscan(orig.pq.M, orig.pq.nbits, orig.nlist, orig.metric_type, bbs);
 
@@ -83,15 +84,17 @@ IndexIVFPQFastScan::IndexIVFPQFastScan(const IndexIVFPQ& orig, int bbs)
     for (size_t i = 0; i < nlist; i++) {
         size_t nb = orig.invlists->list_size(i);
         size_t nb2 = roundup(nb, bbs);
-        AlignedTable<uint8_t> tmp(nb2 * M2 / 2);
-        pq4_pack_codes(
-                InvertedLists::ScopedCodes(orig.invlists, i).get(),
-                nb,
-                M,
-                nb2,
-                bbs,
-                M2,
-                tmp.get());
+        InvertedLists::ScopedCodes orig_codes(orig.invlists, i);
+        AlignedTable<uint8_t> tmp;
+        if (nbits == 4) {
+            tmp.resize(nb2 * M2 / 2);
+            pq4_pack_codes(orig_codes.get(), nb, M, nb2, bbs, M2, tmp.get());
+        } else {
+            tmp.resize(nb2 * M2);
+            tmp.clear();
+            pq8_pack_codes_range(
+                    orig_codes.get(), M, nbits, 0, nb, bbs, M2, tmp.get());
+        }
         invlists->add_entries(
                 i,
                 nb,
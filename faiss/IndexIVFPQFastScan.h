@@ -16,7 +16,14 @@
 
 namespace faiss {
 
-/** Fast scan version of IVFPQ. Works for 4-bit PQ for now.
+/** Fast scan version of IVFPQ. Works for 4-bit PQ, and for 5 to 8-bit PQ
+ * with the split LUT kernels of pq8_fast_scan.h.
+ *
+ * The split LUT kernels cost ksub / 16 table lookups per sub-quantizer, so
+ * they are faster than IndexIVFPQ up to about 6 bits. At 8 bits the scan is
+ * not faster than the float LUT scan of IndexIVFPQ, which has a dedicated
+ * 8-bit code path: use IndexIVFPQ there (see
+ * benchs/bench_ivf_fastscan_nbits.cpp).
  *
  * The codes in the inverted lists are not stored sequentially but
  * grouped in blocks of size bbs. This makes it possible to very quickly
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexIVFRaBitQ.h>
+
+#include <cstring>
+#include <memory>
+
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/utils/Heap.h>
+
+namespace faiss {
+
+IndexIVFRaBitQ::IndexIVFRaBitQ(
+        Index* quantizer,
+        size_t d,
+        size_t nlist,
+        MetricType metric)
+        : IndexIVF(quantizer, d, nlist, 0, metric), rabitq(d, metric) {
+    code_size = rabitq.code_size;
+    invlists->code_size = code_size;
+    by_residual = true;
+    is_trained = false;
+}
+
+IndexIVFRaBitQ::IndexIVFRaBitQ() : IndexIVF() {
+    by_residual = true;
+}
+
+void IndexIVFRaBitQ::encode_vectors(
+        idx_t n,
+        const float* x,
+        const idx_t* list_nos,
+        uint8_t* codes,
+        bool include_listnos) const {
+    size_t coarse_size = include_listnos ? coarse_code_size() : 0;
+    memset(codes, 0, (code_size + coarse_size) * n);
+
+#pragma omp parallel if (n > 1000)
+    {
+        std::vector<float> centroid(d);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            int64_t list_no = list_nos[i];
+            if (list_no >= 0) {
+                uint8_t* code = codes + i * (code_size + coarse_size);
+                quantizer->reconstruct(list_no, centroid.data());
+                if (coarse_size) {
+                    encode_listno(list_no, code);
+                }
+                rabitq.compute_codes_core(
+                        x + i * d, code + coarse_size, 1, centroid.data());
+            }
+        }
+    }
+}
+
+void IndexIVFRaBitQ::sa_decode(idx_t n, const uint8_t* codes, float* x)
+        const {
+    size_t coarse_size = coarse_code_size();
+
+#pragma omp parallel if (n > 1000)
+    {
+        std::vector<float> centroid(d);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            const uint8_t* code = codes + i * (code_size + coarse_size);
+            int64_t list_no = decode_listno(code);
+            quantizer->reconstruct(list_no, centroid.data());
+            rabitq.decode_core(
+                    code + coarse_size, x + i * d, 1, centroid.data());
+        }
+    }
+}
+
+void IndexIVFRaBitQ::reconstruct_from_offset(
+        int64_t list_no,
+        int64_t offset,
+        float* recons) const {
+    InvertedLists::ScopedCodes code(invlists, list_no, offset);
+    std::vector<float> centroid(d);
+    quantizer->reconstruct(list_no, centroid.data());
+    rabitq.decode_core(code.get(), recons, 1, centroid.data());
+}
+
+namespace {
+
+template <bool use_sel>
+struct IVFRaBitQScanner : InvertedListScanner {
+    const IndexIVFRaBitQ& index;
+    RaBitQQuery query;
+    std::vector<float> centroid;
+    const float* x = nullptr;
+
+    IVFRaBitQScanner(
+            const IndexIVFRaBitQ& index,
+            bool store_pairs,
+            const IDSelector* sel,
+            uint8_t qb,
+            float epsilon)
+            : InvertedListScanner(store_pairs, sel),
+              index(index),
+              query(index.rabitq, qb, epsilon),
+              centroid(index.d) {
+        keep_max = is_similarity_metric(index.metric_type);
+        code_size = index.code_size;
+    }
+
+    void set_query(const float* query_vector) override {
+        x = query_vector;
+    }
+
+    void set_list(idx_t list_no, float /* coarse_dis */) override {
+        this->list_no = list_no;
+        index.quantizer->reconstruct(list_no, centroid.data());
+        query.set_query(x, centroid.data());
+    }
+
+    float distance_to_code(const uint8_t* code) const override {
+        return query.distance(code);
+    }
+
+    template <class C>
+    size_t scan_codes_C(
+            size_t list_size,
+            const uint8_t* codes,
+            const idx_t* ids,
+            float* simi,
+            idx_t* idxi,
+            size_t k) const {
+        size_t nup = 0;
+        for (size_t j = 0; j < list_size; j++, codes += code_size) {
+            if (use_sel && !sel->is_member(ids[j])) {
+                continue;
+            }
+            float dis = query.distance(codes);
+            if (C::cmp(simi[0], dis)) {
+                int64_t id = store_pairs ? lo_build(list_no, j) : ids[j];
+                heap_replace_top<C>(k, simi, idxi, dis, id);
+                nup++;
+            }
+        }
+        return nup;
+    }
+
+    size_t scan_codes(
+            size_t list_size,
+            const uint8_t* codes,
+            const idx_t* ids,
+            float* simi,
+            idx_t* idxi,
+            size_t k) const override {
+        if (keep_max) {
+            return scan_codes_C<CMin<float, idx_t>>(
+                    list_size, codes, ids, simi, idxi, k);
+        } else {
+            return scan_codes_C<CMax<float, idx_t>>(
+                    list_size, codes, ids, simi, idxi, k);
+        }
+    }
+
+    void scan_codes_range(
+            size_t list_size,
+            const uint8_t* codes,
+            const idx_t* ids,
+            float radius,
+            RangeQueryResult& res) const override {
+        for (size_t j = 0; j < list_size; j++, codes += code_size) {
+            if (use_sel && !sel->is_member(ids[j])) {
+                continue;
+            }
+            float dis = query.distance(codes);
+            if (keep_max ? dis > radius : dis < radius) {
+                int64_t id = store_pairs ? lo_build(list_no, j) : ids[j];
+                res.add(dis, id);
+            }
+        }
+    }
+};
+
+} // namespace
+
+InvertedListScanner* IndexIVFRaBitQ::get_InvertedListScanner(
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters* params_in) const {
+    uint8_t qb = this->qb;
+    float epsilon = 0;
+    if (auto params =
+                dynamic_cast<const SearchParametersIVFRaBitQ*>(params_in)) {
+        qb = params->qb;
+        epsilon = params->epsilon;
+    }
+    if (sel) {
+        return new IVFRaBitQScanner<true>(*this, store_pairs, sel, qb, epsilon);
+    } else {
+        return new IVFRaBitQScanner<false>(
+                *this, store_pairs, sel, qb, epsilon);
+    }
+}
+
+} // namespace faiss
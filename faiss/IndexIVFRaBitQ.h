@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <faiss/IndexIVF.h>
+#include <faiss/impl/RaBitQuantizer.h>
+
+namespace faiss {
+
+struct SearchParametersIVFRaBitQ : SearchParametersIVF {
+    /// nb of bits of the quantized query components (0 = float)
+    uint8_t qb = 4;
+    /// see SearchParametersRaBitQ::epsilon
+    float epsilon = 0;
+};
+
+/** IVF index with RaBitQ codes of the residuals w.r.t. the centroids: 1
+ * bit per dimension plus 3 floats.
+ */
+struct IndexIVFRaBitQ : IndexIVF {
+    RaBitQuantizer rabitq;
+
+    /// default nb of bits of the quantized queries
+    uint8_t qb = 4;
+
+    IndexIVFRaBitQ(
+            Index* quantizer,
+            size_t d,
+            size_t nlist,
+            MetricType metric = METRIC_L2);
+
+    IndexIVFRaBitQ();
+
+    void encode_vectors(
+            idx_t n,
+            const float* x,
+            const idx_t* list_nos,
+            uint8_t* codes,
+            bool include_listnos = false) const override;
+
+    InvertedListScanner* get_InvertedListScanner(
+            bool store_pairs,
+            const IDSelector* sel,
+            const IVFSearchParameters* params) const override;
+
+    void reconstruct_from_offset(int64_t list_no, int64_t offset, float* recons)
+            const override;
+
+    /* standalone codec interface */
+    void sa_decode(idx_t n, const uint8_t* bytes, float* x) const override;
+};
+
+} // namespace faiss
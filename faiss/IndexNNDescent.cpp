@@ -127,7 +127,9 @@ void IndexNNDescent::search(
 
 #pragma omp parallel
         {
-            VisitedTable vt(ntotal);
+            VisitedTable vt(
+                    ntotal,
+                    VisitedTable::choose_mode(ntotal, nndescent.search_L));
 
             std::unique_ptr<DistanceComputer> dis(
                     storage_distance_computer(storage));
@@ -178,6 +180,14 @@ void IndexNNDescent::reset() {
     ntotal = 0;
 }
 
+void IndexNNDescent::permute_entries(const idx_t* perm) {
+    auto flat_storage = dynamic_cast<IndexFlatCodes*>(storage);
+    FAISS_THROW_IF_NOT_MSG(
+            flat_storage, "don't know how to permute this index");
+    flat_storage->permute_entries(perm);
+    nndescent.permute_entries(perm);
+}
+
 void IndexNNDescent::reconstruct(idx_t key, float* recons) const {
     storage->reconstruct(key, recons);
 }
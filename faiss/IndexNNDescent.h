@@ -58,6 +58,9 @@ struct IndexNNDescent : Index {
     void reconstruct(idx_t key, float* recons) const override;
 
     void reset() override;
+
+    /// perm of size ntotal maps new to old positions
+    void permute_entries(const idx_t* perm);
 };
 
 /** Flat index topped with with a NNDescent structure to access elements
@@ -77,7 +77,7 @@ void IndexNSG::search(
 
 #pragma omp parallel
         {
-            VisitedTable vt(ntotal);
+            VisitedTable vt(ntotal, VisitedTable::choose_mode(ntotal, L));
 
             std::unique_ptr<DistanceComputer> dis(
                     storage_distance_computer(storage));
@@ -237,6 +237,14 @@ void IndexNSG::reset() {
     is_built = false;
 }
 
+void IndexNSG::permute_entries(const idx_t* perm) {
+    auto flat_storage = dynamic_cast<IndexFlatCodes*>(storage);
+    FAISS_THROW_IF_NOT_MSG(
+            flat_storage, "don't know how to permute this index");
+    flat_storage->permute_entries(perm);
+    nsg.permute_entries(perm);
+}
+
 void IndexNSG::reconstruct(idx_t key, float* recons) const {
     storage->reconstruct(key, recons);
 }
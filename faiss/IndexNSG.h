@@ -74,6 +74,9 @@ struct IndexNSG : Index {
     void reset() override;
 
     void check_knn_graph(const idx_t* knn_graph, idx_t n, int K) const;
+
+    /// perm of size ntotal maps new to old positions
+    void permute_entries(const idx_t* perm);
 };
 
 /** Flat index topped with with a NSG structure to access elements
@@ -24,6 +24,8 @@
 
 namespace faiss {
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 /*********************************************************
  * IndexPQ implementation
  ********************************************************/
@@ -71,6 +73,19 @@ void IndexPQ::train(idx_t n, const float* x) {
     is_trained = true;
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
+/* The distance computers are compiled once per SIMD level, see
+ * utils/simd_levels.h. */
+
+namespace index_pq {
+
+template <SIMDLevel>
+FlatCodesDistanceComputer* get_FlatCodesDistanceComputer(
+        const IndexPQ& index);
+
+} // namespace index_pq
+
 namespace {
 
 template <class PQDecoder>
@@ -91,6 +106,30 @@ struct PQDistanceComputer : FlatCodesDistanceComputer {
         return dis;
     }
 
+    void distances_batch_4(
+            const idx_t idx0,
+            const idx_t idx1,
+            const idx_t idx2,
+            const idx_t idx3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) final {
+        ndis += 4;
+        distance_four_codes<PQDecoder>(
+                pq.M,
+                pq.nbits,
+                precomputed_table.data(),
+                codes + idx0 * code_size,
+                codes + idx1 * code_size,
+                codes + idx2 * code_size,
+                codes + idx3 * code_size,
+                dis0,
+                dis1,
+                dis2,
+                dis3);
+    }
+
     float symmetric_dis(idx_t i, idx_t j) override {
         FAISS_THROW_IF_NOT(sdc);
         const float* sdci = sdc;
@@ -110,8 +149,9 @@ struct PQDistanceComputer : FlatCodesDistanceComputer {
             : FlatCodesDistanceComputer(
                       storage.codes.data(),
                       storage.code_size),
-              pq(storage.pq) {
-        precomputed_table.resize(pq.M * pq.ksub);
+              pq(storage.pq),
+              // not resized, see FAISS_SIMD_NAMESPACE_BEGIN
+              precomputed_table(pq.M * pq.ksub) {
         nb = storage.ntotal;
         d = storage.d;
         metric = storage.metric_type;
@@ -134,16 +174,24 @@ struct PQDistanceComputer : FlatCodesDistanceComputer {
 
 } // namespace
 
-FlatCodesDistanceComputer* IndexPQ::get_FlatCodesDistanceComputer() const {
-    if (pq.nbits == 8) {
-        return new PQDistanceComputer<PQDecoder8>(*this);
-    } else if (pq.nbits == 16) {
-        return new PQDistanceComputer<PQDecoder16>(*this);
+template <>
+FlatCodesDistanceComputer* index_pq::get_FlatCodesDistanceComputer<
+        FAISS_THIS_SIMD_LEVEL>(const IndexPQ& index) {
+    if (index.pq.nbits == 8) {
+        return new PQDistanceComputer<PQDecoder8>(index);
+    } else if (index.pq.nbits == 16) {
+        return new PQDistanceComputer<PQDecoder16>(index);
     } else {
-        return new PQDistanceComputer<PQDecoderGeneric>(*this);
+        return new PQDistanceComputer<PQDecoderGeneric>(index);
     }
 }
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
+FlatCodesDistanceComputer* IndexPQ::get_FlatCodesDistanceComputer() const {
+    DISPATCH_SIMDLevel(index_pq::get_FlatCodesDistanceComputer, *this);
+}
+
 /*****************************************
  * IndexPQ polysemous search routines
  ******************************************/
@@ -1112,4 +1160,6 @@ void MultiIndexQuantizer2::search(
     }
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
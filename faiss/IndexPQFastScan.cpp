@@ -15,6 +15,7 @@
 
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/impl/pq8_fast_scan.h>
 #include <faiss/utils/utils.h>
 
 namespace faiss {
@@ -41,8 +42,16 @@ IndexPQFastScan::IndexPQFastScan(const IndexPQ& orig, int bbs) : pq(orig.pq) {
     orig_codes = orig.codes.data();
 
     // pack the codes
-    codes.resize(ntotal2 * M2 / 2);
-    pq4_pack_codes(orig.codes.data(), ntotal, M, ntotal2, bbs, M2, codes.get());
+    if (nbits == 4) {
+        codes.resize(ntotal2 * M2 / 2);
+        pq4_pack_codes(
+                orig.codes.data(), ntotal, M, ntotal2, bbs, M2, codes.get());
+    } else {
+        codes.resize(ntotal2 * M2);
+        codes.clear();
+        pq8_pack_codes_range(
+                orig.codes.data(), M, nbits, 0, ntotal, bbs, M2, codes.get());
+    }
 }
 
 void IndexPQFastScan::train(idx_t n, const float* x) {
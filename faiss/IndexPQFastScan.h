@@ -14,7 +14,10 @@
 
 namespace faiss {
 
-/** Fast scan version of IndexPQ. Works for 4-bit PQ for now.
+/** Fast scan version of IndexPQ. Works for 4-bit PQ, and for 5 to 8-bit PQ
+ * with the split LUT kernels of pq8_fast_scan.h (implem 14 and 15 only).
+ * At 8 bits the gain over IndexPQ is small (about 15% for PQ32 in d=64,
+ * against 14x at 6 bits).
  *
  * The codes are not stored sequentially but grouped in blocks of size bbs.
  * This makes it possible to compute distances quickly with SIMD instructions.
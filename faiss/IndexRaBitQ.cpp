@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/IndexRaBitQ.h>
+
+#include <memory>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/ResultHandler.h>
+
+namespace faiss {
+
+IndexRaBitQ::IndexRaBitQ(idx_t d, MetricType metric)
+        : IndexFlatCodes(0, d, metric), rabitq(d, metric) {
+    code_size = rabitq.code_size;
+    is_trained = false;
+}
+
+IndexRaBitQ::IndexRaBitQ() : IndexRaBitQ(0) {}
+
+void IndexRaBitQ::train(idx_t n, const float* x) {
+    FAISS_THROW_IF_NOT(n > 0);
+    std::vector<double> sum(d);
+    for (idx_t i = 0; i < n; i++) {
+        for (int j = 0; j < d; j++) {
+            sum[j] += x[i * d + j];
+        }
+    }
+    center.resize(d);
+    for (int j = 0; j < d; j++) {
+        center[j] = sum[j] / n;
+    }
+    is_trained = true;
+}
+
+namespace {
+
+struct Run_search_RaBitQ {
+    using T = void;
+
+    template <class BlockResultHandler>
+    void f(BlockResultHandler& res,
+           const IndexRaBitQ* index,
+           const float* x,
+           uint8_t qb,
+           float epsilon) {
+        size_t ntotal = index->ntotal;
+        size_t code_size = index->code_size;
+        using SingleResultHandler =
+                typename BlockResultHandler::SingleResultHandler;
+#pragma omp parallel
+        {
+            std::unique_ptr<FlatCodesDistanceComputer> dc(
+                    index->get_RaBitQDistanceComputer(qb, epsilon));
+            SingleResultHandler resi(res);
+#pragma omp for
+            for (int64_t q = 0; q < int64_t(res.nq); q++) {
+                resi.begin(q);
+                dc->set_query(x + index->d * q);
+                for (size_t i = 0; i < ntotal; i++) {
+                    if (res.is_in_selection(i)) {
+                        const uint8_t* code =
+                                index->codes.data() + i * code_size;
+                        resi.add_result(dc->distance_to_code(code), i);
+                    }
+                }
+                resi.end();
+            }
+        }
+    }
+};
+
+void get_rabitq_params(
+        const IndexRaBitQ& index,
+        const SearchParameters* params_in,
+        uint8_t& qb,
+        float& epsilon) {
+    qb = index.qb;
+    epsilon = 0;
+    if (auto params = dynamic_cast<const SearchParametersRaBitQ*>(params_in)) {
+        qb = params->qb;
+        epsilon = params->epsilon;
+    }
+}
+
+} // namespace
+
+void IndexRaBitQ::search(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params) const {
+    FAISS_THROW_IF_NOT(k > 0);
+    FAISS_THROW_IF_NOT(is_trained);
+    uint8_t qb;
+    float epsilon;
+    get_rabitq_params(*this, params, qb, epsilon);
+    const IDSelector* sel = params ? params->sel : nullptr;
+    Run_search_RaBitQ r;
+    dispatch_knn_ResultHandler(
+            n, distances, labels, k, metric_type, sel, r, this, x, qb, epsilon);
+}
+
+void IndexRaBitQ::range_search(
+        idx_t n,
+        const float* x,
+        float radius,
+        RangeSearchResult* result,
+        const SearchParameters* params) const {
+    FAISS_THROW_IF_NOT(is_trained);
+    FAISS_THROW_IF_NOT(size_t(n) == result->nq);
+    uint8_t qb;
+    float epsilon;
+    get_rabitq_params(*this, params, qb, epsilon);
+    const IDSelector* sel = params ? params->sel : nullptr;
+    Run_search_RaBitQ r;
+    dispatch_range_ResultHandler(
+            result, radius, metric_type, sel, r, this, x, qb, epsilon);
+}
+
+FlatCodesDistanceComputer* IndexRaBitQ::get_FlatCodesDistanceComputer()
+        const {
+    return get_RaBitQDistanceComputer(qb);
+}
+
+FlatCodesDistanceComputer* IndexRaBitQ::get_RaBitQDistanceComputer(
+        uint8_t qb,
+        float epsilon) const {
+    FlatCodesDistanceComputer* dc =
+            rabitq.get_distance_computer(qb, center.data(), epsilon);
+    dc->codes = codes.data();
+    return dc;
+}
+
+void IndexRaBitQ::sa_encode(idx_t n, const float* x, uint8_t* bytes) const {
+    FAISS_THROW_IF_NOT(is_trained);
+    rabitq.compute_codes_core(x, bytes, n, center.data());
+}
+
+void IndexRaBitQ::sa_decode(idx_t n, const uint8_t* bytes, float* x) const {
+    FAISS_THROW_IF_NOT(is_trained);
+    rabitq.decode_core(bytes, x, n, center.data());
+}
+
+} // namespace faiss
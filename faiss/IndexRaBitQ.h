@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <vector>
+
+#include <faiss/IndexFlatCodes.h>
+#include <faiss/impl/RaBitQuantizer.h>
+
+namespace faiss {
+
+struct SearchParametersRaBitQ : SearchParameters {
+    /// nb of bits of the quantized query components (0 = float)
+    uint8_t qb = 4;
+    /** if > 0, the search returns optimistic bounds of the distances
+     * instead of estimates, with this multiplier of the error bound. See
+     * IndexRefineSearchParameters::base_distances_are_bounds */
+    float epsilon = 0;
+};
+
+/** Flat index with RaBitQ codes: 1 bit per dimension plus 3 floats. The
+ * codes are relative to the center of the training vectors.
+ */
+struct IndexRaBitQ : IndexFlatCodes {
+    RaBitQuantizer rabitq;
+
+    /// mean of the training vectors, size d
+    std::vector<float> center;
+
+    /// default nb of bits of the quantized queries
+    uint8_t qb = 4;
+
+    explicit IndexRaBitQ(idx_t d, MetricType metric = METRIC_L2);
+
+    IndexRaBitQ();
+
+    void train(idx_t n, const float* x) override;
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    void range_search(
+            idx_t n,
+            const float* x,
+            float radius,
+            RangeSearchResult* result,
+            const SearchParameters* params = nullptr) const override;
+
+    FlatCodesDistanceComputer* get_FlatCodesDistanceComputer() const override;
+
+    /// distance computer with non-default qb and bounds
+    FlatCodesDistanceComputer* get_RaBitQDistanceComputer(
+            uint8_t qb,
+            float epsilon = 0) const;
+
+    /* standalone codec interface */
+    void sa_encode(idx_t n, const float* x, uint8_t* bytes) const override;
+
+    void sa_decode(idx_t n, const uint8_t* bytes, float* x) const override;
+};
+
+} // namespace faiss
@@ -10,6 +10,7 @@
 #include <faiss/IndexFlat.h>
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/SearchTrace.h>
 #include <faiss/utils/Heap.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/utils.h>
@@ -88,6 +89,40 @@ static void reorder_2_heaps(
     }
 }
 
+/** Rerank the candidates of one query, sorted by their bounds, until the
+ * bound of the next candidate cannot beat the k-th exact distance. The
+ * remaining candidates are removed. Returns the nb of reranked
+ * candidates. */
+template <class C>
+idx_t rerank_with_bounds(
+        DistanceComputer& dc,
+        idx_t k,
+        idx_t k_base,
+        idx_t* base_labels,
+        float* base_distances) {
+    // k best exact distances so far
+    std::vector<float> heap_dis(k);
+    std::vector<idx_t> heap_ids(k);
+    heap_heapify<C>(k, heap_dis.data(), heap_ids.data());
+    idx_t j = 0;
+    for (; j < k_base; j++) {
+        idx_t idx = base_labels[j];
+        if (idx < 0 || !C::cmp(heap_dis[0], base_distances[j])) {
+            break;
+        }
+        float dis = dc(idx);
+        base_distances[j] = dis;
+        if (C::cmp(heap_dis[0], dis)) {
+            heap_replace_top<C>(k, heap_dis.data(), heap_ids.data(), dis, idx);
+        }
+    }
+    for (idx_t j2 = j; j2 < k_base; j2++) {
+        base_labels[j2] = -1;
+        base_distances[j2] = C::neutral();
+    }
+    return j;
+}
+
 } // anonymous namespace
 
 void IndexRefine::search(
@@ -108,6 +143,7 @@ void IndexRefine::search(
                                        : idx_t(k * k_factor);
     SearchParameters* base_index_params =
             (params != nullptr) ? params->base_index_params : nullptr;
+    bool base_bounds = params && params->base_distances_are_bounds;
 
     FAISS_THROW_IF_NOT(k_base >= k);
 
@@ -128,6 +164,11 @@ void IndexRefine::search(
         del2.reset(base_distances);
     }
 
+    // the stages of the base index are recorded if base_index_params has
+    // the same trace
+    SearchTrace* trace = params ? params->trace : nullptr;
+    SearchTraceScope trace_scope(trace, n);
+
     base_index->search(
             n, x, k_base, base_distances, base_labels, base_index_params);
 
@@ -141,19 +182,43 @@ void IndexRefine::search(
                 refine_index->get_distance_computer());
 #pragma omp for
         for (idx_t i = 0; i < n; i++) {
+            QueryTraceTimer timer(trace ? &trace->queries[i] : nullptr);
             dc->set_query(x + i * d);
-            idx_t ij = i * k_base;
-            for (idx_t j = 0; j < k_base; j++) {
-                idx_t idx = base_labels[ij];
-                if (idx < 0)
-                    break;
-                base_distances[ij] = (*dc)(idx);
-                ij++;
+            idx_t nrerank;
+            if (base_bounds) {
+                nrerank = metric_type == METRIC_L2
+                        ? rerank_with_bounds<CMax<float, idx_t>>(
+                                  *dc,
+                                  k,
+                                  k_base,
+                                  base_labels + i * k_base,
+                                  base_distances + i * k_base)
+                        : rerank_with_bounds<CMin<float, idx_t>>(
+                                  *dc,
+                                  k,
+                                  k_base,
+                                  base_labels + i * k_base,
+                                  base_distances + i * k_base);
+            } else {
+                idx_t ij = i * k_base;
+                for (idx_t j = 0; j < k_base; j++) {
+                    idx_t idx = base_labels[ij];
+                    if (idx < 0)
+                        break;
+                    base_distances[ij] = (*dc)(idx);
+                    ij++;
+                }
+                nrerank = ij - i * k_base;
+            }
+            timer.step(QueryTrace::rerank);
+            if (timer.qt) {
+                timer.qt->ndis += nrerank;
             }
         }
     }
 
     // sort and store result
+    uint64_t t0 = trace ? get_cycles() : 0;
     if (metric_type == METRIC_L2) {
         typedef CMax<float, idx_t> C;
         reorder_2_heaps<C>(
@@ -166,6 +231,13 @@ void IndexRefine::search(
     } else {
         FAISS_THROW_MSG("Metric type not supported");
     }
+    if (trace) {
+        SearchTrace::add_block(
+                trace->queries.data(),
+                n,
+                QueryTrace::rerank,
+                get_cycles() - t0);
+    }
 }
 
 void IndexRefine::reconstruct(idx_t key, float* recons) const {
@@ -248,6 +320,12 @@ void IndexRefineFlat::search(
                 params, "IndexRefineFlat params have incorrect type");
     }
 
+    if (params && params->base_distances_are_bounds) {
+        // the early stop is implemented with a DistanceComputer
+        IndexRefine::search(n, x, k, distances, labels, params);
+        return;
+    }
+
     idx_t k_base = (params != nullptr) ? idx_t(k * params->k_factor)
                                        : idx_t(k * k_factor);
     SearchParameters* base_index_params =
@@ -272,6 +350,9 @@ void IndexRefineFlat::search(
         del2.reset(base_distances);
     }
 
+    SearchTrace* trace = params ? params->trace : nullptr;
+    SearchTraceScope trace_scope(trace, n);
+
     base_index->search(
             n, x, k_base, base_distances, base_labels, base_index_params);
 
@@ -279,6 +360,7 @@ void IndexRefineFlat::search(
         assert(base_labels[i] >= -1 && base_labels[i] < ntotal);
 
     // compute refined distances
+    uint64_t t0 = trace ? get_cycles() : 0;
     auto rf = dynamic_cast<const IndexFlat*>(refine_index);
     FAISS_THROW_IF_NOT(rf);
 
@@ -297,6 +379,13 @@ void IndexRefineFlat::search(
     } else {
         FAISS_THROW_MSG("Metric type not supported");
     }
+    if (trace) {
+        SearchTrace::add_block(
+                trace->queries.data(),
+                n,
+                QueryTrace::rerank,
+                get_cycles() - t0);
+    }
 }
 
 } // namespace faiss
@@ -15,6 +15,12 @@ struct IndexRefineSearchParameters : SearchParameters {
     float k_factor = 1;
     SearchParameters* base_index_params = nullptr; // non-owning
 
+    /** the base index returns bounds of the exact distances (lower bounds
+     * for L2, upper bounds for inner products, eg. IndexRaBitQ with
+     * epsilon > 0). Then the candidates are reranked in order, until the
+     * bound of the next one cannot beat the k-th exact distance. */
+    bool base_distances_are_bounds = false;
+
     virtual ~IndexRefineSearchParameters() = default;
 };
 
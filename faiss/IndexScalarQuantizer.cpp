@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 #include <omp.h>
 
@@ -18,6 +19,8 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
 #include <faiss/impl/ScalarQuantizer.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/distances_int8.h>
 #include <faiss/utils/utils.h>
 
 namespace faiss {
@@ -60,6 +63,23 @@ void IndexScalarQuantizer::search(
     FAISS_THROW_IF_NOT(
             metric_type == METRIC_L2 || metric_type == METRIC_INNER_PRODUCT);
 
+    if (sq.qtype == ScalarQuantizer::QT_8bit_direct_signed &&
+        sq.query_quantization != ScalarQuantizer::QQ_none && n >= 4) {
+        // compare the codes with 4 queries at a time
+        knn_int8(
+                x,
+                codes.data(),
+                d,
+                n,
+                ntotal,
+                metric_type,
+                k,
+                distances,
+                labels,
+                sel);
+        return;
+    }
+
 #pragma omp parallel
     {
         std::unique_ptr<InvertedListScanner> scanner(
@@ -255,11 +275,88 @@ void IndexIVFScalarQuantizer::add_core(
 
 InvertedListScanner* IndexIVFScalarQuantizer::get_InvertedListScanner(
         bool store_pairs,
-        const IDSelector* sel) const {
+        const IDSelector* sel,
+        const IVFSearchParameters*) const {
     return sq.select_InvertedListScanner(
             metric_type, quantizer, store_pairs, sel, by_residual);
 }
 
+namespace {
+
+/// the tiles are decoded once, and the queries are compared with the
+/// decoded vectors, as in the scanners of ScalarQuantizer
+struct IVFSQBlockScanner : InvertedListBlockScannerFloat {
+    const Index* quantizer;
+    bool by_residual;
+    std::unique_ptr<ScalarQuantizer::SQuantizer> squant;
+    size_t code_size;
+    std::vector<float> centroid;
+    std::vector<float> tile;
+
+    IVFSQBlockScanner(
+            const IndexIVFScalarQuantizer& ivf,
+            bool store_pairs,
+            const IDSelector* sel)
+            : InvertedListBlockScannerFloat(
+                      ivf.d,
+                      ivf.metric_type,
+                      store_pairs,
+                      sel),
+              quantizer(ivf.quantizer),
+              by_residual(ivf.by_residual),
+              squant(ivf.sq.select_quantizer()),
+              code_size(ivf.sq.code_size),
+              centroid(ivf.d) {}
+
+    void set_list(
+            idx_t list_no,
+            size_t nq,
+            const float* x,
+            const idx_t* qnos,
+            const float* coarse_dis) override {
+        this->list_no = list_no;
+        xq.resize(nq * d);
+        accu0.assign(nq, 0);
+        bool sub_centroid = by_residual && metric == METRIC_L2;
+        if (sub_centroid) {
+            quantizer->reconstruct(list_no, centroid.data());
+        }
+        for (size_t i = 0; i < nq; i++) {
+            const float* xi = x + qnos[i] * d;
+            float* xqi = xq.data() + i * d;
+            if (sub_centroid) {
+                fvec_sub(d, xi, centroid.data(), xqi);
+            } else {
+                memcpy(xqi, xi, sizeof(float) * d);
+            }
+            if (by_residual && metric == METRIC_INNER_PRODUCT) {
+                accu0[i] = coarse_dis[i];
+            }
+        }
+    }
+
+    const float* decode_tile(size_t n, const uint8_t* codes) override {
+        tile.resize(n * d);
+        for (size_t j = 0; j < n; j++) {
+            squant->decode_vector(codes + j * code_size, tile.data() + j * d);
+        }
+        return tile.data();
+    }
+};
+
+} // namespace
+
+InvertedListBlockScanner* IndexIVFScalarQuantizer::get_InvertedListBlockScanner(
+        bool store_pairs,
+        const IDSelector* sel,
+        const IVFSearchParameters*) const {
+    if ((metric_type != METRIC_L2 && metric_type != METRIC_INNER_PRODUCT) ||
+        sq.query_quantization != ScalarQuantizer::QQ_none) {
+        return nullptr;
+    }
+    return new IVFSQBlockScanner(*this, store_pairs, sel);
+}
+
 void IndexIVFScalarQuantizer::reconstruct_from_offset(
         int64_t list_no,
         int64_t offset,
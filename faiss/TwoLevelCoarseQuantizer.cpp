@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/TwoLevelCoarseQuantizer.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/Heap.h>
+#include <faiss/utils/distances.h>
+
+namespace faiss {
+
+TwoLevelCoarseQuantizer::TwoLevelCoarseQuantizer(
+        int d,
+        size_t nlist1,
+        size_t nlist2,
+        MetricType metric)
+        : Index(d, metric),
+          nlist1(nlist1),
+          nlist2(nlist2),
+          top_quantizer(d, metric),
+          sub_centroids(d, metric) {
+    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    // same as Level1Quantizer: few iterations for large clusterings
+    cp.niter = 10;
+    cp.spherical = metric == METRIC_INNER_PRODUCT;
+    is_trained = false;
+}
+
+TwoLevelCoarseQuantizer::TwoLevelCoarseQuantizer()
+        : TwoLevelCoarseQuantizer(0, 0, 0) {}
+
+void TwoLevelCoarseQuantizer::train(idx_t n, const float* x) {
+    FAISS_THROW_IF_NOT(nlist1 > 0 && nlist2 > 0);
+    reset();
+
+    if (verbose) {
+        printf("Training the %zd top-level centroids on %" PRId64
+               " vectors\n",
+               nlist1,
+               n);
+    }
+    Clustering clus(d, nlist1, cp);
+    clus.verbose = verbose;
+    clus.train(n, x, top_quantizer);
+
+    // sort the training vectors by top-level cell
+    std::vector<idx_t> assign(n);
+    top_quantizer.assign(n, x, assign.data());
+    std::vector<size_t> lims(nlist1 + 1);
+    for (idx_t i = 0; i < n; i++) {
+        lims[assign[i] + 1]++;
+    }
+    for (size_t i = 0; i < nlist1; i++) {
+        lims[i + 1] += lims[i];
+    }
+    std::vector<idx_t> perm(n);
+    {
+        std::vector<size_t> ofs(lims.begin(), lims.end() - 1);
+        for (idx_t i = 0; i < n; i++) {
+            perm[ofs[assign[i]]++] = i;
+        }
+    }
+
+    if (verbose) {
+        printf("Training %zd sub-centroids in each top-level cell\n", nlist2);
+    }
+    std::vector<float> centroids(nlist1 * nlist2 * d);
+    std::vector<float> xi;
+    for (size_t i = 0; i < nlist1; i++) {
+        size_t ni = lims[i + 1] - lims[i];
+        xi.resize(ni * d);
+        for (size_t j = 0; j < ni; j++) {
+            memcpy(xi.data() + j * d,
+                   x + perm[lims[i] + j] * d,
+                   sizeof(float) * d);
+        }
+        float* ci = centroids.data() + i * nlist2 * d;
+
+        if (ni >= nlist2) {
+            Clustering clus2(d, nlist2, cp);
+            IndexFlat assigner(d, metric_type);
+            clus2.train(ni, xi.data(), assigner);
+            memcpy(ci, clus2.centroids.data(), sizeof(float) * nlist2 * d);
+        } else {
+            // too few vectors: use them as sub-centroids and pad with the
+            // top-level centroid, the corresponding lists will be empty
+            memcpy(ci, xi.data(), sizeof(float) * ni * d);
+            for (size_t j = ni; j < nlist2; j++) {
+                top_quantizer.reconstruct(i, ci + j * d);
+            }
+        }
+    }
+    sub_centroids.add(nlist1 * nlist2, centroids.data());
+
+    ntotal = nlist1 * nlist2;
+    is_trained = true;
+}
+
+void TwoLevelCoarseQuantizer::add(idx_t, const float*) {
+    FAISS_THROW_MSG("add not supported, the centroids are set by train()");
+}
+
+namespace {
+
+template <class C>
+void search_sub_centroids(
+        const TwoLevelCoarseQuantizer& index,
+        idx_t n,
+        const float* x,
+        size_t nprobe1,
+        const idx_t* top_labels,
+        idx_t k,
+        float* distances,
+        idx_t* labels) {
+    size_t d = index.d;
+    size_t nlist2 = index.nlist2;
+    const float* sub_centroids = index.sub_centroids.get_xb();
+
+#pragma omp parallel if (n > 1)
+    {
+        std::vector<float> dis(nlist2);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            const float* xi = x + i * d;
+            float* simi = distances + i * k;
+            idx_t* idxi = labels + i * k;
+            heap_heapify<C>(k, simi, idxi);
+
+            for (size_t j = 0; j < nprobe1; j++) {
+                idx_t list1 = top_labels[i * nprobe1 + j];
+                if (list1 < 0) {
+                    break;
+                }
+                const float* cj = sub_centroids + list1 * nlist2 * d;
+                if (index.metric_type == METRIC_L2) {
+                    fvec_L2sqr_ny(dis.data(), xi, cj, d, nlist2);
+                } else {
+                    fvec_inner_products_ny(dis.data(), xi, cj, d, nlist2);
+                }
+                for (size_t l = 0; l < nlist2; l++) {
+                    if (C::cmp(simi[0], dis[l])) {
+                        heap_replace_top<C>(
+                                k, simi, idxi, dis[l], list1 * nlist2 + l);
+                    }
+                }
+            }
+            heap_reorder<C>(k, simi, idxi);
+        }
+    }
+}
+
+} // anonymous namespace
+
+void TwoLevelCoarseQuantizer::search(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params_in) const {
+    FAISS_THROW_IF_NOT(k > 0);
+    FAISS_THROW_IF_NOT(is_trained);
+
+    size_t nprobe1 = this->nprobe1;
+    if (params_in) {
+        auto params = dynamic_cast<const SearchParametersTwoLevel*>(params_in);
+        FAISS_THROW_IF_NOT_MSG(params, "need SearchParametersTwoLevel");
+        if (params->nprobe1 > 0) {
+            nprobe1 = params->nprobe1;
+        }
+    }
+    nprobe1 = std::max(nprobe1, (k + nlist2 - 1) / nlist2);
+    nprobe1 = std::min(nprobe1, nlist1);
+
+    std::vector<float> top_distances(n * nprobe1);
+    std::vector<idx_t> top_labels(n * nprobe1);
+    top_quantizer.search(
+            n, x, nprobe1, top_distances.data(), top_labels.data());
+
+    if (metric_type == METRIC_L2) {
+        search_sub_centroids<CMax<float, idx_t>>(
+                *this, n, x, nprobe1, top_labels.data(), k, distances, labels);
+    } else {
+        search_sub_centroids<CMin<float, idx_t>>(
+                *this, n, x, nprobe1, top_labels.data(), k, distances, labels);
+    }
+}
+
+void TwoLevelCoarseQuantizer::reset() {
+    top_quantizer.reset();
+    sub_centroids.reset();
+    ntotal = 0;
+    is_trained = false;
+}
+
+void TwoLevelCoarseQuantizer::reconstruct(idx_t key, float* recons) const {
+    sub_centroids.reconstruct(key, recons);
+}
+
+} // namespace faiss
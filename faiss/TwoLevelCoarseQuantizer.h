@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <faiss/Clustering.h>
+#include <faiss/IndexFlat.h>
+
+namespace faiss {
+
+struct SearchParametersTwoLevel : SearchParameters {
+    /// nb of top-level cells to visit, 0 = use the index default
+    size_t nprobe1 = 0;
+};
+
+/** Coarse quantizer with nlist1 * nlist2 centroids for IVF indexes with a
+ * very large number of lists.
+ *
+ * Training is a hierarchical k-means: the training vectors are clustered
+ * into nlist1 top-level centroids, then the vectors of each top-level cell
+ * are clustered into nlist2 sub-centroids. Centroid i * nlist2 + j is the
+ * j-th sub-centroid of top-level cell i.
+ *
+ * The search looks up the nprobe1 nearest top-level centroids and computes
+ * the distances to their sub-centroids only, so that the assignment costs
+ * nlist1 + nprobe1 * nlist2 distances instead of nlist1 * nlist2. The
+ * results are approximate: a nearest sub-centroid may belong to a top-level
+ * cell that is not visited.
+ *
+ * Use it with IndexIVF::quantizer_trains_alone = 1.
+ */
+struct TwoLevelCoarseQuantizer : Index {
+    size_t nlist1; ///< nb of top-level centroids
+    size_t nlist2; ///< nb of sub-centroids per top-level centroid
+
+    /// the nlist1 top-level centroids
+    IndexFlat top_quantizer;
+
+    /// the nlist1 * nlist2 sub-centroids, grouped by top-level cell
+    IndexFlat sub_centroids;
+
+    /// nb of top-level cells visited at search time. At least
+    /// ceil(k / nlist2) cells are visited so that k results are found
+    size_t nprobe1 = 16;
+
+    /// parameters of the k-means at both levels
+    ClusteringParameters cp;
+
+    TwoLevelCoarseQuantizer(
+            int d,
+            size_t nlist1,
+            size_t nlist2,
+            MetricType metric = METRIC_L2);
+
+    TwoLevelCoarseQuantizer();
+
+    void train(idx_t n, const float* x) override;
+
+    /// not supported, the centroids are set by train()
+    void add(idx_t n, const float* x) override;
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    void reset() override;
+
+    void reconstruct(idx_t key, float* recons) const override;
+};
+
+} // namespace faiss
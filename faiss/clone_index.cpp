@@ -39,6 +39,7 @@
 #include <faiss/IndexScalarQuantizer.h>
 
 #include <faiss/MetaIndexes.h>
+#include <faiss/TwoLevelCoarseQuantizer.h>
 #include <faiss/VectorTransform.h>
 
 #include <faiss/impl/LocalSearchQuantizer.h>
@@ -274,6 +275,7 @@ Index* Cloner::clone_Index(const Index* index) {
 
     TRYCLONE(IndexScalarQuantizer, index)
     TRYCLONE(MultiIndexQuantizer, index)
+    TRYCLONE(TwoLevelCoarseQuantizer, index)
 
     if (const IndexIVF* ivf = dynamic_cast<const IndexIVF*>(index)) {
         IndexIVF* res = clone_IndexIVF(ivf);
@@ -318,6 +320,8 @@ Index* Cloner::clone_Index(const Index* index) {
         res->own_fields = true;
         // make sure we don't get a GPU index here
         res->storage = Cloner::clone_Index(ihnsw->storage);
+        // the online state is tied to the original storage
+        res->hnsw.online.reset();
         return res;
     } else if (const IndexNSG* insg = dynamic_cast<const IndexNSG*>(index)) {
         IndexNSG* res = clone_IndexNSG(insg);
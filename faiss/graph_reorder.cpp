@@ -0,0 +1,368 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/graph_reorder.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIDMap.h>
+#include <faiss/IndexNNDescent.h>
+#include <faiss/IndexNSG.h>
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+namespace {
+
+/// reverse adjacency lists in the same format
+void reverse_graph(
+        idx_t n,
+        const size_t* lims,
+        const int32_t* adj,
+        std::vector<size_t>& rlims,
+        std::vector<int32_t>& radj) {
+    rlims.assign(n + 1, 0);
+    for (size_t j = 0; j < lims[n]; j++) {
+        if (adj[j] >= 0) {
+            rlims[adj[j] + 1]++;
+        }
+    }
+    for (idx_t i = 0; i < n; i++) {
+        rlims[i + 1] += rlims[i];
+    }
+    radj.resize(rlims[n]);
+    std::vector<size_t> ofs(rlims.begin(), rlims.end() - 1);
+    for (idx_t i = 0; i < n; i++) {
+        for (size_t j = lims[i]; j < lims[i + 1]; j++) {
+            if (adj[j] >= 0) {
+                radj[ofs[adj[j]]++] = i;
+            }
+        }
+    }
+}
+
+void order_bfs(
+        idx_t n,
+        const size_t* lims,
+        const int32_t* adj,
+        idx_t start,
+        idx_t* order) {
+    std::vector<bool> visited(n);
+    idx_t nvisited = 0, qbegin = 0;
+    idx_t next_start = 0;
+    while (nvisited < n) {
+        if (start < 0 || visited[start]) {
+            while (visited[next_start]) {
+                next_start++;
+            }
+            start = next_start;
+        }
+        visited[start] = true;
+        order[nvisited++] = start;
+        // order[qbegin:nvisited] is the queue
+        while (qbegin < nvisited) {
+            idx_t u = order[qbegin++];
+            for (size_t j = lims[u]; j < lims[u + 1]; j++) {
+                int32_t v = adj[j];
+                if (v >= 0 && !visited[v]) {
+                    visited[v] = true;
+                    order[nvisited++] = v;
+                }
+            }
+        }
+    }
+}
+
+void order_rcm(idx_t n, const size_t* lims, const int32_t* adj, idx_t* order) {
+    // undirected version of the graph
+    std::vector<size_t> rlims;
+    std::vector<int32_t> radj;
+    reverse_graph(n, lims, adj, rlims, radj);
+    std::vector<size_t> slims(n + 1);
+    std::vector<int32_t> sadj;
+    sadj.reserve(lims[n] + rlims[n]);
+    for (idx_t i = 0; i < n; i++) {
+        size_t begin = sadj.size();
+        for (size_t j = lims[i]; j < lims[i + 1]; j++) {
+            if (adj[j] >= 0 && adj[j] != i) {
+                sadj.push_back(adj[j]);
+            }
+        }
+        for (size_t j = rlims[i]; j < rlims[i + 1]; j++) {
+            if (radj[j] != i) {
+                sadj.push_back(radj[j]);
+            }
+        }
+        std::sort(sadj.begin() + begin, sadj.end());
+        sadj.erase(std::unique(sadj.begin() + begin, sadj.end()), sadj.end());
+        slims[i + 1] = sadj.size();
+    }
+    auto degree = [&](idx_t i) { return slims[i + 1] - slims[i]; };
+
+    // each component starts from its node of minimum degree
+    std::vector<int32_t> by_degree(n);
+    for (idx_t i = 0; i < n; i++) {
+        by_degree[i] = i;
+    }
+    std::stable_sort(
+            by_degree.begin(), by_degree.end(), [&](int32_t a, int32_t b) {
+                return degree(a) < degree(b);
+            });
+
+    std::vector<bool> visited(n);
+    idx_t nvisited = 0, qbegin = 0;
+    size_t next_start = 0;
+    while (nvisited < n) {
+        while (visited[by_degree[next_start]]) {
+            next_start++;
+        }
+        idx_t start = by_degree[next_start];
+        visited[start] = true;
+        order[nvisited++] = start;
+        while (qbegin < nvisited) {
+            idx_t u = order[qbegin++];
+            idx_t first = nvisited;
+            for (size_t j = slims[u]; j < slims[u + 1]; j++) {
+                int32_t v = sadj[j];
+                if (!visited[v]) {
+                    visited[v] = true;
+                    order[nvisited++] = v;
+                }
+            }
+            std::stable_sort(
+                    order + first, order + nvisited, [&](idx_t a, idx_t b) {
+                        return degree(a) < degree(b);
+                    });
+        }
+    }
+    std::reverse(order, order + n);
+}
+
+/* Priority queue with integer keys that are incremented and decremented
+ * by small steps, as used in the Gorder paper. Each key value has a
+ * doubly-linked list of the nodes with that key, so that updates are
+ * O(1). */
+struct UnitHeap {
+    std::vector<int32_t> key, prev, next;
+    std::vector<int32_t> head; // first node of each key
+    int32_t top = 0;           // upper bound of the max key
+
+    explicit UnitHeap(idx_t n) : key(n, 0), prev(n), next(n), head(1, -1) {
+        for (idx_t i = n - 1; i >= 0; i--) {
+            insert(i);
+        }
+    }
+
+    void insert(int32_t v) {
+        int32_t k = key[v];
+        if (k >= int32_t(head.size())) {
+            head.resize(k + 1, -1);
+        }
+        prev[v] = -1;
+        next[v] = head[k];
+        if (head[k] >= 0) {
+            prev[head[k]] = v;
+        }
+        head[k] = v;
+        top = std::max(top, k);
+    }
+
+    void remove(int32_t v) {
+        if (prev[v] >= 0) {
+            next[prev[v]] = next[v];
+        } else {
+            head[key[v]] = next[v];
+        }
+        if (next[v] >= 0) {
+            prev[next[v]] = prev[v];
+        }
+    }
+
+    void update(int32_t v, int32_t delta) {
+        remove(v);
+        key[v] += delta;
+        insert(v);
+    }
+
+    int32_t pop() {
+        while (head[top] < 0) {
+            top--;
+        }
+        int32_t v = head[top];
+        remove(v);
+        return v;
+    }
+};
+
+void order_gorder(
+        idx_t n,
+        const size_t* lims,
+        const int32_t* adj,
+        idx_t start,
+        idx_t* order,
+        int window) {
+    std::vector<size_t> rlims;
+    std::vector<int32_t> radj;
+    reverse_graph(n, lims, adj, rlims, radj);
+
+    UnitHeap heap(n);
+    std::vector<bool> placed(n);
+
+    // the score of a candidate v is the number of links between v and the
+    // last window placed nodes, plus the number of their common
+    // in-neighbors
+    auto update_scores = [&](idx_t u, int32_t delta) {
+        for (size_t j = lims[u]; j < lims[u + 1]; j++) {
+            int32_t v = adj[j];
+            if (v >= 0 && !placed[v]) {
+                heap.update(v, delta);
+            }
+        }
+        for (size_t j = rlims[u]; j < rlims[u + 1]; j++) {
+            int32_t w = radj[j];
+            if (!placed[w]) {
+                heap.update(w, delta);
+            }
+            for (size_t l = lims[w]; l < lims[w + 1]; l++) {
+                int32_t v = adj[l];
+                if (v >= 0 && v != u && !placed[v]) {
+                    heap.update(v, delta);
+                }
+            }
+        }
+    };
+
+    if (start < 0) {
+        // the node with the largest in-degree
+        start = 0;
+        for (idx_t i = 1; i < n; i++) {
+            if (rlims[i + 1] - rlims[i] > rlims[start + 1] - rlims[start]) {
+                start = i;
+            }
+        }
+    }
+    heap.remove(start);
+    for (idx_t i = 0; i < n; i++) {
+        idx_t u = i == 0 ? start : heap.pop();
+        placed[u] = true;
+        order[i] = u;
+        update_scores(u, 1);
+        if (i >= window) {
+            update_scores(order[i - window], -1);
+        }
+    }
+}
+
+} // anonymous namespace
+
+void graph_reorder_permutation(
+        idx_t n,
+        const size_t* lims,
+        const int32_t* adj,
+        GraphReorderMethod method,
+        idx_t start,
+        idx_t* perm,
+        int window) {
+    if (n == 0) {
+        return;
+    }
+    FAISS_THROW_IF_NOT(start < n);
+    switch (method) {
+        case GRAPH_REORDER_BFS:
+            order_bfs(n, lims, adj, start, perm);
+            break;
+        case GRAPH_REORDER_RCM:
+            order_rcm(n, lims, adj, perm);
+            break;
+        case GRAPH_REORDER_GORDER:
+            FAISS_THROW_IF_NOT(window > 0);
+            order_gorder(n, lims, adj, start, perm, window);
+            break;
+        default:
+            FAISS_THROW_MSG("unknown graph reordering method");
+    }
+}
+
+void reorder_graph_index(
+        Index* index,
+        GraphReorderMethod method,
+        idx_t* perm_out) {
+    IndexIDMap* idmap = dynamic_cast<IndexIDMap*>(index);
+    Index* sub = idmap ? idmap->index : index;
+    idx_t n = sub->ntotal;
+
+    // extract the graph, for HNSW only level 0 is used
+    std::vector<size_t> lims(n + 1);
+    std::vector<int32_t> adj;
+    idx_t start = -1;
+    if (auto ihnsw = dynamic_cast<IndexHNSW*>(sub)) {
+        const HNSW& hnsw = ihnsw->hnsw;
+        FAISS_THROW_IF_NOT(hnsw.levels.size() == n);
+        size_t nb0 = hnsw.nb_neighbors(0);
+        adj.resize(n * nb0);
+        for (idx_t i = 0; i < n; i++) {
+            size_t begin, end;
+            hnsw.neighbor_range(i, 0, &begin, &end);
+            memcpy(adj.data() + i * nb0,
+                   hnsw.neighbors.data() + begin,
+                   sizeof(int32_t) * nb0);
+            lims[i + 1] = (i + 1) * nb0;
+        }
+        start = hnsw.entry_point;
+    } else if (auto insg = dynamic_cast<IndexNSG*>(sub)) {
+        const NSG& nsg = insg->nsg;
+        FAISS_THROW_IF_NOT_MSG(nsg.is_built, "the graph is not built");
+        const nsg::Graph<int>& graph = *nsg.final_graph;
+        adj.assign(graph.data, graph.data + size_t(n) * graph.K);
+        for (idx_t i = 0; i < n; i++) {
+            lims[i + 1] = (i + 1) * graph.K;
+        }
+        start = nsg.enterpoint;
+    } else if (auto innd = dynamic_cast<IndexNNDescent*>(sub)) {
+        const NNDescent& nnd = innd->nndescent;
+        FAISS_THROW_IF_NOT_MSG(nnd.has_built, "the graph is not built");
+        adj = nnd.final_graph;
+        for (idx_t i = 0; i < n; i++) {
+            lims[i + 1] = (i + 1) * nnd.K;
+        }
+    } else {
+        FAISS_THROW_MSG("reorder_graph_index: unsupported index type");
+    }
+
+    std::vector<idx_t> perm(n);
+    graph_reorder_permutation(
+            n, lims.data(), adj.data(), method, start, perm.data());
+
+    if (auto ihnsw = dynamic_cast<IndexHNSW*>(sub)) {
+        ihnsw->permute_entries(perm.data());
+    } else if (auto insg = dynamic_cast<IndexNSG*>(sub)) {
+        insg->permute_entries(perm.data());
+    } else if (auto innd = dynamic_cast<IndexNNDescent*>(sub)) {
+        innd->permute_entries(perm.data());
+    }
+
+    if (idmap) {
+        std::vector<idx_t> new_id_map(n);
+        for (idx_t i = 0; i < n; i++) {
+            new_id_map[i] = idmap->id_map[perm[i]];
+        }
+        idmap->id_map = std::move(new_id_map);
+        if (auto idmap2 = dynamic_cast<IndexIDMap2*>(idmap)) {
+            idmap2->construct_rev_map();
+        }
+    }
+    if (perm_out) {
+        memcpy(perm_out, perm.data(), sizeof(idx_t) * n);
+    }
+}
+
+} // namespace faiss
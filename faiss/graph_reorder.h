@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+// Locality-preserving renumbering of graph-based indexes
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <faiss/MetricType.h>
+
+namespace faiss {
+
+struct Index;
+
+enum GraphReorderMethod {
+    /// breadth-first traversal from the entry point
+    GRAPH_REORDER_BFS = 0,
+    /// reverse Cuthill-McKee, reduces the bandwidth of the adjacency matrix
+    GRAPH_REORDER_RCM,
+    /** Gorder (Wei et al., "Speedup Graph Processing by Graph Ordering",
+     * SIGMOD'16): greedily places next the node that shares the most
+     * links and in-neighbors with the last placed nodes. Slower to
+     * compute, usually the best cache locality. */
+    GRAPH_REORDER_GORDER,
+};
+
+/** Compute a node ordering of a directed graph given as adjacency lists
+ *
+ * @param n       number of nodes
+ * @param lims    size n + 1, the neighbors of node i are
+ *                adj[lims[i]] .. adj[lims[i + 1] - 1]
+ * @param adj     neighbors, entries < 0 are ignored
+ * @param start   node where the traversal starts for BFS and Gorder, -1
+ *                for the default: node 0 for BFS, the node with maximum
+ *                in-degree for Gorder. Unused by RCM, which starts each
+ *                component from its node of minimum degree
+ * @param perm    output, size n, perm[new number] = old number
+ * @param window  window size for Gorder
+ */
+void graph_reorder_permutation(
+        idx_t n,
+        const size_t* lims,
+        const int32_t* adj,
+        GraphReorderMethod method,
+        idx_t start,
+        idx_t* perm,
+        int window = 5);
+
+/** Renumber the vectors of a graph-based index (IndexHNSW, IndexNSG or
+ * IndexNNDescent) so that nodes that are linked in the graph get close
+ * numbers, and their codes and links land on the same pages and cache
+ * lines. The graph and the storage codes (which must be an
+ * IndexFlatCodes) are permuted in place.
+ *
+ * If the index is an IndexIDMap / IndexIDMap2, its id map is permuted as
+ * well, so that the labels returned by search do not change. Otherwise
+ * the result labels are the new numbers, that perm maps back to the
+ * previous ones.
+ *
+ * @param perm  optional output, size ntotal, perm[new number] = old number
+ */
+void reorder_graph_index(
+        Index* index,
+        GraphReorderMethod method,
+        idx_t* perm = nullptr);
+
+} // namespace faiss
@@ -261,4 +261,61 @@ void TimeoutCallback::reset(double timeout_in_seconds) {
     tc->set_timeout(timeout_in_seconds);
 }
 
+/***********************************************************************
+ * VisitedTable
+ ***********************************************************************/
+
+VisitedTable::VisitedTable(size_t size, Mode mode) : mode(mode), visno(1) {
+    if (mode == VT_bytes) {
+        visited.resize(size);
+    } else if (mode == VT_bitset) {
+        bits.resize((size + 63) / 64);
+        word_epoch.resize((size + 63) / 64);
+    } else {
+        FAISS_THROW_IF_NOT(mode == VT_hash);
+        hash_table.resize(4096, -1);
+    }
+}
+
+VisitedTable::Mode VisitedTable::choose_mode(size_t size, int ef) {
+    // below 4M elements the byte table is the fastest and not too large
+    if (size <= (size_t(1) << 22)) {
+        return VT_bytes;
+    }
+    // a graph search visits in the order of ef * degree elements, the
+    // hash table is at least twice as large (4 bytes per entry)
+    size_t expected_visits = size_t(std::max(ef, 1)) * 64;
+    size_t hash_bytes = 2 * expected_visits * sizeof(int32_t);
+    // one 64-bit word and one epoch byte per 64 elements
+    size_t nwords = (size + 63) / 64;
+    size_t bitset_bytes = nwords * (sizeof(uint64_t) + 1);
+    // probing the hash set is slower than testing a bit, so it must be
+    // much smaller than the bitset to be worth it
+    if (hash_bytes * 8 <= bitset_bytes) {
+        return VT_hash;
+    }
+    return VT_bitset;
+}
+
+size_t VisitedTable::memory_usage() const {
+    return visited.size() + bits.size() * sizeof(bits[0]) + word_epoch.size() +
+            hash_table.size() * sizeof(hash_table[0]);
+}
+
+void VisitedTable::hash_grow() {
+    std::vector<int32_t> old_table(hash_table.size() * 2, -1);
+    old_table.swap(hash_table);
+    size_t mask = hash_table.size() - 1;
+    for (int32_t k : old_table) {
+        if (k == -1) {
+            continue;
+        }
+        size_t i = hash_slot(k, mask);
+        while (hash_table[i] != -1) {
+            i = (i + 1) & mask;
+        }
+        hash_table[i] = k;
+    }
+}
+
 } // namespace faiss
@@ -13,6 +13,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <mutex>
@@ -20,6 +21,7 @@
 
 #include <faiss/MetricType.h>
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/prefetch.h>
 
 namespace faiss {
 
@@ -169,32 +171,156 @@ struct TimeoutCallback : InterruptCallback {
     static void reset(double timeout_in_seconds);
 };
 
-/// set implementation optimized for fast access.
+/** set implementation optimized for fast access.
+ *
+ * The default implementation uses one byte per element and is reset with
+ * a memset every 250 queries. For very large graphs, this takes a lot of
+ * memory per searching thread, so two compact implementations are
+ * available behind the same interface:
+ *
+ * - VT_bitset: one bit per element, plus one epoch byte per 64-bit word.
+ *   A word that has a stale epoch is considered empty, so only the epoch
+ *   array (1/64 of the elements) needs to be cleared, every 250 queries.
+ *
+ * - VT_hash: an open-addressing hash set of the visited elements, for
+ *   searches that visit a small number of elements (small ef). Its size
+ *   does not depend on the number of elements.
+ *
+ * choose_mode selects one based on the number of elements and ef.
+ */
 struct VisitedTable {
+    enum Mode {
+        VT_bytes,  ///< one byte per element
+        VT_bitset, ///< one bit per element with per-word epochs
+        VT_hash,   ///< hash set of the visited elements
+    };
+
+    Mode mode = VT_bytes;
+
+    /// VT_bytes: element is visited iff visited[no] == visno
     std::vector<uint8_t> visited;
+
+    /// current epoch for VT_bytes and VT_bitset
     uint8_t visno;
 
+    /// VT_bitset: bits[no / 64] is valid iff word_epoch[no / 64] == visno
+    std::vector<uint64_t> bits;
+    std::vector<uint8_t> word_epoch;
+
+    /// VT_hash: table of visited elements (-1 = empty), size power of 2
+    std::vector<int32_t> hash_table;
+    size_t hash_count = 0;
+
     explicit VisitedTable(int size) : visited(size), visno(1) {}
 
+    VisitedTable(size_t size, Mode mode);
+
+    /** implementation to use for a graph search among size elements with
+     * the given queue size (efSearch or equivalent). Above 4M elements,
+     * VT_hash is used if its expected size is at most 1/8 of the memory of
+     * VT_bitset, both in bytes. */
+    static Mode choose_mode(size_t size, int ef);
+
     /// set flag #no to true
     void set(int no) {
-        visited[no] = visno;
+        if (mode == VT_bytes) {
+            visited[no] = visno;
+        } else if (mode == VT_bitset) {
+            size_t w = no >> 6;
+            if (word_epoch[w] != visno) {
+                word_epoch[w] = visno;
+                bits[w] = 0;
+            }
+            bits[w] |= uint64_t(1) << (no & 63);
+        } else {
+            hash_insert(no);
+        }
     }
 
     /// get flag #no
     bool get(int no) const {
-        return visited[no] == visno;
+        if (mode == VT_bytes) {
+            return visited[no] == visno;
+        } else if (mode == VT_bitset) {
+            size_t w = no >> 6;
+            return word_epoch[w] == visno && (bits[w] >> (no & 63)) & 1;
+        } else {
+            return hash_contains(no);
+        }
+    }
+
+    /// prefetch the memory for flag #no
+    void prefetch(int no) const {
+        if (mode == VT_bytes) {
+            prefetch_L2(visited.data() + no);
+        } else if (mode == VT_bitset) {
+            prefetch_L2(bits.data() + (no >> 6));
+        }
     }
 
     /// reset all flags to false
     void advance() {
+        if (mode == VT_hash) {
+            if (hash_count > 0) {
+                std::fill(hash_table.begin(), hash_table.end(), -1);
+                hash_count = 0;
+            }
+            return;
+        }
         visno++;
         if (visno == 250) {
             // 250 rather than 255 because sometimes we use visno and visno+1
-            memset(visited.data(), 0, sizeof(visited[0]) * visited.size());
+            if (mode == VT_bytes) {
+                memset(visited.data(), 0, sizeof(visited[0]) * visited.size());
+            } else {
+                memset(word_epoch.data(), 0, word_epoch.size());
+            }
             visno = 1;
         }
     }
+
+    /// memory used by the table, in bytes
+    size_t memory_usage() const;
+
+   private:
+    static size_t hash_slot(int no, size_t mask) {
+        return (uint32_t(no) * 0x9E3779B1u) & mask;
+    }
+
+    bool hash_contains(int no) const {
+        size_t mask = hash_table.size() - 1;
+        for (size_t i = hash_slot(no, mask);; i = (i + 1) & mask) {
+            int32_t k = hash_table[i];
+            if (k == no) {
+                return true;
+            }
+            if (k == -1) {
+                return false;
+            }
+        }
+    }
+
+    void hash_insert(int no) {
+        size_t mask = hash_table.size() - 1;
+        size_t i = hash_slot(no, mask);
+        for (;; i = (i + 1) & mask) {
+            int32_t k = hash_table[i];
+            if (k == no) {
+                return;
+            }
+            if (k == -1) {
+                break;
+            }
+        }
+        hash_table[i] = no;
+        hash_count++;
+        // keep the load factor below 1/2
+        if (2 * hash_count > hash_table.size()) {
+            hash_grow();
+        }
+    }
+
+    void hash_grow();
 };
 
 } // namespace faiss
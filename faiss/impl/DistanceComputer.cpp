@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <faiss/impl/DistanceComputer.h>
+
+namespace faiss {
+
+/***********************************************************************
+ * DistanceComputer
+ ***********************************************************************/
+
+void DistanceComputer::distances_batch_4(
+        const idx_t idx0,
+        const idx_t idx1,
+        const idx_t idx2,
+        const idx_t idx3,
+        float& dis0,
+        float& dis1,
+        float& dis2,
+        float& dis3) {
+    // compute first, assign next
+    const float d0 = this->operator()(idx0);
+    const float d1 = this->operator()(idx1);
+    const float d2 = this->operator()(idx2);
+    const float d3 = this->operator()(idx3);
+    dis0 = d0;
+    dis1 = d1;
+    dis2 = d2;
+    dis3 = d3;
+}
+
+void DistanceComputer::distances_batch(
+        size_t n,
+        const idx_t* ids,
+        float* dis) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        distances_batch_4(
+                ids[i],
+                ids[i + 1],
+                ids[i + 2],
+                ids[i + 3],
+                dis[i],
+                dis[i + 1],
+                dis[i + 2],
+                dis[i + 3]);
+    }
+    for (; i < n; i++) {
+        dis[i] = this->operator()(ids[i]);
+    }
+}
+
+DistanceComputer::~DistanceComputer() {}
+
+/***********************************************************************
+ * FlatCodesDistanceComputer
+ ***********************************************************************/
+
+float FlatCodesDistanceComputer::operator()(idx_t i) {
+    return distance_to_code(codes + i * code_size);
+}
+
+void FlatCodesDistanceComputer::distances_batch(
+        size_t n,
+        const idx_t* ids,
+        float* dis) {
+    prefetch_codes(n, ids);
+    DistanceComputer::distances_batch(n, ids, dis);
+}
+
+FlatCodesDistanceComputer::~FlatCodesDistanceComputer() {}
+
+} // namespace faiss
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <faiss/Index.h>
+#include <faiss/utils/prefetch.h>
 
 namespace faiss {
 
@@ -41,22 +42,19 @@ struct DistanceComputer {
             float& dis0,
             float& dis1,
             float& dis2,
-            float& dis3) {
-        // compute first, assign next
-        const float d0 = this->operator()(idx0);
-        const float d1 = this->operator()(idx1);
-        const float d2 = this->operator()(idx2);
-        const float d3 = this->operator()(idx3);
-        dis0 = d0;
-        dis1 = d1;
-        dis2 = d2;
-        dis3 = d3;
-    }
+            float& dis3);
+
+    /// compute distances of current query to n stored vectors. This is
+    /// a single virtual call for the whole batch, implementations can use
+    /// wider kernels and prefetch the stored vectors.
+    virtual void distances_batch(size_t n, const idx_t* ids, float* dis);
 
     /// compute distance between two stored vectors
     virtual float symmetric_dis(idx_t i, idx_t j) = 0;
 
-    virtual ~DistanceComputer() {}
+    // defined out-of-line, so that the objects compiled for a SIMD level do
+    // not emit the vtable and typeinfo, see FAISS_SIMD_NAMESPACE_BEGIN
+    virtual ~DistanceComputer();
 };
 
 /* Wrap the distance computer into one that negates the
@@ -95,6 +93,13 @@ struct NegativeDistanceComputer : DistanceComputer {
         dis3 = -dis3;
     }
 
+    void distances_batch(size_t n, const idx_t* ids, float* dis) override {
+        basedis->distances_batch(n, ids, dis);
+        for (size_t i = 0; i < n; i++) {
+            dis[i] = -dis[i];
+        }
+    }
+
     /// compute distance between two stored vectors
     float symmetric_dis(idx_t i, idx_t j) override {
         return -basedis->symmetric_dis(i, j);
@@ -118,14 +123,25 @@ struct FlatCodesDistanceComputer : DistanceComputer {
 
     FlatCodesDistanceComputer() : codes(nullptr), code_size(0) {}
 
-    float operator()(idx_t i) override {
-        return distance_to_code(codes + i * code_size);
-    }
+    float operator()(idx_t i) override;
+
+    /// prefetches all the codes before computing the distances
+    void distances_batch(size_t n, const idx_t* ids, float* dis) override;
 
     /// compute distance of current query to an encoded vector
     virtual float distance_to_code(const uint8_t* code) = 0;
 
-    virtual ~FlatCodesDistanceComputer() {}
+    /// prefetch the codes of n stored vectors to L2
+    void prefetch_codes(size_t n, const idx_t* ids) const {
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t* code = codes + ids[i] * code_size;
+            for (size_t ofs = 0; ofs < code_size; ofs += 64) {
+                prefetch_L2(code + ofs);
+            }
+        }
+    }
+
+    virtual ~FlatCodesDistanceComputer();
 };
 
 } // namespace faiss
@@ -42,10 +42,19 @@ FaissException::FaissException(
             m.c_str());
 }
 
+FaissException::FaissException(
+        const char* m,
+        const char* funcName,
+        const char* file,
+        int line)
+        : FaissException(std::string(m), funcName, file, line) {}
+
 const char* FaissException::what() const noexcept {
     return msg.c_str();
 }
 
+FaissException::~FaissException() noexcept {}
+
 void handleExceptions(
         std::vector<std::pair<int, std::exception_ptr>>& exceptions) {
     if (exceptions.size() == 1) {
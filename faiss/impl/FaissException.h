@@ -29,9 +29,19 @@ class FaissException : public std::exception {
             const char* file,
             int line);
 
+    /// same, the message is not converted to std::string by the caller
+    FaissException(
+            const char* msg,
+            const char* funcName,
+            const char* file,
+            int line);
+
     /// from std::exception
     const char* what() const noexcept override;
 
+    /// not inline, so that it is emitted with the generic compilation flags
+    ~FaissException() noexcept override;
+
     std::string msg;
 };
 
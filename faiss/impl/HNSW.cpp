@@ -8,6 +8,7 @@
 #include <faiss/impl/HNSW.h>
 
 #include <cstddef>
+#include <cstring>
 #include <string>
 
 #include <faiss/impl/AuxIndexStructures.h>
@@ -103,6 +104,113 @@ void HNSW::reset() {
     offsets.push_back(0);
     levels.clear();
     neighbors.clear();
+    clear_interleaved_level_0();
+    if (online) {
+        online->set_entry_point(entry_point, max_level);
+    }
+}
+
+/**************************************************************
+ * Online mode
+ **************************************************************/
+
+HNSWOnlineState::HNSWOnlineState(size_t capacity)
+        : capacity(capacity),
+          versions(new std::atomic<uint32_t>[capacity]),
+          locks(capacity) {
+    for (size_t i = 0; i < capacity; i++) {
+        versions[i].store(0, std::memory_order_relaxed);
+        omp_init_lock(&locks[i]);
+    }
+    ntotal.store(0, std::memory_order_relaxed);
+    set_entry_point(-1, -1);
+}
+
+HNSWOnlineState::~HNSWOnlineState() {
+    for (size_t i = 0; i < capacity; i++) {
+        omp_destroy_lock(&locks[i]);
+    }
+}
+
+void HNSW::set_online(size_t capacity) {
+    if (capacity == 0) {
+        online.reset();
+        return;
+    }
+    size_t ntotal = levels.size();
+    FAISS_THROW_IF_NOT_FMT(
+            capacity >= ntotal,
+            "capacity %zd smaller than the number of vertices %zd",
+            capacity,
+            ntotal);
+    clear_interleaved_level_0();
+    levels.to_owned();
+    offsets.to_owned();
+    neighbors.to_owned();
+    levels.reserve(capacity);
+    offsets.reserve(capacity + 1);
+
+    // expected size of the neighbor table per vertex, with some margin
+    // because the levels are random
+    double per_vertex = 0;
+    for (int i = 0; i < assign_probas.size(); i++) {
+        per_vertex += assign_probas[i] * cum_nb_neighbors(i + 1);
+    }
+    size_t margin = 16 * size_t(cum_nb_neighbors(assign_probas.size()));
+    neighbors.reserve(
+            offsets.back() + size_t((capacity - ntotal) * per_vertex * 1.2) +
+            margin);
+
+    online = std::make_shared<HNSWOnlineState>(capacity);
+    online->neighbors_capacity = neighbors.capacity();
+    online->ntotal.store(ntotal, std::memory_order_release);
+    online->set_entry_point(entry_point, max_level);
+}
+
+void HNSW::get_entry_point(storage_idx_t& entry_point_out, int& max_level_out)
+        const {
+    if (online) {
+        online->get_entry_point(entry_point_out, max_level_out);
+    } else {
+        entry_point_out = entry_point;
+        max_level_out = max_level;
+    }
+}
+
+void HNSW::build_interleaved_level_0(const uint8_t* codes, size_t code_size) {
+    size_t ntotal = levels.size();
+    size_t nb_bytes = nb_neighbors(0) * sizeof(storage_idx_t);
+    if (!codes) {
+        code_size = 0;
+    }
+    // round up to a multiple of the cache line size
+    size_t block_size = (nb_bytes + code_size + 63) & ~size_t(63);
+
+    level0_blocks.resize(ntotal * block_size);
+    level0_block_size = block_size;
+    level0_code_size = code_size;
+
+    // the neighbors may be a view, read them through a const reference
+    const auto& nb = neighbors;
+
+#pragma omp parallel for if (ntotal > 10000)
+    for (int64_t i = 0; i < ntotal; i++) {
+        uint8_t* block = level0_blocks.get() + i * block_size;
+        size_t begin, end;
+        neighbor_range(i, 0, &begin, &end);
+        memcpy(block, nb.data() + begin, nb_bytes);
+        if (code_size > 0) {
+            memcpy(block + nb_bytes, codes + i * code_size, code_size);
+        }
+        size_t used = nb_bytes + code_size;
+        memset(block + used, 0, block_size - used);
+    }
+}
+
+void HNSW::clear_interleaved_level_0() {
+    level0_blocks.resize(0);
+    level0_block_size = 0;
+    level0_code_size = 0;
 }
 
 void HNSW::print_neighbor_stats(int level) const {
@@ -199,6 +307,8 @@ void HNSW::fill_with_random_links(size_t n) {
 
 int HNSW::prepare_level_tab(size_t n, bool preset_levels) {
     size_t n0 = offsets.size() - 1;
+    // the graph is going to change
+    clear_interleaved_level_0();
 
     if (preset_levels) {
         FAISS_ASSERT(n0 + n == levels.size());
@@ -275,6 +385,39 @@ using storage_idx_t = HNSW::storage_idx_t;
 using NodeDistCloser = HNSW::NodeDistCloser;
 using NodeDistFarther = HNSW::NodeDistFarther;
 
+/// pointer range of the neighbors of vertex no at a level, read from the
+/// interleaved level 0 when it is available. In online mode, the list is
+/// copied to buf (of size max_list_size(hnsw)) to get a consistent
+/// snapshot.
+inline void neighbor_ptr_range(
+        const HNSW& hnsw,
+        idx_t no,
+        int level,
+        const HNSW::storage_idx_t*& begin,
+        const HNSW::storage_idx_t*& end,
+        HNSW::storage_idx_t* buf) {
+    if (level == 0 && hnsw.has_interleaved_level_0()) {
+        begin = hnsw.interleaved_neighbors(no);
+        end = begin + hnsw.nb_neighbors(0);
+    } else {
+        size_t b, e;
+        hnsw.neighbor_range(no, level, &b, &e);
+        if (hnsw.online) {
+            hnsw.online->read_list(no, hnsw.neighbors.data() + b, e - b, buf);
+            begin = buf;
+            end = buf + (e - b);
+        } else {
+            begin = hnsw.neighbors.data() + b;
+            end = hnsw.neighbors.data() + e;
+        }
+    }
+}
+
+/// size of the buffer needed by neighbor_ptr_range (0 = not needed)
+inline size_t max_list_size(const HNSW& hnsw) {
+    return hnsw.online ? hnsw.cum_nneighbor_per_level.back() : 0;
+}
+
 /**************************************************************
  * Addition subroutines
  **************************************************************/
@@ -323,7 +466,13 @@ void add_link(
                 break;
             i--;
         }
+        if (hnsw.online) {
+            hnsw.online->begin_write(src);
+        }
         hnsw.neighbors[i] = dest;
+        if (hnsw.online) {
+            hnsw.online->end_write(src);
+        }
         return;
     }
 
@@ -340,6 +489,9 @@ void add_link(
     shrink_neighbor_list(qdis, resultSet, end - begin, keep_max_size_level0);
 
     // ...and back
+    if (hnsw.online) {
+        hnsw.online->begin_write(src);
+    }
     size_t i = begin;
     while (resultSet.size()) {
         hnsw.neighbors[i++] = resultSet.top().id;
@@ -349,6 +501,9 @@ void add_link(
     while (i < end) {
         hnsw.neighbors[i++] = -1;
     }
+    if (hnsw.online) {
+        hnsw.online->end_write(src);
+    }
 }
 
 /// search neighbors on a single level, starting from an entry point
@@ -371,6 +526,8 @@ void search_neighbors_to_add(
     results.emplace(d_entry_point, entry_point);
     vt.set(entry_point);
 
+    std::vector<storage_idx_t> neighbors_buf(max_list_size(hnsw));
+
     while (!candidates.empty()) {
         // get nearest
         const NodeDistFarther& currEv = candidates.top();
@@ -427,8 +584,12 @@ void search_neighbors_to_add(
             int n_buffered = 0;
             storage_idx_t buffered_ids[4];
 
-            for (size_t j = begin; j < end; j++) {
-                storage_idx_t nodeId = hnsw.neighbors[j];
+            const storage_idx_t *nbegin, *nend;
+            neighbor_ptr_range(
+                    hnsw, currNode, level, nbegin, nend, neighbors_buf.data());
+
+            for (const storage_idx_t* j = nbegin; j < nend; j++) {
+                storage_idx_t nodeId = *j;
                 if (nodeId < 0)
                     break;
                 if (vt.get(nodeId)) {
@@ -525,13 +686,27 @@ void HNSW::add_with_locks(
     //  greedy search on upper levels
 
     storage_idx_t nearest;
+    int level = 0; // level at which we start adding neighbors
+    if (online) {
+        online->get_entry_point(nearest, level);
+        if (nearest == -1) {
+            std::lock_guard<std::mutex> guard(online->entry_mutex);
+            online->get_entry_point(nearest, level);
+            if (nearest == -1) {
+                max_level = pt_level;
+                entry_point = pt_id;
+                online->set_entry_point(pt_id, pt_level);
+            }
+        }
+    } else {
 #pragma omp critical
-    {
-        nearest = entry_point;
+        {
+            nearest = entry_point;
 
-        if (nearest == -1) {
-            max_level = pt_level;
-            entry_point = pt_id;
+            if (nearest == -1) {
+                max_level = pt_level;
+                entry_point = pt_id;
+            }
         }
     }
 
@@ -541,7 +716,9 @@ void HNSW::add_with_locks(
 
     omp_set_lock(&locks[pt_id]);
 
-    int level = max_level; // level at which we start adding neighbors
+    if (!online) {
+        level = max_level;
+    }
     float d_nearest = ptdis(nearest);
 
     for (; level > pt_level; level--) {
@@ -562,7 +739,14 @@ void HNSW::add_with_locks(
 
     omp_unset_lock(&locks[pt_id]);
 
-    if (pt_level > max_level) {
+    if (online) {
+        std::lock_guard<std::mutex> guard(online->entry_mutex);
+        if (pt_level > max_level) {
+            max_level = pt_level;
+            entry_point = pt_id;
+            online->set_entry_point(pt_id, pt_level);
+        }
+    } else if (pt_level > max_level) {
         max_level = pt_level;
         entry_point = pt_id;
     }
@@ -575,6 +759,25 @@ void HNSW::add_with_locks(
 using MinimaxHeap = HNSW::MinimaxHeap;
 using Node = HNSW::Node;
 using C = HNSW::C;
+
+namespace {
+
+/// prefetch the code of vertex no from the interleaved level 0, so that it
+/// is in cache when the distance is computed
+inline void prefetch_interleaved_code(const HNSW& hnsw, idx_t no) {
+    const uint8_t* code =
+            hnsw.interleaved_codes() + no * hnsw.level0_block_size;
+    for (size_t ofs = 0; ofs < hnsw.level0_code_size; ofs += 64) {
+        prefetch_L1(code + ofs);
+    }
+}
+
+/// number of neighbor distances that are computed with a single call to
+/// DistanceComputer::distances_batch
+constexpr int neighbor_batch_size = 16;
+
+} // namespace
+
 /** Do a BFS on the candidates list */
 int search_from_candidates(
         const HNSW& hnsw,
@@ -594,6 +797,8 @@ int search_from_candidates(
                                : hnsw.check_relative_distance;
     int efSearch = params ? params->efSearch : hnsw.efSearch;
     const IDSelector* sel = params ? params->sel : nullptr;
+    const bool prefetch_codes = level == 0 && hnsw.level0_code_size > 0;
+    std::vector<storage_idx_t> neighbors_buf(max_list_size(hnsw));
 
     C::T threshold = res.threshold;
     for (int i = 0; i < candidates.size(); i++) {
@@ -627,23 +832,26 @@ int search_from_candidates(
             }
         }
 
-        size_t begin, end;
-        hnsw.neighbor_range(v0, level, &begin, &end);
+        const storage_idx_t *begin, *end;
+        neighbor_ptr_range(
+                hnsw, v0, level, begin, end, neighbors_buf.data());
 
         // a faster version: reference version in unit test test_hnsw.cpp
-        // the following version processes 4 neighbors at a time
-        size_t jmax = begin;
-        for (size_t j = begin; j < end; j++) {
-            int v1 = hnsw.neighbors[j];
+        // the following version computes the distances to the unvisited
+        // neighbors in batches of neighbor_batch_size
+        const storage_idx_t* jmax = begin;
+        for (const storage_idx_t* j = begin; j < end; j++) {
+            int v1 = *j;
             if (v1 < 0)
                 break;
 
-            prefetch_L2(vt.visited.data() + v1);
+            vt.prefetch(v1);
             jmax += 1;
         }
 
         int counter = 0;
-        size_t saved_j[4];
+        idx_t saved_j[neighbor_batch_size];
+        float saved_dis[neighbor_batch_size];
 
         threshold = res.threshold;
 
@@ -659,41 +867,33 @@ int search_from_candidates(
             candidates.push(idx, dis);
         };
 
-        for (size_t j = begin; j < jmax; j++) {
-            int v1 = hnsw.neighbors[j];
+        for (const storage_idx_t* j = begin; j < jmax; j++) {
+            int v1 = *j;
 
             bool vget = vt.get(v1);
             vt.set(v1);
             saved_j[counter] = v1;
+            if (prefetch_codes && !vget) {
+                prefetch_interleaved_code(hnsw, v1);
+            }
             counter += vget ? 0 : 1;
 
-            if (counter == 4) {
-                float dis[4];
-                qdis.distances_batch_4(
-                        saved_j[0],
-                        saved_j[1],
-                        saved_j[2],
-                        saved_j[3],
-                        dis[0],
-                        dis[1],
-                        dis[2],
-                        dis[3]);
-
-                for (size_t id4 = 0; id4 < 4; id4++) {
-                    add_to_heap(saved_j[id4], dis[id4]);
+            if (counter == neighbor_batch_size) {
+                qdis.distances_batch(counter, saved_j, saved_dis);
+                for (int i = 0; i < counter; i++) {
+                    add_to_heap(saved_j[i], saved_dis[i]);
                 }
-
-                ndis += 4;
-
+                ndis += counter;
                 counter = 0;
             }
         }
 
-        for (size_t icnt = 0; icnt < counter; icnt++) {
-            float dis = qdis(saved_j[icnt]);
-            add_to_heap(saved_j[icnt], dis);
-
-            ndis += 1;
+        if (counter > 0) {
+            qdis.distances_batch(counter, saved_j, saved_dis);
+            for (int i = 0; i < counter; i++) {
+                add_to_heap(saved_j[i], saved_dis[i]);
+            }
+            ndis += counter;
         }
 
         nstep++;
@@ -722,6 +922,8 @@ std::priority_queue<HNSW::Node> search_from_candidate_unbounded(
         VisitedTable* vt,
         HNSWStats& stats) {
     int ndis = 0;
+    const bool prefetch_codes = hnsw.level0_code_size > 0;
+    std::vector<storage_idx_t> neighbors_buf(max_list_size(hnsw));
     std::priority_queue<Node> top_candidates;
     std::priority_queue<Node, std::vector<Node>, std::greater<Node>> candidates;
 
@@ -741,23 +943,25 @@ std::priority_queue<HNSW::Node> search_from_candidate_unbounded(
 
         candidates.pop();
 
-        size_t begin, end;
-        hnsw.neighbor_range(v0, 0, &begin, &end);
+        const storage_idx_t *begin, *end;
+        neighbor_ptr_range(hnsw, v0, 0, begin, end, neighbors_buf.data());
 
         // a faster version: reference version in unit test test_hnsw.cpp
-        // the following version processes 4 neighbors at a time
-        size_t jmax = begin;
-        for (size_t j = begin; j < end; j++) {
-            int v1 = hnsw.neighbors[j];
+        // the following version computes the distances to the unvisited
+        // neighbors in batches of neighbor_batch_size
+        const storage_idx_t* jmax = begin;
+        for (const storage_idx_t* j = begin; j < end; j++) {
+            int v1 = *j;
             if (v1 < 0)
                 break;
 
-            prefetch_L2(vt->visited.data() + v1);
+            vt->prefetch(v1);
             jmax += 1;
         }
 
         int counter = 0;
-        size_t saved_j[4];
+        idx_t saved_j[neighbor_batch_size];
+        float saved_dis[neighbor_batch_size];
 
         auto add_to_heap = [&](const size_t idx, const float dis) {
             if (top_candidates.top().first > dis ||
@@ -771,41 +975,33 @@ std::priority_queue<HNSW::Node> search_from_candidate_unbounded(
             }
         };
 
-        for (size_t j = begin; j < jmax; j++) {
-            int v1 = hnsw.neighbors[j];
+        for (const storage_idx_t* j = begin; j < jmax; j++) {
+            int v1 = *j;
 
             bool vget = vt->get(v1);
             vt->set(v1);
             saved_j[counter] = v1;
+            if (prefetch_codes && !vget) {
+                prefetch_interleaved_code(hnsw, v1);
+            }
             counter += vget ? 0 : 1;
 
-            if (counter == 4) {
-                float dis[4];
-                qdis.distances_batch_4(
-                        saved_j[0],
-                        saved_j[1],
-                        saved_j[2],
-                        saved_j[3],
-                        dis[0],
-                        dis[1],
-                        dis[2],
-                        dis[3]);
-
-                for (size_t id4 = 0; id4 < 4; id4++) {
-                    add_to_heap(saved_j[id4], dis[id4]);
+            if (counter == neighbor_batch_size) {
+                qdis.distances_batch(counter, saved_j, saved_dis);
+                for (int i = 0; i < counter; i++) {
+                    add_to_heap(saved_j[i], saved_dis[i]);
                 }
-
-                ndis += 4;
-
+                ndis += counter;
                 counter = 0;
             }
         }
 
-        for (size_t icnt = 0; icnt < counter; icnt++) {
-            float dis = qdis(saved_j[icnt]);
-            add_to_heap(saved_j[icnt], dis);
-
-            ndis += 1;
+        if (counter > 0) {
+            qdis.distances_batch(counter, saved_j, saved_dis);
+            for (int i = 0; i < counter; i++) {
+                add_to_heap(saved_j[i], saved_dis[i]);
+            }
+            ndis += counter;
         }
 
         stats.nhops += 1;
@@ -828,30 +1024,38 @@ HNSWStats greedy_update_nearest(
         storage_idx_t& nearest,
         float& d_nearest) {
     HNSWStats stats;
+    std::vector<storage_idx_t> neighbors_buf(max_list_size(hnsw));
 
     for (;;) {
         storage_idx_t prev_nearest = nearest;
 
-        size_t begin, end;
-        hnsw.neighbor_range(nearest, level, &begin, &end);
+        const storage_idx_t *begin, *end;
+        neighbor_ptr_range(
+                hnsw, nearest, level, begin, end, neighbors_buf.data());
 
         size_t ndis = 0;
 
         // a faster version: reference version in unit test test_hnsw.cpp
-        // the following version processes 4 neighbors at a time
-        auto update_with_candidate = [&](const storage_idx_t idx,
-                                         const float dis) {
-            if (dis < d_nearest) {
-                nearest = idx;
-                d_nearest = dis;
+        // the following version computes the distances in batches of
+        // neighbor_batch_size
+        auto update_with_candidates = [&](int n,
+                                          const idx_t* ids,
+                                          float* dis) {
+            qdis.distances_batch(n, ids, dis);
+            for (int i = 0; i < n; i++) {
+                if (dis[i] < d_nearest) {
+                    nearest = ids[i];
+                    d_nearest = dis[i];
+                }
             }
         };
 
         int n_buffered = 0;
-        storage_idx_t buffered_ids[4];
+        idx_t buffered_ids[neighbor_batch_size];
+        float buffered_dis[neighbor_batch_size];
 
-        for (size_t j = begin; j < end; j++) {
-            storage_idx_t v = hnsw.neighbors[j];
+        for (const storage_idx_t* j = begin; j < end; j++) {
+            storage_idx_t v = *j;
             if (v < 0)
                 break;
             ndis += 1;
@@ -859,30 +1063,15 @@ HNSWStats greedy_update_nearest(
             buffered_ids[n_buffered] = v;
             n_buffered += 1;
 
-            if (n_buffered == 4) {
-                float dis[4];
-                qdis.distances_batch_4(
-                        buffered_ids[0],
-                        buffered_ids[1],
-                        buffered_ids[2],
-                        buffered_ids[3],
-                        dis[0],
-                        dis[1],
-                        dis[2],
-                        dis[3]);
-
-                for (size_t id4 = 0; id4 < 4; id4++) {
-                    update_with_candidate(buffered_ids[id4], dis[id4]);
-                }
-
+            if (n_buffered == neighbor_batch_size) {
+                update_with_candidates(n_buffered, buffered_ids, buffered_dis);
                 n_buffered = 0;
             }
         }
 
         // process leftovers
-        for (size_t icnt = 0; icnt < n_buffered; icnt++) {
-            float dis = qdis(buffered_ids[icnt]);
-            update_with_candidate(buffered_ids[icnt], dis);
+        if (n_buffered > 0) {
+            update_with_candidates(n_buffered, buffered_ids, buffered_dis);
         }
 
         // update stats
@@ -917,7 +1106,10 @@ HNSWStats HNSW::search(
         VisitedTable& vt,
         const SearchParametersHNSW* params) const {
     HNSWStats stats;
-    if (entry_point == -1) {
+    storage_idx_t nearest;
+    int top_level;
+    get_entry_point(nearest, top_level);
+    if (nearest == -1) {
         return stats;
     }
     int k = extract_k_from_ResultHandler(res);
@@ -926,10 +1118,9 @@ HNSWStats HNSW::search(
             params ? params->bounded_queue : this->search_bounded_queue;
 
     //  greedy search on upper levels
-    storage_idx_t nearest = entry_point;
     float d_nearest = qdis(nearest);
 
-    for (int level = max_level; level >= 1; level--) {
+    for (int level = top_level; level >= 1; level--) {
         HNSWStats local_stats =
                 greedy_update_nearest(*this, qdis, level, nearest, d_nearest);
         stats.combine(local_stats);
@@ -948,6 +1139,18 @@ HNSWStats HNSW::search(
                 search_from_candidate_unbounded(
                         *this, Node(d_nearest, nearest), qdis, ef, &vt, stats);
 
+        const IDSelector* sel = params ? params->sel : nullptr;
+        if (sel) {
+            std::priority_queue<Node> selected;
+            while (!top_candidates.empty()) {
+                if (sel->is_member(top_candidates.top().second)) {
+                    selected.push(top_candidates.top());
+                }
+                top_candidates.pop();
+            }
+            top_candidates.swap(selected);
+        }
+
         while (top_candidates.size() > k) {
             top_candidates.pop();
         }
@@ -1028,6 +1231,7 @@ void HNSW::search_level_0(
 }
 
 void HNSW::permute_entries(const idx_t* map) {
+    clear_interleaved_level_0();
     // remap levels
     storage_idx_t ntotal = levels.size();
     std::vector<storage_idx_t> imap(ntotal); // inverse mapping
@@ -1040,24 +1244,28 @@ void HNSW::permute_entries(const idx_t* map) {
     if (entry_point != -1) {
         entry_point = imap[entry_point];
     }
+    // read through const references: the tables may be views
+    const auto& old_levels = levels;
+    const auto& old_offsets = offsets;
+    const auto& old_neighbors = neighbors;
     std::vector<int> new_levels(ntotal);
     std::vector<size_t> new_offsets(ntotal + 1);
-    std::vector<storage_idx_t> new_neighbors(neighbors.size());
+    std::vector<storage_idx_t> new_neighbors(old_neighbors.size());
     size_t no = 0;
     for (int i = 0; i < ntotal; i++) {
         storage_idx_t o = map[i]; // corresponding "old" index
-        new_levels[i] = levels[o];
-        for (size_t j = offsets[o]; j < offsets[o + 1]; j++) {
-            storage_idx_t neigh = neighbors[j];
+        new_levels[i] = old_levels[o];
+        for (size_t j = old_offsets[o]; j < old_offsets[o + 1]; j++) {
+            storage_idx_t neigh = old_neighbors[j];
             new_neighbors[no++] = neigh >= 0 ? imap[neigh] : neigh;
         }
         new_offsets[i + 1] = no;
     }
-    assert(new_offsets[ntotal] == offsets[ntotal]);
+    assert(new_offsets[ntotal] == old_offsets[ntotal]);
     // swap everyone
-    std::swap(levels, new_levels);
-    std::swap(offsets, new_offsets);
-    std::swap(neighbors, new_neighbors);
+    levels = std::move(new_levels);
+    offsets = std::move(new_offsets);
+    neighbors = std::move(new_neighbors);
 }
 
 /**************************************************************
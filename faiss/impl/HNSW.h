@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <unordered_set>
 #include <vector>
@@ -15,7 +19,9 @@
 
 #include <faiss/Index.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/maybe_owned_vector.h>
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/AlignedTable.h>
 #include <faiss/utils/Heap.h>
 #include <faiss/utils/random.h>
 
@@ -51,6 +57,96 @@ struct SearchParametersHNSW : SearchParameters {
     ~SearchParametersHNSW() {}
 };
 
+/** Synchronization state for the online mode of the HNSW, where vertices
+ * are added while searches run in other threads.
+ *
+ * Writers lock the vertices whose neighbor lists they modify with
+ * per-vertex locks, as for the offline build. In addition, each write to
+ * a neighbor list is bracketed by increments of a per-vertex sequence
+ * number (a seqlock): readers copy a list without taking any lock and
+ * retry if a writer touched it meanwhile. The entry point and the max
+ * level are published together in a single atomic.
+ */
+struct HNSWOnlineState {
+    /// max number of vertices
+    size_t capacity;
+
+    /// reserved size of the neighbors table
+    size_t neighbors_capacity = 0;
+
+    /// per-vertex sequence numbers, odd while the list is being written
+    std::unique_ptr<std::atomic<uint32_t>[]> versions;
+
+    /// per-vertex writer locks
+    std::vector<omp_lock_t> locks;
+
+    /// entry point (low 32 bits) and max level (high 32 bits)
+    std::atomic<uint64_t> entry;
+
+    /// serializes the updates of the entry point
+    std::mutex entry_mutex;
+
+    /// serializes the appends to the storage and the level tables. The
+    /// distance computers on the storage are also built under this lock,
+    /// because they read its size
+    std::mutex add_mutex;
+
+    /** nb of vertices appended so far, published after the storage and
+     * the level tables. Concurrent readers should use this instead of
+     * Index::ntotal, which is updated without synchronization */
+    std::atomic<int64_t> ntotal;
+
+    explicit HNSWOnlineState(size_t capacity);
+
+    HNSWOnlineState(const HNSWOnlineState&) = delete;
+    HNSWOnlineState& operator=(const HNSWOnlineState&) = delete;
+
+    ~HNSWOnlineState();
+
+    void begin_write(int32_t no) {
+        std::atomic<uint32_t>& v = versions[no];
+        v.store(v.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write(int32_t no) {
+        std::atomic<uint32_t>& v = versions[no];
+        v.store(v.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+    }
+
+    /// copy the n entries at src, that belong to vertex no, to dest
+    void read_list(int32_t no, const int32_t* src, size_t n, int32_t* dest)
+            const {
+        const std::atomic<uint32_t>& v = versions[no];
+        for (;;) {
+            uint32_t v0 = v.load(std::memory_order_acquire);
+            if (v0 & 1) {
+                continue;
+            }
+            memcpy(dest, src, n * sizeof(*dest));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (v.load(std::memory_order_relaxed) == v0) {
+                return;
+            }
+        }
+    }
+
+    void get_entry_point(int32_t& entry_point, int& max_level) const {
+        uint64_t e = entry.load(std::memory_order_acquire);
+        entry_point = int32_t(uint32_t(e));
+        max_level = int32_t(uint32_t(e >> 32));
+    }
+
+    void set_entry_point(int32_t entry_point, int max_level) {
+        entry.store(
+                uint64_t(uint32_t(entry_point)) |
+                        (uint64_t(uint32_t(max_level)) << 32),
+                std::memory_order_release);
+    }
+};
+
 struct HNSW {
     /// internal storage of vectors (32 bits: this is expensive)
     using storage_idx_t = int32_t;
@@ -113,15 +209,17 @@ struct HNSW {
     std::vector<int> cum_nneighbor_per_level;
 
     /// level of each vector (base level = 1), size = ntotal
-    std::vector<int> levels;
+    MaybeOwnedVector<int> levels;
 
     /// offsets[i] is the offset in the neighbors array where vector i is stored
     /// size ntotal + 1
-    std::vector<size_t> offsets;
+    MaybeOwnedVector<size_t> offsets;
 
     /// neighbors[offsets[i]:offsets[i+1]] is the list of neighbors of vector i
     /// for all levels. this is where all storage goes.
-    std::vector<storage_idx_t> neighbors;
+    /// levels, offsets and neighbors may be views on a memory-mapped file
+    /// (see IO_FLAG_MMAP_IFC), in which case the graph is read-only.
+    MaybeOwnedVector<storage_idx_t> neighbors;
 
     /// entry point in the search structure (one of the points with maximum
     /// level
@@ -145,6 +243,25 @@ struct HNSW {
     /// use bounded queue during exploration
     bool search_bounded_queue = true;
 
+    /** Optional interleaved copy of level 0, used only at search time.
+     *
+     * For each vertex there is a block of level0_block_size bytes (a
+     * multiple of 64, the blocks are 64-byte aligned) that contains its
+     * nb_neighbors(0) level-0 neighbors, optionally followed by its code
+     * (level0_code_size bytes). A hop in the level-0 search then touches
+     * a single contiguous block instead of offsets + neighbors + storage.
+     *
+     * It is a snapshot: it is cleared by any operation that modifies the
+     * graph and it is not serialized.
+     */
+    AlignedTableTightAlloc<uint8_t, 64> level0_blocks;
+    size_t level0_block_size = 0;
+    size_t level0_code_size = 0;
+
+    /** Set in online mode, see set_online. It is not serialized, and
+     * copies of the HNSW object share it. */
+    std::shared_ptr<HNSWOnlineState> online;
+
     // methods that initialize the tree sizes
 
     /// initialize the assign_probas and cum_nneighbor_per_level to
@@ -216,6 +333,41 @@ struct HNSW {
 
     void reset();
 
+    /** Switch to online mode: add_with_locks and search can run
+     * concurrently. The graph tables are reserved for capacity vertices
+     * so that they are not moved by later additions.
+     * capacity = 0 switches back to the offline mode. */
+    void set_online(size_t capacity);
+
+    /// entry point and max level, also valid while vertices are added in
+    /// online mode
+    void get_entry_point(storage_idx_t& entry_point, int& max_level) const;
+
+    /** build the interleaved level 0 from the current graph.
+     * @param codes      codes to copy into the blocks, ntotal * code_size
+     *                   bytes (may be nullptr)
+     * @param code_size  size of the codes (0 = neighbors only)
+     */
+    void build_interleaved_level_0(const uint8_t* codes, size_t code_size);
+
+    void clear_interleaved_level_0();
+
+    bool has_interleaved_level_0() const {
+        return level0_block_size > 0;
+    }
+
+    /// level-0 neighbors of vertex no in the interleaved layout
+    const storage_idx_t* interleaved_neighbors(idx_t no) const {
+        return (const storage_idx_t*)(level0_blocks.get() +
+                                      no * level0_block_size);
+    }
+
+    /// code of vertex 0 in the interleaved layout, the stride between
+    /// codes is level0_block_size
+    const uint8_t* interleaved_codes() const {
+        return level0_blocks.get() + nb_neighbors(0) * sizeof(storage_idx_t);
+    }
+
     void clear_neighbor_tables(int level);
     void print_neighbor_stats(int level) const;
 
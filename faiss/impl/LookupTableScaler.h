@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include <faiss/utils/simd_levels.h>
 #include <faiss/utils/simdlib.h>
 
 /*******************************************
@@ -19,6 +20,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /// no-op handler
 struct DummyScaler {
     static constexpr int nscale = 0;
@@ -108,4 +111,6 @@ struct NormTableScaler {
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
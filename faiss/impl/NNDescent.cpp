@@ -494,4 +494,22 @@ void NNDescent::reset() {
     final_graph.resize(0);
 }
 
+void NNDescent::permute_entries(const idx_t* map) {
+    FAISS_THROW_IF_NOT_MSG(has_built, "The index is not build yet.");
+    // map: new index -> old index
+    // imap: old index -> new index
+    std::vector<int> imap(ntotal);
+    for (int i = 0; i < ntotal; i++) {
+        imap[map[i]] = i;
+    }
+    std::vector<int> new_graph(final_graph.size());
+    for (int i = 0; i < ntotal; i++) {
+        for (int j = 0; j < K; j++) {
+            int id = final_graph[map[i] * K + j];
+            new_graph[i * K + j] = id >= 0 ? imap[id] : id;
+        }
+    }
+    final_graph = std::move(new_graph);
+}
+
 } // namespace faiss
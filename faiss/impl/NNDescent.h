@@ -108,6 +108,9 @@ struct NNDescent {
 
     void reset();
 
+    /// Renumber the nodes, map maps new to old numbers
+    void permute_entries(const idx_t* map);
+
     /// Initialize the KNN graph randomly
     void init_graph(DistanceComputer& qdis);
 
@@ -203,6 +203,26 @@ void NSG::reset() {
     is_built = false;
 }
 
+void NSG::permute_entries(const idx_t* map) {
+    FAISS_THROW_IF_NOT(is_built && final_graph);
+    // map: new index -> old index
+    // imap: old index -> new index
+    std::vector<int> imap(ntotal);
+    for (int i = 0; i < ntotal; i++) {
+        imap[map[i]] = i;
+    }
+    int K = final_graph->K;
+    auto new_graph = std::make_shared<nsg::Graph<int>>(ntotal, K);
+    for (int i = 0; i < ntotal; i++) {
+        for (int j = 0; j < K; j++) {
+            int id = final_graph->at(map[i], j);
+            new_graph->at(i, j) = id >= 0 ? imap[id] : id;
+        }
+    }
+    final_graph = new_graph;
+    enterpoint = imap[enterpoint];
+}
+
 void NSG::init_graph(Index* storage, const nsg::Graph<idx_t>& knn_graph) {
     int d = storage->d;
     int n = storage->ntotal;
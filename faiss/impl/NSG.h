@@ -130,6 +130,9 @@ struct NSG {
     // reset the graph
     void reset();
 
+    /// renumber the nodes, map maps new to old numbers
+    void permute_entries(const idx_t* map);
+
     // search interface
     void search(
             DistanceComputer& dis,
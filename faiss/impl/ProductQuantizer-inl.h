@@ -7,6 +7,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 inline PQEncoderGeneric::PQEncoderGeneric(
         uint8_t* code,
         int nbits,
@@ -113,4 +115,6 @@ inline uint64_t PQDecoder16::decode() {
     return (uint64_t)(*code++);
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
@@ -192,6 +192,9 @@ FAISS_API extern int product_quantizer_compute_codes_bs;
  * Objects to encode / decode strings of bits
  *************************************************/
 
+// Also compiled for each SIMD level, see FAISS_SIMD_NAMESPACE_BEGIN.
+FAISS_SIMD_NAMESPACE_BEGIN
+
 struct PQEncoderGeneric {
     uint8_t* code; ///< code for this vector
     uint8_t offset;
@@ -242,6 +245,8 @@ struct PQDecoder16 {
     uint64_t decode();
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #include <faiss/impl/ProductQuantizer-inl.h>
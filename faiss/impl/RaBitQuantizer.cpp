@@ -0,0 +1,270 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/RaBitQuantizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/hamming_distance/common.h>
+
+namespace faiss {
+
+RaBitQuantizer::RaBitQuantizer(size_t d, MetricType metric)
+        : Quantizer(d, (d + 7) / 8 + sizeof(RaBitQFactors)),
+          metric_type(metric) {
+    FAISS_THROW_IF_NOT_MSG(
+            metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT,
+            "RaBitQ supports only L2 and inner product");
+}
+
+void RaBitQuantizer::train(size_t, const float*) {}
+
+void RaBitQuantizer::compute_codes(const float* x, uint8_t* codes, size_t n)
+        const {
+    compute_codes_core(x, codes, n, nullptr);
+}
+
+void RaBitQuantizer::compute_codes_core(
+        const float* x,
+        uint8_t* codes,
+        size_t n,
+        const float* centroid) const {
+    size_t bs = bits_size();
+    memset(codes, 0, n * code_size);
+
+#pragma omp parallel for if (n > 1000)
+    for (int64_t i = 0; i < int64_t(n); i++) {
+        const float* xi = x + i * d;
+        uint8_t* code = codes + i * code_size;
+        double norm2 = 0, abs_sum = 0;
+        for (size_t j = 0; j < d; j++) {
+            float r = centroid ? xi[j] - centroid[j] : xi[j];
+            if (r > 0) {
+                code[j >> 3] |= 1 << (j & 7);
+            }
+            norm2 += r * r;
+            abs_sum += std::fabs(r);
+        }
+        RaBitQFactors fac = {float(norm2), 0, 0};
+        if (abs_sum > 0) {
+            fac.dp_multiplier = norm2 / abs_sum;
+            // <o_bar, o> of the paper, the cosine between r and its code
+            double a = abs_sum / std::sqrt(norm2 * d);
+            if (d > 1) {
+                fac.error = std::sqrt(norm2 * std::max(1 - a * a, 0.0)) /
+                        (a * std::sqrt(d - 1.0));
+            }
+        }
+        memcpy(code + bs, &fac, sizeof(fac));
+    }
+}
+
+void RaBitQuantizer::decode(const uint8_t* codes, float* x, size_t n) const {
+    decode_core(codes, x, n, nullptr);
+}
+
+void RaBitQuantizer::decode_core(
+        const uint8_t* codes,
+        float* x,
+        size_t n,
+        const float* centroid) const {
+    size_t bs = bits_size();
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t* code = codes + i * code_size;
+        RaBitQFactors fac;
+        memcpy(&fac, code + bs, sizeof(fac));
+        float scale = std::sqrt(fac.norm2 / d);
+        float* xi = x + i * d;
+        for (size_t j = 0; j < d; j++) {
+            float r = (code[j >> 3] >> (j & 7)) & 1 ? scale : -scale;
+            xi[j] = centroid ? centroid[j] + r : r;
+        }
+    }
+}
+
+/*************************************************************
+ * RaBitQQuery
+ *************************************************************/
+
+RaBitQQuery::RaBitQQuery(const RaBitQuantizer& rq, uint8_t qb, float epsilon)
+        : rq(rq), qb(qb), epsilon(epsilon), v(rq.d) {
+    FAISS_THROW_IF_NOT_MSG(qb <= 8, "qb should be at most 8");
+    size_t nw = (rq.bits_size() + 7) / 8;
+    planes.resize(nw * qb);
+}
+
+void RaBitQQuery::set_query(const float* x, const float* centroid) {
+    size_t d = rq.d;
+    bool is_l2 = rq.metric_type == METRIC_L2;
+    for (size_t j = 0; j < d; j++) {
+        v[j] = is_l2 && centroid ? x[j] - centroid[j] : x[j];
+    }
+    float v_norm2 = fvec_norm_L2sqr(v.data(), d);
+    v_norm = std::sqrt(v_norm2);
+    if (is_l2) {
+        offset = v_norm2;
+    } else {
+        offset = centroid ? fvec_inner_product(x, centroid, d) : 0;
+    }
+
+    if (qb == 0) {
+        sum_v = 0;
+        for (size_t j = 0; j < d; j++) {
+            sum_v += v[j];
+        }
+        quant_error = 0;
+        return;
+    }
+
+    // uniform quantization of v to qb bits, stored as bit planes
+    vmin = *std::min_element(v.begin(), v.end());
+    float vmax = *std::max_element(v.begin(), v.end());
+    int qmax = (1 << qb) - 1;
+    delta = (vmax - vmin) / qmax;
+    std::fill(planes.begin(), planes.end(), 0);
+    uint64_t sum_q = 0;
+    double err2 = 0;
+    for (size_t j = 0; j < d; j++) {
+        int q = delta > 0 ? int(std::lrint((v[j] - vmin) / delta)) : 0;
+        q = std::min(std::max(q, 0), qmax);
+        sum_q += q;
+        float e = vmin + delta * q - v[j];
+        err2 += e * e;
+        uint64_t* pw = planes.data() + (j >> 6) * qb;
+        for (int b = 0; b < qb; b++) {
+            pw[b] |= uint64_t((q >> b) & 1) << (j & 63);
+        }
+    }
+    sum_v = d * vmin + delta * sum_q;
+    quant_error = std::sqrt(err2);
+}
+
+float RaBitQQuery::inner_product(const uint8_t* code) const {
+    size_t d = rq.d;
+    size_t bs = rq.bits_size();
+    RaBitQFactors fac;
+    memcpy(&fac, code + bs, sizeof(fac));
+
+    // <b, v> where b is the 0/1 vector of the sign bits
+    float dot_b;
+    if (qb == 0) {
+        dot_b = 0;
+        for (size_t j = 0; j < d; j++) {
+            if ((code[j >> 3] >> (j & 7)) & 1) {
+                dot_b += v[j];
+            }
+        }
+    } else {
+        uint64_t dot_q = 0, nset = 0;
+        const uint64_t* pw = planes.data();
+        size_t i = 0;
+        for (; i + 8 <= bs; i += 8, pw += qb) {
+            uint64_t w;
+            memcpy(&w, code + i, 8);
+            nset += popcount64(w);
+            for (int b = 0; b < qb; b++) {
+                dot_q += uint64_t(popcount64(w & pw[b])) << b;
+            }
+        }
+        if (i < bs) {
+            uint64_t w = 0;
+            memcpy(&w, code + i, bs - i);
+            nset += popcount64(w);
+            for (int b = 0; b < qb; b++) {
+                dot_q += uint64_t(popcount64(w & pw[b])) << b;
+            }
+        }
+        dot_b = vmin * nset + delta * dot_q;
+    }
+    // the code vector is (2 * b - 1) / sqrt(d)
+    return fac.dp_multiplier * (2 * dot_b - sum_v);
+}
+
+float RaBitQQuery::distance(const uint8_t* code) const {
+    float ip = inner_product(code);
+    float bound = 0;
+    if (epsilon > 0) {
+        RaBitQFactors fac;
+        memcpy(&fac, code + rq.bits_size(), sizeof(fac));
+        // the quantization error of v is amplified by ||r|| / <o_bar, o>
+        bound = epsilon * v_norm * fac.error +
+                fac.dp_multiplier * std::sqrt(float(rq.d)) * quant_error;
+    }
+    if (rq.metric_type == METRIC_L2) {
+        RaBitQFactors fac;
+        memcpy(&fac, code + rq.bits_size(), sizeof(fac));
+        return fac.norm2 + offset - 2 * (ip + bound);
+    } else {
+        return offset + ip + bound;
+    }
+}
+
+/*************************************************************
+ * Distance computer
+ *************************************************************/
+
+namespace {
+
+struct RaBitQDistanceComputer : FlatCodesDistanceComputer {
+    RaBitQQuery query;
+    std::vector<float> centroid;
+    std::vector<float> buf;
+
+    RaBitQDistanceComputer(
+            const RaBitQuantizer& rq,
+            uint8_t qb,
+            const float* c,
+            float epsilon)
+            : query(rq, qb, epsilon), buf(2 * rq.d) {
+        code_size = rq.code_size;
+        if (c) {
+            centroid.assign(c, c + rq.d);
+        }
+    }
+
+    const float* centroid_ptr() const {
+        return centroid.empty() ? nullptr : centroid.data();
+    }
+
+    void set_query(const float* x) override {
+        query.set_query(x, centroid_ptr());
+    }
+
+    float distance_to_code(const uint8_t* code) override {
+        return query.distance(code);
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        const RaBitQuantizer& rq = query.rq;
+        rq.decode_core(codes + i * code_size, buf.data(), 1, centroid_ptr());
+        rq.decode_core(
+                codes + j * code_size, buf.data() + rq.d, 1, centroid_ptr());
+        if (rq.metric_type == METRIC_L2) {
+            return fvec_L2sqr(buf.data(), buf.data() + rq.d, rq.d);
+        } else {
+            return fvec_inner_product(buf.data(), buf.data() + rq.d, rq.d);
+        }
+    }
+};
+
+} // namespace
+
+FlatCodesDistanceComputer* RaBitQuantizer::get_distance_computer(
+        uint8_t qb,
+        const float* centroid,
+        float epsilon) const {
+    return new RaBitQDistanceComputer(*this, qb, centroid, epsilon);
+}
+
+} // namespace faiss
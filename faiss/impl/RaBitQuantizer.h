@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <vector>
+
+#include <faiss/MetricType.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/Quantizer.h>
+
+namespace faiss {
+
+/** RaBitQ quantizer, from
+ *
+ * "RaBitQ: Quantizing High-Dimensional Vectors with a Theoretical Error
+ * Bound for Approximate Nearest Neighbor Search", Gao & Long, SIGMOD'24
+ *
+ * The residual r = x - c of a vector x w.r.t. a centroid c is encoded
+ * with its d sign bits, followed by 3 floats (RaBitQFactors). The inner
+ * product of r with any vector v is estimated from the bits, and the
+ * error of the estimate is bounded by
+ *
+ *    epsilon * ||v|| * error
+ *
+ * with a probability that increases quickly with epsilon (~1.9 gives
+ * a failure rate below 1e-3 in the paper). The bound requires the
+ * vectors to be randomly rotated, which is not done by the quantizer:
+ * use a RandomRotationMatrix (eg. "RR,RaBitQ" in the index_factory).
+ *
+ * The queries are scalar quantized to qb bits per component, and the
+ * inner products with the codes are computed with popcounts over the
+ * qb bit planes. qb = 0 keeps the query in float.
+ */
+struct RaBitQuantizer : Quantizer {
+    MetricType metric_type;
+
+    explicit RaBitQuantizer(size_t d = 0, MetricType metric = METRIC_L2);
+
+    /// size of the sign bits in the codes
+    size_t bits_size() const {
+        return (d + 7) / 8;
+    }
+
+    /// the quantizer does not need training
+    void train(size_t n, const float* x) override;
+
+    /// encode x relative to the origin
+    void compute_codes(const float* x, uint8_t* codes, size_t n)
+            const override;
+
+    /// encode the residuals w.r.t. centroid (nullptr = origin)
+    void compute_codes_core(
+            const float* x,
+            uint8_t* codes,
+            size_t n,
+            const float* centroid) const;
+
+    void decode(const uint8_t* codes, float* x, size_t n) const override;
+
+    void decode_core(
+            const uint8_t* codes,
+            float* x,
+            size_t n,
+            const float* centroid) const;
+
+    /** distance computer for codes encoded w.r.t. centroid. If epsilon >
+     * 0 it returns optimistic bounds (lower bounds of L2 distances, upper
+     * bounds of inner products) instead of the estimates. */
+    FlatCodesDistanceComputer* get_distance_computer(
+            uint8_t qb,
+            const float* centroid = nullptr,
+            float epsilon = 0) const;
+};
+
+/// stored after the sign bits of each code
+struct RaBitQFactors {
+    float norm2;         ///< ||r||^2
+    float dp_multiplier; ///< ||r||^2 / sum_i |r_i|
+    float error;         ///< error bound of the inner products, for ||v|| = 1
+};
+
+/** A query prepared for the codes of one centroid. distance() is const
+ * so that it can be used by the InvertedListScanners.
+ */
+struct RaBitQQuery {
+    const RaBitQuantizer& rq;
+    uint8_t qb;
+    float epsilon;
+
+    /// query - centroid for L2, query for inner product
+    std::vector<float> v;
+    /// qb bit planes of the quantized v, interleaved by 64-bit words
+    std::vector<uint64_t> planes;
+    float vmin = 0, delta = 0;
+    float sum_v = 0;  ///< sum of the (quantized) components of v
+    float v_norm = 0; ///< ||v||
+    /// worst-case error of the inner products due to the query quantization
+    float quant_error = 0;
+    /// ||v||^2 for L2, <query, centroid> for inner product
+    float offset = 0;
+
+    RaBitQQuery(const RaBitQuantizer& rq, uint8_t qb, float epsilon = 0);
+
+    /// prepare query x for the codes w.r.t. centroid (nullptr = origin)
+    void set_query(const float* x, const float* centroid);
+
+    /// estimated inner product <r, v> of the code's residual with v
+    float inner_product(const uint8_t* code) const;
+
+    /// distance estimate, or bound if epsilon > 0
+    float distance(const uint8_t* code) const;
+};
+
+} // namespace faiss
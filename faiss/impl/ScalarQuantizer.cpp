@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <memory>
 
 #include <faiss/impl/platform_macros.h>
 #include <omp.h>
@@ -24,7 +25,9 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
 #include <faiss/utils/bf16.h>
+#include <faiss/utils/distances_int8.h>
 #include <faiss/utils/fp16.h>
+#include <faiss/utils/simd_levels.h>
 #include <faiss/utils/utils.h>
 
 namespace faiss {
@@ -1509,6 +1512,60 @@ struct DCTemplate<Quantizer, Similarity, 1> : SQDistanceComputer {
     float query_to_code(const uint8_t* code) const final {
         return compute_distance(q, code);
     }
+
+    /// distances of the query to 4 codes, decoded in the same loop
+    void query_to_codes_batch_4(
+            const uint8_t* __restrict code_0,
+            const uint8_t* __restrict code_1,
+            const uint8_t* __restrict code_2,
+            const uint8_t* __restrict code_3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) const {
+        Similarity sim0(q);
+        Similarity sim1(q);
+        Similarity sim2(q);
+        Similarity sim3(q);
+        sim0.begin();
+        sim1.begin();
+        sim2.begin();
+        sim3.begin();
+        for (size_t i = 0; i < quant.d; i++) {
+            float x0 = quant.reconstruct_component(code_0, i);
+            float x1 = quant.reconstruct_component(code_1, i);
+            float x2 = quant.reconstruct_component(code_2, i);
+            float x3 = quant.reconstruct_component(code_3, i);
+            sim0.add_component(x0);
+            sim1.add_component(x1);
+            sim2.add_component(x2);
+            sim3.add_component(x3);
+        }
+        dis0 = sim0.result();
+        dis1 = sim1.result();
+        dis2 = sim2.result();
+        dis3 = sim3.result();
+    }
+
+    void distances_batch_4(
+            const idx_t idx0,
+            const idx_t idx1,
+            const idx_t idx2,
+            const idx_t idx3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) final {
+        query_to_codes_batch_4(
+                codes + idx0 * code_size,
+                codes + idx1 * code_size,
+                codes + idx2 * code_size,
+                codes + idx3 * code_size,
+                dis0,
+                dis1,
+                dis2,
+                dis3);
+    }
 };
 
 #if defined(USE_AVX512_F16C)
@@ -1557,6 +1614,60 @@ struct DCTemplate<Quantizer, Similarity, 16>
     float query_to_code(const uint8_t* code) const final {
         return compute_distance(q, code);
     }
+
+    /// distances of the query to 4 codes, decoded in the same loop
+    void query_to_codes_batch_4(
+            const uint8_t* __restrict code_0,
+            const uint8_t* __restrict code_1,
+            const uint8_t* __restrict code_2,
+            const uint8_t* __restrict code_3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) const {
+        Similarity sim0(q);
+        Similarity sim1(q);
+        Similarity sim2(q);
+        Similarity sim3(q);
+        sim0.begin_16();
+        sim1.begin_16();
+        sim2.begin_16();
+        sim3.begin_16();
+        for (size_t i = 0; i < quant.d; i += 16) {
+            __m512 x0 = quant.reconstruct_16_components(code_0, i);
+            __m512 x1 = quant.reconstruct_16_components(code_1, i);
+            __m512 x2 = quant.reconstruct_16_components(code_2, i);
+            __m512 x3 = quant.reconstruct_16_components(code_3, i);
+            sim0.add_16_components(x0);
+            sim1.add_16_components(x1);
+            sim2.add_16_components(x2);
+            sim3.add_16_components(x3);
+        }
+        dis0 = sim0.result_16();
+        dis1 = sim1.result_16();
+        dis2 = sim2.result_16();
+        dis3 = sim3.result_16();
+    }
+
+    void distances_batch_4(
+            const idx_t idx0,
+            const idx_t idx1,
+            const idx_t idx2,
+            const idx_t idx3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) final {
+        query_to_codes_batch_4(
+                codes + idx0 * code_size,
+                codes + idx1 * code_size,
+                codes + idx2 * code_size,
+                codes + idx3 * code_size,
+                dis0,
+                dis1,
+                dis2,
+                dis3);
+    }
 };
 
 #elif defined(USE_F16C)
@@ -1604,6 +1715,60 @@ struct DCTemplate<Quantizer, Similarity, 8> : SQDistanceComputer {
     float query_to_code(const uint8_t* code) const final {
         return compute_distance(q, code);
     }
+
+    /// distances of the query to 4 codes, decoded in the same loop
+    void query_to_codes_batch_4(
+            const uint8_t* __restrict code_0,
+            const uint8_t* __restrict code_1,
+            const uint8_t* __restrict code_2,
+            const uint8_t* __restrict code_3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) const {
+        Similarity sim0(q);
+        Similarity sim1(q);
+        Similarity sim2(q);
+        Similarity sim3(q);
+        sim0.begin_8();
+        sim1.begin_8();
+        sim2.begin_8();
+        sim3.begin_8();
+        for (size_t i = 0; i < quant.d; i += 8) {
+            __m256 x0 = quant.reconstruct_8_components(code_0, i);
+            __m256 x1 = quant.reconstruct_8_components(code_1, i);
+            __m256 x2 = quant.reconstruct_8_components(code_2, i);
+            __m256 x3 = quant.reconstruct_8_components(code_3, i);
+            sim0.add_8_components(x0);
+            sim1.add_8_components(x1);
+            sim2.add_8_components(x2);
+            sim3.add_8_components(x3);
+        }
+        dis0 = sim0.result_8();
+        dis1 = sim1.result_8();
+        dis2 = sim2.result_8();
+        dis3 = sim3.result_8();
+    }
+
+    void distances_batch_4(
+            const idx_t idx0,
+            const idx_t idx1,
+            const idx_t idx2,
+            const idx_t idx3,
+            float& dis0,
+            float& dis1,
+            float& dis2,
+            float& dis3) final {
+        query_to_codes_batch_4(
+                codes + idx0 * code_size,
+                codes + idx1 * code_size,
+                codes + idx2 * code_size,
+                codes + idx3 * code_size,
+                dis0,
+                dis1,
+                dis2,
+                dis3);
+    }
 };
 
 #endif
@@ -1667,9 +1832,12 @@ struct DistanceComputerByte<Similarity, 1> : SQDistanceComputer {
     using Sim = Similarity;
 
     int d;
-    std::vector<uint8_t> tmp;
+    // not a vector, whose constructor would be emitted in the objects
+    // compiled for each SIMD level
+    std::unique_ptr<uint8_t[]> tmp;
 
-    DistanceComputerByte(int d, const std::vector<float>&) : d(d), tmp(d) {}
+    DistanceComputerByte(int d, const std::vector<float>&)
+            : d(d), tmp(new uint8_t[d]) {}
 
     int compute_code_distance(const uint8_t* code1, const uint8_t* code2)
             const {
@@ -1693,7 +1861,7 @@ struct DistanceComputerByte<Similarity, 1> : SQDistanceComputer {
 
     int compute_distance(const float* x, const uint8_t* code) {
         set_query(x);
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 
     float symmetric_dis(idx_t i, idx_t j) override {
@@ -1702,7 +1870,7 @@ struct DistanceComputerByte<Similarity, 1> : SQDistanceComputer {
     }
 
     float query_to_code(const uint8_t* code) const final {
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 };
 
@@ -1713,9 +1881,10 @@ struct DistanceComputerByte<Similarity, 16> : SQDistanceComputer {
     using Sim = Similarity;
 
     int d;
-    std::vector<uint8_t> tmp;
+    std::unique_ptr<uint8_t[]> tmp;
 
-    DistanceComputerByte(int d, const std::vector<float>&) : d(d), tmp(d) {}
+    DistanceComputerByte(int d, const std::vector<float>&)
+            : d(d), tmp(new uint8_t[d]) {}
 
     int compute_code_distance(const uint8_t* code1, const uint8_t* code2)
             const {
@@ -1746,7 +1915,7 @@ struct DistanceComputerByte<Similarity, 16> : SQDistanceComputer {
 
     int compute_distance(const float* x, const uint8_t* code) {
         set_query(x);
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 
     float symmetric_dis(idx_t i, idx_t j) override {
@@ -1755,7 +1924,7 @@ struct DistanceComputerByte<Similarity, 16> : SQDistanceComputer {
     }
 
     float query_to_code(const uint8_t* code) const final {
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 };
 
@@ -1766,9 +1935,10 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
     using Sim = Similarity;
 
     int d;
-    std::vector<uint8_t> tmp;
+    std::unique_ptr<uint8_t[]> tmp;
 
-    DistanceComputerByte(int d, const std::vector<float>&) : d(d), tmp(d) {}
+    DistanceComputerByte(int d, const std::vector<float>&)
+            : d(d), tmp(new uint8_t[d]) {}
 
     int compute_code_distance(const uint8_t* code1, const uint8_t* code2)
             const {
@@ -1809,7 +1979,7 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
 
     int compute_distance(const float* x, const uint8_t* code) {
         set_query(x);
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 
     float symmetric_dis(idx_t i, idx_t j) override {
@@ -1818,7 +1988,7 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
     }
 
     float query_to_code(const uint8_t* code) const final {
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 };
 
@@ -1831,9 +2001,10 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
     using Sim = Similarity;
 
     int d;
-    std::vector<uint8_t> tmp;
+    std::unique_ptr<uint8_t[]> tmp;
 
-    DistanceComputerByte(int d, const std::vector<float>&) : d(d), tmp(d) {}
+    DistanceComputerByte(int d, const std::vector<float>&)
+            : d(d), tmp(new uint8_t[d]) {}
 
     int compute_code_distance(const uint8_t* code1, const uint8_t* code2)
             const {
@@ -1857,7 +2028,7 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
 
     int compute_distance(const float* x, const uint8_t* code) {
         set_query(x);
-        return compute_code_distance(tmp.data(), code);
+        return compute_code_distance(tmp.get(), code);
     }
 
     float symmetric_dis(idx_t i, idx_t j) override {
@@ -1872,6 +2043,193 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
 
 #endif
 
+/*******************************************************************
+ * DistanceComputerInt8: QT_8bit_direct_signed distances computed in the
+ * integer domain on a quantized query, see utils/distances_int8.h
+ *******************************************************************/
+
+template <class Similarity>
+struct DistanceComputerInt8 : SQDistanceComputer {
+    using Sim = Similarity;
+
+    int d;
+    Int8Query iq;
+
+    DistanceComputerInt8(int d, const std::vector<float>&) : d(d), iq(d) {}
+
+    void set_query(const float* x) final {
+        q = x;
+        iq.set_query(x);
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        const uint8_t* ci = codes + i * code_size;
+        const uint8_t* cj = codes + j * code_size;
+        int64_t accu = 0;
+        for (int l = 0; l < d; l++) {
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                accu += (int(ci[l]) - 128) * (int(cj[l]) - 128);
+            } else {
+                int diff = int(ci[l]) - cj[l];
+                accu += diff * diff;
+            }
+        }
+        return accu;
+    }
+
+    float query_to_code(const uint8_t* code) const final {
+        return iq.distance(code, Sim::metric_type);
+    }
+};
+
+/*******************************************************************
+ * DistanceComputerQuantizedQuery: QT_8bit and QT_8bit_uniform distances
+ * computed in the integer domain.
+ *
+ * A component decodes to x_i = a_i + delta_i * c_i with
+ * a_i = vmin_i + delta_i / 2 and delta_i = vdiff_i / 255, so
+ *
+ *   <q, x>      = sum_i q_i a_i + sum_i (q_i delta_i) c_i
+ *   ||q - x||^2 = sum_i r_i^2 - 2 sum_i (r_i delta_i) c_i
+ *                 + sum_i delta_i^2 c_i^2      with r_i = q_i - a_i
+ *
+ * The weights of c_i are quantized to QBITS integers in set_query. The
+ * last term depends only on the code: it is exact for the uniform
+ * quantizer, and uses 15-bit weights otherwise.
+ *******************************************************************/
+
+template <class Similarity, int QBITS>
+struct DistanceComputerQuantizedQuery : SQDistanceComputer {
+    using Sim = Similarity;
+
+    int d;
+    bool uniform;
+    std::vector<float> a, delta;
+    float delta_max = 0;
+    /// delta_i / delta_max in 15 bits, for the non-uniform norm term
+    std::vector<int16_t> norm_weights;
+    float norm_scale = 0;
+
+    /// quantized query weights, only one is used depending on QBITS
+    std::vector<int8_t> w8;
+    std::vector<int16_t> w16;
+    float w_scale = 1;
+    float accu0 = 0;
+    std::vector<float> tmp;
+
+    DistanceComputerQuantizedQuery(int d, const std::vector<float>& trained)
+            : d(d),
+              uniform(trained.size() == 2),
+              a(d),
+              delta(d),
+              norm_weights(uniform ? 0 : d),
+              w8(QBITS == 8 ? d : 0),
+              w16(QBITS == 8 ? 0 : d),
+              tmp(d) {
+        for (int i = 0; i < d; i++) {
+            float vmin = uniform ? trained[0] : trained[i];
+            float vdiff = uniform ? trained[1] : trained[d + i];
+            delta[i] = vdiff / 255.0f;
+            a[i] = vmin + delta[i] / 2;
+            delta_max = std::max(delta_max, std::fabs(delta[i]));
+        }
+        if (uniform) {
+            norm_scale = delta[0] * delta[0];
+        } else {
+            for (int i = 0; i < d; i++) {
+                norm_weights[i] = delta_max == 0
+                        ? 0
+                        : std::lrint(std::fabs(delta[i]) / delta_max * 32767);
+            }
+            // z_i ~= c_i * delta_i / delta_max * 32767 / 256
+            float s = delta_max * 256 / 32767;
+            norm_scale = s * s;
+        }
+    }
+
+    void set_query(const float* x) final {
+        q = x;
+        std::vector<float>& w = tmp;
+        accu0 = 0;
+        for (int i = 0; i < d; i++) {
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                accu0 += x[i] * a[i];
+                w[i] = x[i] * delta[i];
+            } else {
+                float r = x[i] - a[i];
+                accu0 += r * r;
+                w[i] = -2 * r * delta[i];
+            }
+        }
+        float wmax = 0;
+        for (int i = 0; i < d; i++) {
+            wmax = std::max(wmax, std::fabs(w[i]));
+        }
+        // the bound on the weights avoids overflows in the kernels
+        float wlim = QBITS == 8
+                ? 63
+                : std::min(32767.0f, float(0x7fffffff / (255 * size_t(d))));
+        w_scale = wmax == 0 ? 1 : wmax / wlim;
+        for (int i = 0; i < d; i++) {
+            long v = std::lrint(w[i] / w_scale);
+            if (QBITS == 8) {
+                w8[i] = v;
+            } else {
+                w16[i] = v;
+            }
+            // the rounding error is exact for a code at the middle of the
+            // range, this removes most of its bias
+            accu0 += (w[i] - w_scale * v) * 127.5f;
+        }
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        const uint8_t* ci = codes + i * code_size;
+        const uint8_t* cj = codes + j * code_size;
+        float accu = 0;
+        for (int l = 0; l < d; l++) {
+            float xi = a[l] + delta[l] * ci[l];
+            float xj = a[l] + delta[l] * cj[l];
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                accu += xi * xj;
+            } else {
+                accu += (xi - xj) * (xi - xj);
+            }
+        }
+        return accu;
+    }
+
+    float query_to_code(const uint8_t* code) const final {
+        if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+            int32_t ip = QBITS == 8 ? u8_inner_product_w8(w8.data(), code, d)
+                                    : u8_inner_product_w16(w16.data(), code, d);
+            return accu0 + w_scale * ip;
+        }
+        float norm2;
+        const int16_t* u = uniform ? nullptr : norm_weights.data();
+        int32_t ip = QBITS == 8
+                ? u8_inner_product_w8(w8.data(), code, d, &norm2, u)
+                : u8_inner_product_w16(w16.data(), code, d, &norm2, u);
+        float dis = accu0 + w_scale * ip + norm_scale * norm2;
+        return dis < 0 ? 0 : dis;
+    }
+};
+
+template <class Similarity>
+SQDistanceComputer* select_distance_computer_quantized_query(
+        QuantizerType qtype,
+        ScalarQuantizer::QueryQuantization qq,
+        int d,
+        const std::vector<float>& trained) {
+    if (qtype == ScalarQuantizer::QT_8bit_direct_signed) {
+        return new DistanceComputerInt8<Similarity>(d, trained);
+    } else if (qq == ScalarQuantizer::QQ_int8) {
+        return new DistanceComputerQuantizedQuery<Similarity, 8>(d, trained);
+    } else {
+        return new DistanceComputerQuantizedQuery<Similarity, 16>(d, trained);
+    }
+}
+
 /*******************************************************************
  * select_distance_computer: runtime selection of template
  * specialization
@@ -1969,6 +2327,8 @@ SQDistanceComputer* select_distance_computer(
  * ScalarQuantizer implementation
  ********************************************************************/
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 ScalarQuantizer::ScalarQuantizer(size_t d, QuantizerType qtype)
         : Quantizer(d), qtype(qtype) {
     set_derived_sizes();
@@ -2045,21 +2405,6 @@ void ScalarQuantizer::train(size_t n, const float* x) {
     }
 }
 
-ScalarQuantizer::SQuantizer* ScalarQuantizer::select_quantizer() const {
-#if defined(USE_AVX512_F16C)
-    if (d % 16 == 0) {
-        return select_quantizer_1<16>(qtype, d, trained);
-    } else
-#elif defined(USE_F16C) || defined(USE_NEON)
-    if (d % 8 == 0) {
-        return select_quantizer_1<8>(qtype, d, trained);
-    } else
-#endif
-    {
-        return select_quantizer_1<1>(qtype, d, trained);
-    }
-}
-
 void ScalarQuantizer::compute_codes(const float* x, uint8_t* codes, size_t n)
         const {
     std::unique_ptr<SQuantizer> squant(select_quantizer());
@@ -2078,37 +2423,15 @@ void ScalarQuantizer::decode(const uint8_t* codes, float* x, size_t n) const {
         squant->decode_vector(codes + i * code_size, x + i * d);
 }
 
-SQDistanceComputer* ScalarQuantizer::get_distance_computer(
-        MetricType metric) const {
-    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
-#if defined(USE_AVX512_F16C)
-    if (d % 16 == 0) {
-        if (metric == METRIC_L2) {
-            return select_distance_computer<SimilarityL2<16>>(
-                    qtype, d, trained);
-        } else {
-            return select_distance_computer<SimilarityIP<16>>(
-                    qtype, d, trained);
-        }
-    } else
-#elif defined(USE_F16C) || defined(USE_NEON)
-    if (d % 8 == 0) {
-        if (metric == METRIC_L2) {
-            return select_distance_computer<SimilarityL2<8>>(qtype, d, trained);
-        } else {
-            return select_distance_computer<SimilarityIP<8>>(qtype, d, trained);
-        }
-    } else
-#endif
-    {
-        if (metric == METRIC_L2) {
-            return select_distance_computer<SimilarityL2<1>>(qtype, d, trained);
-        } else {
-            return select_distance_computer<SimilarityIP<1>>(qtype, d, trained);
-        }
-    }
+ScalarQuantizer::SQuantizer::~SQuantizer() {}
+
+float ScalarQuantizer::SQDistanceComputer::distance_to_code(
+        const uint8_t* code) {
+    return query_to_code(code);
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
 /*******************************************************************
  * IndexScalarQuantizer/IndexIVFScalarQuantizer scanner object
  *
@@ -2453,29 +2776,199 @@ InvertedListScanner* sel0_InvertedListScanner(
     }
 }
 
+template <class Similarity>
+InvertedListScanner* sel1_InvertedListScanner_quantized_query(
+        const ScalarQuantizer* sq,
+        const Index* quantizer,
+        bool store_pairs,
+        const IDSelector* sel,
+        bool r) {
+    if (sq->qtype == ScalarQuantizer::QT_8bit_direct_signed) {
+        return sel2_InvertedListScanner<DistanceComputerInt8<Similarity>>(
+                sq, quantizer, store_pairs, sel, r);
+    } else if (sq->query_quantization == ScalarQuantizer::QQ_int8) {
+        return sel2_InvertedListScanner<
+                DistanceComputerQuantizedQuery<Similarity, 8>>(
+                sq, quantizer, store_pairs, sel, r);
+    } else {
+        return sel2_InvertedListScanner<
+                DistanceComputerQuantizedQuery<Similarity, 16>>(
+                sq, quantizer, store_pairs, sel, r);
+    }
+}
+
+InvertedListScanner* sel0_InvertedListScanner_quantized_query(
+        MetricType mt,
+        const ScalarQuantizer* sq,
+        const Index* quantizer,
+        bool store_pairs,
+        const IDSelector* sel,
+        bool by_residual) {
+    if (mt == METRIC_L2) {
+        return sel1_InvertedListScanner_quantized_query<SimilarityL2<1>>(
+                sq, quantizer, store_pairs, sel, by_residual);
+    } else if (mt == METRIC_INNER_PRODUCT) {
+        return sel1_InvertedListScanner_quantized_query<SimilarityIP<1>>(
+                sq, quantizer, store_pairs, sel, by_residual);
+    } else {
+        FAISS_THROW_MSG("unsupported metric type");
+    }
+}
+
 } // anonymous namespace
 
-InvertedListScanner* ScalarQuantizer::select_InvertedListScanner(
+/*******************************************************************
+ * Entry points compiled for each SIMD level
+ ********************************************************************/
+
+namespace scalar_quantizer {
+
+template <SIMDLevel>
+ScalarQuantizer::SQuantizer* select_quantizer(const ScalarQuantizer& sq);
+
+template <SIMDLevel>
+ScalarQuantizer::SQDistanceComputer* get_distance_computer(
+        const ScalarQuantizer& sq,
+        MetricType metric);
+
+template <SIMDLevel>
+InvertedListScanner* select_InvertedListScanner(
+        const ScalarQuantizer& sq,
         MetricType mt,
         const Index* quantizer,
         bool store_pairs,
         const IDSelector* sel,
-        bool by_residual) const {
+        bool by_residual);
+
+template <>
+ScalarQuantizer::SQuantizer* select_quantizer<FAISS_THIS_SIMD_LEVEL>(
+        const ScalarQuantizer& sq) {
+    size_t d = sq.d;
 #if defined(USE_AVX512_F16C)
     if (d % 16 == 0) {
-        return sel0_InvertedListScanner<16>(
-                mt, this, quantizer, store_pairs, sel, by_residual);
+        return select_quantizer_1<16>(sq.qtype, d, sq.trained);
+    } else
+#elif defined(USE_F16C) || defined(USE_NEON)
+    if (d % 8 == 0) {
+        return select_quantizer_1<8>(sq.qtype, d, sq.trained);
+    } else
+#endif
+    {
+        return select_quantizer_1<1>(sq.qtype, d, sq.trained);
+    }
+}
+
+template <>
+ScalarQuantizer::SQDistanceComputer* get_distance_computer<
+        FAISS_THIS_SIMD_LEVEL>(const ScalarQuantizer& sq, MetricType metric) {
+    size_t d = sq.d;
+    const std::vector<float>& trained = sq.trained;
+    if (sq.query_quantization != ScalarQuantizer::QQ_none &&
+        (sq.qtype == ScalarQuantizer::QT_8bit ||
+         sq.qtype == ScalarQuantizer::QT_8bit_uniform ||
+         sq.qtype == ScalarQuantizer::QT_8bit_direct_signed)) {
+        if (metric == METRIC_L2) {
+            return select_distance_computer_quantized_query<SimilarityL2<1>>(
+                    sq.qtype, sq.query_quantization, d, trained);
+        } else {
+            return select_distance_computer_quantized_query<SimilarityIP<1>>(
+                    sq.qtype, sq.query_quantization, d, trained);
+        }
+    }
+#if defined(USE_AVX512_F16C)
+    if (d % 16 == 0) {
+        if (metric == METRIC_L2) {
+            return select_distance_computer<SimilarityL2<16>>(
+                    sq.qtype, d, trained);
+        } else {
+            return select_distance_computer<SimilarityIP<16>>(
+                    sq.qtype, d, trained);
+        }
     } else
 #elif defined(USE_F16C) || defined(USE_NEON)
     if (d % 8 == 0) {
+        if (metric == METRIC_L2) {
+            return select_distance_computer<SimilarityL2<8>>(
+                    sq.qtype, d, trained);
+        } else {
+            return select_distance_computer<SimilarityIP<8>>(
+                    sq.qtype, d, trained);
+        }
+    } else
+#endif
+    {
+        if (metric == METRIC_L2) {
+            return select_distance_computer<SimilarityL2<1>>(
+                    sq.qtype, d, trained);
+        } else {
+            return select_distance_computer<SimilarityIP<1>>(
+                    sq.qtype, d, trained);
+        }
+    }
+}
+
+template <>
+InvertedListScanner* select_InvertedListScanner<FAISS_THIS_SIMD_LEVEL>(
+        const ScalarQuantizer& sq,
+        MetricType mt,
+        const Index* quantizer,
+        bool store_pairs,
+        const IDSelector* sel,
+        bool by_residual) {
+    if (sq.query_quantization != ScalarQuantizer::QQ_none &&
+        (sq.qtype == ScalarQuantizer::QT_8bit ||
+         sq.qtype == ScalarQuantizer::QT_8bit_uniform ||
+         sq.qtype == ScalarQuantizer::QT_8bit_direct_signed)) {
+        return sel0_InvertedListScanner_quantized_query(
+                mt, &sq, quantizer, store_pairs, sel, by_residual);
+    }
+#if defined(USE_AVX512_F16C)
+    if (sq.d % 16 == 0) {
+        return sel0_InvertedListScanner<16>(
+                mt, &sq, quantizer, store_pairs, sel, by_residual);
+    } else
+#elif defined(USE_F16C) || defined(USE_NEON)
+    if (sq.d % 8 == 0) {
         return sel0_InvertedListScanner<8>(
-                mt, this, quantizer, store_pairs, sel, by_residual);
+                mt, &sq, quantizer, store_pairs, sel, by_residual);
     } else
 #endif
     {
         return sel0_InvertedListScanner<1>(
-                mt, this, quantizer, store_pairs, sel, by_residual);
+                mt, &sq, quantizer, store_pairs, sel, by_residual);
     }
 }
 
+} // namespace scalar_quantizer
+
+#ifndef FAISS_SIMD_LEVEL_TU
+
+ScalarQuantizer::SQuantizer* ScalarQuantizer::select_quantizer() const {
+    DISPATCH_SIMDLevel(scalar_quantizer::select_quantizer, *this);
+}
+
+SQDistanceComputer* ScalarQuantizer::get_distance_computer(
+        MetricType metric) const {
+    FAISS_THROW_IF_NOT(metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    DISPATCH_SIMDLevel(scalar_quantizer::get_distance_computer, *this, metric);
+}
+
+InvertedListScanner* ScalarQuantizer::select_InvertedListScanner(
+        MetricType mt,
+        const Index* quantizer,
+        bool store_pairs,
+        const IDSelector* sel,
+        bool by_residual) const {
+    DISPATCH_SIMDLevel(
+            scalar_quantizer::select_InvertedListScanner,
+            *this,
+            mt,
+            quantizer,
+            store_pairs,
+            sel,
+            by_residual);
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
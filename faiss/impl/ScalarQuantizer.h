@@ -54,6 +54,21 @@ struct ScalarQuantizer : Quantizer {
     RangeStat rangestat = RS_minmax;
     float rangestat_arg = 0;
 
+    /** For QT_8bit and QT_8bit_uniform, the distances can be computed in
+     * the integer domain: the query is folded with the per-dimension
+     * scales into integer weights once, and the codes are not decoded.
+     * For QT_8bit_direct_signed, any value other than QQ_none quantizes
+     * the query to int8, which is exact when its components are integers
+     * in [-128, 127].
+     * This is a search-time setting, it is not serialized. */
+    enum QueryQuantization {
+        QQ_none,  ///< decode the codes to float (default)
+        QQ_int16, ///< 16-bit weights, small loss of accuracy
+        QQ_int8,  ///< 7-bit weights, fastest
+    };
+
+    QueryQuantization query_quantization = QQ_none;
+
     /// bits per scalar code
     size_t bits = 0;
 
@@ -92,11 +107,13 @@ struct ScalarQuantizer : Quantizer {
         virtual void encode_vector(const float* x, uint8_t* code) const = 0;
         virtual void decode_vector(const uint8_t* code, float* x) const = 0;
 
-        virtual ~SQuantizer() {}
+        virtual ~SQuantizer();
     };
 
     SQuantizer* select_quantizer() const;
 
+    /* distance_to_code is defined out-of-line, so that the implementations
+     * compiled for each SIMD level do not emit the vtable and typeinfo. */
     struct SQDistanceComputer : FlatCodesDistanceComputer {
         const float* q;
 
@@ -104,9 +121,7 @@ struct ScalarQuantizer : Quantizer {
 
         virtual float query_to_code(const uint8_t* code) const = 0;
 
-        float distance_to_code(const uint8_t* code) final {
-            return query_to_code(code);
-        }
+        float distance_to_code(const uint8_t* code) final;
     };
 
     SQDistanceComputer* get_distance_computer(
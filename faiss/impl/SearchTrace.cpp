@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/SearchTrace.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/platform_macros.h>
+
+namespace faiss {
+
+/*************************************************************
+ * QueryTrace
+ *************************************************************/
+
+uint64_t QueryTrace::total_cycles() const {
+    uint64_t tot = 0;
+    for (int s = 0; s < nstage; s++) {
+        tot += cycles[s];
+    }
+    return tot;
+}
+
+const char* QueryTrace::stage_name(int stage) {
+    static const char* names[] = {
+            "coarse_quantization",
+            "lut",
+            "scan",
+            "heap",
+            "io_wait",
+            "rerank",
+            "total"};
+    FAISS_THROW_IF_NOT(stage >= 0 && stage <= nstage);
+    return names[stage];
+}
+
+/*************************************************************
+ * SearchTrace
+ *************************************************************/
+
+void SearchTrace::begin(size_t n) {
+    if (depth++ == 0) {
+        queries.assign(n, QueryTrace());
+    } else {
+        FAISS_THROW_IF_NOT_MSG(
+                queries.size() == n,
+                "nested search with a different number of queries");
+    }
+}
+
+void SearchTrace::end() {
+    depth--;
+}
+
+std::vector<size_t> SearchTrace::slow_queries(uint64_t min_cycles) const {
+    std::vector<size_t> res;
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (queries[i].total_cycles() >= min_cycles) {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+void SearchTrace::add_block(
+        QueryTrace* queries,
+        size_t n,
+        QueryTrace::Stage stage,
+        uint64_t cycles) {
+    if (!queries || n == 0) {
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        // distribute the remainder so that the sum is exact
+        queries[i].cycles[stage] +=
+                cycles * (i + 1) / n - cycles * i / n;
+    }
+}
+
+double SearchTrace::cycles_per_ms() {
+    static double res = []() {
+        double t0 = getmillisecs();
+        uint64_t c0 = get_cycles();
+        double t1;
+        do {
+            t1 = getmillisecs();
+        } while (t1 - t0 < 10);
+        uint64_t c1 = get_cycles();
+        return (c1 - c0) / (t1 - t0);
+    }();
+    return res;
+}
+
+SearchTraceScope::SearchTraceScope(SearchTrace* trace, size_t n)
+        : trace(trace) {
+    if (trace) {
+        trace->begin(n);
+    }
+}
+
+SearchTraceScope::~SearchTraceScope() {
+    if (trace) {
+        trace->end();
+    }
+}
+
+/*************************************************************
+ * SearchTraceHistogram
+ *************************************************************/
+
+namespace {
+
+int cycles_bucket(uint64_t c) {
+    return c == 0 ? 0 : 64 - __builtin_clzll(c);
+}
+
+} // namespace
+
+SearchTraceHistogram::SearchTraceHistogram()
+        : counts((QueryTrace::nstage + 1) * nbucket) {}
+
+void SearchTraceHistogram::add(const SearchTrace& trace) {
+    // compute the histogram outside of the lock
+    std::vector<uint64_t> local(counts.size());
+    for (const QueryTrace& qt : trace.queries) {
+        for (int s = 0; s < QueryTrace::nstage; s++) {
+            local[s * nbucket + cycles_bucket(qt.cycles[s])]++;
+        }
+        local[total * nbucket + cycles_bucket(qt.total_cycles())]++;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += local[i];
+    }
+    nq += trace.queries.size();
+}
+
+void SearchTraceHistogram::merge(const SearchTraceHistogram& other) {
+    std::vector<uint64_t> other_counts;
+    size_t other_nq;
+    {
+        std::lock_guard<std::mutex> lock(other.mutex);
+        other_counts = other.counts;
+        other_nq = other.nq;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] += other_counts[i];
+    }
+    nq += other_nq;
+}
+
+void SearchTraceHistogram::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(counts.begin(), counts.end(), 0);
+    nq = 0;
+}
+
+uint64_t SearchTraceHistogram::quantile(int stage, double q) const {
+    FAISS_THROW_IF_NOT(stage >= 0 && stage <= total);
+    FAISS_THROW_IF_NOT(q >= 0 && q <= 1);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nq == 0) {
+        return 0;
+    }
+    // smallest bucket such that a fraction q of the queries is in it or
+    // in a lower bucket
+    uint64_t target = std::max(uint64_t(std::ceil(q * nq)), uint64_t(1));
+    const uint64_t* row = counts.data() + stage * nbucket;
+    uint64_t cum = 0;
+    int b = 0;
+    for (; b < nbucket - 1; b++) {
+        cum += row[b];
+        if (cum >= target) {
+            break;
+        }
+    }
+    return b == 0 ? 0 : b == 64 ? UINT64_MAX : (uint64_t(1) << b) - 1;
+}
+
+} // namespace faiss
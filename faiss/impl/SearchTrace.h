@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/* Per-query search instrumentation.
+ *
+ * The global stats objects (indexIVF_stats, hnsw_stats, ...) only count
+ * totals over all queries and are not updated atomically. A SearchTrace
+ * set in SearchParameters::trace instead records, for each query of one
+ * search call, the cycles spent in each stage of the search. The traces
+ * of many calls can be aggregated in a SearchTraceHistogram to find the
+ * tail latencies and the stage that causes them.
+ *
+ * Times are counted with get_cycles() (rdtsc), that returns 0 on non-x86
+ * platforms.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <faiss/utils/utils.h>
+
+namespace faiss {
+
+/// time spent and work done for one query
+struct QueryTrace {
+    enum Stage {
+        coarse_quantization = 0,
+        lut,     ///< query preprocessing: look-up tables, set_query, set_list
+        scan,    ///< scanning inverted lists, traversing the graph
+        heap,    ///< initialization and sorting of the result heaps
+        io_wait, ///< fetching the inverted lists data
+        rerank,  ///< refinement of the results with another index
+        nstage
+    };
+
+    /// cycles spent in each stage
+    uint64_t cycles[nstage] = {};
+    size_t nlist = 0; ///< nb of inverted lists scanned or graph hops
+    size_t ndis = 0;  ///< nb of distances computed
+
+    /// sum of the cycles of all stages
+    uint64_t total_cycles() const;
+
+    static const char* stage_name(int stage);
+};
+
+/** Per-query trace of one search call.
+ *
+ * queries[i] is written only by the thread that handles query i. The
+ * stages that are computed for a block of queries at a time (eg. the
+ * coarse quantization of an IndexIVF) are split evenly between the
+ * queries of the block. Thus a trace can be passed to a multi-threaded
+ * search, but it should not be shared between concurrent search calls.
+ */
+struct SearchTrace {
+    std::vector<QueryTrace> queries;
+
+    /// nb of begin() calls without end()
+    int depth = 0;
+
+    /** called by the search functions for n queries. The outermost call
+     * clears the trace, the nested calls (eg. the base index of an
+     * IndexRefine, when its parameters have the same trace) add to it. */
+    void begin(size_t n);
+    void end();
+
+    /// indices of the queries with at least min_cycles total cycles
+    std::vector<size_t> slow_queries(uint64_t min_cycles) const;
+
+    /// add cycles to a stage of n queries, split evenly
+    static void add_block(
+            QueryTrace* queries,
+            size_t n,
+            QueryTrace::Stage stage,
+            uint64_t cycles);
+
+    /// nb of get_cycles() ticks per millisecond, measured on first call
+    static double cycles_per_ms();
+};
+
+/// begin / end of a trace for the duration of a search, trace may be null
+struct SearchTraceScope {
+    SearchTrace* trace;
+
+    SearchTraceScope(SearchTrace* trace, size_t n);
+    ~SearchTraceScope();
+};
+
+/** Accumulates the time between successive calls to step() in the stages
+ * of a QueryTrace. Does nothing if the QueryTrace is null, so that it
+ * costs one test when tracing is disabled.
+ */
+struct QueryTraceTimer {
+    QueryTrace* qt;
+    uint64_t t0;
+
+    explicit QueryTraceTimer(QueryTrace* qt)
+            : qt(qt), t0(qt ? get_cycles() : 0) {}
+
+    void step(QueryTrace::Stage stage) {
+        if (qt) {
+            uint64_t t1 = get_cycles();
+            qt->cycles[stage] += t1 - t0;
+            t0 = t1;
+        }
+    }
+};
+
+/** log2 histograms of the per-query cycles of each stage and of the
+ * total. add() and merge() are protected by a mutex, so the searches of
+ * several threads can report to the same histogram.
+ */
+struct SearchTraceHistogram {
+    /// bucket 0 is for 0 cycles, bucket b for [2^(b-1), 2^b)
+    static constexpr int nbucket = 65;
+    /// row used for the total cycles of the queries
+    static constexpr int total = QueryTrace::nstage;
+
+    /// size (QueryTrace::nstage + 1) * nbucket
+    std::vector<uint64_t> counts;
+    size_t nq = 0; ///< nb of queries added
+
+    mutable std::mutex mutex;
+
+    SearchTraceHistogram();
+
+    void add(const SearchTrace& trace);
+    void merge(const SearchTraceHistogram& other);
+    void reset();
+
+    /** upper bound of the q-quantile (0 <= q <= 1) of the cycles of a
+     * stage, or of the total if stage = total */
+    uint64_t quantile(int stage, double q) const;
+};
+
+} // namespace faiss
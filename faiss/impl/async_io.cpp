@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/async_io.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+namespace {
+
+/// returns 0 or the errno of the failure
+int read_block(int fd, const AsyncFileReader::Request& req) {
+    char* dest = (char*)req.dest;
+    size_t done = 0;
+    while (done < req.size) {
+        ssize_t ret = pread(fd, dest + done, req.size - done, req.offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (ret == 0) {
+            return EIO; // past the end of file
+        }
+        done += ret;
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+AsyncFileReader::AsyncFileReader(
+        const std::string& filename,
+        int nthreads,
+        bool direct_io)
+        : filename(filename) {
+    int flags = O_RDONLY;
+#ifdef O_DIRECT
+    if (direct_io) {
+        flags |= O_DIRECT;
+    }
+#else
+    FAISS_THROW_IF_NOT_MSG(!direct_io, "O_DIRECT not supported");
+#endif
+    fd = open(filename.c_str(), flags);
+    FAISS_THROW_IF_NOT_FMT(
+            fd >= 0,
+            "could not open %s for reading: %s",
+            filename.c_str(),
+            strerror(errno));
+    for (int i = 0; i < nthreads; i++) {
+        threads.emplace_back([this] { worker(); });
+    }
+}
+
+AsyncFileReader::~AsyncFileReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+    close(fd);
+}
+
+void AsyncFileReader::worker() {
+    for (;;) {
+        std::pair<Request, std::function<void(int)>> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_cv.wait(lock, [this] { return stop || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job.second(read_block(fd, job.first));
+    }
+}
+
+void AsyncFileReader::submit(
+        const Request& request,
+        std::function<void(int)> callback) {
+    if (threads.empty()) {
+        callback(read_block(fd, request));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.emplace_back(request, std::move(callback));
+    }
+    work_cv.notify_one();
+}
+
+void AsyncFileReader::read(size_t n, const Request* requests) {
+    if (n == 0) {
+        return;
+    }
+    int error = 0;
+    if (threads.empty() || n == 1) {
+        for (size_t i = 0; i < n && error == 0; i++) {
+            error = read_block(fd, requests[i]);
+        }
+    } else {
+        std::mutex batch_mutex;
+        std::condition_variable done_cv;
+        size_t remaining = n;
+        auto callback = [&](int err) {
+            std::lock_guard<std::mutex> lock(batch_mutex);
+            if (err != 0) {
+                error = err;
+            }
+            if (--remaining == 0) {
+                done_cv.notify_one();
+            }
+        };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < n; i++) {
+                queue.emplace_back(requests[i], callback);
+            }
+        }
+        work_cv.notify_all();
+        std::unique_lock<std::mutex> lock(batch_mutex);
+        done_cv.wait(lock, [&remaining] { return remaining == 0; });
+    }
+    FAISS_THROW_IF_NOT_FMT(
+            error == 0,
+            "read error in %s: %s",
+            filename.c_str(),
+            strerror(error));
+}
+
+} // namespace faiss
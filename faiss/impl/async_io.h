@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace faiss {
+
+/** Reads batches of blocks from a file with a pool of threads that call
+ * pread, so that all the reads of a batch are in flight at the same time
+ * (SSDs need many outstanding requests to reach their throughput).
+ *
+ * The reader can be shared by threads that submit batches concurrently.
+ */
+struct AsyncFileReader {
+    struct Request {
+        size_t offset; ///< offset in the file, in bytes
+        size_t size;   ///< number of bytes to read
+        void* dest;    ///< output buffer
+    };
+
+    std::string filename;
+    int fd = -1;
+
+    /** @param nthreads   number of I/O threads, 0 = read in the calling
+     *                    thread
+     *  @param direct_io  open with O_DIRECT (bypasses the page cache, the
+     *                    offsets, sizes and buffers must be aligned to the
+     *                    device block size)
+     */
+    explicit AsyncFileReader(
+            const std::string& filename,
+            int nthreads = 8,
+            bool direct_io = false);
+
+    /// read a batch of blocks, returns when they are all read
+    void read(size_t n, const Request* requests);
+
+    /** submit a read and return immediately. The callback is called
+     * from an I/O thread (or from the calling thread if there are no I/O
+     * threads) with 0 or the errno of the failure. */
+    void submit(const Request& request, std::function<void(int)> callback);
+
+    ~AsyncFileReader();
+
+   private:
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::deque<std::pair<Request, std::function<void(int)>>> queue;
+    std::vector<std::thread> threads;
+    bool stop = false;
+
+    void worker();
+};
+
+} // namespace faiss
@@ -0,0 +1,466 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/chunked_io.h>
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/utils.h>
+
+namespace faiss {
+
+namespace {
+
+const uint32_t chunked_version = 1;
+// trailer offset, trailer checksum, magic, version
+const size_t footer_size = 24;
+
+uint32_t chunked_magic() {
+    return fourcc("FChk");
+}
+
+/// returns 0 or the errno of the failure
+int pwrite_all(int fd, const void* ptr, size_t n, size_t offset) {
+    const char* src = (const char*)ptr;
+    size_t done = 0;
+    while (done < n) {
+        ssize_t ret = pwrite(fd, src + done, n - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        done += ret;
+    }
+    return 0;
+}
+
+/// returns 0 or the errno of the failure
+int pread_all(int fd, void* ptr, size_t n, size_t offset) {
+    char* dest = (char*)ptr;
+    size_t done = 0;
+    while (done < n) {
+        ssize_t ret = pread(fd, dest + done, n - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (ret == 0) {
+            return EIO; // past the end of file
+        }
+        done += ret;
+    }
+    return 0;
+}
+
+int effective_nthreads(int nthreads) {
+    return nthreads > 0 ? nthreads : omp_get_max_threads();
+}
+
+} // anonymous namespace
+
+/***********************************************************************
+ * ChunkedFileIOWriter
+ ***********************************************************************/
+
+ChunkedFileIOWriter::ChunkedFileIOWriter(
+        const char* fname,
+        size_t chunk_size,
+        int nthreads)
+        : chunk_size(chunk_size), nthreads(nthreads) {
+    FAISS_THROW_IF_NOT_MSG(chunk_size > 0, "chunk_size should be > 0");
+    name = fname;
+    fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    FAISS_THROW_IF_NOT_FMT(
+            fd >= 0,
+            "could not open %s for writing: %s",
+            fname,
+            strerror(errno));
+    uint8_t header[header_size] = {};
+    uint32_t magic = chunked_magic();
+    uint64_t cs = chunk_size;
+    memcpy(header, &magic, 4);
+    memcpy(header + 4, &chunked_version, 4);
+    memcpy(header + 8, &cs, 8);
+    int err = pwrite_all(fd, header, header_size, 0);
+    FAISS_THROW_IF_NOT_FMT(
+            err == 0, "write error in %s: %s", fname, strerror(err));
+}
+
+size_t ChunkedFileIOWriter::max_buffer_size() const {
+    return effective_nthreads(nthreads) * chunk_size;
+}
+
+void ChunkedFileIOWriter::write_chunks(const uint8_t* ptr, size_t n) {
+    size_t c0 = checksums.size();
+    int64_t nc = (n + chunk_size - 1) / chunk_size;
+    checksums.resize(c0 + nc);
+    int nt = std::min(int64_t(effective_nthreads(nthreads)), nc);
+    int err = 0;
+
+#pragma omp parallel for num_threads(nt) if (nt > 1)
+    for (int64_t i = 0; i < nc; i++) {
+        size_t ofs = i * chunk_size;
+        size_t sz = std::min(chunk_size, n - ofs);
+        checksums[c0 + i] = bvec_checksum(sz, ptr + ofs);
+        int ret = pwrite_all(
+                fd, ptr + ofs, sz, header_size + (c0 + i) * chunk_size);
+        if (ret != 0) {
+#pragma omp critical
+            err = ret;
+        }
+    }
+    FAISS_THROW_IF_NOT_FMT(
+            err == 0, "write error in %s: %s", name.c_str(), strerror(err));
+}
+
+void ChunkedFileIOWriter::flush_buffer(bool last) {
+    size_t n = last ? buffer.size() : buffer.size() / chunk_size * chunk_size;
+    if (n == 0) {
+        return;
+    }
+    write_chunks(buffer.data(), n);
+    buffer.erase(buffer.begin(), buffer.begin() + n);
+}
+
+size_t ChunkedFileIOWriter::operator()(
+        const void* ptr,
+        size_t size,
+        size_t nitems) {
+    FAISS_THROW_IF_NOT_FMT(fd >= 0, "%s is closed", name.c_str());
+    const uint8_t* p = (const uint8_t*)ptr;
+    size_t n = size * nitems;
+    if (n >= section_min_size) {
+        sections.push_back({total_size, n});
+    }
+    total_size += n;
+    while (n > 0) {
+        if (buffer.size() % chunk_size == 0 && n >= chunk_size) {
+            // at a chunk boundary: the full chunks are written from ptr
+            flush_buffer(false);
+            size_t nfull = n / chunk_size * chunk_size;
+            write_chunks(p, nfull);
+            p += nfull;
+            n -= nfull;
+        } else {
+            size_t m = std::min(n, chunk_size - buffer.size() % chunk_size);
+            buffer.insert(buffer.end(), p, p + m);
+            p += m;
+            n -= m;
+            if (buffer.size() >= max_buffer_size()) {
+                flush_buffer(false);
+            }
+        }
+    }
+    return nitems;
+}
+
+void ChunkedFileIOWriter::close() {
+    if (fd < 0) {
+        return;
+    }
+    flush_buffer(true);
+    FAISS_ASSERT(
+            checksums.size() == (total_size + chunk_size - 1) / chunk_size);
+
+    std::vector<uint64_t> trailer;
+    trailer.push_back(total_size);
+    trailer.push_back(checksums.size());
+    trailer.insert(trailer.end(), checksums.begin(), checksums.end());
+    trailer.push_back(sections.size());
+    for (const ChunkedFileSection& s : sections) {
+        trailer.push_back(s.offset);
+        trailer.push_back(s.size);
+    }
+    size_t trailer_nbytes = trailer.size() * sizeof(uint64_t);
+
+    uint8_t footer[footer_size];
+    uint64_t trailer_offset = header_size + total_size;
+    uint64_t trailer_cs =
+            bvec_checksum(trailer_nbytes, (const uint8_t*)trailer.data());
+    uint32_t magic = chunked_magic();
+    memcpy(footer, &trailer_offset, 8);
+    memcpy(footer + 8, &trailer_cs, 8);
+    memcpy(footer + 16, &magic, 4);
+    memcpy(footer + 20, &chunked_version, 4);
+
+    int err = pwrite_all(fd, trailer.data(), trailer_nbytes, trailer_offset);
+    if (err == 0) {
+        err = pwrite_all(
+                fd, footer, footer_size, trailer_offset + trailer_nbytes);
+    }
+    if (::close(fd) != 0 && err == 0) {
+        err = errno;
+    }
+    fd = -1;
+    FAISS_THROW_IF_NOT_FMT(
+            err == 0, "write error in %s: %s", name.c_str(), strerror(err));
+}
+
+ChunkedFileIOWriter::~ChunkedFileIOWriter() {
+    if (fd < 0) {
+        return;
+    }
+    if (std::uncaught_exceptions() > 0) {
+        // the serialization failed: leave the file without a footer so
+        // that it is not mistaken for a complete index
+        ::close(fd);
+        return;
+    }
+    try {
+        close();
+    } catch (const std::exception& e) {
+        // we cannot raise and exception in the destructor
+        fprintf(stderr, "%s\n", e.what());
+    }
+}
+
+/***********************************************************************
+ * ChunkedFileIOReader
+ ***********************************************************************/
+
+ChunkedFileIOReader::ChunkedFileIOReader(const char* fname, int nthreads)
+        : nthreads(nthreads) {
+    name = fname;
+    fd = open(fname, O_RDONLY);
+    FAISS_THROW_IF_NOT_FMT(
+            fd >= 0,
+            "could not open %s for reading: %s",
+            fname,
+            strerror(errno));
+    try {
+        struct stat st;
+        FAISS_THROW_IF_NOT_FMT(
+                fstat(fd, &st) == 0,
+                "could not stat %s: %s",
+                fname,
+                strerror(errno));
+        size_t file_size = st.st_size;
+        size_t header_size = ChunkedFileIOWriter::header_size;
+        FAISS_THROW_IF_NOT_FMT(
+                file_size >= header_size + footer_size,
+                "%s is not a chunked index file",
+                fname);
+
+        uint8_t header[ChunkedFileIOWriter::header_size];
+        uint8_t footer[footer_size];
+        int err = pread_all(fd, header, header_size, 0);
+        if (err == 0) {
+            err = pread_all(fd, footer, footer_size, file_size - footer_size);
+        }
+        FAISS_THROW_IF_NOT_FMT(
+                err == 0, "read error in %s: %s", fname, strerror(err));
+
+        uint32_t magic, version, footer_magic, footer_version;
+        uint64_t cs, trailer_offset, trailer_cs;
+        memcpy(&magic, header, 4);
+        memcpy(&version, header + 4, 4);
+        memcpy(&cs, header + 8, 8);
+        memcpy(&trailer_offset, footer, 8);
+        memcpy(&trailer_cs, footer + 8, 8);
+        memcpy(&footer_magic, footer + 16, 4);
+        memcpy(&footer_version, footer + 20, 4);
+        FAISS_THROW_IF_NOT_FMT(
+                magic == chunked_magic() && footer_magic == chunked_magic(),
+                "%s is not a complete chunked index file",
+                fname);
+        FAISS_THROW_IF_NOT_FMT(
+                version == chunked_version && footer_version == version,
+                "%s: unsupported chunked file version %d",
+                fname,
+                int(version));
+        FAISS_THROW_IF_NOT_FMT(
+                cs > 0 && trailer_offset >= header_size &&
+                        trailer_offset + footer_size <= file_size &&
+                        (file_size - footer_size - trailer_offset) % 8 == 0,
+                "%s: corrupted footer",
+                fname);
+        chunk_size = cs;
+
+        std::vector<uint64_t> trailer(
+                (file_size - footer_size - trailer_offset) / 8);
+        size_t trailer_nbytes = trailer.size() * sizeof(uint64_t);
+        err = pread_all(fd, trailer.data(), trailer_nbytes, trailer_offset);
+        FAISS_THROW_IF_NOT_FMT(
+                err == 0, "read error in %s: %s", fname, strerror(err));
+        FAISS_THROW_IF_NOT_FMT(
+                bvec_checksum(trailer_nbytes, (const uint8_t*)trailer.data()) ==
+                                trailer_cs &&
+                        trailer.size() >= 3,
+                "%s: corrupted trailer",
+                fname);
+
+        total_size = trailer[0];
+        size_t nchunk = trailer[1];
+        FAISS_THROW_IF_NOT_FMT(
+                trailer_offset == header_size + total_size &&
+                        nchunk == (total_size + chunk_size - 1) / chunk_size &&
+                        trailer.size() >= 3 + nchunk,
+                "%s: inconsistent trailer",
+                fname);
+        checksums.assign(
+                trailer.begin() + 2, trailer.begin() + 2 + nchunk);
+        size_t nsection = trailer[2 + nchunk];
+        FAISS_THROW_IF_NOT_FMT(
+                trailer.size() == 3 + nchunk + 2 * nsection,
+                "%s: inconsistent trailer",
+                fname);
+        sections.resize(nsection);
+        for (size_t i = 0; i < nsection; i++) {
+            sections[i].offset = trailer[3 + nchunk + 2 * i];
+            sections[i].size = trailer[3 + nchunk + 2 * i + 1];
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+int ChunkedFileIOReader::get_nthreads() const {
+    return effective_nthreads(nthreads);
+}
+
+size_t ChunkedFileIOReader::chunk_nbytes(size_t chunk) const {
+    return std::min(chunk_size, total_size - chunk * chunk_size);
+}
+
+void ChunkedFileIOReader::read_chunks(size_t c0, size_t nc, uint8_t* dest) {
+    int nt = std::min(size_t(get_nthreads()), nc);
+    int err = 0;
+    int64_t bad_chunk = -1;
+
+#pragma omp parallel for num_threads(nt) if (nt > 1)
+    for (int64_t i = 0; i < nc; i++) {
+        size_t c = c0 + i;
+        size_t sz = chunk_nbytes(c);
+        uint8_t* d = dest + i * chunk_size;
+        int ret = pread_all(
+                fd, d, sz, ChunkedFileIOWriter::header_size + c * chunk_size);
+        if (ret != 0) {
+#pragma omp critical
+            err = ret;
+        } else if (bvec_checksum(sz, d) != checksums[c]) {
+#pragma omp critical
+            bad_chunk = c;
+        }
+    }
+    FAISS_THROW_IF_NOT_FMT(
+            err == 0, "read error in %s: %s", name.c_str(), strerror(err));
+    FAISS_THROW_IF_NOT_FMT(
+            bad_chunk < 0,
+            "%s: checksum mismatch in chunk %" PRId64 ", the file is corrupted",
+            name.c_str(),
+            bad_chunk);
+}
+
+void ChunkedFileIOReader::read_at(size_t offset, size_t n, void* dest) {
+    FAISS_THROW_IF_NOT_FMT(
+            offset <= total_size && n <= total_size - offset,
+            "read past the end of %s",
+            name.c_str());
+    uint8_t* d = (uint8_t*)dest;
+    while (n > 0) {
+        if (offset >= buffer_offset &&
+            offset < buffer_offset + buffer.size()) {
+            size_t m = std::min(n, buffer_offset + buffer.size() - offset);
+            memcpy(d, buffer.data() + offset - buffer_offset, m);
+            d += m;
+            offset += m;
+            n -= m;
+        } else if (offset % chunk_size == 0 && n >= chunk_size) {
+            // full chunks are read directly to the destination
+            size_t nc = n / chunk_size;
+            read_chunks(offset / chunk_size, nc, d);
+            d += nc * chunk_size;
+            offset += nc * chunk_size;
+            n -= nc * chunk_size;
+        } else {
+            // fill the read-ahead buffer from the chunk of offset
+            size_t c0 = offset / chunk_size;
+            size_t nc =
+                    std::min(size_t(get_nthreads()), checksums.size() - c0);
+            buffer_offset = c0 * chunk_size;
+            buffer.resize(
+                    std::min(nc * chunk_size, total_size - buffer_offset));
+            read_chunks(c0, nc, buffer.data());
+        }
+    }
+}
+
+size_t ChunkedFileIOReader::operator()(void* ptr, size_t size, size_t nitems) {
+    if (size == 0) {
+        return nitems;
+    }
+    nitems = std::min(nitems, (total_size - pos) / size);
+    read_at(pos, size * nitems, ptr);
+    pos += size * nitems;
+    return nitems;
+}
+
+std::vector<size_t> ChunkedFileIOReader::verify() {
+    std::vector<size_t> bad;
+    int64_t nchunk = checksums.size();
+    int nt = std::min(int64_t(get_nthreads()), nchunk);
+
+#pragma omp parallel num_threads(nt) if (nt > 1)
+    {
+        std::vector<uint8_t> buf(chunk_size);
+#pragma omp for schedule(dynamic)
+        for (int64_t c = 0; c < nchunk; c++) {
+            size_t sz = chunk_nbytes(c);
+            int ret = pread_all(
+                    fd,
+                    buf.data(),
+                    sz,
+                    ChunkedFileIOWriter::header_size + c * chunk_size);
+            if (ret != 0 || bvec_checksum(sz, buf.data()) != checksums[c]) {
+#pragma omp critical
+                bad.push_back(c);
+            }
+        }
+    }
+    std::sort(bad.begin(), bad.end());
+    return bad;
+}
+
+ChunkedFileIOReader::~ChunkedFileIOReader() {
+    ::close(fd);
+}
+
+bool is_chunked_file(const char* fname) {
+    struct stat st;
+    // do not consume data from pipes and devices
+    if (stat(fname, &st) != 0 || !S_ISREG(st.st_mode) ||
+        size_t(st.st_size) < ChunkedFileIOWriter::header_size + footer_size) {
+        return false;
+    }
+    FILE* f = fopen(fname, "rb");
+    if (!f) {
+        return false;
+    }
+    uint32_t magic = 0;
+    size_t ret = fread(&magic, sizeof(magic), 1, f);
+    fclose(f);
+    return ret == 1 && magic == chunked_magic();
+}
+
+} // namespace faiss
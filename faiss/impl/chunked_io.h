@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/* Chunked container for serialized indexes.
+ *
+ * The container stores the same byte stream as the classic format (the
+ * output of write_index), cut into chunks of chunk_size bytes. Each chunk
+ * has a checksum (bvec_checksum). Writes and reads that span several
+ * chunks (codes, inverted lists, graphs) are split over threads that
+ * pwrite / pread and checksum their chunks in parallel. Small fields are
+ * buffered and flushed by batches of chunks.
+ *
+ * File layout:
+ *
+ *   header   magic, version, chunk_size             (header_size bytes)
+ *   data     the serialized stream
+ *   trailer  total_size, chunk checksums, section table
+ *   footer   trailer offset, trailer checksum, magic, version
+ *
+ * The stream is stored contiguously, so the byte at stream offset o is at
+ * file offset header_size + o. Writes of at least section_min_size bytes
+ * are recorded in the section table, so that the large arrays can be
+ * located and read (read_at) without deserializing the index. The
+ * checksums can be verified without loading the index (verify).
+ *
+ * read_index and read_index_binary recognize the container when they are
+ * given a file name. write_index writes it with IO_FLAG_CHUNKED.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <faiss/impl/io.h>
+
+namespace faiss {
+
+struct ChunkedFileSection {
+    size_t offset; ///< offset in the stream
+    size_t size;   ///< size in bytes
+};
+
+struct ChunkedFileIOWriter : IOWriter {
+    static constexpr size_t header_size = 32;
+
+    int fd = -1;
+    size_t chunk_size;
+    /// number of threads for the parallel writes, 0 = OpenMP default
+    int nthreads;
+    /// record the writes of at least this size in the section table
+    size_t section_min_size = 1 << 20;
+
+    size_t total_size = 0; ///< number of stream bytes received
+    std::vector<uint64_t> checksums;
+    std::vector<ChunkedFileSection> sections;
+
+    /** @param chunk_size  size of the checksummed chunks (bytes)
+     *  @param nthreads    number of threads, 0 = OpenMP default
+     */
+    explicit ChunkedFileIOWriter(
+            const char* fname,
+            size_t chunk_size = 4 << 20,
+            int nthreads = 0);
+
+    size_t operator()(const void* ptr, size_t size, size_t nitems) override;
+
+    /// flush the data, write the trailer and close the file
+    void close();
+
+    // closes if needed
+    ~ChunkedFileIOWriter() override;
+
+   private:
+    /// bytes received but not written yet, starting at a chunk boundary
+    std::vector<uint8_t> buffer;
+
+    /// write the stream bytes [written, written + n) from ptr
+    void write_chunks(const uint8_t* ptr, size_t n);
+    /// write the full chunks of the buffer (or all of it if last)
+    void flush_buffer(bool last);
+    size_t max_buffer_size() const;
+};
+
+struct ChunkedFileIOReader : IOReader {
+    int fd = -1;
+    size_t chunk_size = 0;
+    /// number of threads for the parallel reads, 0 = OpenMP default
+    int nthreads;
+
+    size_t total_size = 0; ///< size of the stream
+    std::vector<uint64_t> checksums;
+    std::vector<ChunkedFileSection> sections;
+
+    size_t pos = 0; ///< read position in the stream
+
+    /// opens the file and reads the trailer (throws if it is corrupted)
+    explicit ChunkedFileIOReader(const char* fname, int nthreads = 0);
+
+    /// sequential read at pos, the chunks are verified as they are loaded
+    size_t operator()(void* ptr, size_t size, size_t nitems) override;
+
+    /// read the stream bytes [offset, offset + n), verified
+    void read_at(size_t offset, size_t n, void* dest);
+
+    /// verify the checksums of all chunks, returns the corrupted ones
+    std::vector<size_t> verify();
+
+    ~ChunkedFileIOReader() override;
+
+   private:
+    /// read-ahead buffer, covers the stream range [buffer_offset,
+    /// buffer_offset + buffer.size()), buffer_offset is a chunk boundary
+    std::vector<uint8_t> buffer;
+    size_t buffer_offset = 0;
+
+    size_t chunk_nbytes(size_t chunk) const;
+    /// read and verify chunks [c0, c0 + nc) to dest
+    void read_chunks(size_t c0, size_t nc, uint8_t* dest);
+    int get_nthreads() const;
+};
+
+/// does the file start with the chunked container magic
+bool is_chunked_file(const char* fname);
+
+} // namespace faiss
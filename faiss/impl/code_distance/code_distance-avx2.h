@@ -236,6 +236,8 @@ inline void distance_four_codes_avx2_pqdecoder8_m8(
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 template <typename PQDecoderT>
 typename std::enable_if<!std::is_same<PQDecoderT, PQDecoder8>::value, float>::
         type inline distance_single_code_avx2(
@@ -529,6 +531,8 @@ distance_four_codes_avx2(
     }
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
@@ -18,6 +18,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 // According to experiments, the AVX-512 version may be SLOWER than
 //   the AVX2 version, which is somewhat unexpected.
 // This version is not used for now, but it may be used later.
@@ -243,6 +245,8 @@ distance_four_codes_avx512(
     }
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
@@ -10,8 +10,12 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <faiss/utils/simd_levels.h>
+
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /// Returns the distance to a single code.
 template <typename PQDecoderT>
 inline float distance_single_code_generic(
@@ -78,4 +82,6 @@ inline void distance_four_codes_generic(
     }
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
@@ -18,6 +18,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 template <typename PQDecoderT>
 std::enable_if_t<!std::is_same_v<PQDecoderT, PQDecoder8>, float> inline distance_single_code_sve(
         // the product quantizer
@@ -435,6 +437,8 @@ distance_four_codes_sve(
     result3 = svaddv_f32(svptrue_b32(), partialSum3);
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
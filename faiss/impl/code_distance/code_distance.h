@@ -8,6 +8,7 @@
 #pragma once
 
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/simd_levels.h>
 
 // This directory contains functions to compute a distance
 // from a given PQ code to a query vector, given that the
@@ -30,6 +31,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 template <typename PQDecoderT>
 inline float distance_single_code(
         // number of subquantizers
@@ -75,6 +78,8 @@ inline void distance_four_codes(
             result3);
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #elif defined(__ARM_FEATURE_SVE)
@@ -83,6 +88,8 @@ inline void distance_four_codes(
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 template <typename PQDecoderT>
 inline float distance_single_code(
         // the product quantizer
@@ -128,6 +135,8 @@ inline void distance_four_codes(
             result3);
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #else
@@ -136,6 +145,8 @@ inline void distance_four_codes(
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 template <typename PQDecoderT>
 inline float distance_single_code(
         // number of subquantizers
@@ -181,6 +192,8 @@ inline void distance_four_codes(
             result3);
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
@@ -17,8 +17,13 @@
 #include <sys/types.h>
 
 #include <faiss/impl/FaissAssert.h>
+#ifndef _WIN32
+#include <faiss/impl/chunked_io.h>
+#endif
 #include <faiss/impl/io.h>
 #include <faiss/impl/io_macros.h>
+#include <faiss/impl/mapped_io.h>
+#include <faiss/impl/maybe_owned_vector.h>
 #include <faiss/utils/hamming.h>
 
 #include <faiss/invlists/InvertedListsIOHook.h>
@@ -26,7 +31,9 @@
 #include <faiss/Index2Layer.h>
 #include <faiss/IndexAdditiveQuantizer.h>
 #include <faiss/IndexAdditiveQuantizerFastScan.h>
+#include <faiss/IndexDiskGraph.h>
 #include <faiss/IndexFlat.h>
+#include <faiss/IndexFlat16.h>
 #include <faiss/IndexHNSW.h>
 #include <faiss/IndexIVF.h>
 #include <faiss/IndexIVFAdditiveQuantizer.h>
@@ -36,6 +43,7 @@
 #include <faiss/IndexIVFPQ.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
+#include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
@@ -44,10 +52,12 @@
 #include <faiss/IndexPQ.h>
 #include <faiss/IndexPQFastScan.h>
 #include <faiss/IndexPreTransform.h>
+#include <faiss/IndexRaBitQ.h>
 #include <faiss/IndexRefine.h>
 #include <faiss/IndexRowwiseMinMax.h>
 #include <faiss/IndexScalarQuantizer.h>
 #include <faiss/MetaIndexes.h>
+#include <faiss/TwoLevelCoarseQuantizer.h>
 #include <faiss/VectorTransform.h>
 
 #include <faiss/IndexBinaryFlat.h>
@@ -62,6 +72,41 @@ namespace faiss {
  * Read
  **************************************************************/
 
+/** read a vector that may be a view on a memory-mapped file. The
+ * stored size is multiplied by size_multiplier (for READXBVECTOR
+ * compatibility). */
+template <typename T>
+static void read_maybe_owned_vector(
+        MaybeOwnedVector<T>& target,
+        IOReader* f,
+        size_t size_multiplier = 1) {
+    size_t size;
+    READANDCHECK(&size, 1);
+    FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));
+    size *= size_multiplier;
+
+    target.clear();
+    MappedFileIOReader* mf = dynamic_cast<MappedFileIOReader*>(f);
+    if (mf) {
+        void* address = nullptr;
+        size_t nread = mf->mmap(&address, sizeof(T), size);
+        FAISS_THROW_IF_NOT_FMT(
+                nread == size,
+                "read error in %s: %zd != %zd (mmap)",
+                f->name.c_str(),
+                nread,
+                size);
+        target = MaybeOwnedVector<T>::create_view(
+                address, size, mf->mmap_owner);
+    } else {
+        target.resize(size);
+        READANDCHECK(target.data(), size);
+    }
+}
+
+#define READVECTOR_MAYBE_MMAP(vec) read_maybe_owned_vector(vec, f)
+#define READXBVECTOR_MAYBE_MMAP(vec) read_maybe_owned_vector(vec, f, 4)
+
 void read_index_header(Index* idx, IOReader* f) {
     READ1(idx->d);
     READ1(idx->ntotal);
@@ -366,9 +411,9 @@ void read_ScalarQuantizer(ScalarQuantizer* ivsc, IOReader* f) {
 static void read_HNSW(HNSW* hnsw, IOReader* f) {
     READVECTOR(hnsw->assign_probas);
     READVECTOR(hnsw->cum_nneighbor_per_level);
-    READVECTOR(hnsw->levels);
-    READVECTOR(hnsw->offsets);
-    READVECTOR(hnsw->neighbors);
+    READVECTOR_MAYBE_MMAP(hnsw->levels);
+    READVECTOR_MAYBE_MMAP(hnsw->offsets);
+    READVECTOR_MAYBE_MMAP(hnsw->neighbors);
 
     READ1(hnsw->entry_point);
     READ1(hnsw->max_level);
@@ -548,11 +593,24 @@ Index* read_index(IOReader* f, int io_flags) {
         }
         read_index_header(idxf, f);
         idxf->code_size = idxf->d * sizeof(float);
-        READXBVECTOR(idxf->codes);
+        READXBVECTOR_MAYBE_MMAP(idxf->codes);
         FAISS_THROW_IF_NOT(
                 idxf->codes.size() == idxf->ntotal * idxf->code_size);
         // leak!
         idx = idxf;
+    } else if (h == fourcc("IxFh") || h == fourcc("IxFb")) {
+        IndexFlat16* idxf;
+        if (h == fourcc("IxFb")) {
+            idxf = new IndexFlatBF16();
+        } else {
+            idxf = new IndexFlatFP16();
+        }
+        read_index_header(idxf, f);
+        idxf->code_size = idxf->d * sizeof(uint16_t);
+        READVECTOR_MAYBE_MMAP(idxf->codes);
+        FAISS_THROW_IF_NOT(
+                idxf->codes.size() == idxf->ntotal * idxf->code_size);
+        idx = idxf;
     } else if (h == fourcc("IxHE") || h == fourcc("IxHe")) {
         IndexLSH* idxl = new IndexLSH();
         read_index_header(idxl, f);
@@ -579,7 +637,7 @@ Index* read_index(IOReader* f, int io_flags) {
             idxl->rrot = *rrot;
             delete rrot;
         }
-        READVECTOR(idxl->codes);
+        READVECTOR_MAYBE_MMAP(idxl->codes);
         FAISS_THROW_IF_NOT(
                 idxl->rrot.d_in == idxl->d && idxl->rrot.d_out == idxl->nbits);
         FAISS_THROW_IF_NOT(
@@ -592,7 +650,7 @@ Index* read_index(IOReader* f, int io_flags) {
         read_index_header(idxp, f);
         read_ProductQuantizer(&idxp->pq, f);
         idxp->code_size = idxp->pq.code_size;
-        READVECTOR(idxp->codes);
+        READVECTOR_MAYBE_MMAP(idxp->codes);
         if (h == fourcc("IxPo") || h == fourcc("IxPq")) {
             READ1(idxp->search_type);
             READ1(idxp->encode_signs);
@@ -614,28 +672,28 @@ Index* read_index(IOReader* f, int io_flags) {
             read_ResidualQuantizer(&idxr->rq, f, io_flags);
         }
         READ1(idxr->code_size);
-        READVECTOR(idxr->codes);
+        READVECTOR_MAYBE_MMAP(idxr->codes);
         idx = idxr;
     } else if (h == fourcc("IxLS")) {
         auto idxr = new IndexLocalSearchQuantizer();
         read_index_header(idxr, f);
         read_LocalSearchQuantizer(&idxr->lsq, f);
         READ1(idxr->code_size);
-        READVECTOR(idxr->codes);
+        READVECTOR_MAYBE_MMAP(idxr->codes);
         idx = idxr;
     } else if (h == fourcc("IxPR")) {
         auto idxpr = new IndexProductResidualQuantizer();
         read_index_header(idxpr, f);
         read_ProductResidualQuantizer(&idxpr->prq, f, io_flags);
         READ1(idxpr->code_size);
-        READVECTOR(idxpr->codes);
+        READVECTOR_MAYBE_MMAP(idxpr->codes);
         idx = idxpr;
     } else if (h == fourcc("IxPL")) {
         auto idxpl = new IndexProductLocalSearchQuantizer();
         read_index_header(idxpl, f);
         read_ProductLocalSearchQuantizer(&idxpl->plsq, f);
         READ1(idxpl->code_size);
-        READVECTOR(idxpl->codes);
+        READVECTOR_MAYBE_MMAP(idxpl->codes);
         idx = idxpl;
     } else if (h == fourcc("ImRQ")) {
         ResidualCoarseQuantizer* idxr = new ResidualCoarseQuantizer();
@@ -649,6 +707,26 @@ Index* read_index(IOReader* f, int io_flags) {
         }
         idxr->set_beam_factor(idxr->beam_factor);
         idx = idxr;
+    } else if (h == fourcc("Im2L")) {
+        TwoLevelCoarseQuantizer* idx2q = new TwoLevelCoarseQuantizer();
+        read_index_header(idx2q, f);
+        READ1(idx2q->nlist1);
+        READ1(idx2q->nlist2);
+        READ1(idx2q->nprobe1);
+        for (IndexFlat* q : {&idx2q->top_quantizer, &idx2q->sub_centroids}) {
+            q->d = idx2q->d;
+            q->metric_type = idx2q->metric_type;
+            q->code_size = idx2q->d * sizeof(float);
+            READXBVECTOR(q->codes);
+            q->ntotal = q->codes.size() / q->code_size;
+        }
+        if (idx2q->is_trained) {
+            FAISS_THROW_IF_NOT(idx2q->top_quantizer.ntotal == idx2q->nlist1);
+            FAISS_THROW_IF_NOT(
+                    idx2q->sub_centroids.ntotal ==
+                    idx2q->nlist1 * idx2q->nlist2);
+        }
+        idx = idx2q;
     } else if (
             h == fourcc("ILfs") || h == fourcc("IRfs") || h == fourcc("IPRf") ||
             h == fourcc("IPLf")) {
@@ -792,9 +870,26 @@ Index* read_index(IOReader* f, int io_flags) {
         IndexScalarQuantizer* idxs = new IndexScalarQuantizer();
         read_index_header(idxs, f);
         read_ScalarQuantizer(&idxs->sq, f);
-        READVECTOR(idxs->codes);
+        READVECTOR_MAYBE_MMAP(idxs->codes);
         idxs->code_size = idxs->sq.code_size;
         idx = idxs;
+    } else if (h == fourcc("Ixrb")) {
+        IndexRaBitQ* idxrb = new IndexRaBitQ();
+        read_index_header(idxrb, f);
+        idxrb->rabitq = RaBitQuantizer(idxrb->d, idxrb->metric_type);
+        idxrb->code_size = idxrb->rabitq.code_size;
+        READVECTOR(idxrb->center);
+        READ1(idxrb->qb);
+        READVECTOR_MAYBE_MMAP(idxrb->codes);
+        idx = idxrb;
+    } else if (h == fourcc("Iwrb")) {
+        IndexIVFRaBitQ* ivrb = new IndexIVFRaBitQ();
+        read_ivf_header(ivrb, f);
+        ivrb->rabitq = RaBitQuantizer(ivrb->d, ivrb->metric_type);
+        ivrb->code_size = ivrb->rabitq.code_size;
+        READ1(ivrb->qb);
+        read_InvertedLists(ivrb, f, io_flags);
+        idx = ivrb;
     } else if (h == fourcc("IxLa")) {
         int d, nsq, scale_nbit, r2;
         READ1(d);
@@ -950,7 +1045,7 @@ Index* read_index(IOReader* f, int io_flags) {
         READ1(idxp->code_size_1);
         READ1(idxp->code_size_2);
         READ1(idxp->code_size);
-        READVECTOR(idxp->codes);
+        READVECTOR_MAYBE_MMAP(idxp->codes);
         idx = idxp;
     } else if (
             h == fourcc("IHNf") || h == fourcc("IHNp") || h == fourcc("IHNs") ||
@@ -1007,6 +1102,27 @@ Index* read_index(IOReader* f, int io_flags) {
         idxnnd->storage = read_index(f, io_flags);
         idxnnd->own_fields = true;
         idx = idxnnd;
+#ifndef _WIN32
+    } else if (h == fourcc("IDGp")) {
+        IndexDiskGraph* idxdg = new IndexDiskGraph();
+        read_index_header(idxdg, f);
+        read_ProductQuantizer(&idxdg->pq, f);
+        READVECTOR(idxdg->codes);
+        std::vector<char> x;
+        READVECTOR(x);
+        idxdg->filename.assign(x.begin(), x.end());
+        READ1(idxdg->R);
+        READ1(idxdg->entry_point);
+        READ1(idxdg->node_size);
+        READ1(idxdg->search_L);
+        READ1(idxdg->beam_width);
+        READ1(idxdg->io_threads);
+        READ1(idxdg->direct_io);
+        if (idxdg->ntotal > 0) {
+            idxdg->open_file();
+        }
+        idx = idxdg;
+#endif
     } else if (h == fourcc("IPfs")) {
         IndexPQFastScan* idxpqfs = new IndexPQFastScan();
         read_index_header(idxpqfs, f);
@@ -1074,11 +1190,38 @@ Index* read_index(IOReader* f, int io_flags) {
 }
 
 Index* read_index(FILE* f, int io_flags) {
+    if (io_flags & IO_FLAG_MMAP_IFC) {
+        // map the whole file and resume reading at the current position
+        auto owner = std::make_shared<MmappedFileMappingOwner>(f);
+        MappedFileIOReader reader(owner);
+        long pos = ftell(f);
+        FAISS_THROW_IF_NOT_MSG(pos >= 0, "ftell failed");
+        reader.pos = pos;
+        Index* idx = read_index(&reader, io_flags);
+        fseek(f, reader.pos, SEEK_SET);
+        return idx;
+    }
     FileIOReader reader(f);
     return read_index(&reader, io_flags);
 }
 
 Index* read_index(const char* fname, int io_flags) {
+#ifndef _WIN32
+    if (is_chunked_file(fname)) {
+        FAISS_THROW_IF_NOT_MSG(
+                !(io_flags & (IO_FLAG_MMAP_IFC | IO_FLAG_SKIP_IVF_DATA)),
+                "memory mapping is not supported for chunked files");
+        ChunkedFileIOReader reader(fname);
+        return read_index(&reader, io_flags);
+    }
+#endif
+    if (io_flags & IO_FLAG_MMAP_IFC) {
+        auto owner = std::make_shared<MmappedFileMappingOwner>(fname);
+        MappedFileIOReader reader(owner);
+        reader.name = fname;
+        Index* idx = read_index(&reader, io_flags);
+        return idx;
+    }
     FileIOReader reader(fname);
     Index* idx = read_index(&reader, io_flags);
     return idx;
@@ -1257,6 +1400,12 @@ IndexBinary* read_index_binary(FILE* f, int io_flags) {
 }
 
 IndexBinary* read_index_binary(const char* fname, int io_flags) {
+#ifndef _WIN32
+    if (is_chunked_file(fname)) {
+        ChunkedFileIOReader reader(fname);
+        return read_index_binary(&reader, io_flags);
+    }
+#endif
     FileIOReader reader(fname);
     IndexBinary* idx = read_index_binary(&reader, io_flags);
     return idx;
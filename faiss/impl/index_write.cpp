@@ -19,6 +19,9 @@
 #include <faiss/invlists/InvertedListsIOHook.h>
 
 #include <faiss/impl/FaissAssert.h>
+#ifndef _WIN32
+#include <faiss/impl/chunked_io.h>
+#endif
 #include <faiss/impl/io.h>
 #include <faiss/impl/io_macros.h>
 #include <faiss/utils/hamming.h>
@@ -26,7 +29,9 @@
 #include <faiss/Index2Layer.h>
 #include <faiss/IndexAdditiveQuantizer.h>
 #include <faiss/IndexAdditiveQuantizerFastScan.h>
+#include <faiss/IndexDiskGraph.h>
 #include <faiss/IndexFlat.h>
+#include <faiss/IndexFlat16.h>
 #include <faiss/IndexHNSW.h>
 #include <faiss/IndexIVF.h>
 #include <faiss/IndexIVFAdditiveQuantizer.h>
@@ -36,6 +41,7 @@
 #include <faiss/IndexIVFPQ.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
+#include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
@@ -44,10 +50,12 @@
 #include <faiss/IndexPQ.h>
 #include <faiss/IndexPQFastScan.h>
 #include <faiss/IndexPreTransform.h>
+#include <faiss/IndexRaBitQ.h>
 #include <faiss/IndexRefine.h>
 #include <faiss/IndexRowwiseMinMax.h>
 #include <faiss/IndexScalarQuantizer.h>
 #include <faiss/MetaIndexes.h>
+#include <faiss/TwoLevelCoarseQuantizer.h>
 #include <faiss/VectorTransform.h>
 
 #include <faiss/IndexBinaryFlat.h>
@@ -405,6 +413,13 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         WRITE1(h);
         write_index_header(idx, f);
         WRITEXBVECTOR(idxf->codes);
+    } else if (
+            const IndexFlat16* idxf16 =
+                    dynamic_cast<const IndexFlat16*>(idx)) {
+        uint32_t h = fourcc(idxf16->bf16 ? "IxFb" : "IxFh");
+        WRITE1(h);
+        write_index_header(idx, f);
+        WRITEVECTOR(idxf16->codes);
     } else if (const IndexLSH* idxl = dynamic_cast<const IndexLSH*>(idx)) {
         uint32_t h = fourcc("IxHe");
         WRITE1(h);
@@ -584,6 +599,17 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         write_index_header(idx, f);
         write_ResidualQuantizer(&idxr_2->rq, f);
         WRITE1(idxr_2->beam_factor);
+    } else if (
+            const TwoLevelCoarseQuantizer* idx2q =
+                    dynamic_cast<const TwoLevelCoarseQuantizer*>(idx)) {
+        uint32_t h = fourcc("Im2L");
+        WRITE1(h);
+        write_index_header(idx, f);
+        WRITE1(idx2q->nlist1);
+        WRITE1(idx2q->nlist2);
+        WRITE1(idx2q->nprobe1);
+        WRITEXBVECTOR(idx2q->top_quantizer.codes);
+        WRITEXBVECTOR(idx2q->sub_centroids.codes);
     } else if (
             const Index2Layer* idxp_2 = dynamic_cast<const Index2Layer*>(idx)) {
         uint32_t h = fourcc("Ix2L");
@@ -605,6 +631,22 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         write_index_header(idx, f);
         write_ScalarQuantizer(&idxs->sq, f);
         WRITEVECTOR(idxs->codes);
+    } else if (
+            const IndexRaBitQ* idxrb = dynamic_cast<const IndexRaBitQ*>(idx)) {
+        uint32_t h = fourcc("Ixrb");
+        WRITE1(h);
+        write_index_header(idx, f);
+        WRITEVECTOR(idxrb->center);
+        WRITE1(idxrb->qb);
+        WRITEVECTOR(idxrb->codes);
+    } else if (
+            const IndexIVFRaBitQ* ivrb =
+                    dynamic_cast<const IndexIVFRaBitQ*>(idx)) {
+        uint32_t h = fourcc("Iwrb");
+        WRITE1(h);
+        write_ivf_header(ivrb, f);
+        WRITE1(ivrb->qb);
+        write_InvertedLists(ivrb->invlists, f);
     } else if (
             const IndexLattice* idxl_2 =
                     dynamic_cast<const IndexLattice*>(idx)) {
@@ -769,6 +811,10 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
                 : dynamic_cast<const IndexHNSWCagra*>(idx)   ? fourcc("IHNc")
                                                              : 0;
         FAISS_THROW_IF_NOT(h != 0);
+        FAISS_THROW_IF_NOT_MSG(
+                idxhnsw->ndeleted == 0,
+                "cannot serialize an IndexHNSW with deleted vectors, "
+                "call compact_deleted() first");
         WRITE1(h);
         write_index_header(idxhnsw, f);
         if (h == fourcc("IHNc")) {
@@ -811,6 +857,25 @@ void write_index(const Index* idx, IOWriter* f, int io_flags) {
         write_index_header(idxnnd, f);
         write_NNDescent(&idxnnd->nndescent, f);
         write_index(idxnnd->storage, f);
+#ifndef _WIN32
+    } else if (
+            const IndexDiskGraph* idxdg =
+                    dynamic_cast<const IndexDiskGraph*>(idx)) {
+        uint32_t h = fourcc("IDGp");
+        WRITE1(h);
+        write_index_header(idxdg, f);
+        write_ProductQuantizer(&idxdg->pq, f);
+        WRITEVECTOR(idxdg->codes);
+        std::vector<char> x(idxdg->filename.begin(), idxdg->filename.end());
+        WRITEVECTOR(x);
+        WRITE1(idxdg->R);
+        WRITE1(idxdg->entry_point);
+        WRITE1(idxdg->node_size);
+        WRITE1(idxdg->search_L);
+        WRITE1(idxdg->beam_width);
+        WRITE1(idxdg->io_threads);
+        WRITE1(idxdg->direct_io);
+#endif
     } else if (
             const IndexPQFastScan* idxpqfs =
                     dynamic_cast<const IndexPQFastScan*>(idx)) {
@@ -865,6 +930,16 @@ void write_index(const Index* idx, FILE* f, int io_flags) {
 }
 
 void write_index(const Index* idx, const char* fname, int io_flags) {
+    if (io_flags & IO_FLAG_CHUNKED) {
+#ifndef _WIN32
+        ChunkedFileIOWriter writer(fname);
+        write_index(idx, &writer, io_flags);
+        writer.close();
+        return;
+#else
+        FAISS_THROW_MSG("chunked files are not supported on Windows");
+#endif
+    }
     FileIOWriter writer(fname);
     write_index(idx, &writer, io_flags);
 }
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/mapped_io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+/***********************************************************************
+ * Mapping of a full file
+ ***********************************************************************/
+
+#ifndef _WIN32
+
+struct MmappedFileMappingOwner::PImpl {
+    void* ptr = nullptr;
+    size_t ptr_size = 0;
+
+    explicit PImpl(FILE* f) {
+        int fd = fileno(f);
+        struct stat st;
+        int ret = fstat(fd, &st);
+        FAISS_THROW_IF_NOT_FMT(ret == 0, "fstat failed: %s", strerror(errno));
+        ptr_size = st.st_size;
+        if (ptr_size == 0) {
+            return;
+        }
+        ptr = ::mmap(nullptr, ptr_size, PROT_READ, MAP_SHARED, fd, 0);
+        FAISS_THROW_IF_NOT_FMT(
+                ptr != MAP_FAILED, "could not mmap: %s", strerror(errno));
+    }
+
+    ~PImpl() {
+        if (ptr && ptr != MAP_FAILED) {
+            munmap(ptr, ptr_size);
+        }
+    }
+};
+
+#else
+
+struct MmappedFileMappingOwner::PImpl {
+    void* ptr = nullptr;
+    size_t ptr_size = 0;
+
+    explicit PImpl(FILE*) {
+        FAISS_THROW_MSG("memory-mapped index files are not supported");
+    }
+};
+
+#endif
+
+MmappedFileMappingOwner::MmappedFileMappingOwner(const std::string& filename) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    FAISS_THROW_IF_NOT_FMT(
+            f,
+            "could not open %s for reading: %s",
+            filename.c_str(),
+            strerror(errno));
+    try {
+        p_impl = std::make_unique<PImpl>(f);
+    } catch (...) {
+        fclose(f);
+        throw;
+    }
+    // the mapping stays valid after the file is closed
+    fclose(f);
+}
+
+MmappedFileMappingOwner::MmappedFileMappingOwner(FILE* f)
+        : p_impl(std::make_unique<PImpl>(f)) {}
+
+MmappedFileMappingOwner::~MmappedFileMappingOwner() = default;
+
+void* MmappedFileMappingOwner::data() const {
+    return p_impl->ptr;
+}
+
+size_t MmappedFileMappingOwner::size() const {
+    return p_impl->ptr_size;
+}
+
+/***********************************************************************
+ * Reader
+ ***********************************************************************/
+
+MappedFileIOReader::MappedFileIOReader(
+        const std::shared_ptr<MmappedFileMappingOwner>& owner)
+        : mmap_owner(owner) {}
+
+size_t MappedFileIOReader::operator()(void* ptr, size_t size, size_t nitems) {
+    if (size * nitems == 0) {
+        return 0;
+    }
+    const size_t total = mmap_owner->size();
+    if (pos >= total) {
+        return 0;
+    }
+    nitems = std::min(nitems, (total - pos) / size);
+    const char* src = (const char*)mmap_owner->data() + pos;
+    memcpy(ptr, src, size * nitems);
+    pos += size * nitems;
+    return nitems;
+}
+
+size_t MappedFileIOReader::mmap(void** ptr, size_t size, size_t nitems) {
+    const size_t total = mmap_owner->size();
+    if (size * nitems == 0 || pos >= total) {
+        *ptr = nullptr;
+        return 0;
+    }
+    nitems = std::min(nitems, (total - pos) / size);
+    *ptr = (char*)mmap_owner->data() + pos;
+    pos += size * nitems;
+    return nitems;
+}
+
+} // namespace faiss
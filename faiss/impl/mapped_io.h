@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <faiss/impl/io.h>
+#include <faiss/impl/maybe_owned_vector.h>
+
+namespace faiss {
+
+/** Read-only memory mapping of a whole file. The mapping is shared
+ * (MAP_SHARED) so several processes that map the same index file use
+ * the same physical pages from the page cache. */
+struct MmappedFileMappingOwner : MaybeOwnedVectorOwner {
+    explicit MmappedFileMappingOwner(const std::string& filename);
+    explicit MmappedFileMappingOwner(FILE* f);
+
+    ~MmappedFileMappingOwner() override;
+
+    void* data() const;
+    size_t size() const;
+
+    struct PImpl;
+    std::unique_ptr<PImpl> p_impl;
+};
+
+/** IOReader that reads from a memory-mapped file. In addition to the
+ * copying operator(), it can return pointers into the mapping so that
+ * large arrays are not copied (see read_index with IO_FLAG_MMAP_IFC). */
+struct MappedFileIOReader : IOReader {
+    std::shared_ptr<MmappedFileMappingOwner> mmap_owner;
+
+    size_t pos = 0;
+
+    explicit MappedFileIOReader(
+            const std::shared_ptr<MmappedFileMappingOwner>& owner);
+
+    size_t operator()(void* ptr, size_t size, size_t nitems) override;
+
+    /** return a pointer to the next nitems items of size bytes in *ptr,
+     * advance the read position and return the number of items
+     * available */
+    size_t mmap(void** ptr, size_t size, size_t nitems);
+};
+
+} // namespace faiss
@@ -0,0 +1,260 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+/** Base class for objects that keep alive the memory viewed by a
+ * MaybeOwnedVector (eg. a memory-mapped file). */
+struct MaybeOwnedVectorOwner {
+    virtual ~MaybeOwnedVectorOwner() = default;
+};
+
+/** A vector that either owns its data (in a std::vector) or is a
+ * read-only view on memory that is owned by someone else.
+ *
+ * The view mode is used to serve large arrays (codes, graph
+ * structure) directly from a memory-mapped index file. The owner
+ * object is reference-counted so that the mapping stays valid as long
+ * as any of the views on it exist.
+ *
+ * Modifying functions (resize, insert, etc.) and the non-const
+ * accessors (data(), operator[], begin(), etc.) are only supported in
+ * owned mode, since the viewed memory may be mapped read-only. Code
+ * that only reads a vector that may be a view must access it through a
+ * const reference. Use to_owned() to get a modifiable copy of a view.
+ *
+ * T should be a POD type.
+ */
+template <typename T>
+struct MaybeOwnedVector {
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    bool is_owned = true;
+
+    /// storage when is_owned
+    std::vector<T> owned_data;
+
+    /// storage when !is_owned
+    T* view_data = nullptr;
+    size_t view_size = 0;
+
+    /// keeps the viewed memory alive
+    std::shared_ptr<MaybeOwnedVectorOwner> owner;
+
+    MaybeOwnedVector() = default;
+
+    explicit MaybeOwnedVector(size_t n) : owned_data(n) {}
+
+    MaybeOwnedVector(size_t n, const T& v) : owned_data(n, v) {}
+
+    MaybeOwnedVector(const std::vector<T>& v) : owned_data(v) {}
+
+    MaybeOwnedVector(std::vector<T>&& v) : owned_data(std::move(v)) {}
+
+    MaybeOwnedVector(const MaybeOwnedVector&) = default;
+    MaybeOwnedVector(MaybeOwnedVector&&) = default;
+    MaybeOwnedVector& operator=(const MaybeOwnedVector&) = default;
+    MaybeOwnedVector& operator=(MaybeOwnedVector&&) = default;
+
+    MaybeOwnedVector& operator=(const std::vector<T>& v) {
+        reset_view();
+        owned_data = v;
+        return *this;
+    }
+
+    MaybeOwnedVector& operator=(std::vector<T>&& v) {
+        reset_view();
+        owned_data = std::move(v);
+        return *this;
+    }
+
+    /// build a view on n elements stored at address
+    static MaybeOwnedVector create_view(
+            void* address,
+            size_t n,
+            const std::shared_ptr<MaybeOwnedVectorOwner>& owner) {
+        MaybeOwnedVector v;
+        v.is_owned = false;
+        v.view_data = reinterpret_cast<T*>(address);
+        v.view_size = n;
+        v.owner = owner;
+        return v;
+    }
+
+    const T* data() const {
+        return is_owned ? owned_data.data() : view_data;
+    }
+
+    /// throws if this is a view
+    T* data() {
+        return get_owned().data();
+    }
+
+    size_t size() const {
+        return is_owned ? owned_data.size() : view_size;
+    }
+
+    size_t byte_size() const {
+        return size() * sizeof(T);
+    }
+
+    size_t capacity() const {
+        return is_owned ? owned_data.capacity() : view_size;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    T& operator[](size_t i) {
+        return data()[i];
+    }
+
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+
+    T& back() {
+        return data()[size() - 1];
+    }
+
+    const T& back() const {
+        return data()[size() - 1];
+    }
+
+    iterator begin() {
+        return data();
+    }
+
+    iterator end() {
+        return data() + size();
+    }
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator end() const {
+        return data() + size();
+    }
+
+    /// copy the contents of a view to owned storage (no-op if owned)
+    void to_owned() {
+        if (is_owned) {
+            return;
+        }
+        std::vector<T> tmp(view_data, view_data + view_size);
+        reset_view();
+        owned_data.swap(tmp);
+    }
+
+    /// owned storage, throws if this is a view
+    std::vector<T>& get_owned() {
+        FAISS_THROW_IF_NOT_MSG(is_owned, "cannot modify a non-owned vector");
+        return owned_data;
+    }
+
+    void clear() {
+        reset_view();
+        owned_data.clear();
+    }
+
+    void resize(size_t n) {
+        get_owned().resize(n);
+    }
+
+    void resize(size_t n, const T& v) {
+        get_owned().resize(n, v);
+    }
+
+    void reserve(size_t n) {
+        get_owned().reserve(n);
+    }
+
+    void push_back(const T& v) {
+        get_owned().push_back(v);
+    }
+
+    void assign(size_t n, const T& v) {
+        get_owned().assign(n, v);
+    }
+
+    template <class InputIt>
+    void assign(InputIt first, InputIt last) {
+        get_owned().assign(first, last);
+    }
+
+    /// insert a range before position pos (which must be in [begin, end])
+    template <class InputIt>
+    void insert(const_iterator pos, InputIt first, InputIt last) {
+        std::vector<T>& v = get_owned();
+        size_t ofs = pos - v.data();
+        v.insert(v.begin() + ofs, first, last);
+    }
+
+    void insert(const_iterator pos, size_t n, const T& val) {
+        std::vector<T>& v = get_owned();
+        size_t ofs = pos - v.data();
+        v.insert(v.begin() + ofs, n, val);
+    }
+
+    void erase(const_iterator first, const_iterator last) {
+        std::vector<T>& v = get_owned();
+        v.erase(v.begin() + (first - v.data()),
+                v.begin() + (last - v.data()));
+    }
+
+    void swap(MaybeOwnedVector& other) {
+        std::swap(*this, other);
+    }
+
+    void swap(std::vector<T>& other) {
+        to_owned();
+        owned_data.swap(other);
+    }
+
+    void shrink_to_fit() {
+        if (is_owned) {
+            owned_data.shrink_to_fit();
+        }
+    }
+
+   private:
+    void reset_view() {
+        is_owned = true;
+        view_data = nullptr;
+        view_size = 0;
+        owner.reset();
+    }
+};
+
+template <typename T>
+bool operator==(const MaybeOwnedVector<T>& a, const MaybeOwnedVector<T>& b) {
+    return a.size() == b.size() &&
+            (a.size() == 0 ||
+             memcmp(a.data(), b.data(), a.byte_size()) == 0);
+}
+
+template <typename T>
+bool operator!=(const MaybeOwnedVector<T>& a, const MaybeOwnedVector<T>& b) {
+    return !(a == b);
+}
+
+} // namespace faiss
@@ -11,6 +11,7 @@
 #include <cstdlib>
 
 #include <faiss/impl/CodePacker.h>
+#include <faiss/utils/simd_levels.h>
 
 /** PQ4 SIMD packing and accumulation functions
  *
@@ -24,8 +25,10 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
 struct NormTableScaler;
 struct SIMDResultHandler;
+FAISS_SIMD_NAMESPACE_END
 
 /** Pack codes for consumption by the SIMD kernels.
  *  The unused bytes are set to 0.
@@ -130,6 +133,25 @@ void pq4_accumulate_loop(
         SIMDResultHandler& res,
         const NormTableScaler* scaler);
 
+/** Same as pq4_accumulate_loop, with kernels on 512-bit registers that
+ * process the codes of 64 database elements per shuffle. The blocks of 32
+ * elements are processed by pairs, so any bbs is supported. Throws if
+ * pq4_has_512bit_kernels() is false.
+ */
+void pq4_accumulate_loop_512(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        SIMDResultHandler& res,
+        const NormTableScaler* scaler);
+
+/// are the kernels of pq4_accumulate_loop_512 usable: compiled with
+/// AVX512, or with dynamic dispatch and the SIMD level set to AVX512
+bool pq4_has_512bit_kernels();
+
 /* qbs versions, supported only for bbs=32.
  *
  * The kernel function runs the kernel for *several* query blocks
@@ -7,9 +7,13 @@
 
 #include <faiss/impl/pq4_fast_scan.h>
 
+#include <algorithm>
+
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/LookupTableScaler.h>
 #include <faiss/impl/simd_result_handlers.h>
+#include <faiss/utils/AlignedTable.h>
+#include <faiss/utils/simd_levels.h>
 
 namespace faiss {
 
@@ -190,6 +194,236 @@ void pq4_accumulate_loop_fixed_handler(
     }
 }
 
+#ifdef __AVX512F__
+
+/*
+ * 512-bit version of the kernel. It accumulates results for NQ queries and
+ * 2 blocks of 32 database elements (codes_a and codes_b) that can be
+ * anywhere in the packed array. The 4 128-bit lanes of a register hold the
+ * codes of sub-quantizers (sq, sq + 1) for block a, then for block b, so
+ * one shuffle handles 64 codes.
+ */
+template <int NQ, class ResultHandler, class Scaler>
+void kernel_accumulate_block_512(
+        int nsq,
+        const uint8_t* codes_a,
+        const uint8_t* codes_b,
+        size_t stride,
+        const uint8_t* LUT,
+        ResultHandler& res,
+        const Scaler& scaler) {
+    // distance accumulators, the low halves are for block a
+    simd32uint16 accu[NQ][4];
+
+    for (int q = 0; q < NQ; q++) {
+        for (int b = 0; b < 4; b++) {
+            accu[q][b].clear();
+        }
+    }
+
+    for (int sq = 0; sq < nsq - scaler.nscale; sq += 2) {
+        simd32uint8 ca(codes_a), cb(codes_b);
+        simd64uint8 c(ca, cb);
+        codes_a += stride;
+        codes_b += stride;
+        simd64uint8 mask(15);
+        simd64uint8 chi = simd64uint8(simd32uint16(c) >> 4) & mask;
+        simd64uint8 clo = c & mask;
+
+        for (int q = 0; q < NQ; q++) {
+            simd32uint8 lut_ab(LUT);
+            LUT += 32;
+            simd64uint8 lut(lut_ab, lut_ab);
+            simd64uint8 res0 = lut.lookup_4_lanes(clo);
+            simd64uint8 res1 = lut.lookup_4_lanes(chi);
+
+            accu[q][0] += simd32uint16(res0);
+            accu[q][1] += simd32uint16(res0) >> 8;
+
+            accu[q][2] += simd32uint16(res1);
+            accu[q][3] += simd32uint16(res1) >> 8;
+        }
+    }
+
+    for (int sq = 0; sq < scaler.nscale; sq += 2) {
+        simd32uint8 ca(codes_a), cb(codes_b);
+        simd64uint8 c(ca, cb);
+        codes_a += stride;
+        codes_b += stride;
+        simd64uint8 mask(15);
+        simd64uint8 chi = simd64uint8(simd32uint16(c) >> 4) & mask;
+        simd64uint8 clo = c & mask;
+
+        for (int q = 0; q < NQ; q++) {
+            simd32uint8 lut_ab(LUT);
+            LUT += 32;
+            simd64uint8 lut(lut_ab, lut_ab);
+
+            simd64uint8 res0 = scaler.lookup(lut, clo);
+            accu[q][0] += scaler.scale_lo(res0);
+            accu[q][1] += scaler.scale_hi(res0);
+
+            simd64uint8 res1 = scaler.lookup(lut, chi);
+            accu[q][2] += scaler.scale_lo(res1);
+            accu[q][3] += scaler.scale_hi(res1);
+        }
+    }
+
+    for (int q = 0; q < NQ; q++) {
+        accu[q][0] -= accu[q][1] << 8;
+        accu[q][2] -= accu[q][3] << 8;
+        res.handle(
+                q,
+                0,
+                combine2x2(accu[q][0].low(), accu[q][1].low()),
+                combine2x2(accu[q][2].low(), accu[q][3].low()));
+        res.handle(
+                q,
+                1,
+                combine2x2(accu[q][0].high(), accu[q][1].high()),
+                combine2x2(accu[q][2].high(), accu[q][3].high()));
+    }
+}
+
+/* The blocks of 32 elements are processed by pairs. Block i starts at
+ * (i / bb) * bbs * nsq / 2 + (i % bb) * 32 and the codes of successive
+ * sub-quantizer pairs are bbs bytes apart. */
+template <int NQ, class ResultHandler, class Scaler>
+void accumulate_blocks_512(
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        ResultHandler& res,
+        const Scaler& scaler) {
+    size_t bb = bbs / 32;
+    size_t nblock = nb / 32;
+    auto block_codes = [&](size_t i) {
+        return codes + (i / bb) * bbs * nsq / 2 + (i % bb) * 32;
+    };
+    for (size_t i = 0; i < nblock; i += 2) {
+        FixedStorageHandler<NQ, 4> res2;
+        const uint8_t* codes_a = block_codes(i);
+        // the last block is paired with itself if nblock is odd
+        const uint8_t* codes_b = i + 1 < nblock ? block_codes(i + 1) : codes_a;
+        kernel_accumulate_block_512<NQ>(
+                nsq, codes_a, codes_b, bbs, LUT, res2, scaler);
+        res.set_block_origin(0, i * 32);
+        for (int q = 0; q < NQ; q++) {
+            res.handle(q, 0, res2.dis[q][0], res2.dis[q][1]);
+            if (i + 1 < nblock) {
+                res.handle(q, 1, res2.dis[q][2], res2.dis[q][3]);
+            }
+        }
+    }
+}
+
+template <class ResultHandler, class Scaler>
+void pq4_accumulate_loop_512_fixed_scaler(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        ResultHandler& res,
+        const Scaler& scaler) {
+    FAISS_THROW_IF_NOT(bbs % 32 == 0);
+    FAISS_THROW_IF_NOT(nb % bbs == 0);
+
+#define DISPATCH(NQ)                                                     \
+    case NQ:                                                             \
+        accumulate_blocks_512<NQ>(nb, bbs, nsq, codes, LUT, res, scaler); \
+        break
+
+    switch (nq) {
+        DISPATCH(1);
+        DISPATCH(2);
+        DISPATCH(3);
+        DISPATCH(4);
+        default:
+            FAISS_THROW_FMT("nq=%d not instantiated", nq);
+    }
+#undef DISPATCH
+}
+
+#endif
+
+template <class Scaler>
+void pq4_accumulate_loop_to_mem(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        uint16_t* dis,
+        const Scaler& scaler,
+        bool kernel_512) {
+    StoreResultHandler res(dis, nb);
+#ifdef __AVX512F__
+    if (kernel_512) {
+        pq4_accumulate_loop_512_fixed_scaler(
+                nq, nb, bbs, nsq, codes, LUT, res, scaler);
+        return;
+    }
+#endif
+    FAISS_THROW_IF_NOT(!kernel_512);
+    pq4_accumulate_loop_fixed_scaler(nq, nb, bbs, nsq, codes, LUT, res, scaler);
+}
+
+} // anonymous namespace
+
+/***************************************************************
+ * Entry point compiled for each SIMD level
+ ***************************************************************/
+
+namespace pq4_fast_scan {
+
+/* computes the distances of the nq queries to the nb codes in dis, size
+ * (nq, nb), with the 256-bit or 512-bit kernels. nb is a multiple of bbs.
+ * scale_int is the NormTableScaler scale, 0 if there is no scaler. */
+template <SIMDLevel>
+void accumulate_loop_to_mem(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        int scale_int,
+        uint16_t* dis,
+        bool kernel_512);
+
+template <>
+void accumulate_loop_to_mem<FAISS_THIS_SIMD_LEVEL>(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        int scale_int,
+        uint16_t* dis,
+        bool kernel_512) {
+    if (scale_int) {
+        NormTableScaler scaler(scale_int);
+        pq4_accumulate_loop_to_mem(
+                nq, nb, bbs, nsq, codes, LUT, dis, scaler, kernel_512);
+    } else {
+        DummyScaler dummy;
+        pq4_accumulate_loop_to_mem(
+                nq, nb, bbs, nsq, codes, LUT, dis, dummy, kernel_512);
+    }
+}
+
+} // namespace pq4_fast_scan
+
+#ifndef FAISS_SIMD_LEVEL_TU
+
+namespace {
+
 struct Run_pq4_accumulate_loop {
     template <class ResultHandler>
     void f(ResultHandler& res,
@@ -205,6 +439,109 @@ struct Run_pq4_accumulate_loop {
     }
 };
 
+#ifdef __AVX512F__
+
+struct Run_pq4_accumulate_loop_512 {
+    template <class ResultHandler>
+    void f(ResultHandler& res,
+           int nq,
+           size_t nb,
+           int bbs,
+           int nsq,
+           const uint8_t* codes,
+           const uint8_t* LUT,
+           const NormTableScaler* scaler) {
+        if (scaler) {
+            pq4_accumulate_loop_512_fixed_scaler(
+                    nq, nb, bbs, nsq, codes, LUT, res, *scaler);
+        } else {
+            DummyScaler dscaler;
+            pq4_accumulate_loop_512_fixed_scaler(
+                    nq, nb, bbs, nsq, codes, LUT, res, dscaler);
+        }
+    }
+};
+
+#endif
+
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+
+void accumulate_loop_to_mem(
+        SIMDLevel level,
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        int scale_int,
+        uint16_t* dis,
+        bool kernel_512) {
+    switch (level) {
+#ifdef COMPILE_SIMD_AVX512
+        case SIMDLevel::AVX512:
+            pq4_fast_scan::accumulate_loop_to_mem<SIMDLevel::AVX512>(
+                    nq, nb, bbs, nsq, codes, LUT, scale_int, dis, kernel_512);
+            return;
+#endif
+#ifdef COMPILE_SIMD_AVX2
+        case SIMDLevel::AVX2:
+            pq4_fast_scan::accumulate_loop_to_mem<SIMDLevel::AVX2>(
+                    nq, nb, bbs, nsq, codes, LUT, scale_int, dis, kernel_512);
+            return;
+#endif
+        default:
+            pq4_fast_scan::accumulate_loop_to_mem<SIMDLevel::NONE>(
+                    nq, nb, bbs, nsq, codes, LUT, scale_int, dis, kernel_512);
+    }
+}
+
+/* The distances are computed by the kernels of a SIMD level for tiles of
+ * codes, and the result handler reads them back from memory. */
+struct Run_pq4_accumulate_loop_tiled {
+    template <class ResultHandler>
+    void f(ResultHandler& res,
+           SIMDLevel level,
+           int nq,
+           size_t nb,
+           int bbs,
+           int nsq,
+           const uint8_t* codes,
+           const uint8_t* LUT,
+           const NormTableScaler* scaler,
+           bool kernel_512) {
+        FAISS_THROW_IF_NOT(bbs % 32 == 0);
+        FAISS_THROW_IF_NOT(nb % bbs == 0);
+        // nb of codes per tile (a multiple of bbs), the distances stay in
+        // L1 cache
+        const size_t bs = std::max(256 / bbs, 1) * bbs;
+        AlignedTable<uint16_t> dis(nq * bs);
+        for (size_t j0 = 0; j0 < nb; j0 += bs) {
+            size_t j1 = std::min(j0 + bs, nb);
+            accumulate_loop_to_mem(
+                    level,
+                    nq,
+                    j1 - j0,
+                    bbs,
+                    nsq,
+                    codes + j0 * nsq / 2,
+                    LUT,
+                    scaler ? scaler->scale_int : 0,
+                    dis.get(),
+                    kernel_512);
+            for (size_t j = j0; j < j1; j += 32) {
+                res.set_block_origin(0, j);
+                for (int q = 0; q < nq; q++) {
+                    const uint16_t* d = dis.get() + q * (j1 - j0) + j - j0;
+                    res.handle(q, 0, simd16uint16(d), simd16uint16(d + 16));
+                }
+            }
+        }
+    }
+};
+
+#endif
+
 } // anonymous namespace
 
 void pq4_accumulate_loop(
@@ -216,9 +553,74 @@ void pq4_accumulate_loop(
         const uint8_t* LUT,
         SIMDResultHandler& res,
         const NormTableScaler* scaler) {
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+    SIMDLevel level = SIMDConfig::get_level();
+    if (level != SIMDLevel::NONE) {
+        Run_pq4_accumulate_loop_tiled consumer;
+        dispatch_SIMDResultHandler(
+                res,
+                consumer,
+                level,
+                nq,
+                nb,
+                bbs,
+                nsq,
+                codes,
+                LUT,
+                scaler,
+                false);
+        return;
+    }
+#endif
     Run_pq4_accumulate_loop consumer;
     dispatch_SIMDResultHandler(
             res, consumer, nq, nb, bbs, nsq, codes, LUT, scaler);
 }
 
+void pq4_accumulate_loop_512(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        SIMDResultHandler& res,
+        const NormTableScaler* scaler) {
+#ifdef __AVX512F__
+    Run_pq4_accumulate_loop_512 consumer;
+    dispatch_SIMDResultHandler(
+            res, consumer, nq, nb, bbs, nsq, codes, LUT, scaler);
+#else
+    FAISS_THROW_IF_NOT_MSG(
+            pq4_has_512bit_kernels(), "the 512-bit kernels are not available");
+#ifdef COMPILE_SIMD_AVX512
+    Run_pq4_accumulate_loop_tiled consumer;
+    dispatch_SIMDResultHandler(
+            res,
+            consumer,
+            SIMDLevel::AVX512,
+            nq,
+            nb,
+            bbs,
+            nsq,
+            codes,
+            LUT,
+            scaler,
+            true);
+#endif
+#endif
+}
+
+bool pq4_has_512bit_kernels() {
+#if defined(__AVX512F__)
+    return true;
+#elif defined(COMPILE_SIMD_AVX512)
+    return SIMDConfig::level == SIMDLevel::AVX512;
+#else
+    return false;
+#endif
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
@@ -10,13 +10,19 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/LookupTableScaler.h>
 #include <faiss/impl/simd_result_handlers.h>
+#include <faiss/utils/AlignedTable.h>
+#include <faiss/utils/simd_levels.h>
 #include <faiss/utils/simdlib.h>
 
 namespace faiss {
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 // declared in simd_result_handlers.h
 bool simd_result_handlers_accept_virtual = true;
 
+#endif
+
 using namespace simd_result_handlers;
 
 /************************************************************
@@ -720,6 +726,57 @@ void pq4_accumulate_loop_qbs_fixed_scaler(
     }
 }
 
+} // namespace
+
+/***************************************************************
+ * Entry point compiled for each SIMD level
+ ***************************************************************/
+
+namespace pq4_fast_scan {
+
+/* computes the distances of the nq = pq4_qbs_to_nq(qbs) queries to the nb
+ * codes in dis, size (nq, nb). nb is a multiple of 32. scale_int is the
+ * NormTableScaler scale, 0 if there is no scaler. The result handlers and
+ * scalers are not passed in, because their simd types are not the same at
+ * the different levels.
+ */
+template <SIMDLevel>
+void accumulate_loop_qbs_to_mem(
+        int qbs,
+        size_t nb,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        int scale_int,
+        uint16_t* dis);
+
+template <>
+void accumulate_loop_qbs_to_mem<FAISS_THIS_SIMD_LEVEL>(
+        int qbs,
+        size_t nb,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        int scale_int,
+        uint16_t* dis) {
+    StoreResultHandler res(dis, nb);
+    if (scale_int) {
+        NormTableScaler scaler(scale_int);
+        pq4_accumulate_loop_qbs_fixed_scaler(
+                qbs, nb, nsq, codes, LUT, res, scaler);
+    } else {
+        DummyScaler dummy;
+        pq4_accumulate_loop_qbs_fixed_scaler(
+                qbs, nb, nsq, codes, LUT, res, dummy);
+    }
+}
+
+} // namespace pq4_fast_scan
+
+#ifndef FAISS_SIMD_LEVEL_TU
+
+namespace {
+
 struct Run_pq4_accumulate_loop_qbs {
     template <class ResultHandler>
     void f(ResultHandler& res,
@@ -740,6 +797,67 @@ struct Run_pq4_accumulate_loop_qbs {
     }
 };
 
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+
+void accumulate_loop_qbs_to_mem(
+        int qbs,
+        size_t nb,
+        int nsq,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        int scale_int,
+        uint16_t* dis) {
+    DISPATCH_SIMDLevel(
+            pq4_fast_scan::accumulate_loop_qbs_to_mem,
+            qbs,
+            nb,
+            nsq,
+            codes,
+            LUT,
+            scale_int,
+            dis);
+}
+
+/* The distances are computed by the kernels of the current SIMD level for
+ * tiles of codes, and the result handler reads them back from memory. */
+struct Run_pq4_accumulate_loop_qbs_tiled {
+    template <class ResultHandler>
+    void f(ResultHandler& res,
+           int qbs,
+           size_t nb,
+           int nsq,
+           const uint8_t* codes,
+           const uint8_t* LUT,
+           const NormTableScaler* scaler) {
+        // nb of codes per tile, the distances stay in L1 cache
+        const size_t bs = 256;
+        int nq = pq4_qbs_to_nq(qbs);
+        // the codes are padded to a multiple of 32
+        size_t nb2 = (nb + 31) / 32 * 32;
+        AlignedTable<uint16_t> dis(nq * bs);
+        for (size_t j0 = 0; j0 < nb2; j0 += bs) {
+            size_t j1 = std::min(j0 + bs, nb2);
+            accumulate_loop_qbs_to_mem(
+                    qbs,
+                    j1 - j0,
+                    nsq,
+                    codes + j0 * nsq / 2,
+                    LUT,
+                    scaler ? scaler->scale_int : 0,
+                    dis.get());
+            for (size_t j = j0; j < j1; j += 32) {
+                res.set_block_origin(0, j);
+                for (int q = 0; q < nq; q++) {
+                    const uint16_t* d = dis.get() + q * (j1 - j0) + j - j0;
+                    res.handle(q, 0, simd16uint16(d), simd16uint16(d + 16));
+                }
+            }
+        }
+    }
+};
+
+#endif
+
 } // namespace
 
 void pq4_accumulate_loop_qbs(
@@ -750,6 +868,14 @@ void pq4_accumulate_loop_qbs(
         const uint8_t* LUT,
         SIMDResultHandler& res,
         const NormTableScaler* scaler) {
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+    if (SIMDConfig::level != SIMDLevel::NONE) {
+        Run_pq4_accumulate_loop_qbs_tiled consumer;
+        dispatch_SIMDResultHandler(
+                res, consumer, qbs, nb, nsq, codes, LUT, scaler);
+        return;
+    }
+#endif
     Run_pq4_accumulate_loop_qbs consumer;
     dispatch_SIMDResultHandler(res, consumer, qbs, nb, nsq, codes, LUT, scaler);
 }
@@ -800,4 +926,6 @@ int pq4_preferred_qbs(int n) {
     }
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
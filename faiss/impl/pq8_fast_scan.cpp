@@ -0,0 +1,469 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <faiss/impl/pq8_fast_scan.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/simd_result_handlers.h>
+#include <faiss/utils/AlignedTable.h>
+#include <faiss/utils/hamming.h>
+#include <faiss/utils/simd_levels.h>
+
+namespace faiss {
+
+using namespace simd_result_handlers;
+
+#ifndef FAISS_SIMD_LEVEL_TU
+
+/***************************************************************
+ * Packing functions for codes
+ ***************************************************************/
+
+namespace {
+
+// size of a block of bbs vectors
+size_t get_block_size(size_t bbs, size_t nsq) {
+    return ((nsq + 1) / 2) * 2 * bbs;
+}
+
+// get the specific address of the vector inside a block. The order of the
+// vectors within a group of 16 is the same as for PQ4
+size_t get_vector_specific_address(size_t bbs, size_t vector_id, size_t sq) {
+    // get the vector_id inside the block
+    vector_id = vector_id % bbs;
+
+    // 64 bytes per pair of sub-quantizers and 32 vectors
+    size_t address = (vector_id / 32) * 64;
+    if (vector_id & 16) {
+        address += 32;
+    }
+    vector_id = vector_id & 15;
+
+    if (vector_id < 8) {
+        address += vector_id << 1;
+    } else {
+        address += ((vector_id - 8) << 1) + 1;
+    }
+    if (sq & 1) {
+        address += 16;
+    }
+    return (sq >> 1) * bbs * 2 + address;
+}
+
+} // anonymous namespace
+
+void pq8_pack_codes_range(
+        const uint8_t* codes,
+        size_t M,
+        size_t nbits,
+        size_t i0,
+        size_t i1,
+        size_t bbs,
+        size_t nsq,
+        uint8_t* blocks) {
+    FAISS_THROW_IF_NOT(bbs % 32 == 0);
+    FAISS_THROW_IF_NOT(nsq % 2 == 0);
+    FAISS_THROW_IF_NOT(nbits > 4 && nbits <= 8);
+
+    size_t code_size = (M * nbits + 7) / 8;
+    for (size_t i = i0; i < i1; i++) {
+        BitstringReader bsr(codes + (i - i0) * code_size, code_size);
+        for (size_t sq = 0; sq < M; sq++) {
+            pq8_set_packed_element(blocks, bsr.read(nbits), bbs, nsq, i, sq);
+        }
+    }
+}
+
+uint8_t pq8_get_packed_element(
+        const uint8_t* data,
+        size_t bbs,
+        size_t nsq,
+        size_t vector_id,
+        size_t sq) {
+    data += (vector_id / bbs) * get_block_size(bbs, nsq);
+    return data[get_vector_specific_address(bbs, vector_id, sq)];
+}
+
+void pq8_set_packed_element(
+        uint8_t* data,
+        uint8_t code,
+        size_t bbs,
+        size_t nsq,
+        size_t vector_id,
+        size_t sq) {
+    data += (vector_id / bbs) * get_block_size(bbs, nsq);
+    data[get_vector_specific_address(bbs, vector_id, sq)] = code;
+}
+
+/***************************************************************
+ * CodePackerPQ8 implementation
+ ***************************************************************/
+
+CodePackerPQ8::CodePackerPQ8(size_t nsq, size_t nbits, size_t bbs) {
+    FAISS_THROW_IF_NOT(nbits > 4 && nbits <= 8);
+    this->nsq = nsq;
+    this->nbits = nbits;
+    nvec = bbs;
+    code_size = (nsq * nbits + 7) / 8;
+    block_size = get_block_size(bbs, nsq);
+}
+
+void CodePackerPQ8::pack_1(
+        const uint8_t* flat_code,
+        size_t offset,
+        uint8_t* block) const {
+    size_t bbs = nvec;
+    if (offset >= nvec) {
+        block += (offset / nvec) * block_size;
+        offset = offset % nvec;
+    }
+    BitstringReader bsr(flat_code, code_size);
+    for (size_t sq = 0; sq < nsq; sq++) {
+        uint8_t code = bsr.read(nbits);
+        pq8_set_packed_element(block, code, bbs, nsq, offset, sq);
+    }
+}
+
+void CodePackerPQ8::unpack_1(
+        const uint8_t* block,
+        size_t offset,
+        uint8_t* flat_code) const {
+    size_t bbs = nvec;
+    if (offset >= nvec) {
+        block += (offset / nvec) * block_size;
+        offset = offset % nvec;
+    }
+    memset(flat_code, 0, code_size);
+    BitstringWriter bsw(flat_code, code_size);
+    for (size_t sq = 0; sq < nsq; sq++) {
+        bsw.write(pq8_get_packed_element(block, bbs, nsq, offset, sq), nbits);
+    }
+}
+
+/***************************************************************
+ * Packing functions for Look-Up Tables (LUT)
+ ***************************************************************/
+
+void pq8_pack_LUT(
+        int nq,
+        int nsq,
+        int ksub,
+        const uint8_t* src,
+        uint8_t* dest) {
+    FAISS_THROW_IF_NOT(nsq % 2 == 0);
+    FAISS_THROW_IF_NOT(ksub % 16 == 0);
+    int nlut = ksub / 16;
+    // the sub-tables are ordered by (pair of sub-quantizers, sub-table, query)
+    for (int q = 0; q < nq; q++) {
+        for (int sq = 0; sq < nsq; sq += 2) {
+            for (int h = 0; h < nlut; h++) {
+                uint8_t* d = dest + ((sq / 2 * nlut + h) * nq + q) * 32;
+                memcpy(d, src + (q * nsq + sq) * ksub + h * 16, 16);
+                memcpy(d + 16, src + (q * nsq + sq + 1) * ksub + h * 16, 16);
+            }
+        }
+    }
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
+
+/***************************************************************
+ * accumulation functions
+ ***************************************************************/
+
+namespace {
+
+/*
+ * The computation kernel
+ * It accumulates results for NQ queries and 32 database elements
+ * writes results in a ResultHandler. Consecutive pairs of sub-quantizers are
+ * stride bytes apart in codes.
+ */
+template <int NQ, class ResultHandler>
+void kernel_accumulate_block(
+        int nsq,
+        int nlut,
+        const uint8_t* codes,
+        size_t stride,
+        const uint8_t* LUT,
+        ResultHandler& res) {
+    // distance accumulators
+    simd16uint16 accu[NQ][4];
+
+    for (int q = 0; q < NQ; q++) {
+        for (int b = 0; b < 4; b++) {
+            accu[q][b].clear();
+        }
+    }
+
+    simd32uint8 mask(15);
+    simd16uint16 even_bytes(0x00ff);
+    simd16uint16 odd_bytes(0xff00);
+
+    for (int sq = 0; sq < nsq; sq += 2) {
+        // low nibbles as shuffle indices, high nibbles of the even and odd
+        // bytes in 16-bit lanes, for vectors 0..15 and 16..31
+        simd32uint8 clo[2];
+        simd16uint16 chi[2][2];
+        for (int i = 0; i < 2; i++) {
+            simd32uint8 c(codes + 32 * i);
+            clo[i] = c & mask;
+            simd16uint16 c16(c);
+            chi[i][0] = (c16 >> 4) & simd16uint16(15);
+            chi[i][1] = c16 >> 12;
+        }
+        codes += stride;
+
+        simd16uint16 lookups[NQ][2];
+        for (int q = 0; q < NQ; q++) {
+            lookups[q][0].clear();
+            lookups[q][1].clear();
+        }
+
+        for (int h = 0; h < nlut; h++) {
+            // select the bytes whose high nibble is h
+            simd16uint16 hv(h);
+            simd16uint16 sel[2];
+            for (int i = 0; i < 2; i++) {
+                sel[i] = ((chi[i][0] == hv) & even_bytes) |
+                        ((chi[i][1] == hv) & odd_bytes);
+            }
+
+            for (int q = 0; q < NQ; q++) {
+                simd32uint8 lut(LUT);
+                LUT += 32;
+                for (int i = 0; i < 2; i++) {
+                    simd16uint16 r(lut.lookup_2_lanes(clo[i]));
+                    lookups[q][i] = lookups[q][i] | (r & sel[i]);
+                }
+            }
+        }
+
+        for (int q = 0; q < NQ; q++) {
+            accu[q][0] += lookups[q][0];
+            accu[q][1] += lookups[q][0] >> 8;
+
+            accu[q][2] += lookups[q][1];
+            accu[q][3] += lookups[q][1] >> 8;
+        }
+    }
+
+    for (int q = 0; q < NQ; q++) {
+        accu[q][0] -= accu[q][1] << 8;
+        simd16uint16 dis0 = combine2x2(accu[q][0], accu[q][1]);
+
+        accu[q][2] -= accu[q][3] << 8;
+        simd16uint16 dis1 = combine2x2(accu[q][2], accu[q][3]);
+
+        res.handle(q, 0, dis0, dis1);
+    }
+}
+
+template <int NQ, class ResultHandler>
+void accumulate_blocks(
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        ResultHandler& res) {
+    int nlut = ksub / 16;
+    for (size_t j0 = 0; j0 < nb; j0 += bbs) {
+        for (int i = 0; i < bbs / 32; i++) {
+            res.set_block_origin(0, j0 + i * 32);
+            kernel_accumulate_block<NQ>(
+                    nsq, nlut, codes + i * 64, 2 * bbs, LUT, res);
+        }
+        codes += bbs * nsq;
+    }
+}
+
+template <class ResultHandler>
+void pq8_accumulate_loop_fixed_handler(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        ResultHandler& res) {
+#define DISPATCH(NQ)                                                \
+    case NQ:                                                        \
+        accumulate_blocks<NQ>(nb, bbs, nsq, ksub, codes, LUT, res); \
+        break
+
+    switch (nq) {
+        DISPATCH(1);
+        DISPATCH(2);
+        DISPATCH(3);
+        DISPATCH(4);
+        default:
+            FAISS_THROW_FMT("nq=%d not instantiated", nq);
+    }
+#undef DISPATCH
+}
+
+} // anonymous namespace
+
+/***************************************************************
+ * Entry point compiled for each SIMD level
+ ***************************************************************/
+
+namespace pq8_fast_scan {
+
+/* computes the distances of the nq queries to the nb codes in dis, size
+ * (nq, nb). nb is a multiple of bbs. */
+template <SIMDLevel>
+void accumulate_loop_to_mem(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        uint16_t* dis);
+
+template <>
+void accumulate_loop_to_mem<FAISS_THIS_SIMD_LEVEL>(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        uint16_t* dis) {
+    StoreResultHandler res(dis, nb);
+    pq8_accumulate_loop_fixed_handler(nq, nb, bbs, nsq, ksub, codes, LUT, res);
+}
+
+} // namespace pq8_fast_scan
+
+#ifndef FAISS_SIMD_LEVEL_TU
+
+namespace {
+
+struct Run_pq8_accumulate_loop {
+    template <class ResultHandler>
+    void f(ResultHandler& res,
+           int nq,
+           size_t nb,
+           int bbs,
+           int nsq,
+           int ksub,
+           const uint8_t* codes,
+           const uint8_t* LUT) {
+        pq8_accumulate_loop_fixed_handler(
+                nq, nb, bbs, nsq, ksub, codes, LUT, res);
+    }
+};
+
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+
+void accumulate_loop_to_mem(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        uint16_t* dis) {
+    DISPATCH_SIMDLevel(
+            pq8_fast_scan::accumulate_loop_to_mem,
+            nq,
+            nb,
+            bbs,
+            nsq,
+            ksub,
+            codes,
+            LUT,
+            dis);
+}
+
+/* The distances are computed by the kernels of the current SIMD level for
+ * tiles of codes, and the result handler reads them back from memory. */
+struct Run_pq8_accumulate_loop_tiled {
+    template <class ResultHandler>
+    void f(ResultHandler& res,
+           int nq,
+           size_t nb,
+           int bbs,
+           int nsq,
+           int ksub,
+           const uint8_t* codes,
+           const uint8_t* LUT) {
+        // nb of codes per tile (a multiple of bbs), the distances stay in
+        // L1 cache
+        const size_t bs = std::max(256 / bbs, 1) * bbs;
+        AlignedTable<uint16_t> dis(nq * bs);
+        for (size_t j0 = 0; j0 < nb; j0 += bs) {
+            size_t j1 = std::min(j0 + bs, nb);
+            accumulate_loop_to_mem(
+                    nq,
+                    j1 - j0,
+                    bbs,
+                    nsq,
+                    ksub,
+                    codes + j0 * nsq,
+                    LUT,
+                    dis.get());
+            for (size_t j = j0; j < j1; j += 32) {
+                res.set_block_origin(0, j);
+                for (int q = 0; q < nq; q++) {
+                    const uint16_t* d = dis.get() + q * (j1 - j0) + j - j0;
+                    res.handle(q, 0, simd16uint16(d), simd16uint16(d + 16));
+                }
+            }
+        }
+    }
+};
+
+#endif
+
+} // anonymous namespace
+
+void pq8_accumulate_loop(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        SIMDResultHandler& res,
+        const NormTableScaler* scaler) {
+    FAISS_THROW_IF_NOT_MSG(!scaler, "norm scaling not supported");
+    FAISS_THROW_IF_NOT(is_aligned_pointer(codes));
+    FAISS_THROW_IF_NOT(is_aligned_pointer(LUT));
+    FAISS_THROW_IF_NOT(bbs % 32 == 0);
+    FAISS_THROW_IF_NOT(nb % bbs == 0);
+    FAISS_THROW_IF_NOT(nsq % 2 == 0);
+    FAISS_THROW_IF_NOT(ksub % 16 == 0 && ksub <= 256);
+
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+    if (SIMDConfig::level != SIMDLevel::NONE) {
+        Run_pq8_accumulate_loop_tiled consumer;
+        dispatch_SIMDResultHandler(
+                res, consumer, nq, nb, bbs, nsq, ksub, codes, LUT);
+        return;
+    }
+#endif
+    Run_pq8_accumulate_loop consumer;
+    dispatch_SIMDResultHandler(
+            res, consumer, nq, nb, bbs, nsq, ksub, codes, LUT);
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
+
+} // namespace faiss
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <faiss/impl/CodePacker.h>
+
+/** SIMD packing and accumulation functions for PQ codes of 5 to 8 bits
+ *
+ * This is the counterpart of pq4_fast_scan.h for larger sub-quantizers. Each
+ * code is stored on one byte. Within a block of bbs vectors, the codes of a
+ * pair of sub-quantizers for 32 vectors occupy 64 bytes: the low nibbles are
+ * looked up with the same 16-entry shuffles as the PQ4 kernels, the
+ * ksub-entry LUT of each sub-quantizer being split into ksub / 16 sub-tables.
+ * The high nibble of the code selects which of the sub-tables applies.
+ * The cost therefore grows with ksub / 16: at 8 bits, 16 lookups are done
+ * per code, which is about the cost of a scalar scan with float LUTs.
+ *
+ * The output of the kernels is the same as for the PQ4 kernels, so the
+ * result handlers of simd_result_handlers.h are used unchanged.
+ */
+
+namespace faiss {
+
+struct NormTableScaler;
+struct SIMDResultHandler;
+
+/** Pack codes for consumption by the SIMD kernels, in a given range of
+ * the output, leaving the rest untouched. Assumes allocated entries are 0 on
+ * input.
+ *
+ * @param codes   input codes, size (i1 - i0, ceil(M * nbits / 8))
+ * @param nbits   number of bits per sub-quantizer (5..8)
+ * @param i0      first output code to write
+ * @param i1      last output code to write
+ * @param bbs     size of database blocks (multiple of 32)
+ * @param nsq     number of sub-quantizers (=M rounded up to a muliple of 2)
+ * @param blocks  output array, size at least ceil(i1 / bbs) * bbs * nsq
+ */
+void pq8_pack_codes_range(
+        const uint8_t* codes,
+        size_t M,
+        size_t nbits,
+        size_t i0,
+        size_t i1,
+        size_t bbs,
+        size_t nsq,
+        uint8_t* blocks);
+
+/** get a single element from a packed codes table
+ *
+ * @param vector_id        vector id
+ * @param sq       subquantizer (< nsq)
+ */
+uint8_t pq8_get_packed_element(
+        const uint8_t* data,
+        size_t bbs,
+        size_t nsq,
+        size_t vector_id,
+        size_t sq);
+
+/** set a single element "code" into a packed codes table
+ *
+ * @param vector_id       vector id
+ * @param sq       subquantizer (< nsq)
+ */
+void pq8_set_packed_element(
+        uint8_t* data,
+        uint8_t code,
+        size_t bbs,
+        size_t nsq,
+        size_t vector_id,
+        size_t sq);
+
+/** CodePacker API for the PQ fast-scan with 5 to 8 bits */
+struct CodePackerPQ8 : CodePacker {
+    size_t nsq;
+    size_t nbits;
+
+    CodePackerPQ8(size_t nsq, size_t nbits, size_t bbs);
+
+    void pack_1(const uint8_t* flat_code, size_t offset, uint8_t* block)
+            const final;
+    void unpack_1(const uint8_t* block, size_t offset, uint8_t* flat_code)
+            const final;
+};
+
+/** Pack Look-up table for consumption by the kernel.
+ *
+ * @param nq      number of queries
+ * @param nsq     number of sub-quantizers (muliple of 2)
+ * @param ksub    number of centroids per sub-quantizer (32..256)
+ * @param src     input array, size (nq, nsq, ksub)
+ * @param dest    output array, size (nq, nsq, ksub)
+ */
+void pq8_pack_LUT(
+        int nq,
+        int nsq,
+        int ksub,
+        const uint8_t* src,
+        uint8_t* dest);
+
+/** Loop over database elements and accumulate results into result handler
+ *
+ * @param nq      number of queries (1..4)
+ * @param nb      number of database elements
+ * @param bbs     size of database blocks (multiple of 32)
+ * @param nsq     number of sub-quantizers (muliple of 2)
+ * @param ksub    number of centroids per sub-quantizer (32..256)
+ * @param codes   packed codes array
+ * @param LUT     packed look-up table
+ * @param scaler  must be null, the norm scaling is not supported
+ */
+void pq8_accumulate_loop(
+        int nq,
+        size_t nb,
+        int bbs,
+        int nsq,
+        int ksub,
+        const uint8_t* codes,
+        const uint8_t* LUT,
+        SIMDResultHandler& res,
+        const NormTableScaler* scaler);
+
+} // namespace faiss
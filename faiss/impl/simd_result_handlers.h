@@ -20,12 +20,15 @@
 #include <faiss/impl/platform_macros.h>
 #include <faiss/utils/AlignedTable.h>
 #include <faiss/utils/partitioning.h>
+#include <faiss/utils/simd_levels.h>
 
 /** This file contains callbacks for kernels that compute distances.
  */
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 struct SIMDResultHandler {
     // used to dispatch templates
     bool is_CMax = false;
@@ -72,8 +75,12 @@ struct SIMDResultHandlerToFloat : SIMDResultHandler {
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 FAISS_API extern bool simd_result_handlers_accept_virtual;
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 namespace simd_result_handlers {
 
 /** Dummy structure that just computes a chqecksum on results
@@ -784,4 +791,6 @@ void dispatch_SIMDResultHandler(
 
 } // namespace simd_result_handlers
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
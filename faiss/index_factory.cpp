@@ -26,6 +26,7 @@
 #include <faiss/IndexAdditiveQuantizer.h>
 #include <faiss/IndexAdditiveQuantizerFastScan.h>
 #include <faiss/IndexFlat.h>
+#include <faiss/IndexFlat16.h>
 #include <faiss/IndexHNSW.h>
 #include <faiss/IndexIVF.h>
 #include <faiss/IndexIVFAdditiveQuantizer.h>
@@ -34,6 +35,7 @@
 #include <faiss/IndexIVFPQ.h>
 #include <faiss/IndexIVFPQFastScan.h>
 #include <faiss/IndexIVFPQR.h>
+#include <faiss/IndexIVFRaBitQ.h>
 #include <faiss/IndexIVFSpectralHash.h>
 #include <faiss/IndexLSH.h>
 #include <faiss/IndexLattice.h>
@@ -41,10 +43,12 @@
 #include <faiss/IndexPQ.h>
 #include <faiss/IndexPQFastScan.h>
 #include <faiss/IndexPreTransform.h>
+#include <faiss/IndexRaBitQ.h>
 #include <faiss/IndexRefine.h>
 #include <faiss/IndexRowwiseMinMax.h>
 #include <faiss/IndexScalarQuantizer.h>
 #include <faiss/MetaIndexes.h>
+#include <faiss/TwoLevelCoarseQuantizer.h>
 #include <faiss/VectorTransform.h>
 
 #include <faiss/IndexBinaryFlat.h>
@@ -110,7 +114,8 @@ char get_trains_alone(const Index* coarse_quantizer) {
     }
     // multi index just needs to be quantized
     if (dynamic_cast<const MultiIndexQuantizer*>(coarse_quantizer) ||
-        dynamic_cast<const ResidualCoarseQuantizer*>(coarse_quantizer)) {
+        dynamic_cast<const ResidualCoarseQuantizer*>(coarse_quantizer) ||
+        dynamic_cast<const TwoLevelCoarseQuantizer*>(coarse_quantizer)) {
         return 1;
     }
     if (dynamic_cast<const IndexHNSWFlat*>(coarse_quantizer)) {
@@ -265,6 +270,12 @@ Index* parse_coarse_quantizer(
         nlist = (size_t)1 << (2 * nbit);
         return new MultiIndexQuantizer(d, 2, nbit);
     }
+    if (match("IVF2L_([0-9]+[kM]?)x([0-9]+[kM]?)")) {
+        size_t nlist1 = parse_nlist(sm[1].str());
+        size_t nlist2 = parse_nlist(sm[2].str());
+        nlist = nlist1 * nlist2;
+        return new TwoLevelCoarseQuantizer(d, nlist1, nlist2, mt);
+    }
     if (match("IVF([0-9]+[kM]?)_HNSW([0-9]*)")) {
         nlist = parse_nlist(sm[1].str());
         int hnsw_M = sm[2].length() > 0 ? std::stoi(sm[2]) : 32;
@@ -327,6 +338,9 @@ IndexIVF* parse_IndexIVF(
         return new IndexIVFScalarQuantizer(
                 get_q(), d, nlist, sq_types[sm[1].str()], mt);
     }
+    if (match("RaBitQ")) {
+        return new IndexIVFRaBitQ(get_q(), d, nlist, mt);
+    }
     if (match("PQ([0-9]+)(x[0-9]+)?(np)?")) {
         int M = mres_to_int(sm[1]), nbit = mres_to_int(sm[2], 8, 1);
         IndexIVFPQ* index_ivf = new IndexIVFPQ(get_q(), d, nlist, M, nbit, mt);
@@ -340,12 +354,13 @@ IndexIVF* parse_IndexIVF(
         int M1 = mres_to_int(sm[1]), M2 = mres_to_int(sm[2]);
         return new IndexIVFPQR(get_q(), d, nlist, M1, 8, M2, 8);
     }
-    if (match("PQ([0-9]+)x4fs(r?)(_[0-9]+)?")) {
+    if (match("PQ([0-9]+)x([4-8])fs(r?)(_[0-9]+)?")) {
         int M = mres_to_int(sm[1]);
-        int bbs = mres_to_int(sm[3], 32, 1);
+        int nbit = mres_to_int(sm[2]);
+        int bbs = mres_to_int(sm[4], 32, 1);
         IndexIVFPQFastScan* index_ivf =
-                new IndexIVFPQFastScan(get_q(), d, nlist, M, 4, mt, bbs);
-        index_ivf->by_residual = sm[2].str() == "r";
+                new IndexIVFPQFastScan(get_q(), d, nlist, M, nbit, mt, bbs);
+        index_ivf->by_residual = sm[3].str() == "r";
         return index_ivf;
     }
     if (match("(RQ|LSQ)" + aq_def_pattern + aq_norm_pattern)) {
@@ -542,6 +557,14 @@ Index* parse_other_indexes(
         return new IndexFlat(d, metric);
     }
 
+    // IndexFlat16
+    if (description == "FlatFP16") {
+        return new IndexFlatFP16(d, metric);
+    }
+    if (description == "FlatBF16") {
+        return new IndexFlatBF16(d, metric);
+    }
+
     // IndexLSH
     if (match("LSH([0-9]*)(r?)(t?)")) {
         int nbits = sm[1].length() > 0 ? std::stoi(sm[1].str()) : d;
@@ -563,6 +586,11 @@ Index* parse_other_indexes(
         return new IndexScalarQuantizer(d, sq_types[description], metric);
     }
 
+    // IndexRaBitQ
+    if (match("RaBitQ")) {
+        return new IndexRaBitQ(d, metric);
+    }
+
     // IndexPQ
     if (match("PQ([0-9]+)(x[0-9]+)?(np)?")) {
         int M = std::stoi(sm[1].str());
@@ -573,10 +601,11 @@ Index* parse_other_indexes(
     }
 
     // IndexPQFastScan
-    if (match("PQ([0-9]+)x4fs(_[0-9]+)?")) {
+    if (match("PQ([0-9]+)x([4-8])fs(_[0-9]+)?")) {
         int M = std::stoi(sm[1].str());
-        int bbs = mres_to_int(sm[2], 32, 1);
-        return new IndexPQFastScan(d, M, 4, metric, bbs);
+        int nbit = std::stoi(sm[2].str());
+        int bbs = mres_to_int(sm[3], 32, 1);
+        return new IndexPQFastScan(d, M, nbit, metric, bbs);
     }
 
     // IndexResidualCoarseQuantizer and IndexResidualQuantizer
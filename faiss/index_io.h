@@ -62,6 +62,18 @@ const int IO_FLAG_PQ_SKIP_SDC_TABLE = 32;
 // try to memmap data (useful to load an ArrayInvertedLists as an
 // OnDiskInvertedLists)
 const int IO_FLAG_MMAP = IO_FLAG_SKIP_IVF_DATA | 0x646f0000;
+// memory-map the file and serve the codes of IndexFlatCodes descendants
+// and the HNSW graph structure directly from the mapping, without copying
+// them to RAM. The mapping is shared between processes that read the same
+// file. The mapped fields are read-only. Only supported when reading from
+// a file name or a FILE*.
+const int IO_FLAG_MMAP_IFC = 1 << 9;
+
+/** write_index to a file name: write the chunked container (see
+ * impl/chunked_io.h), with per-chunk checksums and parallel I/O. The read
+ * functions detect chunked files automatically, they cannot be
+ * memory-mapped. */
+const int IO_FLAG_CHUNKED = 1 << 10;
 
 Index* read_index(const char* fname, int io_flags = 0);
 Index* read_index(FILE* f, int io_flags = 0);
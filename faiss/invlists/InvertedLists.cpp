@@ -7,8 +7,12 @@
 
 #include <faiss/invlists/InvertedLists.h>
 
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/utils.h>
@@ -791,4 +795,226 @@ void StopWordsInvertedLists::prefetch_lists(const idx_t* list_nos, int nlist)
     il0->prefetch_lists(list0.data(), list0.size());
 }
 
+/*****************************************
+ * CachedInvertedLists implementation
+ ******************************************/
+
+struct CachedInvertedLists::Cache {
+    struct Entry {
+        std::vector<uint8_t> codes;
+        std::vector<idx_t> ids;
+        size_t nbytes = 0;
+        int nuse = 0;           // nb of pointers not released yet
+        bool referenced = true; // CLOCK reference bit
+        bool loading = true;
+        bool failed = false;
+    };
+
+    std::mutex mutex;
+    std::condition_variable loaded_cv;
+    std::unordered_map<idx_t, std::shared_ptr<Entry>> entries;
+    std::vector<idx_t> clock; // ring of the cached lists
+    size_t hand = 0;
+    size_t used_bytes = 0;
+
+    void remove(size_t i) {
+        used_bytes -= entries[clock[i]]->nbytes;
+        entries.erase(clock[i]);
+        clock.erase(clock.begin() + i);
+    }
+
+    /// evict lists until nbytes more fit, returns the nb of evicted lists
+    size_t make_room(size_t nbytes, size_t max_bytes) {
+        size_t nevict = 0;
+        // 2 turns of the clock: clear the reference bits, then evict
+        size_t max_steps = 2 * clock.size();
+        for (size_t step = 0;
+             used_bytes + nbytes > max_bytes && !clock.empty() &&
+             step < max_steps;
+             step++) {
+            if (hand >= clock.size()) {
+                hand = 0;
+            }
+            Entry& e = *entries[clock[hand]];
+            if (e.nuse > 0 || e.loading) {
+                hand++;
+            } else if (e.referenced) {
+                e.referenced = false;
+                hand++;
+            } else {
+                remove(hand);
+                nevict++;
+            }
+        }
+        return nevict;
+    }
+};
+
+CachedInvertedLists::CachedInvertedLists(
+        const InvertedLists* il,
+        size_t max_bytes)
+        : ReadOnlyInvertedLists(il->nlist, il->code_size),
+          il(il),
+          max_bytes(max_bytes),
+          cache(new Cache()) {
+    FAISS_THROW_IF_NOT_MSG(
+            !il->use_iterator,
+            "CachedInvertedLists needs random access lists");
+}
+
+CachedInvertedLists::~CachedInvertedLists() {
+    delete cache;
+}
+
+size_t CachedInvertedLists::list_size(size_t list_no) const {
+    return il->list_size(list_no);
+}
+
+const void* CachedInvertedLists::acquire(size_t list_no, bool ids) const {
+    std::unique_lock<std::mutex> lock(cache->mutex);
+    auto it = cache->entries.find(list_no);
+    if (it != cache->entries.end()) {
+        std::shared_ptr<Cache::Entry> e = it->second;
+        e->nuse++;
+        e->referenced = true;
+        nhit++;
+        cache->loaded_cv.wait(lock, [&e] { return !e->loading; });
+        FAISS_THROW_IF_NOT_MSG(!e->failed, "list could not be cached");
+        return ids ? (const void*)e->ids.data() : e->codes.data();
+    }
+
+    nmiss++;
+    size_t size = il->list_size(list_no);
+    size_t nbytes = size * (code_size + sizeof(idx_t));
+    if (size == 0 || nbytes > max_bytes) {
+        return nullptr;
+    }
+    nevict += cache->make_room(nbytes, max_bytes);
+    if (cache->used_bytes + nbytes > max_bytes) {
+        return nullptr; // all the lists are in use
+    }
+    auto e = std::make_shared<Cache::Entry>();
+    e->nbytes = nbytes;
+    e->nuse = 1;
+    cache->entries[list_no] = e;
+    cache->clock.push_back(list_no);
+    cache->used_bytes += nbytes;
+    lock.unlock();
+
+    // copy the list without holding the lock, the other threads that
+    // need it wait for loaded_cv
+    try {
+        e->codes.resize(size * code_size);
+        e->ids.resize(size);
+        memcpy(e->codes.data(),
+               ScopedCodes(il, list_no).get(),
+               size * code_size);
+        memcpy(e->ids.data(),
+               ScopedIds(il, list_no).get(),
+               size * sizeof(idx_t));
+    } catch (...) {
+        lock.lock();
+        for (size_t i = 0; i < cache->clock.size(); i++) {
+            if (cache->clock[i] == list_no) {
+                cache->remove(i);
+                break;
+            }
+        }
+        e->failed = true;
+        e->loading = false;
+        cache->loaded_cv.notify_all();
+        throw;
+    }
+
+    lock.lock();
+    e->loading = false;
+    cache->loaded_cv.notify_all();
+    return ids ? (const void*)e->ids.data() : e->codes.data();
+}
+
+bool CachedInvertedLists::release(size_t list_no, const void* p) const {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    auto it = cache->entries.find(list_no);
+    if (it == cache->entries.end()) {
+        return false;
+    }
+    Cache::Entry& e = *it->second;
+    if (p != e.codes.data() && p != e.ids.data()) {
+        return false;
+    }
+    e.nuse--;
+    return true;
+}
+
+const uint8_t* CachedInvertedLists::get_codes(size_t list_no) const {
+    const void* codes = acquire(list_no, false);
+    return codes ? (const uint8_t*)codes : il->get_codes(list_no);
+}
+
+const idx_t* CachedInvertedLists::get_ids(size_t list_no) const {
+    const void* ids = acquire(list_no, true);
+    return ids ? (const idx_t*)ids : il->get_ids(list_no);
+}
+
+void CachedInvertedLists::release_codes(size_t list_no, const uint8_t* codes)
+        const {
+    if (!release(list_no, codes)) {
+        il->release_codes(list_no, codes);
+    }
+}
+
+void CachedInvertedLists::release_ids(size_t list_no, const idx_t* ids) const {
+    if (!release(list_no, ids)) {
+        il->release_ids(list_no, ids);
+    }
+}
+
+idx_t CachedInvertedLists::get_single_id(size_t list_no, size_t offset) const {
+    return il->get_single_id(list_no, offset);
+}
+
+const uint8_t* CachedInvertedLists::get_single_code(
+        size_t list_no,
+        size_t offset) const {
+    return il->get_single_code(list_no, offset);
+}
+
+void CachedInvertedLists::prefetch_lists(const idx_t* list_nos, int nlist)
+        const {
+    std::vector<idx_t> to_fetch;
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        for (int i = 0; i < nlist; i++) {
+            idx_t list_no = list_nos[i];
+            if (list_no >= 0 && cache->entries.count(list_no) == 0) {
+                to_fetch.push_back(list_no);
+            }
+        }
+    }
+    il->prefetch_lists(to_fetch.data(), to_fetch.size());
+}
+
+size_t CachedInvertedLists::cached_bytes() const {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    return cache->used_bytes;
+}
+
+void CachedInvertedLists::clear_cache() {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    for (size_t i = 0; i < cache->clock.size();) {
+        const Cache::Entry& e = *cache->entries[cache->clock[i]];
+        if (e.nuse == 0 && !e.loading) {
+            cache->remove(i);
+        } else {
+            i++;
+        }
+    }
+    cache->hand = 0;
+}
+
+void CachedInvertedLists::reset_stats() {
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    nhit = nmiss = nevict = 0;
+}
+
 } // namespace faiss
@@ -419,6 +419,66 @@ struct StopWordsInvertedLists : ReadOnlyInvertedLists {
     void prefetch_lists(const idx_t* list_nos, int nlist) const override;
 };
 
+/** Cache of the most used inverted lists of another InvertedLists
+ * (eg. an OnDiskInvertedLists or any InvertedLists that is slow to
+ * access), within a budget of max_bytes bytes.
+ *
+ * get_codes / get_ids copy the list into the cache on a miss, and the
+ * copy stays pinned until the matching release_codes / release_ids.
+ * When there is not enough space, unpinned lists are evicted with the
+ * CLOCK algorithm (an approximation of LRU that only needs one reference
+ * bit per list). Lists larger than the budget are accessed directly in
+ * il. All the accesses are thread-safe.
+ */
+struct CachedInvertedLists : ReadOnlyInvertedLists {
+    const InvertedLists* il;
+    size_t max_bytes;
+
+    /// nb of get_codes / get_ids served from the cache / from il
+    mutable size_t nhit = 0;
+    mutable size_t nmiss = 0;
+    /// nb of lists evicted from the cache
+    mutable size_t nevict = 0;
+
+    CachedInvertedLists(const InvertedLists* il, size_t max_bytes);
+
+    size_t list_size(size_t list_no) const override;
+    const uint8_t* get_codes(size_t list_no) const override;
+    const idx_t* get_ids(size_t list_no) const override;
+
+    void release_codes(size_t list_no, const uint8_t* codes) const override;
+    void release_ids(size_t list_no, const idx_t* ids) const override;
+
+    idx_t get_single_id(size_t list_no, size_t offset) const override;
+
+    const uint8_t* get_single_code(size_t list_no, size_t offset)
+            const override;
+
+    /// forwards the lists that are not in the cache to il
+    void prefetch_lists(const idx_t* list_nos, int nlist) const override;
+
+    /// nb of bytes used by the cached lists
+    size_t cached_bytes() const;
+
+    /// remove all the lists that are not in use from the cache
+    void clear_cache();
+
+    void reset_stats();
+
+    ~CachedInvertedLists() override;
+
+    // private
+
+    struct Cache;
+    Cache* cache;
+
+    /// pins the list in the cache, nullptr if it does not fit
+    const void* acquire(size_t list_no, bool ids) const;
+
+    /// unpins, returns false if p does not belong to the cache
+    bool release(size_t list_no, const void* p) const;
+};
+
 } // namespace faiss
 
 #endif
@@ -11,6 +11,10 @@
 
 #include <pthread.h>
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <sys/mman.h>
@@ -19,6 +23,7 @@
 #include <unistd.h>
 
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/async_io.h>
 #include <faiss/utils/utils.h>
 
 #include <faiss/impl/io.h>
@@ -154,8 +159,8 @@ struct OnDiskInvertedLists::OngoingPrefetch {
             const OnDiskInvertedLists* od = pf->od;
             od->locks->lock_1(list_no);
             size_t n = od->list_size(list_no);
-            const idx_t* idx = od->get_ids(list_no);
-            const uint8_t* codes = od->get_codes(list_no);
+            const idx_t* idx = od->mmap_ids(list_no);
+            const uint8_t* codes = od->mmap_codes(list_no);
             int cs = 0;
             for (size_t i = 0; i < n; i++) {
                 cs += idx[i];
@@ -256,8 +261,211 @@ struct OnDiskInvertedLists::OngoingPrefetch {
 
 int OnDiskInvertedLists::OngoingPrefetch::global_cs = 0;
 
+/**********************************************
+ * FetchedLists
+ **********************************************/
+
+struct OnDiskInvertedLists::FetchedLists {
+    struct Entry {
+        // the list as stored in the file: codes then ids
+        std::unique_ptr<uint8_t[]> data;
+        size_t nbytes = 0;
+        const idx_t* ids = nullptr;
+        bool ready = false;
+        int error = 0;
+        int nuse = 0; // nb of get_codes / get_ids not released yet
+        // nb of scans requested by the last fetch that did not start yet
+        int npending = 0;
+    };
+
+    const OnDiskInvertedLists* od;
+
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    std::unordered_map<idx_t, std::unique_ptr<Entry>> entries;
+    // fetch order, for the eviction
+    std::list<idx_t> lru;
+    // dropped while in use, freed when released
+    std::vector<std::unique_ptr<Entry>> detached;
+    size_t used_bytes = 0;
+
+    // rebuilt when async_nthread changes. The fetches in progress keep
+    // the previous reader alive until their reads are submitted
+    std::shared_ptr<AsyncFileReader> reader;
+    int reader_nthread = 0;
+
+    explicit FetchedLists(const OnDiskInvertedLists* od) : od(od) {}
+
+    // evict lists that are not in use and have no pending scan until
+    // nbytes fit, called with the mutex held
+    bool make_room(size_t nbytes) {
+        if (nbytes > od->async_buffer_size) {
+            return false;
+        }
+        auto it = lru.begin();
+        while (used_bytes + nbytes > od->async_buffer_size &&
+               it != lru.end()) {
+            const Entry& e = *entries[*it];
+            if (e.ready && e.nuse == 0 && e.npending == 0) {
+                used_bytes -= e.nbytes;
+                entries.erase(*it);
+                it = lru.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return used_bytes + nbytes <= od->async_buffer_size;
+    }
+
+    void fetch(const idx_t* list_nos, int n) {
+        std::vector<std::pair<AsyncFileReader::Request, Entry*>> todo;
+        // released outside of the mutex: the destructor of a previous
+        // reader waits for its reads, whose callbacks take the mutex
+        std::shared_ptr<AsyncFileReader> cur_reader, prev_reader;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!reader || reader_nthread != od->async_nthread) {
+                prev_reader = std::move(reader);
+                reader = std::make_shared<AsyncFileReader>(
+                        od->filename, od->async_nthread);
+                reader_nthread = od->async_nthread;
+            }
+            cur_reader = reader;
+            // the scans of the previous fetch are done or abandoned
+            for (auto& kv : entries) {
+                kv.second->npending = 0;
+            }
+            // the lists stay pinned until they are scanned, so the lists
+            // that do not fit are not read and are accessed from the mmap.
+            // This bounds the reads in flight to the buffer pool size, in
+            // the order of list_nos.
+            for (int i = 0; i < n; i++) {
+                idx_t list_no = list_nos[i];
+                if (list_no < 0 || od->list_size(list_no) == 0) {
+                    continue;
+                }
+                auto it = entries.find(list_no);
+                if (it != entries.end()) {
+                    it->second->npending++;
+                    continue;
+                }
+                const List& l = od->lists[list_no];
+                size_t nbytes = l.capacity * (od->code_size + sizeof(idx_t));
+                if (!make_room(nbytes)) {
+                    continue; // will be read from the mmap
+                }
+                Entry* e = new Entry();
+                e->npending = 1;
+                entries[list_no].reset(e);
+                lru.push_back(list_no);
+                used_bytes += nbytes;
+                e->data.reset(new uint8_t[nbytes]);
+                e->nbytes = nbytes;
+                e->ids = (const idx_t*)(e->data.get() +
+                                        l.capacity * od->code_size);
+                todo.push_back({{l.offset, nbytes, e->data.get()}, e});
+            }
+        }
+        // submit in the order of the list_nos, so that the first lists
+        // to be scanned are the first ones read
+        for (auto& req_e : todo) {
+            Entry* e = req_e.second;
+            cur_reader->submit(req_e.first, [this, e](int err) {
+                std::lock_guard<std::mutex> lock(mutex);
+                e->error = err;
+                e->ready = true;
+                ready_cv.notify_all();
+            });
+        }
+    }
+
+    // returns nullptr if the list is not in the buffer pool. A scan
+    // starts with the access to the codes
+    const Entry* get(idx_t list_no, bool is_scan) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = entries.find(list_no);
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        Entry* e = it->second.get();
+        e->nuse++;
+        if (is_scan && e->npending > 0) {
+            e->npending--;
+        }
+        ready_cv.wait(lock, [e] { return e->ready; });
+        if (e->error != 0) {
+            e->nuse--;
+            FAISS_THROW_FMT(
+                    "read error in %s: %s",
+                    od->filename.c_str(),
+                    strerror(e->error));
+        }
+        return e;
+    }
+
+    void release(idx_t list_no, const void* p) {
+        auto contains = [p](const Entry& e) {
+            return p >= e.data.get() && p < e.data.get() + e.nbytes;
+        };
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(list_no);
+        if (it != entries.end() && contains(*it->second)) {
+            it->second->nuse--;
+            return;
+        }
+        for (size_t i = 0; i < detached.size(); i++) {
+            if (contains(*detached[i])) {
+                if (--detached[i]->nuse == 0) {
+                    detached.erase(detached.begin() + i);
+                }
+                return;
+            }
+        }
+    }
+
+    // the list is about to be modified
+    void drop(idx_t list_no) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = entries.find(list_no);
+        if (it == entries.end()) {
+            return;
+        }
+        Entry* e = it->second.get();
+        ready_cv.wait(lock, [e] { return e->ready; });
+        used_bytes -= e->nbytes;
+        if (e->nuse > 0) {
+            detached.push_back(std::move(it->second));
+        }
+        entries.erase(it);
+        lru.remove(list_no);
+    }
+
+    ~FetchedLists() {
+        // waits for the ongoing reads
+        reader.reset();
+    }
+};
+
 void OnDiskInvertedLists::prefetch_lists(const idx_t* list_nos, int n) const {
-    pf->prefetch_lists(list_nos, n);
+    if (async_buffer_size > 0) {
+        fetched->fetch(list_nos, n);
+    } else {
+        pf->prefetch_lists(list_nos, n);
+    }
+}
+
+void OnDiskInvertedLists::release_codes(size_t list_no, const uint8_t* codes)
+        const {
+    if (codes && (codes < ptr || codes >= ptr + totsize)) {
+        fetched->release(list_no, codes);
+    }
+}
+
+void OnDiskInvertedLists::release_ids(size_t list_no, const idx_t* ids) const {
+    const uint8_t* p = (const uint8_t*)ids;
+    if (p && (p < ptr || p >= ptr + totsize)) {
+        fetched->release(list_no, p);
+    }
 }
 
 /**********************************************
@@ -354,9 +562,12 @@ OnDiskInvertedLists::OnDiskInvertedLists(
           totsize(0),
           ptr(nullptr),
           read_only(false),
+          async_buffer_size(0),
+          async_nthread(16),
           locks(new LockLevels()),
           pf(new OngoingPrefetch(this)),
-          prefetch_nthread(32) {
+          prefetch_nthread(32),
+          fetched(new FetchedLists(this)) {
     lists.resize(nlist);
 
     // slots starts empty
@@ -366,6 +577,7 @@ OnDiskInvertedLists::OnDiskInvertedLists() : OnDiskInvertedLists(0, 0, "") {}
 
 OnDiskInvertedLists::~OnDiskInvertedLists() {
     delete pf;
+    delete fetched;
 
     // unmap all lists
     if (ptr != nullptr) {
@@ -381,7 +593,7 @@ size_t OnDiskInvertedLists::list_size(size_t list_no) const {
     return lists[list_no].size;
 }
 
-const uint8_t* OnDiskInvertedLists::get_codes(size_t list_no) const {
+const uint8_t* OnDiskInvertedLists::mmap_codes(size_t list_no) const {
     if (lists[list_no].offset == INVALID_OFFSET) {
         return nullptr;
     }
@@ -389,7 +601,7 @@ const uint8_t* OnDiskInvertedLists::get_codes(size_t list_no) const {
     return ptr + lists[list_no].offset;
 }
 
-const idx_t* OnDiskInvertedLists::get_ids(size_t list_no) const {
+const idx_t* OnDiskInvertedLists::mmap_ids(size_t list_no) const {
     if (lists[list_no].offset == INVALID_OFFSET) {
         return nullptr;
     }
@@ -398,6 +610,26 @@ const idx_t* OnDiskInvertedLists::get_ids(size_t list_no) const {
                           code_size * lists[list_no].capacity);
 }
 
+const uint8_t* OnDiskInvertedLists::get_codes(size_t list_no) const {
+    if (async_buffer_size > 0) {
+        const FetchedLists::Entry* e = fetched->get(list_no, true);
+        if (e) {
+            return e->data.get();
+        }
+    }
+    return mmap_codes(list_no);
+}
+
+const idx_t* OnDiskInvertedLists::get_ids(size_t list_no) const {
+    if (async_buffer_size > 0) {
+        const FetchedLists::Entry* e = fetched->get(list_no, false);
+        if (e) {
+            return e->ids;
+        }
+    }
+    return mmap_ids(list_no);
+}
+
 void OnDiskInvertedLists::update_entries(
         size_t list_no,
         size_t offset,
@@ -409,9 +641,10 @@ void OnDiskInvertedLists::update_entries(
         return;
     [[maybe_unused]] const List& l = lists[list_no];
     assert(n_entry + offset <= l.size);
-    idx_t* ids = const_cast<idx_t*>(get_ids(list_no));
+    fetched->drop(list_no);
+    idx_t* ids = const_cast<idx_t*>(mmap_ids(list_no));
     memcpy(ids + offset, ids_in, sizeof(ids_in[0]) * n_entry);
-    uint8_t* codes = const_cast<uint8_t*>(get_codes(list_no));
+    uint8_t* codes = const_cast<uint8_t*>(mmap_codes(list_no));
     memcpy(codes + offset * code_size, codes_in, code_size * n_entry);
 }
 
@@ -438,6 +671,7 @@ void OnDiskInvertedLists::resize(size_t list_no, size_t new_size) {
 
 void OnDiskInvertedLists::resize_locked(size_t list_no, size_t new_size) {
     List& l = lists[list_no];
+    fetched->drop(list_no);
 
     if (new_size <= l.capacity && new_size > l.capacity / 2) {
         l.size = new_size;
@@ -467,9 +701,9 @@ void OnDiskInvertedLists::resize_locked(size_t list_no, size_t new_size) {
     if (l.offset != new_l.offset) {
         size_t n = std::min(new_size, l.size);
         if (n > 0) {
-            memcpy(ptr + new_l.offset, get_codes(list_no), n * code_size);
+            memcpy(ptr + new_l.offset, mmap_codes(list_no), n * code_size);
             memcpy(ptr + new_l.offset + new_l.capacity * code_size,
-                   get_ids(list_no),
+                   mmap_ids(list_no),
                    n * sizeof(idx_t));
         }
     }
@@ -56,6 +56,17 @@ struct OnDiskOneList {
  * When it is known that a set of lists will be accessed, it is useful
  * to call prefetch_lists, that launches a set of threads to read the
  * lists in parallel.
+ *
+ * With async_buffer_size > 0, prefetch_lists instead reads the lists
+ * explicitly (with a pool of threads that issue pread calls) into a
+ * buffer pool of at most async_buffer_size bytes, and returns
+ * immediately. get_codes / get_ids serve the lists from the buffer pool,
+ * waiting for their read to complete if necessary, so that the scan of
+ * the first lists overlaps with the reads of the next ones. A fetched
+ * list is not evicted before it is scanned (its codes accessed) as many
+ * times as it appears in the prefetch_lists call, or until the next
+ * prefetch_lists call. The lists that do not fit in the buffer pool are
+ * not read and are accessed through the mmap.
  */
 struct OnDiskInvertedLists : InvertedLists {
     using List = OnDiskOneList;
@@ -115,6 +126,16 @@ struct OnDiskInvertedLists : InvertedLists {
 
     void prefetch_lists(const idx_t* list_nos, int nlist) const override;
 
+    void release_codes(size_t list_no, const uint8_t* codes) const override;
+    void release_ids(size_t list_no, const idx_t* ids) const override;
+
+    /// size of the buffer pool for explicit reads, 0 = use the mmap only
+    size_t async_buffer_size;
+
+    /// nb of threads that issue the explicit reads, a change takes effect
+    /// at the next prefetch
+    int async_nthread;
+
     ~OnDiskInvertedLists() override;
 
     // private
@@ -126,6 +147,14 @@ struct OnDiskInvertedLists : InvertedLists {
     OngoingPrefetch* pf;
     int prefetch_nthread;
 
+    // buffer pool of the lists read with explicit reads
+    struct FetchedLists;
+    FetchedLists* fetched;
+
+    /// pointers to the list data in the mmapped region
+    const uint8_t* mmap_codes(size_t list_no) const;
+    const idx_t* mmap_ids(size_t list_no) const;
+
     void do_mmap();
     void update_totsize(size_t new_totsize);
     void resize_locked(size_t list_no, size_t new_size);
@@ -106,6 +106,8 @@ def vector_to_array(v):
     classname = v.__class__.__name__
     if classname.startswith('AlignedTable'):
         return AlignedTable_to_array(v)
+    if classname.startswith('MaybeOwnedVector'):
+        classname = classname[16:]
     assert classname.endswith('Vector')
     dtype = np.dtype(vector_name_map[classname[:-6]])
     a = np.empty(v.size(), dtype=dtype)
@@ -122,6 +124,8 @@ def copy_array_to_vector(a, v):
     """ copy a numpy array to a vector """
     n, = a.shape
     classname = v.__class__.__name__
+    if classname.startswith('MaybeOwnedVector'):
+        classname = classname[16:]
     assert classname.endswith('Vector')
     dtype = np.dtype(vector_name_map[classname[:-6]])
     assert dtype == a.dtype, (
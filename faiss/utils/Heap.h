@@ -33,9 +33,14 @@
 #include <utility>
 
 #include <faiss/utils/ordered_key_value.h>
+#include <faiss/utils/simd_levels.h>
 
 namespace faiss {
 
+// The inline heap functions are also instantiated by the objects compiled
+// for each SIMD level, see FAISS_SIMD_NAMESPACE_BEGIN.
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /*******************************************************************
  * Basic heap ops: push and pop
  *******************************************************************/
@@ -459,6 +464,8 @@ inline size_t maxheap_reorder(size_t k, T* bh_val, int64_t* bh_ids) {
     return heap_reorder<CMax<T, int64_t>>(k, bh_val, bh_ids);
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 /*******************************************************************
  * Operations on heap arrays
  *******************************************************************/
@@ -562,6 +569,8 @@ typedef HeapArray<CMax<int, int64_t>> int_maxheap_array_t;
  *
  *********************************************************************/
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 template <class C>
 inline void indirect_heap_pop(
         size_t k,
@@ -610,6 +619,8 @@ inline void indirect_heap_push(
     bh_ids[i] = id;
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 /** Merge result tables from several shards. The per-shard results are assumed
  * to be sorted. Note that the C comparator is reversed w.r.t. the usual top-k
  * element heap because we want the best (ie. lowest for L2) result to be on
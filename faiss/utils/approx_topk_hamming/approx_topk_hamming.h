@@ -16,6 +16,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 // HeapWithBucketsForHamming32 uses simd8uint32 under the hood.
 
 template <typename C, uint32_t NBUCKETS, uint32_t N, typename HammingComputerT>
@@ -364,4 +366,6 @@ struct HeapWithBucketsForHamming16<
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
@@ -787,6 +787,53 @@ void exhaustive_L2sqr_blas<Top1BlockResultHandler<CMax<float, int64_t>>>(
 #endif
 }
 
+// the fused kernels are implemented only for heaps without selector
+template <class BlockResultHandler>
+bool exhaustive_inner_product_fused(
+        const float*,
+        const float*,
+        size_t,
+        size_t,
+        size_t,
+        BlockResultHandler&) {
+    return false;
+}
+
+bool exhaustive_inner_product_fused(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+    return distance_compute_use_fused &&
+            exhaustive_inner_product_fused_heap(x, y, d, nx, ny, res);
+}
+
+template <class BlockResultHandler>
+bool exhaustive_L2sqr_fused(
+        const float*,
+        const float*,
+        size_t,
+        size_t,
+        size_t,
+        BlockResultHandler&,
+        const float*) {
+    return false;
+}
+
+bool exhaustive_L2sqr_fused(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    return distance_compute_use_fused &&
+            exhaustive_L2sqr_fused_heap(x, y, d, nx, ny, res, y_norms);
+}
+
 struct Run_search_inner_product {
     using T = void;
     template <class BlockResultHandler>
@@ -798,7 +845,7 @@ struct Run_search_inner_product {
            size_t ny) {
         if (res.sel || nx < distance_compute_blas_threshold) {
             exhaustive_inner_product_seq(x, y, d, nx, ny, res);
-        } else {
+        } else if (!exhaustive_inner_product_fused(x, y, d, nx, ny, res)) {
             exhaustive_inner_product_blas(x, y, d, nx, ny, res);
         }
     }
@@ -816,7 +863,7 @@ struct Run_search_L2sqr {
            const float* y_norm2) {
         if (res.sel || nx < distance_compute_blas_threshold) {
             exhaustive_L2sqr_seq(x, y, d, nx, ny, res);
-        } else {
+        } else if (!exhaustive_L2sqr_fused(x, y, d, nx, ny, res, y_norm2)) {
             exhaustive_L2sqr_blas(x, y, d, nx, ny, res, y_norm2);
         }
     }
@@ -832,6 +879,7 @@ int distance_compute_blas_threshold = 20;
 int distance_compute_blas_query_bs = 4096;
 int distance_compute_blas_database_bs = 1024;
 int distance_compute_min_k_reservoir = 100;
+bool distance_compute_use_fused = true;
 
 void knn_inner_product(
         const float* x,
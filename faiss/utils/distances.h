@@ -285,6 +285,10 @@ FAISS_API extern int distance_compute_blas_database_bs;
 // rather than a heap
 FAISS_API extern int distance_compute_min_k_reservoir;
 
+// above the BLAS threshold, use the fused distance + heap kernels
+// (distances_fused.h) rather than BLAS when they are available
+FAISS_API extern bool distance_compute_use_fused;
+
 /** Return the k nearest neighbors of each of the nx vectors x among the ny
  *  vector y, w.r.t to max inner product.
  *
@@ -0,0 +1,766 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/utils/distances_16bit.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <omp.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/impl/ResultHandler.h>
+#include <faiss/utils/bf16.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/distances_fused/distances_fused.h>
+#include <faiss/utils/fp16.h>
+
+#ifndef FINTEGER
+#define FINTEGER long
+#endif
+
+extern "C" {
+
+/* declare BLAS functions, see http://www.netlib.org/clapack/cblas/ */
+
+int sgemm_(
+        const char* transa,
+        const char* transb,
+        FINTEGER* m,
+        FINTEGER* n,
+        FINTEGER* k,
+        const float* alpha,
+        const float* a,
+        FINTEGER* lda,
+        const float* b,
+        FINTEGER* ldb,
+        float* beta,
+        float* c,
+        FINTEGER* ldc);
+}
+
+namespace faiss {
+
+namespace {
+
+/* The 16-bit formats, with the SIMD conversions of 16 (AVX512) or 8 (AVX2)
+ * components to float */
+
+struct FP16 {
+    static float decode(uint16_t v) {
+        return decode_fp16(v);
+    }
+#ifdef __AVX512F__
+    static __m512 load16(const uint16_t* p) {
+        return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)p));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    static __m256 load8(const uint16_t* p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+    }
+#endif
+};
+
+struct BF16 {
+    static float decode(uint16_t v) {
+        return decode_bf16(v);
+    }
+#ifdef __AVX512F__
+    static __m512 load16(const uint16_t* p) {
+        __m512i v = _mm512_cvtepu16_epi32(
+                _mm256_loadu_si256((const __m256i*)p));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(v, 16));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    static __m256 load8(const uint16_t* p) {
+        __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(v, 16));
+    }
+#endif
+};
+
+#if !defined(__AVX512F__) && defined(__AVX2__) && defined(__F16C__)
+inline float horizontal_sum(const __m256 v) {
+    const __m128 v0 =
+            _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    const __m128 v1 = _mm_add_ps(v0, _mm_movehl_ps(v0, v0));
+    const __m128 v2 = _mm_add_ss(v1, _mm_movehdup_ps(v1));
+    return _mm_cvtss_f32(v2);
+}
+#endif
+
+template <class T16>
+float inner_product_16bit(const float* x, const uint16_t* y, size_t d) {
+    size_t i = 0;
+    float res = 0;
+#ifdef __AVX512F__
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    for (; i + 32 <= d; i += 32) {
+        acc0 = _mm512_fmadd_ps(
+                _mm512_loadu_ps(x + i), T16::load16(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(
+                _mm512_loadu_ps(x + i + 16), T16::load16(y + i + 16), acc1);
+    }
+    if (i + 16 <= d) {
+        acc0 = _mm512_fmadd_ps(
+                _mm512_loadu_ps(x + i), T16::load16(y + i), acc0);
+        i += 16;
+    }
+    res = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+#elif defined(__AVX2__) && defined(__F16C__)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), T16::load8(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(
+                _mm256_loadu_ps(x + i + 8), T16::load8(y + i + 8), acc1);
+    }
+    if (i + 8 <= d) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), T16::load8(y + i), acc0);
+        i += 8;
+    }
+    res = horizontal_sum(_mm256_add_ps(acc0, acc1));
+#endif
+    for (; i < d; i++) {
+        res += x[i] * T16::decode(y[i]);
+    }
+    return res;
+}
+
+template <class T16>
+float L2sqr_16bit(const float* x, const uint16_t* y, size_t d) {
+    size_t i = 0;
+    float res = 0;
+#ifdef __AVX512F__
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    for (; i + 32 <= d; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(x + i), T16::load16(y + i));
+        __m512 d1 = _mm512_sub_ps(
+                _mm512_loadu_ps(x + i + 16), T16::load16(y + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    if (i + 16 <= d) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(x + i), T16::load16(y + i));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        i += 16;
+    }
+    res = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+#elif defined(__AVX2__) && defined(__F16C__)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(x + i), T16::load8(y + i));
+        __m256 d1 = _mm256_sub_ps(
+                _mm256_loadu_ps(x + i + 8), T16::load8(y + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    if (i + 8 <= d) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(x + i), T16::load8(y + i));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        i += 8;
+    }
+    res = horizontal_sum(_mm256_add_ps(acc0, acc1));
+#endif
+    for (; i < d; i++) {
+        float tmp = x[i] - T16::decode(y[i]);
+        res += tmp * tmp;
+    }
+    return res;
+}
+
+template <class T16>
+float norm_L2sqr_16bit(const uint16_t* y, size_t d) {
+    size_t i = 0;
+    float res = 0;
+#ifdef __AVX512F__
+    __m512 acc = _mm512_setzero_ps();
+    for (; i + 16 <= d; i += 16) {
+        __m512 yi = T16::load16(y + i);
+        acc = _mm512_fmadd_ps(yi, yi, acc);
+    }
+    res = _mm512_reduce_add_ps(acc);
+#elif defined(__AVX2__) && defined(__F16C__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= d; i += 8) {
+        __m256 yi = T16::load8(y + i);
+        acc = _mm256_fmadd_ps(yi, yi, acc);
+    }
+    res = horizontal_sum(acc);
+#endif
+    for (; i < d; i++) {
+        float yi = T16::decode(y[i]);
+        res += yi * yi;
+    }
+    return res;
+}
+
+#ifdef __AVX512BF16__
+
+/* <q, y> with q = qh + ql given in bf16 and padded to a multiple of 32
+ * components. The products of bf16 values are exact, vdpbf16ps
+ * accumulates them in float. If compute_norm, also returns ||y||^2. */
+template <bool compute_norm>
+float bf16_split_inner_product(
+        const uint16_t* qh,
+        const uint16_t* ql,
+        const uint16_t* y,
+        size_t d,
+        float* norm2) {
+    __m512 acc_h = _mm512_setzero_ps();
+    __m512 acc_l = _mm512_setzero_ps();
+    __m512 acc_n = _mm512_setzero_ps();
+    for (size_t i = 0; i < d; i += 32) {
+        __mmask32 mask = d - i >= 32 ? ~__mmask32(0)
+                                     : (__mmask32(1) << (d - i)) - 1;
+        __m512bh yv = (__m512bh)_mm512_maskz_loadu_epi16(mask, y + i);
+        __m512bh hv = (__m512bh)_mm512_loadu_si512(qh + i);
+        __m512bh lv = (__m512bh)_mm512_loadu_si512(ql + i);
+        acc_h = _mm512_dpbf16_ps(acc_h, hv, yv);
+        acc_l = _mm512_dpbf16_ps(acc_l, lv, yv);
+        if (compute_norm) {
+            acc_n = _mm512_dpbf16_ps(acc_n, yv, yv);
+        }
+    }
+    if (compute_norm) {
+        *norm2 = _mm512_reduce_add_ps(acc_n);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc_h, acc_l));
+}
+
+#endif
+
+} // namespace
+
+/*********************************************************
+ * Conversions
+ *********************************************************/
+
+void fvec_to_fp16(const float* x, uint16_t* out, size_t n) {
+    size_t i = 0;
+#ifdef __AVX512F__
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_si256(
+                (__m256i*)(out + i),
+                _mm512_cvtps_ph(
+                        _mm512_loadu_ps(x + i),
+                        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128(
+                (__m128i*)(out + i),
+                _mm256_cvtps_ph(
+                        _mm256_loadu_ps(x + i),
+                        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = encode_fp16(x[i]);
+    }
+}
+
+void fp16_to_fvec(const uint16_t* x, float* out, size_t n) {
+    size_t i = 0;
+#ifdef __AVX512F__
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, FP16::load16(x + i));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, FP16::load8(x + i));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = decode_fp16(x[i]);
+    }
+}
+
+void fvec_to_bf16(const float* x, uint16_t* out, size_t n) {
+    size_t i = 0;
+#ifdef __AVX512F__
+    const __m512i round = _mm512_set1_epi32(0x8000);
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_castps_si512(_mm512_loadu_ps(x + i));
+        v = _mm512_srli_epi32(_mm512_add_epi32(v, round), 16);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm512_cvtepi32_epi16(v));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = encode_bf16(x[i]);
+    }
+}
+
+void bf16_to_fvec(const uint16_t* x, float* out, size_t n) {
+    size_t i = 0;
+#ifdef __AVX512F__
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, BF16::load16(x + i));
+    }
+#elif defined(__AVX2__) && defined(__F16C__)
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, BF16::load8(x + i));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = decode_bf16(x[i]);
+    }
+}
+
+/*********************************************************
+ * Distances
+ *********************************************************/
+
+float fvec_inner_product_fp16(const float* x, const uint16_t* y, size_t d) {
+    return inner_product_16bit<FP16>(x, y, d);
+}
+
+float fvec_L2sqr_fp16(const float* x, const uint16_t* y, size_t d) {
+    return L2sqr_16bit<FP16>(x, y, d);
+}
+
+float fvec_inner_product_bf16(const float* x, const uint16_t* y, size_t d) {
+    return inner_product_16bit<BF16>(x, y, d);
+}
+
+float fvec_L2sqr_bf16(const float* x, const uint16_t* y, size_t d) {
+    return L2sqr_16bit<BF16>(x, y, d);
+}
+
+void fvec_norms_L2sqr_fp16(float* nr, const uint16_t* y, size_t d, size_t ny) {
+#pragma omp parallel for if (ny > 10000)
+    for (int64_t i = 0; i < ny; i++) {
+        nr[i] = norm_L2sqr_16bit<FP16>(y + i * d, d);
+    }
+}
+
+void fvec_norms_L2sqr_bf16(float* nr, const uint16_t* y, size_t d, size_t ny) {
+#pragma omp parallel for if (ny > 10000)
+    for (int64_t i = 0; i < ny; i++) {
+        nr[i] = norm_L2sqr_16bit<BF16>(y + i * d, d);
+    }
+}
+
+Float16QueryDistance::Float16QueryDistance(
+        size_t d,
+        bool bf16,
+        MetricType metric)
+        : d(d), bf16(bf16), metric(metric) {
+    FAISS_THROW_IF_NOT_MSG(
+            metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT,
+            "only L2 and inner product are supported");
+#ifdef __AVX512BF16__
+    if (bf16) {
+        q_split.resize((d + 31) / 32 * 32 * 2, 0);
+    }
+#endif
+}
+
+void Float16QueryDistance::set_query(const float* x) {
+    q = x;
+#ifdef __AVX512BF16__
+    if (bf16) {
+        uint16_t* qh = q_split.data();
+        uint16_t* ql = qh + q_split.size() / 2;
+        for (size_t i = 0; i < d; i++) {
+            qh[i] = encode_bf16(x[i]);
+            ql[i] = encode_bf16(x[i] - decode_bf16(qh[i]));
+        }
+        q_norm2 = fvec_norm_L2sqr(x, d);
+    }
+#endif
+}
+
+float Float16QueryDistance::operator()(const uint16_t* y) const {
+    if (bf16) {
+#ifdef __AVX512BF16__
+        const uint16_t* qh = q_split.data();
+        const uint16_t* ql = qh + q_split.size() / 2;
+        if (metric == METRIC_INNER_PRODUCT) {
+            return bf16_split_inner_product<false>(qh, ql, y, d, nullptr);
+        }
+        float y_norm2;
+        float ip = bf16_split_inner_product<true>(qh, ql, y, d, &y_norm2);
+        return std::max(q_norm2 + y_norm2 - 2 * ip, 0.0f);
+#else
+        return metric == METRIC_INNER_PRODUCT
+                ? inner_product_16bit<BF16>(q, y, d)
+                : L2sqr_16bit<BF16>(q, y, d);
+#endif
+    } else {
+        return metric == METRIC_INNER_PRODUCT
+                ? inner_product_16bit<FP16>(q, y, d)
+                : L2sqr_16bit<FP16>(q, y, d);
+    }
+}
+
+/*********************************************************
+ * KNN functions
+ *********************************************************/
+
+namespace {
+
+template <class BlockResultHandler>
+void exhaustive_16bit_seq(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        MetricType metric,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        BlockResultHandler& res) {
+    using SingleResultHandler =
+            typename BlockResultHandler::SingleResultHandler;
+    [[maybe_unused]] int nt = std::min(int(nx), omp_get_max_threads());
+
+#pragma omp parallel num_threads(nt)
+    {
+        SingleResultHandler resi(res);
+        Float16QueryDistance qd(d, bf16, metric);
+#pragma omp for
+        for (int64_t i = 0; i < nx; i++) {
+            qd.set_query(x + i * d);
+            const uint16_t* y_j = y;
+
+            resi.begin(i);
+            for (size_t j = 0; j < ny; j++, y_j += d) {
+                if (!res.is_in_selection(j)) {
+                    continue;
+                }
+                resi.add_result(qd(y_j), j);
+            }
+            resi.end();
+        }
+    }
+}
+
+/* Converts blocks of the database vectors to float and computes the dot
+ * products with BLAS. For L2, the y_norms are provided. */
+template <class BlockResultHandler>
+void exhaustive_16bit_blas(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        BlockResultHandler& res,
+        const float* y_norms) {
+    // BLAS does not like empty matrices
+    if (nx == 0 || ny == 0)
+        return;
+
+    /* block sizes */
+    const size_t bs_x = distance_compute_blas_query_bs;
+    const size_t bs_y = distance_compute_blas_database_bs;
+    std::unique_ptr<float[]> ip_block(new float[bs_x * bs_y]);
+    std::unique_ptr<float[]> y_block(new float[bs_y * d]);
+    std::unique_ptr<float[]> x_norms;
+
+    if (y_norms) {
+        x_norms.reset(new float[nx]);
+        fvec_norms_L2sqr(x_norms.get(), x, d, nx);
+    }
+
+    for (size_t i0 = 0; i0 < nx; i0 += bs_x) {
+        size_t i1 = std::min(i0 + bs_x, nx);
+
+        res.begin_multiple(i0, i1);
+
+        for (size_t j0 = 0; j0 < ny; j0 += bs_y) {
+            size_t j1 = std::min(j0 + bs_y, ny);
+            if (bf16) {
+                bf16_to_fvec(y + j0 * d, y_block.get(), (j1 - j0) * d);
+            } else {
+                fp16_to_fvec(y + j0 * d, y_block.get(), (j1 - j0) * d);
+            }
+            {
+                float one = 1, zero = 0;
+                FINTEGER nyi = j1 - j0, nxi = i1 - i0, di = d;
+                sgemm_("Transpose",
+                       "Not transpose",
+                       &nyi,
+                       &nxi,
+                       &di,
+                       &one,
+                       y_block.get(),
+                       &di,
+                       x + i0 * d,
+                       &di,
+                       &zero,
+                       ip_block.get(),
+                       &nyi);
+            }
+            if (y_norms) {
+                for (size_t i = i0; i < i1; i++) {
+                    float* ip_line = ip_block.get() + (i - i0) * (j1 - j0);
+                    for (size_t j = j0; j < j1; j++) {
+                        float dis = x_norms[i] + y_norms[j] - 2 * ip_line[0];
+                        // negative values can occur for identical vectors
+                        // due to roundoff errors
+                        *ip_line++ = dis < 0 ? 0 : dis;
+                    }
+                }
+            }
+
+            res.add_results(j0, j1, ip_block.get());
+        }
+        res.end_multiple();
+        InterruptCallback::check();
+    }
+}
+
+// the fused kernels are implemented only for heaps without selector
+template <class BlockResultHandler>
+bool exhaustive_16bit_fused(
+        const float*,
+        const uint16_t*,
+        bool,
+        size_t,
+        size_t,
+        size_t,
+        BlockResultHandler&,
+        const float*) {
+    return false;
+}
+
+bool exhaustive_16bit_fused(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res,
+        const float*) {
+    return distance_compute_use_fused &&
+            exhaustive_inner_product_fused_heap_16bit(
+                   x, y, bf16, d, nx, ny, res);
+}
+
+bool exhaustive_16bit_fused(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    return distance_compute_use_fused &&
+            exhaustive_L2sqr_fused_heap_16bit(
+                   x, y, bf16, d, nx, ny, res, y_norms);
+}
+
+bool use_batched_search(size_t nx, const IDSelector* sel) {
+    return !sel && nx >= distance_compute_blas_threshold;
+}
+
+struct Run_search_16bit {
+    using T = void;
+    template <class BlockResultHandler>
+    void f(BlockResultHandler& res,
+           const float* x,
+           const uint16_t* y,
+           bool bf16,
+           MetricType metric,
+           size_t d,
+           size_t nx,
+           size_t ny,
+           const float* y_norms) {
+        if (!use_batched_search(nx, res.sel)) {
+            exhaustive_16bit_seq(x, y, bf16, metric, d, nx, ny, res);
+        } else if (!exhaustive_16bit_fused(
+                           x, y, bf16, d, nx, ny, res, y_norms)) {
+            exhaustive_16bit_blas(x, y, bf16, d, nx, ny, res, y_norms);
+        }
+    }
+};
+
+void knn_16bit(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        MetricType metric,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* vals,
+        int64_t* ids,
+        const float* y_norm2,
+        const IDSelector* sel) {
+    int64_t imin = 0;
+    if (auto selr = dynamic_cast<const IDSelectorRange*>(sel)) {
+        imin = std::max(selr->imin, int64_t(0));
+        int64_t imax = std::min(selr->imax, int64_t(ny));
+        ny = imax - imin;
+        y += d * imin;
+        if (y_norm2) {
+            y_norm2 += imin;
+        }
+        sel = nullptr;
+    }
+
+    std::unique_ptr<float[]> del2;
+    if (metric == METRIC_L2 && !y_norm2 && use_batched_search(nx, sel)) {
+        del2.reset(new float[ny]);
+        if (bf16) {
+            fvec_norms_L2sqr_bf16(del2.get(), y, d, ny);
+        } else {
+            fvec_norms_L2sqr_fp16(del2.get(), y, d, ny);
+        }
+        y_norm2 = del2.get();
+    }
+    if (metric == METRIC_INNER_PRODUCT) {
+        y_norm2 = nullptr;
+    }
+
+    Run_search_16bit r;
+    dispatch_knn_ResultHandler(
+            nx,
+            vals,
+            ids,
+            k,
+            metric,
+            sel,
+            r,
+            x,
+            y,
+            bf16,
+            metric,
+            d,
+            nx,
+            ny,
+            y_norm2);
+
+    if (imin != 0) {
+        for (size_t i = 0; i < nx * k; i++) {
+            if (ids[i] >= 0) {
+                ids[i] += imin;
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+void knn_inner_product_fp16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const IDSelector* sel) {
+    knn_16bit(
+            x,
+            y,
+            false,
+            METRIC_INNER_PRODUCT,
+            d,
+            nx,
+            ny,
+            k,
+            distances,
+            indexes,
+            nullptr,
+            sel);
+}
+
+void knn_L2sqr_fp16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const float* y_norm2,
+        const IDSelector* sel) {
+    knn_16bit(
+            x,
+            y,
+            false,
+            METRIC_L2,
+            d,
+            nx,
+            ny,
+            k,
+            distances,
+            indexes,
+            y_norm2,
+            sel);
+}
+
+void knn_inner_product_bf16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const IDSelector* sel) {
+    knn_16bit(
+            x,
+            y,
+            true,
+            METRIC_INNER_PRODUCT,
+            d,
+            nx,
+            ny,
+            k,
+            distances,
+            indexes,
+            nullptr,
+            sel);
+}
+
+void knn_L2sqr_bf16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const float* y_norm2,
+        const IDSelector* sel) {
+    knn_16bit(
+            x,
+            y,
+            true,
+            METRIC_L2,
+            d,
+            nx,
+            ny,
+            k,
+            distances,
+            indexes,
+            y_norm2,
+            sel);
+}
+
+} // namespace faiss
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/* Distances between float queries and database vectors stored in 16-bit
+ * floating point formats: fp16 (IEEE half precision) or bf16 (the upper
+ * 16 bits of a float). The components are converted to float on the fly
+ * with the native instructions (F16C for fp16, a shift for bf16), so the
+ * results are the same as with the decoded float vectors up to roundoff.
+ *
+ * When compiled with AVX512-BF16, the distances between a prepared query
+ * and bf16 vectors use vdpbf16ps. Since that instruction multiplies bf16
+ * values, the query is split into two bf16 vectors (hi + lo) whose sum
+ * approximates it with a relative error of about 2^-16.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <faiss/MetricType.h>
+
+namespace faiss {
+
+struct IDSelector;
+
+/*********************************************************
+ * Conversions
+ *********************************************************/
+
+void fvec_to_fp16(const float* x, uint16_t* out, size_t n);
+void fp16_to_fvec(const uint16_t* x, float* out, size_t n);
+
+void fvec_to_bf16(const float* x, uint16_t* out, size_t n);
+void bf16_to_fvec(const uint16_t* x, float* out, size_t n);
+
+/*********************************************************
+ * Distances between a float vector and a 16-bit vector
+ *********************************************************/
+
+float fvec_inner_product_fp16(const float* x, const uint16_t* y, size_t d);
+float fvec_L2sqr_fp16(const float* x, const uint16_t* y, size_t d);
+
+float fvec_inner_product_bf16(const float* x, const uint16_t* y, size_t d);
+float fvec_L2sqr_bf16(const float* x, const uint16_t* y, size_t d);
+
+/// squared norms of the ny vectors of size d stored in y
+void fvec_norms_L2sqr_fp16(float* nr, const uint16_t* y, size_t d, size_t ny);
+void fvec_norms_L2sqr_bf16(float* nr, const uint16_t* y, size_t d, size_t ny);
+
+/** Computes the distances between one float query and 16-bit vectors,
+ * the query is prepared once in set_query. */
+struct Float16QueryDistance {
+    size_t d;
+    bool bf16;         ///< bf16 vectors, otherwise fp16
+    MetricType metric; ///< METRIC_L2 or METRIC_INNER_PRODUCT
+
+    const float* q = nullptr;
+
+    /// with AVX512-BF16: the query split in bf16 hi and lo parts, padded
+    std::vector<uint16_t> q_split;
+    float q_norm2 = 0;
+
+    Float16QueryDistance(size_t d, bool bf16, MetricType metric);
+
+    void set_query(const float* x);
+
+    /// distance between the query and the 16-bit vector y
+    float operator()(const uint16_t* y) const;
+};
+
+/*********************************************************
+ * KNN functions
+ *********************************************************/
+
+/** Return the k nearest neighbors of each of the nx float vectors x among
+ * the ny fp16 or bf16 vectors y. The batched search (nx >=
+ * distance_compute_blas_threshold) converts tiles of y to float and uses
+ * the fused GEMM + top-k kernels when available, or BLAS otherwise.
+ *
+ * @param x        query vectors, size nx * d
+ * @param y        database vectors, size ny * d
+ * @param y_norm2  (optional) squared norms of the y vectors, size ny
+ * @param distances output distances, size nx * k
+ * @param indexes  output labels, size nx * k
+ */
+void knn_inner_product_fp16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const IDSelector* sel = nullptr);
+
+void knn_L2sqr_fp16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const float* y_norm2 = nullptr,
+        const IDSelector* sel = nullptr);
+
+void knn_inner_product_bf16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const IDSelector* sel = nullptr);
+
+void knn_L2sqr_bf16(
+        const float* x,
+        const uint16_t* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        const float* y_norm2 = nullptr,
+        const IDSelector* sel = nullptr);
+
+} // namespace faiss
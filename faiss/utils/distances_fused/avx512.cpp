@@ -13,6 +13,8 @@
 
 #include <immintrin.h>
 
+#include <faiss/utils/distances_fused/fused_knn-inl.h>
+
 namespace faiss {
 
 namespace {
@@ -341,6 +343,110 @@ bool exhaustive_L2sqr_fused_cmax_AVX512(
 #undef DISPATCH
 }
 
+namespace {
+
+// 8 queries x 32 database vectors: 16 accumulators out of the 32 AVX512
+// registers
+struct MicroKernelAVX512 {
+    static constexpr size_t NX = 8;
+    static constexpr size_t NY = 32;
+
+    static void compute(
+            const float* const* xs,
+            size_t d,
+            const float* __restrict panel,
+            float* __restrict tile,
+            bool accumulate) {
+        __m512 acc0[NX], acc1[NX];
+        for (size_t i = 0; i < NX; i++) {
+            if (accumulate) {
+                acc0[i] = _mm512_loadu_ps(tile + i * NY);
+                acc1[i] = _mm512_loadu_ps(tile + i * NY + 16);
+            } else {
+                acc0[i] = _mm512_setzero_ps();
+                acc1[i] = _mm512_setzero_ps();
+            }
+        }
+        for (size_t l = 0; l < d; l++) {
+            const __m512 y0 = _mm512_loadu_ps(panel + l * NY);
+            const __m512 y1 = _mm512_loadu_ps(panel + l * NY + 16);
+            for (size_t i = 0; i < NX; i++) {
+                const __m512 xi = _mm512_set1_ps(xs[i][l]);
+                acc0[i] = _mm512_fmadd_ps(xi, y0, acc0[i]);
+                acc1[i] = _mm512_fmadd_ps(xi, y1, acc1[i]);
+            }
+        }
+        for (size_t i = 0; i < NX; i++) {
+            _mm512_storeu_ps(tile + i * NY, acc0[i]);
+            _mm512_storeu_ps(tile + i * NY + 16, acc1[i]);
+        }
+    }
+};
+
+} // namespace
+
+void exhaustive_inner_product_fused_heap_AVX512(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+    fused_knn::exhaustive_fused<MicroKernelAVX512>(
+            x, y, d, nx, ny, res, false, nullptr);
+}
+
+void exhaustive_L2sqr_fused_heap_AVX512(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    fused_knn::exhaustive_fused<MicroKernelAVX512>(
+            x, y, d, nx, ny, res, true, y_norms);
+}
+
+void exhaustive_inner_product_fused_heap_16bit_AVX512(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+    using C = CMin<float, int64_t>;
+    using MK = MicroKernelAVX512;
+    if (bf16) {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderBF16>(
+                x, y, d, nx, ny, res, false, nullptr);
+    } else {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderFP16>(
+                x, y, d, nx, ny, res, false, nullptr);
+    }
+}
+
+void exhaustive_L2sqr_fused_heap_16bit_AVX512(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    using C = CMax<float, int64_t>;
+    using MK = MicroKernelAVX512;
+    if (bf16) {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderBF16>(
+                x, y, d, nx, ny, res, true, y_norms);
+    } else {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderFP16>(
+                x, y, d, nx, ny, res, true, y_norms);
+    }
+}
+
 } // namespace faiss
 
 #endif
@@ -39,4 +39,84 @@ bool exhaustive_L2sqr_fused_cmax(
 #endif
 }
 
+bool exhaustive_inner_product_fused_heap(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+#ifdef __AVX512F__
+    exhaustive_inner_product_fused_heap_AVX512(x, y, d, nx, ny, res);
+    return true;
+#elif defined(__AVX2__) || defined(__aarch64__)
+    exhaustive_inner_product_fused_heap_simdlib(x, y, d, nx, ny, res);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool exhaustive_L2sqr_fused_heap(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+#ifdef __AVX512F__
+    exhaustive_L2sqr_fused_heap_AVX512(x, y, d, nx, ny, res, y_norms);
+    return true;
+#elif defined(__AVX2__) || defined(__aarch64__)
+    exhaustive_L2sqr_fused_heap_simdlib(x, y, d, nx, ny, res, y_norms);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool exhaustive_inner_product_fused_heap_16bit(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+#ifdef __AVX512F__
+    exhaustive_inner_product_fused_heap_16bit_AVX512(
+            x, y, bf16, d, nx, ny, res);
+    return true;
+#elif defined(__AVX2__) || defined(__aarch64__)
+    exhaustive_inner_product_fused_heap_16bit_simdlib(
+            x, y, bf16, d, nx, ny, res);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool exhaustive_L2sqr_fused_heap_16bit(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+#ifdef __AVX512F__
+    exhaustive_L2sqr_fused_heap_16bit_AVX512(
+            x, y, bf16, d, nx, ny, res, y_norms);
+    return true;
+#elif defined(__AVX2__) || defined(__aarch64__)
+    exhaustive_L2sqr_fused_heap_16bit_simdlib(
+            x, y, bf16, d, nx, ny, res, y_norms);
+    return true;
+#else
+    return false;
+#endif
+}
+
 } // namespace faiss
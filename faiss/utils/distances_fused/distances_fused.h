@@ -37,4 +37,47 @@ bool exhaustive_L2sqr_fused_cmax(
         Top1BlockResultHandler<CMax<float, int64_t>>& res,
         const float* y_norms);
 
+// Fused kernels for any dimensionality that keep the k best results in
+// heaps: the dot products are computed by small tiles that stay in
+// registers and update the heaps directly (see fused_knn-inl.h).
+// Return false if no kernel is available for the platform.
+bool exhaustive_inner_product_fused_heap(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res);
+
+bool exhaustive_L2sqr_fused_heap(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms);
+
+// Same, for database vectors stored in fp16 or bf16 (if bf16 = true). The
+// vectors are converted to float when they are packed in the panels. The
+// y_norms are required for L2.
+bool exhaustive_inner_product_fused_heap_16bit(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res);
+
+bool exhaustive_L2sqr_fused_heap_16bit(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms);
+
 } // namespace faiss
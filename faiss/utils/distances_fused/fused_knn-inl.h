@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+// Blocked driver for the fused k-NN kernels at any dimensionality, shared
+// by the SIMD implementations. The dot products between NX queries and
+// NY database vectors are accumulated in registers by a micro-kernel, and
+// the resulting NX * NY tile (that stays in L1) is immediately used to
+// update the result heaps, so that the full distance matrix is never
+// written to memory.
+//
+// The database vectors are packed by panels of NY vectors in dimension-
+// major order, so that the micro-kernel loads NY components with
+// contiguous SIMD loads and broadcasts one component of each query.
+// For large d, the panels are split in slices of bs_d dimensions that fit
+// in L1, and the tiles are accumulated over the slices.
+//
+// The threads process blocks of bs_x queries. When there are fewer blocks
+// than threads (small batches), the database is also split in ranges of
+// panels, and the heaps of each range are merged into the result heaps.
+//
+// The database vectors may be stored in a 16-bit format (fp16 or bf16):
+// they are converted to float when the panels are packed, so the
+// conversion cost is amortized over the bs_x queries of a block and the
+// micro-kernels are the same as for float data.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <omp.h>
+
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/ResultHandler.h>
+#include <faiss/utils/Heap.h>
+#include <faiss/utils/bf16.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/fp16.h>
+
+namespace faiss {
+
+namespace fused_knn {
+
+/// conversion of the database components to float when packing
+struct DecoderFloat {
+    using T = float;
+    static float decode(float v) {
+        return v;
+    }
+};
+
+struct DecoderFP16 {
+    using T = uint16_t;
+    static float decode(uint16_t v) {
+        return decode_fp16(v);
+    }
+};
+
+struct DecoderBF16 {
+    using T = uint16_t;
+    static float decode(uint16_t v) {
+        return decode_bf16(v);
+    }
+};
+
+/** MicroKernel must define
+ *
+ *  static constexpr size_t NX, NY;
+ *
+ *  // tile[i * NY + j] (+)= <xs[i], packed panel vector j>
+ *  static void compute(
+ *          const float* const* xs, size_t d, const float* panel,
+ *          float* tile, bool accumulate);
+ *
+ * C is CMin<float, int64_t> for the inner product (the heaps keep the
+ * largest values) and CMax<float, int64_t> for L2.
+ *
+ * For 16-bit database vectors, the y_norms must be provided for L2.
+ */
+template <class MicroKernel, class C, class Decoder = DecoderFloat>
+void exhaustive_fused(
+        const float* x,
+        const typename Decoder::T* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<C>& res,
+        bool is_l2,
+        const float* y_norms) {
+    constexpr size_t NX = MicroKernel::NX;
+    constexpr size_t NY = MicroKernel::NY;
+    // slice of the dimensions such that a slice of panel fits in L1
+    const size_t bs_d = std::min(d, 16 * 1024 / 4 / NY);
+    // nb of queries handled by one thread at a time (a multiple of NX),
+    // their vectors should stay in L2 cache
+    const size_t bs_x_l2 = std::min(size_t(256), 256 * 1024 / 4 / d);
+    const size_t bs_x = std::max(bs_x_l2 / NX, size_t(1)) * NX;
+
+    std::unique_ptr<float[]> x_norms;
+    std::unique_ptr<float[]> del2;
+    if (is_l2) {
+        x_norms.reset(new float[nx]);
+        fvec_norms_L2sqr(x_norms.get(), x, d, nx);
+        if constexpr (std::is_same<typename Decoder::T, float>::value) {
+            if (!y_norms) {
+                del2.reset(new float[ny]);
+                fvec_norms_L2sqr(del2.get(), y, d, ny);
+                y_norms = del2.get();
+            }
+        } else {
+            FAISS_THROW_IF_NOT(y_norms);
+        }
+    }
+
+    const size_t k = res.k;
+    res.begin_multiple(0, nx);
+
+    size_t nblock = (nx + bs_x - 1) / bs_x;
+    // with fewer query blocks than threads, the database is also split in
+    // ranges of panels. Each (block, range) is searched into local heaps
+    // that are merged into the result heaps
+    size_t npanel = (ny + NY - 1) / NY;
+    size_t nsplit = 1;
+    // called from a parallel region (eg. the list-major IVF search), the
+    // nested region has a single thread
+    size_t nt = omp_in_parallel() ? 1 : omp_get_max_threads();
+    if (nblock < nt) {
+        nsplit = std::max(
+                std::min((nt + nblock - 1) / nblock, npanel), size_t(1));
+    }
+    int64_t nwork = nblock * nsplit;
+
+#pragma omp parallel
+    {
+        std::vector<float> panel(NY * bs_d);
+        std::vector<float> tiles(bs_x * NY);
+        std::vector<float> local_dis(nsplit > 1 ? bs_x * k : 0);
+        std::vector<int64_t> local_ids(nsplit > 1 ? bs_x * k : 0);
+
+#pragma omp for schedule(dynamic)
+        for (int64_t w = 0; w < nwork; w++) {
+            size_t b = w / nsplit, s = w % nsplit;
+            size_t i0 = b * bs_x;
+            size_t i1 = std::min(i0 + bs_x, nx);
+            size_t j_begin = npanel * s / nsplit * NY;
+            size_t j_end = std::min(npanel * (s + 1) / nsplit * NY, ny);
+
+            // heaps of query i0
+            float* heap_dis0;
+            int64_t* heap_ids0;
+            if (nsplit > 1) {
+                heap_dis0 = local_dis.data();
+                heap_ids0 = local_ids.data();
+                for (size_t i = i0; i < i1; i++) {
+                    heap_heapify<C>(
+                            k,
+                            heap_dis0 + (i - i0) * k,
+                            heap_ids0 + (i - i0) * k);
+                }
+            } else {
+                heap_dis0 = res.heap_dis_tab + i0 * k;
+                heap_ids0 = res.heap_ids_tab + i0 * k;
+            }
+
+            for (size_t j0 = j_begin; j0 < j_end; j0 += NY) {
+                size_t nj = std::min(NY, j_end - j0);
+
+                for (size_t l0 = 0; l0 < d; l0 += bs_d) {
+                    size_t nl = std::min(bs_d, d - l0);
+                    // pack the slice of the panel, padded with zeros
+                    for (size_t jj = 0; jj < nj; jj++) {
+                        const auto* yj = y + (j0 + jj) * d + l0;
+                        for (size_t l = 0; l < nl; l++) {
+                            panel[l * NY + jj] = Decoder::decode(yj[l]);
+                        }
+                    }
+                    for (size_t jj = nj; jj < NY; jj++) {
+                        for (size_t l = 0; l < nl; l++) {
+                            panel[l * NY + jj] = 0;
+                        }
+                    }
+
+                    for (size_t i = i0; i < i1; i += NX) {
+                        size_t ni = std::min(NX, i1 - i);
+                        const float* xs[NX];
+                        for (size_t ii = 0; ii < NX; ii++) {
+                            // the missing rows are computed but ignored
+                            xs[ii] = x + (i + (ii < ni ? ii : 0)) * d + l0;
+                        }
+                        MicroKernel::compute(
+                                xs,
+                                nl,
+                                panel.data(),
+                                tiles.data() + (i - i0) * NY,
+                                l0 > 0);
+                    }
+                }
+
+                for (size_t i = i0; i < i1; i++) {
+                    float* heap_dis = heap_dis0 + (i - i0) * k;
+                    int64_t* heap_ids = heap_ids0 + (i - i0) * k;
+                    const float* tile_i = tiles.data() + (i - i0) * NY;
+                    float thresh = heap_dis[0];
+                    if (is_l2) {
+                        for (size_t jj = 0; jj < nj; jj++) {
+                            float dis = x_norms[i] + y_norms[j0 + jj] -
+                                    2 * tile_i[jj];
+                            // roundoff errors for identical vectors
+                            if (dis < 0) {
+                                dis = 0;
+                            }
+                            if (C::cmp(thresh, dis)) {
+                                heap_replace_top<C>(
+                                        k, heap_dis, heap_ids, dis, j0 + jj);
+                                thresh = heap_dis[0];
+                            }
+                        }
+                    } else {
+                        for (size_t jj = 0; jj < nj; jj++) {
+                            if (C::cmp(thresh, tile_i[jj])) {
+                                heap_replace_top<C>(
+                                        k,
+                                        heap_dis,
+                                        heap_ids,
+                                        tile_i[jj],
+                                        j0 + jj);
+                                thresh = heap_dis[0];
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (nsplit > 1) {
+#pragma omp critical
+                {
+                    for (size_t i = i0; i < i1; i++) {
+                        heap_addn<C>(
+                                k,
+                                res.heap_dis_tab + i * k,
+                                res.heap_ids_tab + i * k,
+                                heap_dis0 + (i - i0) * k,
+                                heap_ids0 + (i - i0) * k,
+                                k);
+                    }
+                }
+            }
+        }
+    }
+
+    res.end_multiple();
+    InterruptCallback::check();
+}
+
+} // namespace fused_knn
+
+} // namespace faiss
@@ -11,6 +11,7 @@
 
 #if defined(__AVX2__) || defined(__aarch64__)
 
+#include <faiss/utils/distances_fused/fused_knn-inl.h>
 #include <faiss/utils/simdlib.h>
 
 #if defined(__AVX2__)
@@ -347,6 +348,110 @@ bool exhaustive_L2sqr_fused_cmax_simdlib(
 #undef DISPATCH
 }
 
+namespace {
+
+// 6 queries x 16 database vectors: 12 accumulators, 2 loads and 1
+// broadcast fit in the 16 AVX2 registers
+struct MicroKernelSimdlib {
+    static constexpr size_t NX = 6;
+    static constexpr size_t NY = 16;
+
+    static void compute(
+            const float* const* xs,
+            size_t d,
+            const float* __restrict panel,
+            float* __restrict tile,
+            bool accumulate) {
+        simd8float32 acc0[NX], acc1[NX];
+        for (size_t i = 0; i < NX; i++) {
+            if (accumulate) {
+                acc0[i] = simd8float32(tile + i * NY);
+                acc1[i] = simd8float32(tile + i * NY + 8);
+            } else {
+                acc0[i] = simd8float32(0.0f);
+                acc1[i] = simd8float32(0.0f);
+            }
+        }
+        for (size_t l = 0; l < d; l++) {
+            const simd8float32 y0(panel + l * NY);
+            const simd8float32 y1(panel + l * NY + 8);
+            for (size_t i = 0; i < NX; i++) {
+                const simd8float32 xi(xs[i][l]);
+                acc0[i] = fmadd(xi, y0, acc0[i]);
+                acc1[i] = fmadd(xi, y1, acc1[i]);
+            }
+        }
+        for (size_t i = 0; i < NX; i++) {
+            acc0[i].storeu(tile + i * NY);
+            acc1[i].storeu(tile + i * NY + 8);
+        }
+    }
+};
+
+} // namespace
+
+void exhaustive_inner_product_fused_heap_simdlib(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+    fused_knn::exhaustive_fused<MicroKernelSimdlib>(
+            x, y, d, nx, ny, res, false, nullptr);
+}
+
+void exhaustive_L2sqr_fused_heap_simdlib(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    fused_knn::exhaustive_fused<MicroKernelSimdlib>(
+            x, y, d, nx, ny, res, true, y_norms);
+}
+
+void exhaustive_inner_product_fused_heap_16bit_simdlib(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res) {
+    using C = CMin<float, int64_t>;
+    using MK = MicroKernelSimdlib;
+    if (bf16) {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderBF16>(
+                x, y, d, nx, ny, res, false, nullptr);
+    } else {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderFP16>(
+                x, y, d, nx, ny, res, false, nullptr);
+    }
+}
+
+void exhaustive_L2sqr_fused_heap_16bit_simdlib(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    using C = CMax<float, int64_t>;
+    using MK = MicroKernelSimdlib;
+    if (bf16) {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderBF16>(
+                x, y, d, nx, ny, res, true, y_norms);
+    } else {
+        fused_knn::exhaustive_fused<MK, C, fused_knn::DecoderFP16>(
+                x, y, d, nx, ny, res, true, y_norms);
+    }
+}
+
 } // namespace faiss
 
 #endif
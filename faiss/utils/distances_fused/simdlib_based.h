@@ -27,6 +27,44 @@ bool exhaustive_L2sqr_fused_cmax_simdlib(
         Top1BlockResultHandler<CMax<float, int64_t>>& res,
         const float* y_norms);
 
+// Fused k-NN kernels for any dimensionality, see fused_knn-inl.h
+void exhaustive_inner_product_fused_heap_simdlib(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res);
+
+void exhaustive_L2sqr_fused_heap_simdlib(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms);
+
+// same, for database vectors stored in fp16 or bf16 (if bf16 = true)
+void exhaustive_inner_product_fused_heap_16bit_simdlib(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMin<float, int64_t>>& res);
+
+void exhaustive_L2sqr_fused_heap_16bit_simdlib(
+        const float* x,
+        const uint16_t* y,
+        bool bf16,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        HeapBlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms);
+
 } // namespace faiss
 
 #endif
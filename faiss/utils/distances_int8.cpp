@@ -0,0 +1,498 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/utils/distances_int8.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/utils/Heap.h>
+#include <faiss/utils/distances.h>
+
+namespace faiss {
+
+Int8Query::Int8Query(size_t d)
+        : d(d), q((d + 63) / 64 * 64, 0), q16((d + 63) / 64 * 64, 0) {}
+
+Int8Query::~Int8Query() {}
+
+void Int8Query::set_query(const float* x) {
+    float vmin = 0, vmax = 0;
+    exact = true;
+    for (size_t i = 0; i < d; i++) {
+        vmin = std::min(vmin, x[i]);
+        vmax = std::max(vmax, x[i]);
+        if (x[i] != std::nearbyint(x[i])) {
+            exact = false;
+        }
+    }
+    if (vmin < -128 || vmax > 127) {
+        exact = false;
+    }
+    float amax = std::max(-vmin, vmax);
+    scale = exact || amax == 0 ? 1 : amax / 127;
+    q_sum = 0;
+    q_norm2 = 0;
+    for (size_t i = 0; i < d; i++) {
+        int v = int(std::lrint(x[i] / scale));
+        v = std::min(std::max(v, -128), 127);
+        q[i] = v;
+        q16[i] = v;
+        q_sum += v;
+        q_norm2 += v * v;
+    }
+    x_norm2 = exact ? float(q_norm2) : fvec_norm_L2sqr(x, d);
+}
+
+namespace {
+
+#ifdef __AVX2__
+inline int32_t horizontal_sum(const __m256i v) {
+    __m128i sum = _mm_add_epi32(
+            _mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+/* dot products of NQ queries with code - 128, and optionally the squared
+ * norm of code - 128 */
+template <int NQ, bool with_norm>
+void inner_products(
+        const Int8Query* const* qs,
+        const uint8_t* code,
+        int32_t* ip,
+        int32_t* norm2) {
+    const size_t d = qs[0]->d;
+    size_t i = 0;
+    int32_t nr = 0;
+    for (int t = 0; t < NQ; t++) {
+        ip[t] = 0;
+    }
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+    __m512i acc[NQ];
+    for (int t = 0; t < NQ; t++) {
+        acc[t] = _mm512_setzero_si512();
+    }
+    __m512i accn = _mm512_setzero_si512();
+    const __m512i offset = _mm512_set1_epi16(128);
+    for (; i < d; i += 64) {
+        __mmask64 mask = d - i >= 64 ? ~__mmask64(0)
+                                     : (__mmask64(1) << (d - i)) - 1;
+        // the masked components are 0 in the code and in the queries
+        __m512i c = _mm512_maskz_loadu_epi8(mask, code + i);
+        for (int t = 0; t < NQ; t++) {
+            __m512i qv = _mm512_loadu_si512(qs[t]->q.data() + i);
+            acc[t] = _mm512_dpbusd_epi32(acc[t], c, qv);
+        }
+        if (with_norm) {
+            __m512i y0 = _mm512_maskz_sub_epi16(
+                    __mmask32(mask),
+                    _mm512_cvtepu8_epi16(_mm512_castsi512_si256(c)),
+                    offset);
+            __m512i y1 = _mm512_maskz_sub_epi16(
+                    __mmask32(mask >> 32),
+                    _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(c, 1)),
+                    offset);
+            accn = _mm512_dpwssd_epi32(accn, y0, y0);
+            accn = _mm512_dpwssd_epi32(accn, y1, y1);
+        }
+    }
+    for (int t = 0; t < NQ; t++) {
+        // remove the offset of the codes
+        ip[t] = _mm512_reduce_add_epi32(acc[t]) - 128 * qs[t]->q_sum;
+    }
+    nr = _mm512_reduce_add_epi32(accn);
+#elif defined(__AVX512BW__) && defined(__AVX512VL__)
+    __m512i acc[NQ];
+    for (int t = 0; t < NQ; t++) {
+        acc[t] = _mm512_setzero_si512();
+    }
+    __m512i accn = _mm512_setzero_si512();
+    const __m512i offset = _mm512_set1_epi16(128);
+    for (; i < d; i += 32) {
+        __mmask32 mask = d - i >= 32 ? ~__mmask32(0)
+                                     : (__mmask32(1) << (d - i)) - 1;
+        __m512i c = _mm512_cvtepu8_epi16(
+                _mm256_maskz_loadu_epi8(mask, code + i));
+        __m512i y = _mm512_maskz_sub_epi16(mask, c, offset);
+        for (int t = 0; t < NQ; t++) {
+            __m512i qv = _mm512_loadu_si512(qs[t]->q16.data() + i);
+            acc[t] = _mm512_add_epi32(acc[t], _mm512_madd_epi16(y, qv));
+        }
+        if (with_norm) {
+            accn = _mm512_add_epi32(accn, _mm512_madd_epi16(y, y));
+        }
+    }
+    for (int t = 0; t < NQ; t++) {
+        ip[t] = _mm512_reduce_add_epi32(acc[t]);
+    }
+    nr = _mm512_reduce_add_epi32(accn);
+#elif defined(__AVX2__)
+    __m256i acc[NQ];
+    for (int t = 0; t < NQ; t++) {
+        acc[t] = _mm256_setzero_si256();
+    }
+    __m256i accn = _mm256_setzero_si256();
+    const __m256i offset = _mm256_set1_epi16(128);
+    for (; i + 16 <= d; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(code + i));
+        __m256i y = _mm256_sub_epi16(_mm256_cvtepu8_epi16(c), offset);
+        for (int t = 0; t < NQ; t++) {
+            __m256i qv = _mm256_loadu_si256(
+                    (const __m256i*)(qs[t]->q16.data() + i));
+            acc[t] = _mm256_add_epi32(acc[t], _mm256_madd_epi16(y, qv));
+        }
+        if (with_norm) {
+            accn = _mm256_add_epi32(accn, _mm256_madd_epi16(y, y));
+        }
+    }
+    for (int t = 0; t < NQ; t++) {
+        ip[t] = horizontal_sum(acc[t]);
+    }
+    nr = horizontal_sum(accn);
+#endif
+    for (; i < d; i++) {
+        int32_t y = int32_t(code[i]) - 128;
+        for (int t = 0; t < NQ; t++) {
+            ip[t] += qs[t]->q[i] * y;
+        }
+        nr += y * y;
+    }
+    if (with_norm) {
+        *norm2 = nr;
+    }
+}
+
+} // namespace
+
+int32_t Int8Query::inner_product(const uint8_t* code) const {
+    const Int8Query* qs[1] = {this};
+    int32_t ip;
+    inner_products<1, false>(qs, code, &ip, nullptr);
+    return ip;
+}
+
+int32_t Int8Query::inner_product_and_norm(const uint8_t* code, int32_t* norm2)
+        const {
+    const Int8Query* qs[1] = {this};
+    int32_t ip;
+    inner_products<1, true>(qs, code, &ip, norm2);
+    return ip;
+}
+
+float Int8Query::distance(const uint8_t* code, MetricType metric) const {
+    if (metric == METRIC_INNER_PRODUCT) {
+        return to_distance(inner_product(code), 0, metric);
+    }
+    int32_t norm2;
+    int32_t ip = inner_product_and_norm(code, &norm2);
+    return to_distance(ip, norm2, metric);
+}
+
+void int8_inner_products_4(
+        const Int8Query* const* qs,
+        const uint8_t* code,
+        int32_t* ip,
+        int32_t* norm2) {
+    if (norm2) {
+        inner_products<4, true>(qs, code, ip, norm2);
+    } else {
+        inner_products<4, false>(qs, code, ip, nullptr);
+    }
+}
+
+namespace {
+
+template <class C, bool with_norm>
+void knn_int8_block(
+        const Int8Query* const* qs,
+        size_t nq,
+        const uint8_t* codes,
+        size_t d,
+        size_t j0,
+        size_t j1,
+        MetricType metric,
+        size_t k,
+        float* const* heap_dis,
+        int64_t* const* heap_ids,
+        const IDSelector* sel) {
+    for (size_t j = j0; j < j1; j++) {
+        if (sel && !sel->is_member(j)) {
+            continue;
+        }
+        int32_t ip[4], norm2 = 0;
+        inner_products<4, with_norm>(qs, codes + j * d, ip, &norm2);
+        for (size_t t = 0; t < nq; t++) {
+            float dis = qs[t]->to_distance(ip[t], norm2, metric);
+            if (C::cmp(heap_dis[t][0], dis)) {
+                heap_replace_top<C>(k, heap_dis[t], heap_ids[t], dis, j);
+            }
+        }
+    }
+}
+
+template <class C>
+void knn_int8_heaps(
+        const float* x,
+        const uint8_t* codes,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        MetricType metric,
+        size_t k,
+        float* distances,
+        int64_t* labels,
+        const IDSelector* sel) {
+    // nb of queries per task, a multiple of 4
+    const size_t bs_x = 32;
+    // nb of codes that stay in L2 cache while they are compared to the
+    // queries of the task
+    const size_t bs_y =
+            std::max(size_t(1), 128 * 1024 / std::max(d, size_t(1)));
+    const int64_t nblock = (nx + bs_x - 1) / bs_x;
+
+#pragma omp parallel if (nblock > 1)
+    {
+        std::vector<Int8Query> queries(bs_x, Int8Query(d));
+
+#pragma omp for schedule(dynamic)
+        for (int64_t b = 0; b < nblock; b++) {
+            size_t i0 = b * bs_x;
+            size_t i1 = std::min(i0 + bs_x, nx);
+            for (size_t i = i0; i < i1; i++) {
+                queries[i - i0].set_query(x + i * d);
+                heap_heapify<C>(k, distances + i * k, labels + i * k);
+            }
+            for (size_t j0 = 0; j0 < ny; j0 += bs_y) {
+                size_t j1 = std::min(j0 + bs_y, ny);
+                for (size_t g = i0; g < i1; g += 4) {
+                    size_t ng = std::min(size_t(4), i1 - g);
+                    const Int8Query* qs[4];
+                    float* heap_dis[4];
+                    int64_t* heap_ids[4];
+                    for (size_t t = 0; t < 4; t++) {
+                        // the missing queries are computed but ignored
+                        size_t ii = g + (t < ng ? t : 0);
+                        qs[t] = &queries[ii - i0];
+                        heap_dis[t] = distances + ii * k;
+                        heap_ids[t] = labels + ii * k;
+                    }
+                    if (metric == METRIC_L2) {
+                        knn_int8_block<C, true>(
+                                qs,
+                                ng,
+                                codes,
+                                d,
+                                j0,
+                                j1,
+                                metric,
+                                k,
+                                heap_dis,
+                                heap_ids,
+                                sel);
+                    } else {
+                        knn_int8_block<C, false>(
+                                qs,
+                                ng,
+                                codes,
+                                d,
+                                j0,
+                                j1,
+                                metric,
+                                k,
+                                heap_dis,
+                                heap_ids,
+                                sel);
+                    }
+                }
+            }
+            for (size_t i = i0; i < i1; i++) {
+                heap_reorder<C>(k, distances + i * k, labels + i * k);
+            }
+        }
+    }
+    InterruptCallback::check();
+}
+
+} // namespace
+
+void knn_int8(
+        const float* x,
+        const uint8_t* codes,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        MetricType metric,
+        size_t k,
+        float* distances,
+        int64_t* labels,
+        const IDSelector* sel) {
+    FAISS_THROW_IF_NOT(
+            metric == METRIC_L2 || metric == METRIC_INNER_PRODUCT);
+    if (metric == METRIC_L2) {
+        knn_int8_heaps<CMax<float, int64_t>>(
+                x, codes, d, nx, ny, metric, k, distances, labels, sel);
+    } else {
+        knn_int8_heaps<CMin<float, int64_t>>(
+                x, codes, d, nx, ny, metric, k, distances, labels, sel);
+    }
+}
+
+/*********************************************************
+ * Kernels on unsigned 8-bit codes
+ *********************************************************/
+
+namespace {
+
+enum class U8Norm {
+    none,     // no norm
+    plain,    // sum_i c[i]^2
+    weighted, // sum_i round(c[i] * u[i] / 256)^2
+};
+
+/* The kernels process 32 components at a time (16 for the int16 weights)
+ * with AVX2, the remaining components are handled by the scalar loop. */
+template <class W, U8Norm NORM>
+int32_t u8_inner_product_norm(
+        const W* w,
+        const int16_t* u,
+        const uint8_t* c,
+        size_t d,
+        float* norm2) {
+    size_t i = 0;
+    int32_t accu = 0;
+    int32_t accu_n = 0;
+    float accu_wn = 0;
+#ifdef __AVX2__
+    __m256i acc = _mm256_setzero_si256();
+    __m256i accn = _mm256_setzero_si256();
+    __m256 accwn = _mm256_setzero_ps();
+
+    // norm of 16 components widened to int16
+    auto add_norm = [&](__m256i c16, const int16_t* ui) {
+        if (NORM == U8Norm::plain) {
+            accn = _mm256_add_epi32(accn, _mm256_madd_epi16(c16, c16));
+        } else if (NORM == U8Norm::weighted) {
+            // vpmulhrsw computes (c * 128 * u + 2^14) >> 15. The pairs
+            // of z^2 fit in an int32 but their sum may not
+            __m256i uv = _mm256_loadu_si256((const __m256i*)ui);
+            __m256i z = _mm256_mulhrs_epi16(_mm256_slli_epi16(c16, 7), uv);
+            accwn = _mm256_add_ps(
+                    accwn, _mm256_cvtepi32_ps(_mm256_madd_epi16(z, z)));
+        }
+    };
+
+    if (sizeof(W) == 1) {
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (; i + 32 <= d; i += 32) {
+            __m256i cv = _mm256_loadu_si256((const __m256i*)(c + i));
+            __m256i wv = _mm256_loadu_si256((const __m256i*)(w + i));
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+            acc = _mm256_dpbusd_epi32(acc, cv, wv);
+#else
+            // 2 * 255 * 63 fits in an int16
+            __m256i p = _mm256_maddubs_epi16(cv, wv);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p, ones));
+#endif
+            if (NORM != U8Norm::none) {
+                add_norm(
+                        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(cv)),
+                        u + i);
+                add_norm(
+                        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(cv, 1)),
+                        u + i + 16);
+            }
+        }
+    } else {
+        for (; i + 16 <= d; i += 16) {
+            __m256i c16 = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i*)(c + i)));
+            __m256i wv = _mm256_loadu_si256((const __m256i*)(w + i));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(c16, wv));
+            if (NORM != U8Norm::none) {
+                add_norm(c16, u + i);
+            }
+        }
+    }
+    accu = horizontal_sum(acc);
+    if (NORM == U8Norm::plain) {
+        accu_n = horizontal_sum(accn);
+    } else if (NORM == U8Norm::weighted) {
+        __m128 sum = _mm_add_ps(
+                _mm256_castps256_ps128(accwn),
+                _mm256_extractf128_ps(accwn, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        accu_wn = _mm_cvtss_f32(sum);
+    }
+#endif
+    for (; i < d; i++) {
+        int32_t ci = c[i];
+        accu += int32_t(w[i]) * ci;
+        if (NORM == U8Norm::plain) {
+            accu_n += ci * ci;
+        } else if (NORM == U8Norm::weighted) {
+            int32_t z = (ci * 128 * u[i] + (1 << 14)) >> 15;
+            accu_wn += float(z * z);
+        }
+    }
+    if (NORM == U8Norm::plain) {
+        *norm2 = accu_n;
+    } else if (NORM == U8Norm::weighted) {
+        *norm2 = accu_wn;
+    }
+    return accu;
+}
+
+template <class W>
+int32_t u8_inner_product_dispatch(
+        const W* w,
+        const int16_t* u,
+        const uint8_t* c,
+        size_t d,
+        float* norm2) {
+    if (!norm2) {
+        return u8_inner_product_norm<W, U8Norm::none>(w, u, c, d, norm2);
+    } else if (!u) {
+        return u8_inner_product_norm<W, U8Norm::plain>(w, u, c, d, norm2);
+    } else {
+        return u8_inner_product_norm<W, U8Norm::weighted>(w, u, c, d, norm2);
+    }
+}
+
+} // namespace
+
+int32_t u8_inner_product_w8(
+        const int8_t* w,
+        const uint8_t* c,
+        size_t d,
+        float* norm2,
+        const int16_t* u) {
+    return u8_inner_product_dispatch(w, u, c, d, norm2);
+}
+
+int32_t u8_inner_product_w16(
+        const int16_t* w,
+        const uint8_t* c,
+        size_t d,
+        float* norm2,
+        const int16_t* u) {
+    return u8_inner_product_dispatch(w, u, c, d, norm2);
+}
+
+} // namespace faiss
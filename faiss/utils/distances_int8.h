@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/* Integer-domain distances between float queries and int8 vectors stored
+ * as codes c = y + 128 in [0, 255] (the ScalarQuantizer
+ * QT_8bit_direct_signed format).
+ *
+ * The query is quantized once to int8: x ~= scale * q. If the query
+ * components are integers in [-128, 127], scale = 1 and all distances are
+ * exact. The dot products <q, y> are accumulated exactly in int32:
+ *
+ * - with AVX512-VNNI, vpdpbusd multiplies the unsigned codes with the
+ *   signed query, the offset is removed with 128 * sum(q);
+ * - with AVX2 and AVX512BW, the codes and the query are widened to int16
+ *   and multiplied with vpmaddwd. vpmaddubsw would saturate on codes up to
+ *   255, so it is not used.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <faiss/MetricType.h>
+
+namespace faiss {
+
+struct IDSelector;
+
+/// a float query quantized to int8
+struct Int8Query {
+    size_t d;
+
+    /// quantized query, padded with 0s to a multiple of 64 components
+    std::vector<int8_t> q;
+    /// same, widened to int16
+    std::vector<int16_t> q16;
+
+    float scale = 1;     ///< the query is approximated by scale * q
+    bool exact = true;   ///< scale == 1 and q is exactly the query
+    int32_t q_sum = 0;   ///< sum of the components of q
+    int64_t q_norm2 = 0; ///< squared L2 norm of q
+    float x_norm2 = 0;   ///< squared L2 norm of the (float) query
+
+    explicit Int8Query(size_t d);
+
+    ~Int8Query();
+
+    void set_query(const float* x);
+
+    /// <q, y> where code = y + 128
+    int32_t inner_product(const uint8_t* code) const;
+
+    /// <q, y>, and ||y||^2 in norm2
+    int32_t inner_product_and_norm(const uint8_t* code, int32_t* norm2) const;
+
+    /// distance given <q, y> and ||y||^2 (unused for the inner product)
+    float to_distance(int32_t ip, int32_t norm2, MetricType metric) const {
+        if (metric == METRIC_INNER_PRODUCT) {
+            return scale * ip;
+        }
+        if (exact) {
+            return float(q_norm2 + norm2 - 2 * int64_t(ip));
+        }
+        float dis = x_norm2 + norm2 - 2 * scale * ip;
+        return dis < 0 ? 0 : dis;
+    }
+
+    /** distance between the query and the vector y. Not inline, so that
+     * the float computation of to_distance is the same as in knn_int8
+     * whatever the compilation flags of the caller. */
+    float distance(const uint8_t* code, MetricType metric) const;
+};
+
+/** Computes the dot products of 4 queries with the same code, which is
+ * loaded once.
+ *
+ * @param ip     output dot products, size 4
+ * @param norm2  if not nullptr, output squared norm of the code
+ */
+void int8_inner_products_4(
+        const Int8Query* const* qs,
+        const uint8_t* code,
+        int32_t* ip,
+        int32_t* norm2);
+
+/** Return the k nearest neighbors of each of the nx float vectors x among
+ * the ny int8 vectors stored as codes (size ny * d). The queries are
+ * processed by groups of 4, and the codes by blocks that fit in the L2
+ * cache.
+ */
+void knn_int8(
+        const float* x,
+        const uint8_t* codes,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        MetricType metric,
+        size_t k,
+        float* distances,
+        int64_t* labels,
+        const IDSelector* sel = nullptr);
+
+/*********************************************************
+ * Kernels on unsigned 8-bit codes c in [0, 255] (the QT_8bit and
+ * QT_8bit_uniform scalar quantizer codes), where the query has been
+ * folded into integer weights w.
+ *********************************************************/
+
+/** sum_i w[i] * c[i], with |w[i]| <= 63 so that vpmaddubsw does not
+ * saturate.
+ *
+ * @param norm2  if not nullptr, output squared norm of the code, computed
+ *               in the same pass: sum_i c[i]^2 if u is nullptr, otherwise
+ *               sum_i z[i]^2 with z[i] = round(c[i] * u[i] / 256)
+ * @param u      per-dimension weights of the norm, in [0, 32767]
+ */
+int32_t u8_inner_product_w8(
+        const int8_t* w,
+        const uint8_t* c,
+        size_t d,
+        float* norm2 = nullptr,
+        const int16_t* u = nullptr);
+
+/// same, with 255 * d * |w[i]| < 2^31
+int32_t u8_inner_product_w16(
+        const int16_t* w,
+        const uint8_t* c,
+        size_t d,
+        float* norm2 = nullptr,
+        const int16_t* u = nullptr);
+
+} // namespace faiss
@@ -17,6 +17,7 @@
 
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/simd_impl/distances_simd_levels.h>
 #include <faiss/utils/simdlib.h>
 
 #ifdef __SSE3__
@@ -62,6 +63,8 @@ namespace faiss {
 
 */
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 /*********************************************************
  * Reference implementations
  */
@@ -188,83 +191,47 @@ void fvec_inner_products_ny_ref(
 }
 
 /*********************************************************
- * Autovectorized implementations
+ * Autovectorized implementations, compiled per SIMD level in
+ * simd_impl/distances_autovec.cpp
  */
 
-FAISS_PRAGMA_IMPRECISE_FUNCTION_BEGIN
 float fvec_inner_product(const float* x, const float* y, size_t d) {
-    float res = 0.F;
-    FAISS_PRAGMA_IMPRECISE_LOOP
-    for (size_t i = 0; i != d; ++i) {
-        res += x[i] * y[i];
-    }
-    return res;
+    DISPATCH_SIMDLevel(fvec_inner_product, x, y, d);
 }
-FAISS_PRAGMA_IMPRECISE_FUNCTION_END
 
-FAISS_PRAGMA_IMPRECISE_FUNCTION_BEGIN
 float fvec_norm_L2sqr(const float* x, size_t d) {
-    // the double in the _ref is suspected to be a typo. Some of the manual
-    // implementations this replaces used float.
-    float res = 0;
-    FAISS_PRAGMA_IMPRECISE_LOOP
-    for (size_t i = 0; i != d; ++i) {
-        res += x[i] * x[i];
-    }
-
-    return res;
+    DISPATCH_SIMDLevel(fvec_norm_L2sqr, x, d);
 }
-FAISS_PRAGMA_IMPRECISE_FUNCTION_END
 
-FAISS_PRAGMA_IMPRECISE_FUNCTION_BEGIN
 float fvec_L2sqr(const float* x, const float* y, size_t d) {
-    size_t i;
-    float res = 0;
-    FAISS_PRAGMA_IMPRECISE_LOOP
-    for (i = 0; i < d; i++) {
-        const float tmp = x[i] - y[i];
-        res += tmp * tmp;
-    }
-    return res;
+    DISPATCH_SIMDLevel(fvec_L2sqr, x, y, d);
 }
-FAISS_PRAGMA_IMPRECISE_FUNCTION_END
 
-/// Special version of inner product that computes 4 distances
-/// between x and yi
-FAISS_PRAGMA_IMPRECISE_FUNCTION_BEGIN
 void fvec_inner_product_batch_4(
-        const float* __restrict x,
-        const float* __restrict y0,
-        const float* __restrict y1,
-        const float* __restrict y2,
-        const float* __restrict y3,
+        const float* x,
+        const float* y0,
+        const float* y1,
+        const float* y2,
+        const float* y3,
         const size_t d,
         float& dis0,
         float& dis1,
         float& dis2,
         float& dis3) {
-    float d0 = 0;
-    float d1 = 0;
-    float d2 = 0;
-    float d3 = 0;
-    FAISS_PRAGMA_IMPRECISE_LOOP
-    for (size_t i = 0; i < d; ++i) {
-        d0 += x[i] * y0[i];
-        d1 += x[i] * y1[i];
-        d2 += x[i] * y2[i];
-        d3 += x[i] * y3[i];
-    }
-
-    dis0 = d0;
-    dis1 = d1;
-    dis2 = d2;
-    dis3 = d3;
-}
-FAISS_PRAGMA_IMPRECISE_FUNCTION_END
-
-/// Special version of L2sqr that computes 4 distances
-/// between x and yi, which is performance oriented.
-FAISS_PRAGMA_IMPRECISE_FUNCTION_BEGIN
+    DISPATCH_SIMDLevel(
+            fvec_inner_product_batch_4,
+            x,
+            y0,
+            y1,
+            y2,
+            y3,
+            d,
+            dis0,
+            dis1,
+            dis2,
+            dis3);
+}
+
 void fvec_L2sqr_batch_4(
         const float* x,
         const float* y0,
@@ -276,28 +243,11 @@ void fvec_L2sqr_batch_4(
         float& dis1,
         float& dis2,
         float& dis3) {
-    float d0 = 0;
-    float d1 = 0;
-    float d2 = 0;
-    float d3 = 0;
-    FAISS_PRAGMA_IMPRECISE_LOOP
-    for (size_t i = 0; i < d; ++i) {
-        const float q0 = x[i] - y0[i];
-        const float q1 = x[i] - y1[i];
-        const float q2 = x[i] - y2[i];
-        const float q3 = x[i] - y3[i];
-        d0 += q0 * q0;
-        d1 += q1 * q1;
-        d2 += q2 * q2;
-        d3 += q3 * q3;
-    }
-
-    dis0 = d0;
-    dis1 = d1;
-    dis2 = d2;
-    dis3 = d3;
-}
-FAISS_PRAGMA_IMPRECISE_FUNCTION_END
+    DISPATCH_SIMDLevel(
+            fvec_L2sqr_batch_4, x, y0, y1, y2, y3, d, dis0, dis1, dis2, dis3);
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
 
 /*********************************************************
  * SSE and AVX implementations
@@ -1359,7 +1309,8 @@ void fvec_op_ny_D12(float* dis, const float* x, const float* y, size_t ny) {
 
 } // anonymous namespace
 
-void fvec_L2sqr_ny(
+template <>
+void fvec_L2sqr_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -1385,7 +1336,8 @@ void fvec_L2sqr_ny(
 #undef DISPATCH
 }
 
-void fvec_inner_products_ny(
+template <>
+void fvec_inner_products_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -1409,6 +1361,8 @@ void fvec_inner_products_ny(
 #undef DISPATCH
 }
 
+namespace {
+
 #if defined(__AVX512F__)
 
 template <size_t DIM>
@@ -1564,7 +1518,10 @@ void fvec_L2sqr_ny_y_transposed_D(
 
 #endif
 
-void fvec_L2sqr_ny_transposed(
+} // anonymous namespace
+
+template <>
+void fvec_L2sqr_ny_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -1596,6 +1553,8 @@ void fvec_L2sqr_ny_transposed(
 #endif
 }
 
+namespace {
+
 #if defined(__AVX512F__)
 
 size_t fvec_L2sqr_ny_nearest_D2(
@@ -2295,7 +2254,10 @@ size_t fvec_L2sqr_ny_nearest_D8(
 }
 #endif
 
-size_t fvec_L2sqr_ny_nearest(
+} // anonymous namespace
+
+template <>
+size_t fvec_L2sqr_ny_nearest<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -2316,6 +2278,8 @@ size_t fvec_L2sqr_ny_nearest(
 #undef DISPATCH
 }
 
+namespace {
+
 #if defined(__AVX512F__)
 
 template <size_t DIM>
@@ -2551,7 +2515,10 @@ size_t fvec_L2sqr_ny_nearest_y_transposed_D(
 
 #endif
 
-size_t fvec_L2sqr_ny_nearest_y_transposed(
+} // anonymous namespace
+
+template <>
+size_t fvec_L2sqr_ny_nearest_y_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -2587,7 +2554,8 @@ size_t fvec_L2sqr_ny_nearest_y_transposed(
 
 #ifdef USE_AVX
 
-float fvec_L1(const float* x, const float* y, size_t d) {
+template <>
+float fvec_L1<FAISS_THIS_SIMD_LEVEL>(const float* x, const float* y, size_t d) {
     __m256 msum1 = _mm256_setzero_ps();
     __m256 signmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffffUL));
 
@@ -2627,7 +2595,11 @@ float fvec_L1(const float* x, const float* y, size_t d) {
     return _mm_cvtss_f32(msum2);
 }
 
-float fvec_Linf(const float* x, const float* y, size_t d) {
+template <>
+float fvec_Linf<FAISS_THIS_SIMD_LEVEL>(
+        const float* x,
+        const float* y,
+        size_t d) {
     __m256 msum1 = _mm256_setzero_ps();
     __m256 signmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffffUL));
 
@@ -2669,11 +2641,16 @@ float fvec_Linf(const float* x, const float* y, size_t d) {
 
 #elif defined(__SSE3__) // But not AVX
 
-float fvec_L1(const float* x, const float* y, size_t d) {
+template <>
+float fvec_L1<FAISS_THIS_SIMD_LEVEL>(const float* x, const float* y, size_t d) {
     return fvec_L1_ref(x, y, d);
 }
 
-float fvec_Linf(const float* x, const float* y, size_t d) {
+template <>
+float fvec_Linf<FAISS_THIS_SIMD_LEVEL>(
+        const float* x,
+        const float* y,
+        size_t d) {
     return fvec_Linf_ref(x, y, d);
 }
 
@@ -3028,7 +3005,8 @@ void fvec_op_ny_sve_lanes4(
     }
 }
 
-void fvec_L2sqr_ny(
+template <>
+void fvec_L2sqr_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3037,7 +3015,8 @@ void fvec_L2sqr_ny(
     fvec_L2sqr_ny_ref(dis, x, y, d, ny);
 }
 
-void fvec_L2sqr_ny_transposed(
+template <>
+void fvec_L2sqr_ny_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3048,7 +3027,8 @@ void fvec_L2sqr_ny_transposed(
     return fvec_L2sqr_ny_y_transposed_ref(dis, x, y, y_sqlen, d, d_offset, ny);
 }
 
-size_t fvec_L2sqr_ny_nearest(
+template <>
+size_t fvec_L2sqr_ny_nearest<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -3057,7 +3037,8 @@ size_t fvec_L2sqr_ny_nearest(
     return fvec_L2sqr_ny_nearest_ref(distances_tmp_buffer, x, y, d, ny);
 }
 
-size_t fvec_L2sqr_ny_nearest_y_transposed(
+template <>
+size_t fvec_L2sqr_ny_nearest_y_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -3069,15 +3050,21 @@ size_t fvec_L2sqr_ny_nearest_y_transposed(
             distances_tmp_buffer, x, y, y_sqlen, d, d_offset, ny);
 }
 
-float fvec_L1(const float* x, const float* y, size_t d) {
+template <>
+float fvec_L1<FAISS_THIS_SIMD_LEVEL>(const float* x, const float* y, size_t d) {
     return fvec_L1_ref(x, y, d);
 }
 
-float fvec_Linf(const float* x, const float* y, size_t d) {
+template <>
+float fvec_Linf<FAISS_THIS_SIMD_LEVEL>(
+        const float* x,
+        const float* y,
+        size_t d) {
     return fvec_Linf_ref(x, y, d);
 }
 
-void fvec_inner_products_ny(
+template <>
+void fvec_inner_products_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3115,7 +3102,8 @@ void fvec_inner_products_ny(
 #elif defined(__aarch64__)
 
 // not optimized for ARM
-void fvec_L2sqr_ny(
+template <>
+void fvec_L2sqr_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3124,7 +3112,8 @@ void fvec_L2sqr_ny(
     fvec_L2sqr_ny_ref(dis, x, y, d, ny);
 }
 
-void fvec_L2sqr_ny_transposed(
+template <>
+void fvec_L2sqr_ny_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3135,7 +3124,8 @@ void fvec_L2sqr_ny_transposed(
     return fvec_L2sqr_ny_y_transposed_ref(dis, x, y, y_sqlen, d, d_offset, ny);
 }
 
-size_t fvec_L2sqr_ny_nearest(
+template <>
+size_t fvec_L2sqr_ny_nearest<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -3144,7 +3134,8 @@ size_t fvec_L2sqr_ny_nearest(
     return fvec_L2sqr_ny_nearest_ref(distances_tmp_buffer, x, y, d, ny);
 }
 
-size_t fvec_L2sqr_ny_nearest_y_transposed(
+template <>
+size_t fvec_L2sqr_ny_nearest_y_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -3156,15 +3147,21 @@ size_t fvec_L2sqr_ny_nearest_y_transposed(
             distances_tmp_buffer, x, y, y_sqlen, d, d_offset, ny);
 }
 
-float fvec_L1(const float* x, const float* y, size_t d) {
+template <>
+float fvec_L1<FAISS_THIS_SIMD_LEVEL>(const float* x, const float* y, size_t d) {
     return fvec_L1_ref(x, y, d);
 }
 
-float fvec_Linf(const float* x, const float* y, size_t d) {
+template <>
+float fvec_Linf<FAISS_THIS_SIMD_LEVEL>(
+        const float* x,
+        const float* y,
+        size_t d) {
     return fvec_Linf_ref(x, y, d);
 }
 
-void fvec_inner_products_ny(
+template <>
+void fvec_inner_products_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3176,15 +3173,21 @@ void fvec_inner_products_ny(
 #else
 // scalar implementation
 
-float fvec_L1(const float* x, const float* y, size_t d) {
+template <>
+float fvec_L1<FAISS_THIS_SIMD_LEVEL>(const float* x, const float* y, size_t d) {
     return fvec_L1_ref(x, y, d);
 }
 
-float fvec_Linf(const float* x, const float* y, size_t d) {
+template <>
+float fvec_Linf<FAISS_THIS_SIMD_LEVEL>(
+        const float* x,
+        const float* y,
+        size_t d) {
     return fvec_Linf_ref(x, y, d);
 }
 
-void fvec_L2sqr_ny(
+template <>
+void fvec_L2sqr_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3193,7 +3196,8 @@ void fvec_L2sqr_ny(
     fvec_L2sqr_ny_ref(dis, x, y, d, ny);
 }
 
-void fvec_L2sqr_ny_transposed(
+template <>
+void fvec_L2sqr_ny_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3204,7 +3208,8 @@ void fvec_L2sqr_ny_transposed(
     return fvec_L2sqr_ny_y_transposed_ref(dis, x, y, y_sqlen, d, d_offset, ny);
 }
 
-size_t fvec_L2sqr_ny_nearest(
+template <>
+size_t fvec_L2sqr_ny_nearest<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -3213,7 +3218,8 @@ size_t fvec_L2sqr_ny_nearest(
     return fvec_L2sqr_ny_nearest_ref(distances_tmp_buffer, x, y, d, ny);
 }
 
-size_t fvec_L2sqr_ny_nearest_y_transposed(
+template <>
+size_t fvec_L2sqr_ny_nearest_y_transposed<FAISS_THIS_SIMD_LEVEL>(
         float* distances_tmp_buffer,
         const float* x,
         const float* y,
@@ -3225,7 +3231,8 @@ size_t fvec_L2sqr_ny_nearest_y_transposed(
             distances_tmp_buffer, x, y, y_sqlen, d, d_offset, ny);
 }
 
-void fvec_inner_products_ny(
+template <>
+void fvec_inner_products_ny<FAISS_THIS_SIMD_LEVEL>(
         float* dis,
         const float* x,
         const float* y,
@@ -3360,7 +3367,13 @@ static inline void fvec_madd_avx2(
     }
 }
 
-void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c) {
+template <>
+void fvec_madd<FAISS_THIS_SIMD_LEVEL>(
+        size_t n,
+        const float* a,
+        float bf,
+        const float* b,
+        float* c) {
 #ifdef __AVX512F__
     fvec_madd_avx512(n, a, bf, b, c);
 #elif __AVX2__
@@ -3375,7 +3388,8 @@ void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c) {
 
 #elif defined(__ARM_FEATURE_SVE)
 
-void fvec_madd(
+template <>
+void fvec_madd<FAISS_THIS_SIMD_LEVEL>(
         const size_t n,
         const float* __restrict a,
         const float bf,
@@ -3429,7 +3443,13 @@ void fvec_madd(
 
 #elif defined(__aarch64__)
 
-void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c) {
+template <>
+void fvec_madd<FAISS_THIS_SIMD_LEVEL>(
+        size_t n,
+        const float* a,
+        float bf,
+        const float* b,
+        float* c) {
     const size_t n_simd = n - (n & 3);
     const float32x4_t bfv = vdupq_n_f32(bf);
     size_t i;
@@ -3445,7 +3465,13 @@ void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c) {
 
 #else
 
-void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c) {
+template <>
+void fvec_madd<FAISS_THIS_SIMD_LEVEL>(
+        size_t n,
+        const float* a,
+        float bf,
+        const float* b,
+        float* c) {
     fvec_madd_ref(n, a, bf, b, c);
 }
 
@@ -3524,7 +3550,8 @@ static inline int fvec_madd_and_argmin_sse(
     return _mm_cvtsi128_si32(imin4);
 }
 
-int fvec_madd_and_argmin(
+template <>
+int fvec_madd_and_argmin<FAISS_THIS_SIMD_LEVEL>(
         size_t n,
         const float* a,
         float bf,
@@ -3538,7 +3565,8 @@ int fvec_madd_and_argmin(
 
 #elif defined(__aarch64__)
 
-int fvec_madd_and_argmin(
+template <>
+int fvec_madd_and_argmin<FAISS_THIS_SIMD_LEVEL>(
         size_t n,
         const float* a,
         float bf,
@@ -3589,7 +3617,8 @@ int fvec_madd_and_argmin(
 
 #else
 
-int fvec_madd_and_argmin(
+template <>
+int fvec_madd_and_argmin<FAISS_THIS_SIMD_LEVEL>(
         size_t n,
         const float* a,
         float bf,
@@ -3666,7 +3695,8 @@ simd8float32 load_simd8float32_partial(const float* x, int n) {
 
 } // anonymous namespace
 
-void compute_PQ_dis_tables_dsub2(
+template <>
+void compute_PQ_dis_tables_dsub2<FAISS_THIS_SIMD_LEVEL>(
         size_t d,
         size_t ksub,
         const float* all_centroids,
@@ -3725,7 +3755,12 @@ void compute_PQ_dis_tables_dsub2(
  * Vector to vector functions
  *********************************************************/
 
-void fvec_sub(size_t d, const float* a, const float* b, float* c) {
+template <>
+void fvec_sub<FAISS_THIS_SIMD_LEVEL>(
+        size_t d,
+        const float* a,
+        const float* b,
+        float* c) {
     size_t i;
     for (i = 0; i + 7 < d; i += 8) {
         simd8float32 ci, ai, bi;
@@ -3740,7 +3775,12 @@ void fvec_sub(size_t d, const float* a, const float* b, float* c) {
     }
 }
 
-void fvec_add(size_t d, const float* a, const float* b, float* c) {
+template <>
+void fvec_add<FAISS_THIS_SIMD_LEVEL>(
+        size_t d,
+        const float* a,
+        const float* b,
+        float* c) {
     size_t i;
     for (i = 0; i + 7 < d; i += 8) {
         simd8float32 ci, ai, bi;
@@ -3755,7 +3795,12 @@ void fvec_add(size_t d, const float* a, const float* b, float* c) {
     }
 }
 
-void fvec_add(size_t d, const float* a, float b, float* c) {
+template <>
+void fvec_add<FAISS_THIS_SIMD_LEVEL>(
+        size_t d,
+        const float* a,
+        float b,
+        float* c) {
     size_t i;
     simd8float32 bv(b);
     for (i = 0; i + 7 < d; i += 8) {
@@ -3770,4 +3815,124 @@ void fvec_add(size_t d, const float* a, float b, float* c) {
     }
 }
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
+/*********************************************************
+ * Hand-written implementations: the code above is compiled once per SIMD
+ * level, these functions dispatch to the specializations
+ */
+
+void fvec_L2sqr_ny(
+        float* dis,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny) {
+    DISPATCH_SIMDLevel(fvec_L2sqr_ny, dis, x, y, d, ny);
+}
+
+void fvec_inner_products_ny(
+        float* ip,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny) {
+    DISPATCH_SIMDLevel(fvec_inner_products_ny, ip, x, y, d, ny);
+}
+
+void fvec_L2sqr_ny_transposed(
+        float* dis,
+        const float* x,
+        const float* y,
+        const float* y_sqlen,
+        size_t d,
+        size_t d_offset,
+        size_t ny) {
+    DISPATCH_SIMDLevel(
+            fvec_L2sqr_ny_transposed, dis, x, y, y_sqlen, d, d_offset, ny);
+}
+
+size_t fvec_L2sqr_ny_nearest(
+        float* distances_tmp_buffer,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny) {
+    DISPATCH_SIMDLevel(
+            fvec_L2sqr_ny_nearest, distances_tmp_buffer, x, y, d, ny);
+}
+
+size_t fvec_L2sqr_ny_nearest_y_transposed(
+        float* distances_tmp_buffer,
+        const float* x,
+        const float* y,
+        const float* y_sqlen,
+        size_t d,
+        size_t d_offset,
+        size_t ny) {
+    DISPATCH_SIMDLevel(
+            fvec_L2sqr_ny_nearest_y_transposed,
+            distances_tmp_buffer,
+            x,
+            y,
+            y_sqlen,
+            d,
+            d_offset,
+            ny);
+}
+
+float fvec_L1(const float* x, const float* y, size_t d) {
+    DISPATCH_SIMDLevel(fvec_L1, x, y, d);
+}
+
+float fvec_Linf(const float* x, const float* y, size_t d) {
+    DISPATCH_SIMDLevel(fvec_Linf, x, y, d);
+}
+
+void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c) {
+    DISPATCH_SIMDLevel(fvec_madd, n, a, bf, b, c);
+}
+
+int fvec_madd_and_argmin(
+        size_t n,
+        const float* a,
+        float bf,
+        const float* b,
+        float* c) {
+    DISPATCH_SIMDLevel(fvec_madd_and_argmin, n, a, bf, b, c);
+}
+
+void compute_PQ_dis_tables_dsub2(
+        size_t d,
+        size_t ksub,
+        const float* all_centroids,
+        size_t nx,
+        const float* x,
+        bool is_inner_product,
+        float* dis_tables) {
+    DISPATCH_SIMDLevel(
+            compute_PQ_dis_tables_dsub2,
+            d,
+            ksub,
+            all_centroids,
+            nx,
+            x,
+            is_inner_product,
+            dis_tables);
+}
+
+void fvec_sub(size_t d, const float* a, const float* b, float* c) {
+    DISPATCH_SIMDLevel(fvec_sub, d, a, b, c);
+}
+
+void fvec_add(size_t d, const float* a, const float* b, float* c) {
+    DISPATCH_SIMDLevel(fvec_add, d, a, b, c);
+}
+
+void fvec_add(size_t d, const float* a, float b, float* c) {
+    DISPATCH_SIMDLevel(fvec_add, d, a, b, c);
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
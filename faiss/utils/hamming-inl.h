@@ -64,6 +64,8 @@ inline uint64_t BitstringReader::read(int nbit) {
     }
 }
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /** This class maintains a list of best distances seen so far.
  *
  * Since the distances are in a limited range (0 to nbit), the
@@ -116,4 +118,6 @@ struct HCounterState {
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
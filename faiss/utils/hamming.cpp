@@ -37,7 +37,15 @@
 
 namespace faiss {
 
+#ifndef FAISS_SIMD_LEVEL_TU
 size_t hamming_batch_size = 65536;
+#endif // FAISS_SIMD_LEVEL_TU
+
+/* This file is compiled once per SIMD level, see utils/simd_levels.h: the
+ * kernels are in the anonymous namespace and the public functions dispatch
+ * to their specialization for the current level. */
+
+namespace {
 
 template <size_t nbits>
 void hammings(
@@ -160,8 +168,6 @@ size_t match_hamming_thres(
     return posm;
 }
 
-namespace {
-
 /* Return closest neighbors w.r.t Hamming distance, using a heap. */
 template <class HammingComputer>
 void hammings_knn_hc(
@@ -241,13 +247,15 @@ void hammings_knn_mc(
         int32_t* __restrict distances,
         int64_t* __restrict labels) {
     const int nBuckets = bytes_per_code * 8 + 1;
-    std::vector<int> all_counters(na * nBuckets, 0);
+    // not a std::vector<int>, whose instantiations would be shared with the
+    // generic objects, see FAISS_SIMD_NAMESPACE_BEGIN
+    std::unique_ptr<int[]> all_counters(new int[na * nBuckets]());
     std::unique_ptr<int64_t[]> all_ids_per_dis(new int64_t[na * nBuckets * k]);
 
     std::vector<HCounterState<HammingComputer>> cs;
     for (size_t i = 0; i < na; ++i) {
         cs.push_back(HCounterState<HammingComputer>(
-                all_counters.data() + i * nBuckets,
+                all_counters.get() + i * nBuckets,
                 all_ids_per_dis.get() + i * nBuckets * k,
                 a + i * bytes_per_code,
                 8 * bytes_per_code,
@@ -341,6 +349,8 @@ struct Run_hamming_range_search {
 
 } // namespace
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 /* Functions to maps vectors to bits. Assume proper allocation done beforehand,
    meaning that b should be be able to receive as many bits as x may produce. */
 
@@ -440,13 +450,96 @@ void bitvec_shuffle(
     }
 }
 
+#endif // FAISS_SIMD_LEVEL_TU
+
 /*----------------------------------------*/
 /* Hamming distance computation and k-nn  */
 
+// specializations for each SIMD level of the public functions
+
+template <SIMDLevel>
+void hammings(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        size_t ncodes,
+        hamdis_t* dis);
+
+template <SIMDLevel>
+void hammings_knn_hc(
+        int_maxheap_array_t* ha,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t nb,
+        size_t ncodes,
+        int order,
+        ApproxTopK_mode_t approx_topk_mode);
+
+template <SIMDLevel>
+void hammings_knn_mc(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        size_t k,
+        size_t ncodes,
+        int32_t* distances,
+        int64_t* labels);
+
+template <SIMDLevel>
+void hamming_range_search(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        int radius,
+        size_t code_size,
+        RangeSearchResult* result);
+
+template <SIMDLevel>
+void hamming_count_thres(
+        const uint8_t* bs1,
+        const uint8_t* bs2,
+        size_t n1,
+        size_t n2,
+        hamdis_t ht,
+        size_t ncodes,
+        size_t* nptr);
+
+template <SIMDLevel>
+void crosshamming_count_thres(
+        const uint8_t* dbs,
+        size_t n,
+        hamdis_t ht,
+        size_t ncodes,
+        size_t* nptr);
+
+template <SIMDLevel>
+size_t match_hamming_thres(
+        const uint8_t* bs1,
+        const uint8_t* bs2,
+        size_t n1,
+        size_t n2,
+        hamdis_t ht,
+        size_t ncodes,
+        int64_t* idx,
+        hamdis_t* dis);
+
+template <SIMDLevel>
+void generalized_hammings_knn_hc(
+        int_maxheap_array_t* ha,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t nb,
+        size_t code_size,
+        int ordered);
+
 #define C64(x) ((uint64_t*)x)
 
 /* Compute a set of Hamming distances */
-void hammings(
+template <>
+void hammings<FAISS_THIS_SIMD_LEVEL>(
         const uint8_t* __restrict a,
         const uint8_t* __restrict b,
         size_t na,
@@ -456,34 +549,25 @@ void hammings(
     FAISS_THROW_IF_NOT(ncodes % 8 == 0);
     switch (ncodes) {
         case 8:
-            faiss::hammings<64>(C64(a), C64(b), na, nb, dis);
+            hammings<64>(C64(a), C64(b), na, nb, dis);
             return;
         case 16:
-            faiss::hammings<128>(C64(a), C64(b), na, nb, dis);
+            hammings<128>(C64(a), C64(b), na, nb, dis);
             return;
         case 32:
-            faiss::hammings<256>(C64(a), C64(b), na, nb, dis);
+            hammings<256>(C64(a), C64(b), na, nb, dis);
             return;
         case 64:
-            faiss::hammings<512>(C64(a), C64(b), na, nb, dis);
+            hammings<512>(C64(a), C64(b), na, nb, dis);
             return;
         default:
-            faiss::hammings(C64(a), C64(b), na, nb, ncodes * 8, dis);
+            hammings(C64(a), C64(b), na, nb, ncodes * 8, dis);
             return;
     }
 }
 
-void hammings_knn(
-        int_maxheap_array_t* __restrict ha,
-        const uint8_t* __restrict a,
-        const uint8_t* __restrict b,
-        size_t nb,
-        size_t ncodes,
-        int order) {
-    hammings_knn_hc(ha, a, b, nb, ncodes, order);
-}
-
-void hammings_knn_hc(
+template <>
+void hammings_knn_hc<FAISS_THIS_SIMD_LEVEL>(
         int_maxheap_array_t* __restrict ha,
         const uint8_t* __restrict a,
         const uint8_t* __restrict b,
@@ -496,7 +580,8 @@ void hammings_knn_hc(
             ncodes, r, ncodes, ha, a, b, nb, order, true, approx_topk_mode);
 }
 
-void hammings_knn_mc(
+template <>
+void hammings_knn_mc<FAISS_THIS_SIMD_LEVEL>(
         const uint8_t* __restrict a,
         const uint8_t* __restrict b,
         size_t na,
@@ -510,7 +595,8 @@ void hammings_knn_mc(
             ncodes, r, ncodes, a, b, na, nb, k, distances, labels);
 }
 
-void hamming_range_search(
+template <>
+void hamming_range_search<FAISS_THIS_SIMD_LEVEL>(
         const uint8_t* a,
         const uint8_t* b,
         size_t na,
@@ -524,7 +610,8 @@ void hamming_range_search(
 }
 
 /* Count number of matches given a max threshold            */
-void hamming_count_thres(
+template <>
+void hamming_count_thres<FAISS_THIS_SIMD_LEVEL>(
         const uint8_t* bs1,
         const uint8_t* bs2,
         size_t n1,
@@ -534,19 +621,19 @@ void hamming_count_thres(
         size_t* nptr) {
     switch (ncodes) {
         case 8:
-            faiss::hamming_count_thres<64>(
+            hamming_count_thres<64>(
                     C64(bs1), C64(bs2), n1, n2, ht, nptr);
             return;
         case 16:
-            faiss::hamming_count_thres<128>(
+            hamming_count_thres<128>(
                     C64(bs1), C64(bs2), n1, n2, ht, nptr);
             return;
         case 32:
-            faiss::hamming_count_thres<256>(
+            hamming_count_thres<256>(
                     C64(bs1), C64(bs2), n1, n2, ht, nptr);
             return;
         case 64:
-            faiss::hamming_count_thres<512>(
+            hamming_count_thres<512>(
                     C64(bs1), C64(bs2), n1, n2, ht, nptr);
             return;
         default:
@@ -555,7 +642,8 @@ void hamming_count_thres(
 }
 
 /* Count number of cross-matches given a threshold */
-void crosshamming_count_thres(
+template <>
+void crosshamming_count_thres<FAISS_THIS_SIMD_LEVEL>(
         const uint8_t* dbs,
         size_t n,
         hamdis_t ht,
@@ -563,16 +651,16 @@ void crosshamming_count_thres(
         size_t* nptr) {
     switch (ncodes) {
         case 8:
-            faiss::crosshamming_count_thres<64>(C64(dbs), n, ht, nptr);
+            crosshamming_count_thres<64>(C64(dbs), n, ht, nptr);
             return;
         case 16:
-            faiss::crosshamming_count_thres<128>(C64(dbs), n, ht, nptr);
+            crosshamming_count_thres<128>(C64(dbs), n, ht, nptr);
             return;
         case 32:
-            faiss::crosshamming_count_thres<256>(C64(dbs), n, ht, nptr);
+            crosshamming_count_thres<256>(C64(dbs), n, ht, nptr);
             return;
         case 64:
-            faiss::crosshamming_count_thres<512>(C64(dbs), n, ht, nptr);
+            crosshamming_count_thres<512>(C64(dbs), n, ht, nptr);
             return;
         default:
             FAISS_THROW_FMT("not implemented for %zu bits", ncodes);
@@ -580,7 +668,8 @@ void crosshamming_count_thres(
 }
 
 /* Returns all matches given a threshold */
-size_t match_hamming_thres(
+template <>
+size_t match_hamming_thres<FAISS_THIS_SIMD_LEVEL>(
         const uint8_t* bs1,
         const uint8_t* bs2,
         size_t n1,
@@ -591,16 +680,16 @@ size_t match_hamming_thres(
         hamdis_t* dis) {
     switch (ncodes) {
         case 8:
-            return faiss::match_hamming_thres<64>(
+            return match_hamming_thres<64>(
                     C64(bs1), C64(bs2), n1, n2, ht, idx, dis);
         case 16:
-            return faiss::match_hamming_thres<128>(
+            return match_hamming_thres<128>(
                     C64(bs1), C64(bs2), n1, n2, ht, idx, dis);
         case 32:
-            return faiss::match_hamming_thres<256>(
+            return match_hamming_thres<256>(
                     C64(bs1), C64(bs2), n1, n2, ht, idx, dis);
         case 64:
-            return faiss::match_hamming_thres<512>(
+            return match_hamming_thres<512>(
                     C64(bs1), C64(bs2), n1, n2, ht, idx, dis);
         default:
             FAISS_THROW_FMT("not implemented for %zu bits", ncodes);
@@ -634,7 +723,8 @@ static void hamming_dis_inner_loop(
     }
 }
 
-void generalized_hammings_knn_hc(
+template <>
+void generalized_hammings_knn_hc<FAISS_THIS_SIMD_LEVEL>(
         int_maxheap_array_t* __restrict ha,
         const uint8_t* __restrict a,
         const uint8_t* __restrict b,
@@ -679,6 +769,8 @@ void generalized_hammings_knn_hc(
         ha->reorder();
 }
 
+#ifndef FAISS_SIMD_LEVEL_TU
+
 void pack_bitstrings(
         size_t n,
         size_t M,
@@ -763,4 +855,111 @@ void unpack_bitstrings(
     }
 }
 
+/*************************************
+ * dispatch to the SIMD levels
+ ************************************/
+
+void hammings(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        size_t ncodes,
+        hamdis_t* dis) {
+    DISPATCH_SIMDLevel(hammings, a, b, na, nb, ncodes, dis);
+}
+
+void hammings_knn(
+        int_maxheap_array_t* __restrict ha,
+        const uint8_t* __restrict a,
+        const uint8_t* __restrict b,
+        size_t nb,
+        size_t ncodes,
+        int order) {
+    hammings_knn_hc(ha, a, b, nb, ncodes, order);
+}
+
+void hammings_knn_hc(
+        int_maxheap_array_t* ha,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t nb,
+        size_t ncodes,
+        int order,
+        ApproxTopK_mode_t approx_topk_mode) {
+    DISPATCH_SIMDLevel(
+            hammings_knn_hc, ha, a, b, nb, ncodes, order, approx_topk_mode);
+}
+
+void hammings_knn_mc(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        size_t k,
+        size_t ncodes,
+        int32_t* distances,
+        int64_t* labels) {
+    DISPATCH_SIMDLevel(
+            hammings_knn_mc, a, b, na, nb, k, ncodes, distances, labels);
+}
+
+void hamming_range_search(
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t na,
+        size_t nb,
+        int radius,
+        size_t code_size,
+        RangeSearchResult* result) {
+    DISPATCH_SIMDLevel(
+            hamming_range_search, a, b, na, nb, radius, code_size, result);
+}
+
+void hamming_count_thres(
+        const uint8_t* bs1,
+        const uint8_t* bs2,
+        size_t n1,
+        size_t n2,
+        hamdis_t ht,
+        size_t ncodes,
+        size_t* nptr) {
+    DISPATCH_SIMDLevel(hamming_count_thres, bs1, bs2, n1, n2, ht, ncodes, nptr);
+}
+
+void crosshamming_count_thres(
+        const uint8_t* dbs,
+        size_t n,
+        hamdis_t ht,
+        size_t ncodes,
+        size_t* nptr) {
+    DISPATCH_SIMDLevel(crosshamming_count_thres, dbs, n, ht, ncodes, nptr);
+}
+
+size_t match_hamming_thres(
+        const uint8_t* bs1,
+        const uint8_t* bs2,
+        size_t n1,
+        size_t n2,
+        hamdis_t ht,
+        size_t ncodes,
+        int64_t* idx,
+        hamdis_t* dis) {
+    DISPATCH_SIMDLevel(
+            match_hamming_thres, bs1, bs2, n1, n2, ht, ncodes, idx, dis);
+}
+
+void generalized_hammings_knn_hc(
+        int_maxheap_array_t* ha,
+        const uint8_t* a,
+        const uint8_t* b,
+        size_t nb,
+        size_t code_size,
+        int ordered) {
+    DISPATCH_SIMDLevel(
+            generalized_hammings_knn_hc, ha, a, b, nb, code_size, ordered);
+}
+
+#endif // FAISS_SIMD_LEVEL_TU
+
 } // namespace faiss
@@ -209,8 +209,10 @@ void crosshamming_count_thres(
         size_t ncodes,
         size_t* nptr);
 
+FAISS_SIMD_NAMESPACE_BEGIN
 /* compute the Hamming distances between two codewords of nwords*64 bits */
 hamdis_t hamming(const uint64_t* bs1, const uint64_t* bs2, size_t nwords);
+FAISS_SIMD_NAMESPACE_END
 
 /** generalized Hamming distances (= count number of code bytes that
     are the same) */
@@ -15,11 +15,14 @@
 #include <cstdint>
 
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/hamming_distance/common.h>
 
 #include <immintrin.h>
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /* Elementary Hamming distance computation: unoptimized  */
 template <size_t nbits, typename T>
 inline T hamming(const uint8_t* bs1, const uint8_t* bs2) {
@@ -457,6 +460,8 @@ struct GenHammingComputerM8 {
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
@@ -11,12 +11,17 @@
 #include <cstdint>
 
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/simd_levels.h>
 
 /* The Hamming distance type */
 using hamdis_t = int32_t;
 
 namespace faiss {
 
+// Compiled for each SIMD level by utils/hamming.cpp, see
+// FAISS_SIMD_NAMESPACE_BEGIN.
+FAISS_SIMD_NAMESPACE_BEGIN
+
 // trust the compiler to provide efficient popcount implementations
 inline int popcount32(uint32_t x) {
     return __builtin_popcount(x);
@@ -44,6 +49,8 @@ static constexpr uint8_t hamdis_tab_ham_bytes[256] = {
         4, 5, 5, 6, 5, 6, 6, 7, 3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
         4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8};
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
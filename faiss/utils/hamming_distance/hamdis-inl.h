@@ -25,6 +25,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /***************************************************************************
  * Equivalence with a template class when code size is known at compile time
  **************************************************************************/
@@ -79,6 +81,8 @@ typename Consumer::T dispatch_HammingComputer(
 #undef DISPATCH_HC
 }
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
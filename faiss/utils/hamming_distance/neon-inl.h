@@ -25,6 +25,8 @@
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /* Elementary Hamming distance computation: unoptimized  */
 template <size_t nbits, typename T>
 inline T hamming(const uint8_t* bs1, const uint8_t* bs2) {
@@ -517,6 +519,8 @@ struct GenHammingComputerM8 {
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
 
 #endif
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/* Per-SIMDLevel versions of the distance kernels, see utils/simd_levels.h.
+ * The auto-vectorized kernels are defined in distances_autovec.cpp and the
+ * hand-written ones in utils/distances_simd.cpp, both compiled once per
+ * level. Use the functions of utils/distances.h, which dispatch to them. */
+
+#pragma once
+
+#include <cstddef>
+
+#include <faiss/utils/simd_levels.h>
+
+namespace faiss {
+
+template <SIMDLevel>
+float fvec_inner_product(const float* x, const float* y, size_t d);
+
+template <SIMDLevel>
+float fvec_norm_L2sqr(const float* x, size_t d);
+
+template <SIMDLevel>
+float fvec_L2sqr(const float* x, const float* y, size_t d);
+
+template <SIMDLevel>
+void fvec_inner_product_batch_4(
+        const float* x,
+        const float* y0,
+        const float* y1,
+        const float* y2,
+        const float* y3,
+        const size_t d,
+        float& dis0,
+        float& dis1,
+        float& dis2,
+        float& dis3);
+
+template <SIMDLevel>
+void fvec_L2sqr_batch_4(
+        const float* x,
+        const float* y0,
+        const float* y1,
+        const float* y2,
+        const float* y3,
+        const size_t d,
+        float& dis0,
+        float& dis1,
+        float& dis2,
+        float& dis3);
+
+/*********************************************************
+ * Hand-written kernels
+ */
+
+template <SIMDLevel>
+void fvec_L2sqr_ny(
+        float* dis,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny);
+
+template <SIMDLevel>
+void fvec_inner_products_ny(
+        float* ip,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny);
+
+template <SIMDLevel>
+void fvec_L2sqr_ny_transposed(
+        float* dis,
+        const float* x,
+        const float* y,
+        const float* y_sqlen,
+        size_t d,
+        size_t d_offset,
+        size_t ny);
+
+template <SIMDLevel>
+size_t fvec_L2sqr_ny_nearest(
+        float* distances_tmp_buffer,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny);
+
+template <SIMDLevel>
+size_t fvec_L2sqr_ny_nearest_y_transposed(
+        float* distances_tmp_buffer,
+        const float* x,
+        const float* y,
+        const float* y_sqlen,
+        size_t d,
+        size_t d_offset,
+        size_t ny);
+
+template <SIMDLevel>
+float fvec_L1(const float* x, const float* y, size_t d);
+
+template <SIMDLevel>
+float fvec_Linf(const float* x, const float* y, size_t d);
+
+template <SIMDLevel>
+void fvec_madd(size_t n, const float* a, float bf, const float* b, float* c);
+
+template <SIMDLevel>
+int fvec_madd_and_argmin(
+        size_t n,
+        const float* a,
+        float bf,
+        const float* b,
+        float* c);
+
+template <SIMDLevel>
+void compute_PQ_dis_tables_dsub2(
+        size_t d,
+        size_t ksub,
+        const float* centroids,
+        size_t nx,
+        const float* x,
+        bool is_inner_product,
+        float* dis_tables);
+
+template <SIMDLevel>
+void fvec_sub(size_t d, const float* a, const float* b, float* c);
+
+template <SIMDLevel>
+void fvec_add(size_t d, const float* a, const float* b, float* c);
+
+template <SIMDLevel>
+void fvec_add(size_t d, const float* a, float b, float* c);
+
+/*********************************************************
+ * Reference implementations, the hand-written kernels fall back to them.
+ * They are compiled only in the generic object.
+ */
+
+float fvec_L1_ref(const float* x, const float* y, size_t d);
+
+float fvec_Linf_ref(const float* x, const float* y, size_t d);
+
+void fvec_L2sqr_ny_ref(
+        float* dis,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny);
+
+void fvec_L2sqr_ny_y_transposed_ref(
+        float* dis,
+        const float* x,
+        const float* y,
+        const float* y_sqlen,
+        size_t d,
+        size_t d_offset,
+        size_t ny);
+
+size_t fvec_L2sqr_ny_nearest_ref(
+        float* distances_tmp_buffer,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny);
+
+size_t fvec_L2sqr_ny_nearest_y_transposed_ref(
+        float* distances_tmp_buffer,
+        const float* x,
+        const float* y,
+        const float* y_sqlen,
+        size_t d,
+        size_t d_offset,
+        size_t ny);
+
+void fvec_inner_products_ny_ref(
+        float* ip,
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t ny);
+
+} // namespace faiss
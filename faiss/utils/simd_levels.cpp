@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/utils/simd_levels.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <faiss/impl/FaissAssert.h>
+
+namespace faiss {
+
+namespace {
+
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+
+bool cpu_supports(SIMDLevel level) {
+#if (defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    switch (level) {
+        case SIMDLevel::NONE:
+            return true;
+        case SIMDLevel::AVX2:
+            return __builtin_cpu_supports("avx2") &&
+                    __builtin_cpu_supports("fma");
+        case SIMDLevel::AVX512:
+            return __builtin_cpu_supports("avx2") &&
+                    __builtin_cpu_supports("fma") &&
+                    __builtin_cpu_supports("avx512f") &&
+                    __builtin_cpu_supports("avx512cd") &&
+                    __builtin_cpu_supports("avx512vl") &&
+                    __builtin_cpu_supports("avx512dq") &&
+                    __builtin_cpu_supports("avx512bw");
+    }
+    return false;
+#else
+    return level == SIMDLevel::NONE;
+#endif
+}
+
+#endif
+
+SIMDLevel initial_level() {
+    // this runs at load time, so errors are not fatal
+    const char* env = getenv("FAISS_SIMD_LEVEL");
+    if (env) {
+        for (SIMDLevel level :
+             {SIMDLevel::NONE, SIMDLevel::AVX2, SIMDLevel::AVX512}) {
+            if (SIMDConfig::level_name(level) == env &&
+                SIMDConfig::is_available(level)) {
+                return level;
+            }
+        }
+        fprintf(stderr,
+                "Faiss: FAISS_SIMD_LEVEL=%s is not available, ignored\n",
+                env);
+    }
+    return SIMDConfig::auto_detect();
+}
+
+} // namespace
+
+std::atomic<SIMDLevel> SIMDConfig::level{initial_level()};
+
+bool SIMDConfig::is_available(SIMDLevel level) {
+    switch (level) {
+        case SIMDLevel::NONE:
+            return true;
+        case SIMDLevel::AVX2:
+#ifdef COMPILE_SIMD_AVX2
+            return cpu_supports(level);
+#else
+            return false;
+#endif
+        case SIMDLevel::AVX512:
+#ifdef COMPILE_SIMD_AVX512
+            return cpu_supports(level);
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+SIMDLevel SIMDConfig::auto_detect() {
+    for (SIMDLevel level : {SIMDLevel::AVX512, SIMDLevel::AVX2}) {
+        if (is_available(level)) {
+            return level;
+        }
+    }
+    return SIMDLevel::NONE;
+}
+
+void SIMDConfig::set_level(SIMDLevel l) {
+    FAISS_THROW_IF_NOT_FMT(
+            is_available(l),
+            "SIMD level %s is not available",
+            level_name(l).c_str());
+    level.store(l);
+}
+
+SIMDLevel SIMDConfig::get_level() {
+    return level.load();
+}
+
+std::string SIMDConfig::level_name(SIMDLevel level) {
+    switch (level) {
+        case SIMDLevel::NONE:
+            return "NONE";
+        case SIMDLevel::AVX2:
+            return "AVX2";
+        case SIMDLevel::AVX512:
+            return "AVX512";
+    }
+    return "UNKNOWN";
+}
+
+SIMDLevel SIMDConfig::level_from_name(const std::string& name) {
+    for (SIMDLevel level :
+         {SIMDLevel::NONE, SIMDLevel::AVX2, SIMDLevel::AVX512}) {
+        if (name == level_name(level)) {
+            return level;
+        }
+    }
+    FAISS_THROW_FMT("unknown SIMD level %s", name.c_str());
+}
+
+} // namespace faiss
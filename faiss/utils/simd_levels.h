@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/* Runtime selection of the SIMD kernels.
+ *
+ * With FAISS_OPT_LEVEL=dd ("dynamic dispatch"), a single libfaiss is built
+ * for the generic target, and the hot kernels are compiled a second and
+ * third time for AVX2 and AVX512 (these objects are built with
+ * FAISS_SIMD_LEVEL_TU=AVX2 or AVX512 and COMPILE_SIMD_AVX2 /
+ * COMPILE_SIMD_AVX512 are defined for the whole library). The kernel
+ * entry points are templates on SIMDLevel, and the public functions
+ * forward to the specialization selected by SIMDConfig at runtime.
+ *
+ * In the other build modes, only SIMDLevel::NONE is compiled, with the
+ * flags of the library.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace faiss {
+
+enum class SIMDLevel {
+    NONE,   ///< the compilation flags of the library
+    AVX2,   ///< AVX2 + FMA + F16C
+    AVX512, ///< AVX512 F, CD, VL, DQ, BW
+};
+
+struct SIMDConfig {
+    /** level used by the dispatched kernels. Initialized with the best
+     * available level, or from the FAISS_SIMD_LEVEL environment variable
+     * (NONE, AVX2 or AVX512) if it is set. It may be changed with
+     * set_level while other threads search: each kernel call reads it
+     * once, so a search that runs concurrently may mix the two levels. */
+    static std::atomic<SIMDLevel> level;
+
+    /// is the level compiled in and supported by the CPU
+    static bool is_available(SIMDLevel level);
+
+    /// best available level
+    static SIMDLevel auto_detect();
+
+    /// throws if the level is not available
+    static void set_level(SIMDLevel level);
+
+    static SIMDLevel get_level();
+
+    static std::string level_name(SIMDLevel level);
+
+    /// parse a level name, throws if it is not valid
+    static SIMDLevel level_from_name(const std::string& name);
+};
+
+} // namespace faiss
+
+/* Level of the translation unit being compiled: the specializations it
+ * defines are for this level. */
+#ifdef FAISS_SIMD_LEVEL_TU
+#define FAISS_THIS_SIMD_LEVEL ::faiss::SIMDLevel::FAISS_SIMD_LEVEL_TU
+#else
+#define FAISS_THIS_SIMD_LEVEL ::faiss::SIMDLevel::NONE
+#endif
+
+/* The objects compiled for a level must not define any symbol that the
+ * generic objects may also define, otherwise the linker keeps either copy
+ * and the generic code may run instructions of the level. So the types of
+ * simdlib.h, the code that takes them as arguments (the fast-scan result
+ * handlers and scalers), the inline heap functions, the Hamming computers,
+ * the PQ decoders and the PQ code distances are enclosed in an inline
+ * namespace in these objects. The inline virtual functions that they would
+ * emit are defined out-of-line in the generic objects. The build checks the
+ * symbols of the per-level objects, see
+ * cmake/check_simd_level_symbols.cmake. */
+#ifdef FAISS_SIMD_LEVEL_TU
+#define FAISS_SIMD_NAMESPACE_CAT2(a, b) a##b
+#define FAISS_SIMD_NAMESPACE_CAT(a, b) FAISS_SIMD_NAMESPACE_CAT2(a, b)
+#define FAISS_SIMD_NAMESPACE_BEGIN \
+    inline namespace FAISS_SIMD_NAMESPACE_CAT(simd_, FAISS_SIMD_LEVEL_TU) {
+#define FAISS_SIMD_NAMESPACE_END }
+#else
+#define FAISS_SIMD_NAMESPACE_BEGIN
+#define FAISS_SIMD_NAMESPACE_END
+#endif
+
+#ifdef COMPILE_SIMD_AVX512
+#define FAISS_DISPATCH_CASE_AVX512(f, ...) \
+    case ::faiss::SIMDLevel::AVX512:       \
+        return f<::faiss::SIMDLevel::AVX512>(__VA_ARGS__);
+#else
+#define FAISS_DISPATCH_CASE_AVX512(f, ...)
+#endif
+
+#ifdef COMPILE_SIMD_AVX2
+#define FAISS_DISPATCH_CASE_AVX2(f, ...) \
+    case ::faiss::SIMDLevel::AVX2:       \
+        return f<::faiss::SIMDLevel::AVX2>(__VA_ARGS__);
+#else
+#define FAISS_DISPATCH_CASE_AVX2(f, ...)
+#endif
+
+/// return f<level>(args...) for the current SIMDConfig::level
+#define DISPATCH_SIMDLevel(f, ...)                                        \
+    switch (::faiss::SIMDConfig::level.load(std::memory_order_relaxed)) { \
+        FAISS_DISPATCH_CASE_AVX512(f, __VA_ARGS__)                        \
+        FAISS_DISPATCH_CASE_AVX2(f, __VA_ARGS__)                          \
+        default:                                                          \
+            return f<::faiss::SIMDLevel::NONE>(__VA_ARGS__);              \
+    }
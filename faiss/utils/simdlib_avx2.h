@@ -13,9 +13,12 @@
 #include <immintrin.h>
 
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/simd_levels.h>
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /** Simple wrapper around the AVX 256-bit registers
  *
  * The objective is to separate the different interpretations of the same
@@ -800,4 +803,6 @@ inline simd8float32 gethigh128(simd8float32 a, simd8float32 b) {
 
 } // namespace
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
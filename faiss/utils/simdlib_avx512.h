@@ -13,11 +13,14 @@
 #include <immintrin.h>
 
 #include <faiss/impl/platform_macros.h>
+#include <faiss/utils/simd_levels.h>
 
 #include <faiss/utils/simdlib_avx2.h>
 
 namespace faiss {
 
+FAISS_SIMD_NAMESPACE_BEGIN
+
 /** Simple wrapper around the AVX 512-bit registers
  *
  * The objective is to separate the different interpretations of the same
@@ -293,4 +296,6 @@ struct simd64uint8 : simd512bit {
     }
 };
 
+FAISS_SIMD_NAMESPACE_END
+
 } // namespace faiss
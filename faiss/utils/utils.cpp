@@ -37,6 +37,7 @@
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/platform_macros.h>
 #include <faiss/utils/random.h>
+#include <faiss/utils/simd_levels.h>
 
 #ifndef FINTEGER
 #define FINTEGER long
@@ -127,6 +128,10 @@ std::string get_compile_options() {
     options += "GENERIC ";
 #endif
 
+#if defined(COMPILE_SIMD_AVX2) || defined(COMPILE_SIMD_AVX512)
+    options += "DD(" + SIMDConfig::level_name(SIMDConfig::get_level()) + ") ";
+#endif
+
     options += gpu_compile_options;
 
     return options;
@@ -451,7 +456,7 @@ uint64_t ivec_checksum(size_t n, const int32_t* assigned) {
 uint64_t bvec_checksum(size_t n, const uint8_t* a) {
     uint64_t cs = ivec_checksum(n / 4, (const int32_t*)a);
     for (size_t i = n / 4 * 4; i < n; i++) {
-        cs = cs * 65713 + a[n] * 1686049;
+        cs = cs * 65713 + a[i] * 1686049;
     }
     return cs;
 }
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <faiss/Index.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/impl/chunked_io.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+
+#include "test_util.h"
+
+namespace {
+
+pthread_mutex_t temp_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+std::vector<float> make_data(size_t n, size_t d, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+std::unique_ptr<faiss::Index> make_index(
+        const char* factory_string,
+        int d,
+        const std::vector<float>& xb) {
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, factory_string));
+    size_t nb = xb.size() / d;
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    return index;
+}
+
+void expect_same_search(
+        const faiss::Index* index1,
+        const faiss::Index* index2,
+        const std::vector<float>& xq) {
+    int k = 10;
+    size_t nq = xq.size() / index1->d;
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    index1->search(nq, xq.data(), k, D1.data(), I1.data());
+    index2->search(nq, xq.data(), k, D2.data(), I2.data());
+    EXPECT_EQ(I1, I2);
+    EXPECT_EQ(D1, D2);
+}
+
+// the chunked file contains the same stream as the classic format
+void test_roundtrip(const char* factory_string, const char* tmpname) {
+    Tempfilename fname(&temp_file_mutex, tmpname);
+    int d = 32;
+    std::vector<float> xb = make_data(2000, d, 123);
+    std::vector<float> xq = make_data(20, d, 456);
+    auto index = make_index(factory_string, d, xb);
+
+    faiss::VectorIOWriter ref;
+    faiss::write_index(index.get(), &ref);
+
+    {
+        // odd chunk size to exercise the partial chunks
+        faiss::ChunkedFileIOWriter writer(fname.c_str(), 1001, 3);
+        writer.section_min_size = 4096;
+        faiss::write_index(index.get(), &writer);
+        writer.close();
+    }
+    EXPECT_TRUE(faiss::is_chunked_file(fname.c_str()));
+
+    faiss::ChunkedFileIOReader reader(fname.c_str(), 3);
+    ASSERT_EQ(reader.total_size, ref.data.size());
+    EXPECT_EQ(reader.checksums.size(), (ref.data.size() + 1000) / 1001);
+    EXPECT_TRUE(reader.verify().empty());
+
+    std::vector<uint8_t> stream(reader.total_size);
+    reader.read_at(0, stream.size(), stream.data());
+    EXPECT_EQ(stream, ref.data);
+
+    // the large arrays can be read without deserializing the index
+    ASSERT_FALSE(reader.sections.empty());
+    for (const faiss::ChunkedFileSection& s : reader.sections) {
+        EXPECT_GE(s.size, 4096);
+        std::vector<uint8_t> section(s.size);
+        reader.read_at(s.offset, s.size, section.data());
+        EXPECT_TRUE(std::equal(
+                section.begin(),
+                section.end(),
+                ref.data.begin() + s.offset));
+    }
+
+    std::unique_ptr<faiss::Index> index2(faiss::read_index(fname.c_str()));
+    expect_same_search(index.get(), index2.get(), xq);
+}
+
+} // namespace
+
+TEST(ChunkedIO, roundtrip_IVFFlat) {
+    test_roundtrip("IVF16,Flat", "/tmp/faiss_chunked_ivf_XXXXXX");
+}
+
+TEST(ChunkedIO, roundtrip_HNSW) {
+    test_roundtrip("HNSW16,Flat", "/tmp/faiss_chunked_hnsw_XXXXXX");
+}
+
+TEST(ChunkedIO, io_flag) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_chunked_flag_XXXXXX");
+    int d = 16;
+    std::vector<float> xb = make_data(1000, d, 123);
+    std::vector<float> xq = make_data(10, d, 456);
+    auto index = make_index("IVF8,SQ8", d, xb);
+
+    faiss::write_index(index.get(), fname.c_str());
+    EXPECT_FALSE(faiss::is_chunked_file(fname.c_str()));
+
+    faiss::write_index(index.get(), fname.c_str(), faiss::IO_FLAG_CHUNKED);
+    EXPECT_TRUE(faiss::is_chunked_file(fname.c_str()));
+    std::unique_ptr<faiss::Index> index2(faiss::read_index(fname.c_str()));
+    expect_same_search(index.get(), index2.get(), xq);
+
+    EXPECT_THROW(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC),
+            faiss::FaissException);
+}
+
+TEST(ChunkedIO, corruption) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_chunked_bad_XXXXXX");
+    int d = 32;
+    std::vector<float> xb = make_data(2000, d, 123);
+    auto index = make_index("IVF16,Flat", d, xb);
+    size_t chunk_size = 4096;
+    {
+        faiss::ChunkedFileIOWriter writer(fname.c_str(), chunk_size);
+        faiss::write_index(index.get(), &writer);
+    }
+
+    // flip a byte in the data of chunk 5
+    size_t bad_chunk = 5;
+    {
+        FILE* f = fopen(fname.c_str(), "r+b");
+        ASSERT_TRUE(f);
+        long ofs = faiss::ChunkedFileIOWriter::header_size +
+                bad_chunk * chunk_size + 123;
+        fseek(f, ofs, SEEK_SET);
+        int c = fgetc(f);
+        fseek(f, ofs, SEEK_SET);
+        fputc(c ^ 0x5a, f);
+        fclose(f);
+    }
+
+    faiss::ChunkedFileIOReader reader(fname.c_str());
+    EXPECT_EQ(reader.verify(), std::vector<size_t>{bad_chunk});
+    EXPECT_THROW(faiss::read_index(fname.c_str()), faiss::FaissException);
+
+    // truncated files are rejected when they are opened
+    ASSERT_EQ(truncate(fname.c_str(), 10000), 0);
+    EXPECT_FALSE(faiss::is_chunked_file("/dev/null"));
+    EXPECT_THROW(
+            faiss::ChunkedFileIOReader reader2(fname.c_str()),
+            faiss::FaissException);
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <faiss/IndexDiskGraph.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexNSG.h>
+#include <faiss/index_io.h>
+#include <faiss/utils/random.h>
+
+#include <unistd.h>
+
+namespace {
+
+// the tests can run concurrently, the temporary files need unique names
+std::string make_temp_file(const char* prefix) {
+    std::string fname = std::string("/tmp/") + prefix + "_XXXXXX";
+    int fd = mkstemp(&fname[0]);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return fname;
+}
+
+int d = 32, nb = 5000, nt = 2000, nq = 100, k = 10;
+
+// fraction of the 1-NN found in the top k
+double recall_at_k(const faiss::Index& index, const faiss::MetricType metric) {
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 1);
+    faiss::float_rand(xq.data(), xq.size(), 2);
+    faiss::IndexFlat ref(d, metric);
+    ref.add(nb, xb.data());
+    std::vector<faiss::idx_t> I_ref(nq), I(nq * k);
+    std::vector<float> D_ref(nq), D(nq * k);
+    ref.search(nq, xq.data(), 1, D_ref.data(), I_ref.data());
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    int n_ok = 0;
+    for (int q = 0; q < nq; q++) {
+        for (int j = 0; j < k; j++) {
+            n_ok += I[q * k + j] == I_ref[q];
+        }
+    }
+    return n_ok / double(nq);
+}
+
+void test_disk_graph(faiss::Index& graph_index, faiss::MetricType metric) {
+    std::vector<float> xb(nb * d), xt(nt * d);
+    faiss::float_rand(xb.data(), xb.size(), 1);
+    faiss::float_rand(xt.data(), xt.size(), 3);
+    graph_index.add(nb, xb.data());
+
+    std::string graph_file = make_temp_file("faiss_disk_graph");
+    std::string index_file = make_temp_file("faiss_disk_index");
+
+    faiss::IndexDiskGraph index(d, 8, 8, metric);
+    index.train(nt, xt.data());
+    index.build(&graph_index, graph_file.c_str());
+    EXPECT_EQ(index.ntotal, nb);
+
+    faiss::diskgraph_stats.reset();
+    EXPECT_GE(recall_at_k(index, metric), 0.95);
+    EXPECT_EQ(faiss::diskgraph_stats.nq, nq);
+    EXPECT_GT(faiss::diskgraph_stats.nreads, 0);
+    EXPECT_LE(
+            faiss::diskgraph_stats.nreads,
+            faiss::diskgraph_stats.nhops * index.beam_width);
+
+    std::vector<float> recons(d);
+    for (int i = 0; i < nb; i += 500) {
+        index.reconstruct(i, recons.data());
+        for (int j = 0; j < d; j++) {
+            EXPECT_EQ(recons[j], xb[i * d + j]);
+        }
+    }
+
+    // synchronous reads give the same results
+    std::vector<float> xq(nq * d);
+    faiss::float_rand(xq.data(), xq.size(), 2);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    std::vector<float> D1(nq * k), D2(nq * k);
+    index.search(nq, xq.data(), k, D1.data(), I1.data());
+
+    faiss::write_index(&index, index_file.c_str());
+    std::unique_ptr<faiss::Index> index2(faiss::read_index(index_file.c_str()));
+    auto index2_dg = dynamic_cast<faiss::IndexDiskGraph*>(index2.get());
+    ASSERT_TRUE(index2_dg);
+    index2_dg->io_threads = 0;
+    index2_dg->open_file();
+    index2->search(nq, xq.data(), k, D2.data(), I2.data());
+    EXPECT_EQ(I1, I2);
+    EXPECT_EQ(D1, D2);
+
+    remove(graph_file.c_str());
+    remove(index_file.c_str());
+}
+
+} // namespace
+
+TEST(DiskGraph, HNSW) {
+    faiss::IndexHNSWFlat graph_index(d, 16);
+    test_disk_graph(graph_index, faiss::METRIC_L2);
+}
+
+TEST(DiskGraph, HNSW_IP) {
+    faiss::IndexHNSWFlat graph_index(d, 16, faiss::METRIC_INNER_PRODUCT);
+    test_disk_graph(graph_index, faiss::METRIC_INNER_PRODUCT);
+}
+
+TEST(DiskGraph, NSG) {
+    faiss::IndexNSGFlat graph_index(d, 32);
+    test_disk_graph(graph_index, faiss::METRIC_L2);
+}
@@ -13,6 +13,8 @@
 #include <random>
 #include <vector>
 
+#include <omp.h>
+
 #include <faiss/utils/distances.h>
 
 // reference implementations
@@ -107,3 +109,58 @@ TEST(TestFvecInnerProductsNy, D2) {
         }
     }
 }
+
+// the blocked k-NN search (fused kernels or BLAS) should return the same
+// distances as the sequential one. nx = 600 covers several query blocks,
+// and with several threads, the small batches split the database.
+TEST(TestKnn, BlockedVsSequential) {
+    std::default_random_engine rng(123);
+    // integer values so that all computations are exact
+    std::uniform_int_distribution<int32_t> u(0, 32);
+
+    size_t ny = 1234, k = 10;
+    int nt_bak = omp_get_max_threads();
+    for (const size_t nx : {100, 600}) {
+        for (const size_t dim : {3, 16, 67, 300}) {
+            std::vector<float> x(nx * dim), y(ny * dim);
+            for (auto& v : x) {
+                v = u(rng);
+            }
+            for (auto& v : y) {
+                v = u(rng);
+            }
+
+            for (int nt : {1, 4}) {
+                omp_set_num_threads(nt);
+                for (bool is_l2 : {false, true}) {
+                    std::vector<float> D_ref(nx * k), D(nx * k);
+                    std::vector<int64_t> I_ref(nx * k), I(nx * k);
+
+                    int bak = faiss::distance_compute_blas_threshold;
+                    faiss::distance_compute_blas_threshold = nx + 1;
+                    for (int blocked = 0; blocked < 2; blocked++) {
+                        float* Dp = blocked ? D.data() : D_ref.data();
+                        int64_t* Ip = blocked ? I.data() : I_ref.data();
+                        if (is_l2) {
+                            faiss::knn_L2sqr(
+                                    x.data(), y.data(), dim, nx, ny, k, Dp, Ip);
+                        } else {
+                            faiss::knn_inner_product(
+                                    x.data(), y.data(), dim, nx, ny, k, Dp, Ip);
+                        }
+                        faiss::distance_compute_blas_threshold = bak;
+                    }
+
+                    ASSERT_EQ(D, D_ref)
+                            << "nx = " << nx << ", dim = " << dim
+                            << ", nt = " << nt << ", l2 = " << is_l2;
+                    for (size_t i = 0; i < nx * k; i++) {
+                        ASSERT_GE(I[i], 0);
+                        ASSERT_LT(I[i], ny);
+                    }
+                }
+            }
+        }
+    }
+    omp_set_num_threads(nt_bak);
+}
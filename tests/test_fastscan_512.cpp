@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <faiss/IndexFastScan.h>
+#include <faiss/IndexIVFFastScan.h>
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/pq4_fast_scan.h>
+#include <faiss/index_factory.h>
+
+/* The 512-bit kernels (implem 16 and 17) compute exactly the same uint16
+ * distances as the 256-bit ones, so the results should be identical. */
+
+namespace {
+
+int d = 32;
+size_t nb = 2000 + 17; // not a multiple of the block sizes
+size_t nq = 13;
+
+std::vector<float> make_data(size_t n, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+std::unique_ptr<faiss::Index> make_index(const char* factory_string) {
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, factory_string));
+    std::vector<float> xb = make_data(nb, 123);
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    return index;
+}
+
+void set_implem(faiss::Index* index, int implem) {
+    if (auto ifs = dynamic_cast<faiss::IndexFastScan*>(index)) {
+        ifs->implem = implem;
+        // the 256-bit kernels are not instantiated for all nq and bbs
+        ifs->qbs = implem >= 16 ? 0 : 1;
+    } else {
+        dynamic_cast<faiss::IndexIVFFastScan*>(index)->implem = implem;
+    }
+}
+
+void compare_implems(faiss::Index* index, int implem_ref, int implem, int k) {
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    set_implem(index, implem_ref);
+    index->search(nq, xq.data(), k, D1.data(), I1.data());
+    set_implem(index, implem);
+    index->search(nq, xq.data(), k, D2.data(), I2.data());
+    EXPECT_EQ(I1, I2);
+    EXPECT_EQ(D1, D2);
+}
+
+} // namespace
+
+TEST(TestFastScan512, unavailable) {
+    if (faiss::pq4_has_512bit_kernels()) {
+        GTEST_SKIP() << "the 512-bit kernels are available";
+    }
+    auto index = make_index("PQ8x4fs");
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> D(nq * 10);
+    std::vector<faiss::idx_t> I(nq * 10);
+    set_implem(index.get(), 16);
+    EXPECT_THROW(
+            index->search(nq, xq.data(), 10, D.data(), I.data()),
+            faiss::FaissException);
+}
+
+TEST(TestFastScan512, IndexPQFastScan) {
+    if (!faiss::pq4_has_512bit_kernels()) {
+        GTEST_SKIP() << "the 512-bit kernels are not available";
+    }
+    // 96 = odd nb of 32-element blocks per bbs block
+    for (const char* factory_string :
+         {"PQ8x4fs", "PQ8x4fs_64", "PQ16x4fs_96"}) {
+        auto index = make_index(factory_string);
+        compare_implems(index.get(), 14, 16, 10);
+        compare_implems(index.get(), 15, 17, 30);
+    }
+}
+
+TEST(TestFastScan512, with_norm_scaler) {
+    if (!faiss::pq4_has_512bit_kernels()) {
+        GTEST_SKIP() << "the 512-bit kernels are not available";
+    }
+    auto index = make_index("RQ4x4fs_64_Nrq2x4");
+    compare_implems(index.get(), 14, 16, 10);
+}
+
+TEST(TestFastScan512, IndexIVFPQFastScan) {
+    if (!faiss::pq4_has_512bit_kernels()) {
+        GTEST_SKIP() << "the 512-bit kernels are not available";
+    }
+    for (const char* factory_string : {"IVF8,PQ8x4fs", "IVF8,PQ8x4fs_64"}) {
+        auto index = make_index(factory_string);
+        dynamic_cast<faiss::IndexIVF*>(index.get())->nprobe = 4;
+        compare_implems(index.get(), 10, 16, 10);
+        compare_implems(index.get(), 11, 17, 30);
+        // single-thread scanning
+        compare_implems(index.get(), 110, 116, 10);
+
+        std::vector<float> xq = make_data(nq, 456);
+        faiss::RangeSearchResult res1(nq), res2(nq);
+        set_implem(index.get(), 10);
+        index->range_search(nq, xq.data(), 3.0, &res1);
+        set_implem(index.get(), 16);
+        index->range_search(nq, xq.data(), 3.0, &res2);
+        ASSERT_EQ(res1.lims[nq], res2.lims[nq]);
+        EXPECT_GT(res1.lims[nq], 0);
+        for (size_t i = 0; i < res1.lims[nq]; i++) {
+            EXPECT_EQ(res1.labels[i], res2.labels[i]);
+            EXPECT_EQ(res1.distances[i], res2.distances[i]);
+        }
+    }
+}
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexIVFPQFastScan.h>
+#include <faiss/IndexPQ.h>
+#include <faiss/IndexPQFastScan.h>
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/index_factory.h>
+
+/* Fast-scan with 5 to 8 bits per sub-quantizer. The kernels add up the same
+ * quantized LUT entries as the reference implementations on the unpacked
+ * codes, so the distances should match up to float rounding. */
+
+namespace {
+
+int d = 32;
+size_t nb = 2000 + 17; // not a multiple of the block sizes
+size_t nq = 13;
+int k = 10;
+
+std::vector<float> make_data(size_t n, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+void search(
+        const faiss::Index& index,
+        std::vector<float>& D,
+        std::vector<faiss::idx_t>& I) {
+    std::vector<float> xq = make_data(nq, 456);
+    D.resize(nq * k);
+    I.resize(nq * k);
+    index.search(nq, xq.data(), k, D.data(), I.data());
+}
+
+/// the distances must be the same, the labels may differ on ties
+void compare_results(
+        const faiss::Index& index1,
+        const faiss::Index& index2) {
+    std::vector<float> D1, D2;
+    std::vector<faiss::idx_t> I1, I2;
+    search(index1, D1, I1);
+    search(index2, D2, I2);
+    size_t ndiff = 0;
+    for (size_t i = 0; i < nq * k; i++) {
+        EXPECT_NEAR(D1[i], D2[i], 1e-5 * std::abs(D1[i]) + 1e-5);
+        ndiff += I1[i] != I2[i];
+    }
+    EXPECT_LT(ndiff, nq * k / 10);
+}
+
+} // namespace
+
+TEST(TestFastScanNbits, IndexPQFastScan) {
+    for (const char* factory_string : {"PQ8x6np", "PQ16x8np", "PQ8x5np"}) {
+        std::unique_ptr<faiss::IndexPQ> index_pq(dynamic_cast<faiss::IndexPQ*>(
+                faiss::index_factory(d, factory_string)));
+        std::vector<float> xb = make_data(nb, 123);
+        index_pq->train(nb, xb.data());
+        index_pq->add(nb, xb.data());
+
+        for (int bbs : {32, 96}) {
+            faiss::IndexPQFastScan index(*index_pq, bbs);
+
+            // implem 4 uses the same quantized LUT on the unpacked codes
+            faiss::IndexPQFastScan ref(*index_pq, bbs);
+            ref.implem = 4;
+            index.implem = 14;
+            compare_results(ref, index);
+            index.implem = 15;
+            compare_results(ref, index);
+
+            // default implem and the ones that fall back to 14
+            index.implem = 0;
+            compare_results(ref, index);
+            index.implem = 12;
+            compare_results(ref, index);
+
+            // codes packed by add() and reconstruction
+            faiss::IndexPQFastScan index2(*index_pq, bbs);
+            index2.reset();
+            index2.add(nb, xb.data());
+            compare_results(index, index2);
+            std::vector<float> recons(d), recons_ref(d);
+            for (faiss::idx_t i : {0, 31, 32, 1000, 2016}) {
+                index2.reconstruct(i, recons.data());
+                index_pq->reconstruct(i, recons_ref.data());
+                EXPECT_EQ(recons, recons_ref);
+            }
+        }
+    }
+}
+
+TEST(TestFastScanNbits, IndexIVFPQFastScan) {
+    for (const char* factory_string : {"IVF8,PQ8x6np", "IVF8,PQ8x8np"}) {
+        std::unique_ptr<faiss::IndexIVFPQ> index_ivfpq(
+                dynamic_cast<faiss::IndexIVFPQ*>(
+                        faiss::index_factory(d, factory_string)));
+        index_ivfpq->nprobe = 4;
+        std::vector<float> xb = make_data(nb, 123);
+        index_ivfpq->train(nb, xb.data());
+
+        // empty index with the same trained quantizers
+        faiss::IndexIVFPQFastScan index2(*index_ivfpq, 64);
+        index_ivfpq->add(nb, xb.data());
+
+        // implem 2 uses the same quantized LUT on the original codes
+        faiss::IndexIVFPQFastScan index(*index_ivfpq, 64);
+        faiss::IndexIVFPQFastScan ref(*index_ivfpq, 64);
+        ref.implem = 2;
+        for (int implem : {10, 11, 12, 14, 16, 110}) {
+            index.implem = implem;
+            compare_results(ref, index);
+        }
+
+        index2.add(nb, xb.data());
+        compare_results(index, index2);
+
+        std::vector<float> xq = make_data(nq, 456);
+        faiss::RangeSearchResult res1(nq), res2(nq);
+        index.implem = 10;
+        index.range_search(nq, xq.data(), 3.0, &res1);
+        index2.implem = 12;
+        index2.range_search(nq, xq.data(), 3.0, &res2);
+        ASSERT_EQ(res1.lims[nq], res2.lims[nq]);
+        EXPECT_GT(res1.lims[nq], 0);
+    }
+}
+
+TEST(TestFastScanNbits, factory) {
+    std::unique_ptr<faiss::Index> index(faiss::index_factory(d, "PQ8x6fs"));
+    EXPECT_EQ(dynamic_cast<faiss::IndexPQFastScan*>(index.get())->nbits, 6);
+    index.reset(faiss::index_factory(d, "IVF8,PQ8x8fsr_64"));
+    auto index_ivf = dynamic_cast<faiss::IndexIVFPQFastScan*>(index.get());
+    EXPECT_EQ(index_ivf->nbits, 8);
+    EXPECT_EQ(index_ivf->bbs, 64);
+    EXPECT_TRUE(index_ivf->by_residual);
+}
+
+/* The 8-bit quantization of the LUTs should not cost recall compared to the
+ * float LUTs of IndexIVFPQ. The timings are in
+ * benchs/bench_ivf_fastscan_nbits.cpp. */
+TEST(TestFastScanNbits, recall_vs_IndexIVFPQ) {
+    size_t nq_recall = 200;
+    std::vector<float> xb = make_data(nb, 123);
+    std::vector<float> xq = make_data(nq_recall, 789);
+    std::vector<float> D(nq_recall * k);
+    std::vector<faiss::idx_t> gt(nq_recall), I(nq_recall * k);
+    faiss::IndexFlatL2 flat(d);
+    flat.add(nb, xb.data());
+    flat.search(nq_recall, xq.data(), 1, D.data(), gt.data());
+
+    auto recall = [&](const faiss::Index& index) {
+        index.search(nq_recall, xq.data(), k, D.data(), I.data());
+        size_t n = 0;
+        for (size_t i = 0; i < nq_recall; i++) {
+            for (int j = 0; j < k; j++) {
+                n += I[i * k + j] == gt[i];
+            }
+        }
+        return n / double(nq_recall);
+    };
+
+    for (const char* factory_string : {"IVF8,PQ8x6np", "IVF8,PQ8x8np"}) {
+        std::unique_ptr<faiss::IndexIVFPQ> index_ivfpq(
+                dynamic_cast<faiss::IndexIVFPQ*>(
+                        faiss::index_factory(d, factory_string)));
+        index_ivfpq->nprobe = 4;
+        index_ivfpq->train(nb, xb.data());
+        index_ivfpq->add(nb, xb.data());
+        faiss::IndexIVFPQFastScan index(*index_ivfpq, 32);
+
+        double r_ref = recall(*index_ivfpq);
+        double r = recall(index);
+        EXPECT_GT(r_ref, 0.5);
+        EXPECT_GE(r, r_ref - 0.03);
+    }
+}
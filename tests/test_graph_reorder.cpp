@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIDMap.h>
+#include <faiss/IndexNNDescent.h>
+#include <faiss/IndexNSG.h>
+#include <faiss/graph_reorder.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/utils/random.h>
+
+namespace {
+
+int d = 16, nb = 3000, nq = 100, k = 10;
+
+std::vector<float> make_data(int n, int seed) {
+    std::vector<float> x(n * d);
+    faiss::float_rand(x.data(), x.size(), seed);
+    return x;
+}
+
+// fraction of the links between nodes whose numbers are close
+double local_link_ratio(const faiss::HNSW& hnsw) {
+    size_t nlocal = 0, nlink = 0;
+    for (int i = 0; i < hnsw.levels.size(); i++) {
+        size_t begin, end;
+        hnsw.neighbor_range(i, 0, &begin, &end);
+        for (size_t j = begin; j < end && hnsw.neighbors[j] >= 0; j++) {
+            nlocal += std::abs(hnsw.neighbors[j] - i) < 64;
+            nlink++;
+        }
+    }
+    return nlocal / double(nlink);
+}
+
+void check_permutation(const std::vector<faiss::idx_t>& perm) {
+    std::vector<bool> seen(perm.size());
+    for (faiss::idx_t p : perm) {
+        ASSERT_GE(p, 0);
+        ASSERT_LT(p, perm.size());
+        ASSERT_FALSE(seen[p]);
+        seen[p] = true;
+    }
+}
+
+} // namespace
+
+TEST(GraphReorder, HNSW) {
+    std::vector<float> xb = make_data(nb, 1), xq = make_data(nq, 2);
+    std::vector<faiss::idx_t> ids(nb);
+    for (int i = 0; i < nb; i++) {
+        ids[i] = 7 * i + 3;
+    }
+
+    for (auto method :
+         {faiss::GRAPH_REORDER_BFS,
+          faiss::GRAPH_REORDER_RCM,
+          faiss::GRAPH_REORDER_GORDER}) {
+        faiss::IndexHNSWFlat sub(d, 16);
+        faiss::IndexIDMap2 index(&sub);
+        index.add_with_ids(nb, xb.data(), ids.data());
+
+        std::vector<faiss::idx_t> I_ref(nq * k), I(nq * k);
+        std::vector<float> D_ref(nq * k), D(nq * k);
+        index.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+        double local_ref = local_link_ratio(sub.hnsw);
+
+        std::vector<faiss::idx_t> perm(nb);
+        faiss::reorder_graph_index(&index, method, perm.data());
+        check_permutation(perm);
+
+        // same graph with other node numbers: the results are the same
+        index.search(nq, xq.data(), k, D.data(), I.data());
+        EXPECT_EQ(I, I_ref);
+        EXPECT_EQ(D, D_ref);
+        EXPECT_GT(local_link_ratio(sub.hnsw), 1.5 * local_ref);
+
+        std::vector<float> recons(d);
+        for (int i = 0; i < nb; i += 100) {
+            index.reconstruct(ids[i], recons.data());
+            EXPECT_EQ(
+                    memcmp(recons.data(), xb.data() + i * d, sizeof(float) * d),
+                    0);
+        }
+    }
+}
+
+// the tombstones follow the vectors, also those of vectors added after
+// mark_deleted
+TEST(GraphReorder, HNSW_deleted) {
+    int nb0 = 100;
+    std::vector<float> xb = make_data(nb, 1);
+    faiss::IndexHNSWFlat index(d, 16);
+    index.add(nb0, xb.data());
+    faiss::IDSelectorRange sel(0, 10);
+    EXPECT_EQ(index.mark_deleted(sel), 10);
+    index.add(nb - nb0, xb.data() + nb0 * d);
+
+    // the deleted vectors get the last numbers
+    std::vector<faiss::idx_t> perm(nb);
+    for (int i = 0; i < nb; i++) {
+        perm[i] = nb - 1 - i;
+    }
+    index.permute_entries(perm.data());
+    EXPECT_EQ(index.ndeleted, 10);
+    for (int i = 0; i < nb; i++) {
+        EXPECT_EQ(index.is_deleted(i), i >= nb - 10);
+    }
+}
+
+TEST(GraphReorder, NSG) {
+    std::vector<float> xb = make_data(nb, 1), xq = make_data(nq, 2);
+    faiss::IndexNSGFlat index(d, 16);
+    index.GK = 32;
+    index.add(nb, xb.data());
+
+    std::vector<faiss::idx_t> I_ref(nq * k), I(nq * k);
+    std::vector<float> D_ref(nq * k), D(nq * k);
+    index.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+
+    std::vector<faiss::idx_t> perm(nb);
+    faiss::reorder_graph_index(&index, faiss::GRAPH_REORDER_GORDER, perm.data());
+    check_permutation(perm);
+
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    for (int i = 0; i < nq * k; i++) {
+        EXPECT_EQ(perm[I[i]], I_ref[i]);
+    }
+    EXPECT_EQ(D, D_ref);
+}
+
+TEST(GraphReorder, NNDescent) {
+    std::vector<float> xb = make_data(nb, 1), xq = make_data(nq, 2);
+    faiss::IndexNNDescentFlat index(d, 32);
+    index.add(nb, xb.data());
+
+    std::vector<faiss::idx_t> perm(nb);
+    faiss::reorder_graph_index(&index, faiss::GRAPH_REORDER_RCM, perm.data());
+    check_permutation(perm);
+
+    // the search starts from random nodes, so only check the recall
+    faiss::IndexFlatL2 ref(d);
+    ref.add(nb, xb.data());
+    std::vector<faiss::idx_t> I_ref(nq), I(nq);
+    std::vector<float> D_ref(nq), D(nq);
+    ref.search(nq, xq.data(), 1, D_ref.data(), I_ref.data());
+    index.nndescent.search_L = 32;
+    index.search(nq, xq.data(), 1, D.data(), I.data());
+    int n1 = 0;
+    for (int i = 0; i < nq; i++) {
+        n1 += perm[I[i]] == I_ref[i];
+    }
+    EXPECT_GE(n1, nq * 9 / 10);
+}
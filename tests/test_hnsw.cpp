@@ -7,14 +7,19 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstddef>
 #include <limits>
+#include <memory>
 #include <random>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
 #include <faiss/IndexHNSW.h>
+#include <faiss/impl/DistanceComputer.h>
 #include <faiss/impl/HNSW.h>
+#include <faiss/impl/IDSelector.h>
 #include <faiss/impl/ResultHandler.h>
 #include <faiss/utils/random.h>
 #include <faiss/utils/utils.h>
@@ -542,3 +547,336 @@ TEST_F(HNSWTest, TEST_search_from_candidates) {
     EXPECT_EQ(reference_stats.n1, stats.n1);
     EXPECT_EQ(reference_stats.n2, stats.n2);
 }
+
+TEST_F(HNSWTest, TEST_interleaved_level_0) {
+    std::vector<faiss::idx_t> I(k * nq), I_ref(k * nq);
+    std::vector<float> D(k * nq), D_ref(k * nq);
+
+    index->search(nq, xq->data(), k, D_ref.data(), I_ref.data());
+
+    for (bool with_codes : {false, true}) {
+        index->set_interleaved_level_0(with_codes);
+        EXPECT_TRUE(index->hnsw.has_interleaved_level_0());
+        EXPECT_EQ(index->hnsw.level0_block_size % 64, 0);
+        EXPECT_EQ(
+                (size_t)index->hnsw.level0_blocks.get() % 64, size_t(0));
+
+        index->search(nq, xq->data(), k, D.data(), I.data());
+        EXPECT_EQ(I, I_ref);
+        EXPECT_EQ(D, D_ref);
+    }
+
+    // modifying the graph drops the interleaved copy
+    index->add(1, xb->data());
+    EXPECT_FALSE(index->hnsw.has_interleaved_level_0());
+}
+
+TEST(HNSW, Test_distances_batch) {
+    int d = 40, nb = 500, n = 37;
+    std::vector<float> xb(d * nb), xq(d);
+    faiss::float_rand(xb.data(), xb.size(), 1234);
+    faiss::float_rand(xq.data(), xq.size(), 4567);
+    std::vector<faiss::idx_t> ids(n);
+    for (int i = 0; i < n; i++) {
+        ids[i] = (i * 97) % nb;
+    }
+
+    std::vector<std::unique_ptr<faiss::IndexHNSW>> indexes;
+    indexes.emplace_back(new faiss::IndexHNSWFlat(d, 16));
+    indexes.emplace_back(
+            new faiss::IndexHNSWFlat(d, 16, faiss::METRIC_INNER_PRODUCT));
+    indexes.emplace_back(
+            new faiss::IndexHNSWSQ(d, faiss::ScalarQuantizer::QT_8bit, 16));
+    indexes.emplace_back(
+            new faiss::IndexHNSWSQ(d, faiss::ScalarQuantizer::QT_4bit, 16));
+    indexes.emplace_back(new faiss::IndexHNSWSQ(
+            d,
+            faiss::ScalarQuantizer::QT_fp16,
+            16,
+            faiss::METRIC_INNER_PRODUCT));
+    indexes.emplace_back(new faiss::IndexHNSWPQ(d, 10, 16, 8));
+    indexes.emplace_back(new faiss::IndexHNSWPQ(d, 10, 16, 6));
+
+    for (auto& index : indexes) {
+        index->train(nb, xb.data());
+        index->add(nb, xb.data());
+        std::unique_ptr<faiss::DistanceComputer> dis(
+                index->get_distance_computer());
+        dis->set_query(xq.data());
+        std::vector<float> D(n);
+        dis->distances_batch(n, ids.data(), D.data());
+        for (int i = 0; i < n; i++) {
+            EXPECT_NEAR(D[i], (*dis)(ids[i]), 1e-4);
+        }
+    }
+}
+
+TEST(HNSW, Test_online_add_search) {
+    int d = 16, nb = 3000, n0 = 500, nq = 100;
+    std::vector<float> xb(d * nb);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+
+    faiss::IndexHNSWFlat index(d, 16);
+    index.set_online_mode(nb);
+    index.add(n0, xb.data());
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (int i0 = n0; i0 < nb; i0 += 50) {
+            index.add(50, xb.data() + i0 * d);
+        }
+        done = true;
+    });
+
+    // search vectors of the initial batch while the writer adds
+    std::vector<faiss::idx_t> I(nq);
+    std::vector<float> D(nq);
+    int nsearch = 0;
+    int64_t ntotal_prev = n0;
+    while (!done || nsearch == 0) {
+        index.search(nq, xb.data(), 1, D.data(), I.data());
+        for (int i = 0; i < nq; i++) {
+            EXPECT_GE(I[i], 0);
+            EXPECT_LT(I[i], nb);
+        }
+        // the published count grows monotonically
+        int64_t ntotal = index.hnsw.online->ntotal.load();
+        EXPECT_GE(ntotal, ntotal_prev);
+        EXPECT_LE(ntotal, nb);
+        ntotal_prev = ntotal;
+        nsearch++;
+    }
+    writer.join();
+
+    EXPECT_EQ(index.ntotal, nb);
+    EXPECT_EQ(index.hnsw.online->ntotal.load(), nb);
+    EXPECT_THROW(index.add(1, xb.data()), faiss::FaissException);
+
+    // all vectors are reachable
+    std::vector<faiss::idx_t> Iall(nb);
+    std::vector<float> Dall(nb);
+    index.search(nb, xb.data(), 1, Dall.data(), Iall.data());
+    int nfound = 0;
+    for (int i = 0; i < nb; i++) {
+        nfound += Iall[i] == i;
+    }
+    EXPECT_GE(nfound, nb * 98 / 100);
+}
+
+namespace {
+
+/// fraction of the non-deleted vectors of xb that are found as their own
+/// nearest neighbor, and check that no deleted vector is returned
+float self_recall(const faiss::IndexHNSW& index, const float* xb, int nb) {
+    std::vector<faiss::idx_t> I(nb);
+    std::vector<float> D(nb);
+    index.search(nb, xb, 1, D.data(), I.data());
+    int nfound = 0, nvalid = 0;
+    for (int i = 0; i < nb; i++) {
+        EXPECT_FALSE(I[i] >= 0 && index.is_deleted(I[i]));
+        if (!index.is_deleted(i)) {
+            nvalid++;
+            nfound += I[i] == i;
+        }
+    }
+    return nfound / float(nvalid);
+}
+
+} // namespace
+
+TEST(HNSW, Test_deletion) {
+    int d = 16, nb = 2000, nnew = 200;
+    std::vector<float> xb(d * (nb + nnew));
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    const float* xnew = xb.data() + nb * d;
+
+    faiss::IndexHNSWFlat index(d, 16);
+    index.add(nb, xb.data());
+
+    // delete one vector out of 3
+    std::vector<faiss::idx_t> to_delete;
+    for (int i = 0; i < nb; i += 3) {
+        to_delete.push_back(i);
+    }
+    faiss::IDSelectorBatch sel(to_delete.size(), to_delete.data());
+    EXPECT_EQ(index.mark_deleted(sel), to_delete.size());
+    EXPECT_EQ(index.mark_deleted(sel), 0);
+    EXPECT_EQ(index.ntotal, nb);
+    EXPECT_GE(self_recall(index, xb.data(), nb), 0.98);
+
+    // repair detaches the deleted vectors
+    EXPECT_EQ(index.repair_deleted(), to_delete.size());
+    EXPECT_EQ(index.free_slots.size(), to_delete.size());
+    EXPECT_GE(self_recall(index, xb.data(), nb), 0.98);
+
+    // new vectors reuse the free slots
+    std::vector<faiss::idx_t> ids(nnew);
+    index.add_reuse_slots(nnew, xnew, ids.data());
+    EXPECT_EQ(index.ntotal, nb);
+    EXPECT_EQ(index.ndeleted, to_delete.size() - nnew);
+    std::vector<faiss::idx_t> I(nnew);
+    std::vector<float> D(nnew);
+    index.search(nnew, xnew, 1, D.data(), I.data());
+    int nfound = 0;
+    for (int i = 0; i < nnew; i++) {
+        EXPECT_EQ(ids[i] % 3, 0);
+        nfound += I[i] == ids[i];
+    }
+    EXPECT_GE(nfound, nnew * 98 / 100);
+
+    // remove_ids compacts the index
+    faiss::IDSelectorRange range(0, 100);
+    size_t nremain = nb - index.ndeleted;
+    size_t nremove = 0;
+    for (int i = 0; i < 100; i++) {
+        nremove += !index.is_deleted(i);
+    }
+    index.remove_ids(range);
+    EXPECT_EQ(index.ntotal, nremain - nremove);
+    EXPECT_EQ(index.ndeleted, 0);
+    EXPECT_EQ(index.hnsw.levels.size(), index.ntotal);
+
+    std::vector<float> xremain(index.ntotal * d);
+    index.reconstruct_n(0, index.ntotal, xremain.data());
+    EXPECT_GE(self_recall(index, xremain.data(), index.ntotal), 0.98);
+}
+
+namespace {
+
+// flat storage that does not support removal
+struct NoRemoveIndexFlatL2 : faiss::IndexFlatL2 {
+    using faiss::IndexFlatL2::IndexFlatL2;
+    size_t remove_ids(const faiss::IDSelector& sel) override {
+        return faiss::Index::remove_ids(sel);
+    }
+};
+
+} // namespace
+
+TEST(HNSW, Test_compact_deleted_no_remove) {
+    int d = 16, nb = 500;
+    std::vector<float> xb(d * nb);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+
+    faiss::IndexHNSW index(new NoRemoveIndexFlatL2(d), 16);
+    index.own_fields = true;
+    index.add(nb, xb.data());
+
+    faiss::IDSelectorRange range(0, 100);
+    std::vector<faiss::HNSW::storage_idx_t> neighbors0(
+            index.hnsw.neighbors.begin(), index.hnsw.neighbors.end());
+    EXPECT_THROW(index.remove_ids(range), faiss::FaissException);
+
+    // the index is unchanged: the graph is not repaired and the vectors
+    // are not marked
+    EXPECT_EQ(index.ntotal, nb);
+    EXPECT_EQ(index.storage->ntotal, nb);
+    EXPECT_EQ(index.hnsw.levels.size(), nb);
+    std::vector<faiss::HNSW::storage_idx_t> neighbors1(
+            index.hnsw.neighbors.begin(), index.hnsw.neighbors.end());
+    EXPECT_EQ(neighbors0, neighbors1);
+    EXPECT_EQ(index.ndeleted, 0);
+    EXPECT_TRUE(index.free_slots.empty());
+    EXPECT_GE(self_recall(index, xb.data(), nb), 0.98);
+
+    // same with vectors that are already marked
+    index.mark_deleted(range);
+    EXPECT_THROW(index.compact_deleted(), faiss::FaissException);
+    neighbors1.assign(
+            index.hnsw.neighbors.begin(), index.hnsw.neighbors.end());
+    EXPECT_EQ(neighbors0, neighbors1);
+    EXPECT_EQ(index.ndeleted, 100);
+}
+
+TEST(HNSW, Test_visited_table_modes) {
+    size_t size = 100000;
+    std::vector<faiss::VisitedTable> tables;
+    for (auto mode :
+         {faiss::VisitedTable::VT_bytes,
+          faiss::VisitedTable::VT_bitset,
+          faiss::VisitedTable::VT_hash}) {
+        tables.emplace_back(size, mode);
+    }
+    std::mt19937 rng(123);
+    // more than 250 rounds to go through the epoch resets
+    for (int round = 0; round < 300; round++) {
+        // the last rounds insert enough elements to grow the hash table
+        int nins = round < 295 ? 50 : 5000;
+        std::unordered_set<int> ref;
+        for (int i = 0; i < nins; i++) {
+            int no = rng() % size;
+            ref.insert(no);
+            for (auto& vt : tables) {
+                vt.set(no);
+            }
+        }
+        for (int i = 0; i < 100; i++) {
+            int no = rng() % size;
+            for (auto& vt : tables) {
+                ASSERT_EQ(vt.get(no), ref.count(no) > 0);
+            }
+        }
+        for (int no : ref) {
+            for (auto& vt : tables) {
+                ASSERT_TRUE(vt.get(no));
+            }
+        }
+        for (auto& vt : tables) {
+            vt.advance();
+        }
+    }
+    EXPECT_LT(tables[1].memory_usage(), tables[0].memory_usage() / 6);
+
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode(1000, 16),
+            faiss::VisitedTable::VT_bytes);
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode(500000000, 64),
+            faiss::VisitedTable::VT_hash);
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode(500000000, 100000),
+            faiss::VisitedTable::VT_bitset);
+
+    // 64M elements: the bitset takes 1M * 9 bytes, the hash table is
+    // expected to take 512 * ef bytes, and must be 8 times smaller
+    size_t nbig = size_t(1) << 26;
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode(nbig, 2304),
+            faiss::VisitedTable::VT_hash);
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode(nbig, 2305),
+            faiss::VisitedTable::VT_bitset);
+    // at the 4M threshold the byte table is still used
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode(size_t(1) << 22, 1),
+            faiss::VisitedTable::VT_bytes);
+    EXPECT_EQ(
+            faiss::VisitedTable::choose_mode((size_t(1) << 22) + 1, 1),
+            faiss::VisitedTable::VT_hash);
+}
+
+TEST_F(HNSWTest, TEST_visited_table_modes) {
+    std::vector<faiss::idx_t> I_ref(k * nq);
+    std::vector<float> D_ref(k * nq);
+    index->search(nq, xq->data(), k, D_ref.data(), I_ref.data());
+
+    for (auto mode :
+         {faiss::VisitedTable::VT_bitset, faiss::VisitedTable::VT_hash}) {
+        faiss::VisitedTable vt(index->ntotal, mode);
+        using RH = faiss::HeapBlockResultHandler<faiss::HNSW::C>;
+        std::vector<faiss::idx_t> I(k * nq);
+        std::vector<float> D(k * nq);
+        RH bres(nq, D.data(), I.data(), k);
+        RH::SingleResultHandler res(bres);
+        std::unique_ptr<faiss::DistanceComputer> dis(
+                index->storage->get_distance_computer());
+        for (int i = 0; i < nq; i++) {
+            res.begin(i);
+            dis->set_query(xq->data() + i * index->d);
+            index->hnsw.search(*dis, res, vt);
+            res.end();
+        }
+        EXPECT_EQ(I, I_ref);
+        EXPECT_EQ(D, D_ref);
+    }
+}
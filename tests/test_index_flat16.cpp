@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexFlat16.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+#include <faiss/utils/bf16.h>
+#include <faiss/utils/fp16.h>
+#include <faiss/utils/random.h>
+
+namespace {
+
+int d = 67, nb = 3000;
+
+// compare the 16-bit index with an IndexFlat on the decoded vectors
+void test_flat16(bool bf16, faiss::MetricType metric, int nq, int k) {
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_randn(xb.data(), xb.size(), 1);
+    faiss::float_randn(xq.data(), xq.size(), 2);
+
+    faiss::IndexFlat16 index(d, bf16, metric);
+    index.add(nb, xb.data());
+    EXPECT_EQ(index.codes.size(), nb * d * 2);
+
+    std::vector<float> decoded(nb * d);
+    index.reconstruct_n(0, nb, decoded.data());
+    for (size_t i = 0; i < xb.size(); i++) {
+        float ref = bf16 ? faiss::decode_bf16(faiss::encode_bf16(xb[i]))
+                         : faiss::decode_fp16(faiss::encode_fp16(xb[i]));
+        ASSERT_EQ(decoded[i], ref);
+    }
+
+    faiss::IndexFlat ref(d, metric);
+    ref.add(nb, decoded.data());
+
+    std::vector<faiss::idx_t> I(nq * k), I_ref(nq * k);
+    std::vector<float> D(nq * k), D_ref(nq * k);
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    ref.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+
+    // the bf16 kernels may round the query to 16 bits of mantissa
+    int ndiff = 0;
+    for (int i = 0; i < nq * k; i++) {
+        EXPECT_NEAR(D[i], D_ref[i], 1e-3 * (std::fabs(D_ref[i]) + 1));
+        ndiff += I[i] != I_ref[i];
+    }
+    EXPECT_LE(ndiff, nq * k / 100);
+
+    // distance computer
+    std::unique_ptr<faiss::DistanceComputer> dc(index.get_distance_computer());
+    dc->set_query(xq.data());
+    for (int j = 0; j < k; j++) {
+        EXPECT_NEAR((*dc)(I[j]), D[j], 1e-3 * (std::fabs(D[j]) + 1));
+    }
+}
+
+} // namespace
+
+TEST(IndexFlat16, fp16_L2) {
+    test_flat16(false, faiss::METRIC_L2, 5, 10);
+    test_flat16(false, faiss::METRIC_L2, 200, 10);
+    test_flat16(false, faiss::METRIC_L2, 200, 1);
+}
+
+TEST(IndexFlat16, fp16_IP) {
+    test_flat16(false, faiss::METRIC_INNER_PRODUCT, 5, 10);
+    test_flat16(false, faiss::METRIC_INNER_PRODUCT, 200, 10);
+}
+
+TEST(IndexFlat16, bf16_L2) {
+    test_flat16(true, faiss::METRIC_L2, 5, 10);
+    test_flat16(true, faiss::METRIC_L2, 200, 10);
+}
+
+TEST(IndexFlat16, bf16_IP) {
+    test_flat16(true, faiss::METRIC_INNER_PRODUCT, 5, 10);
+    test_flat16(true, faiss::METRIC_INNER_PRODUCT, 200, 10);
+    test_flat16(true, faiss::METRIC_INNER_PRODUCT, 200, 200);
+}
+
+TEST(IndexFlat16, io_and_factory) {
+    int nq = 30, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_randn(xb.data(), xb.size(), 1);
+    faiss::float_randn(xq.data(), xq.size(), 2);
+
+    for (const char* desc : {"FlatFP16", "FlatBF16"}) {
+        std::unique_ptr<faiss::Index> index(
+                faiss::index_factory(d, desc, faiss::METRIC_INNER_PRODUCT));
+        index->add(nb, xb.data());
+
+        faiss::VectorIOWriter writer;
+        faiss::write_index(index.get(), &writer);
+        faiss::VectorIOReader reader;
+        reader.data = writer.data;
+        std::unique_ptr<faiss::Index> index2(faiss::read_index(&reader));
+
+        auto index16 = dynamic_cast<faiss::IndexFlat16*>(index2.get());
+        ASSERT_TRUE(index16);
+        EXPECT_EQ(index16->bf16, desc[4] == 'B');
+        EXPECT_EQ(index16->metric_type, faiss::METRIC_INNER_PRODUCT);
+
+        std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+        std::vector<float> D1(nq * k), D2(nq * k);
+        index->search(nq, xq.data(), k, D1.data(), I1.data());
+        index2->search(nq, xq.data(), k, D2.data(), I2.data());
+        EXPECT_EQ(I1, I2);
+        EXPECT_EQ(D1, D2);
+    }
+}
@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexScalarQuantizer.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/random.h>
+
+namespace {
+
+int d = 77, nb = 2000;
+
+std::vector<float> make_int8_data(size_t n, int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> distrib(-128, 127);
+    std::vector<float> x(n * d);
+    for (auto& v : x) {
+        v = distrib(rng);
+    }
+    return x;
+}
+
+// fraction of the reference k-nearest neighbors that are found
+float recall(
+        const std::vector<faiss::idx_t>& I,
+        const std::vector<faiss::idx_t>& I_ref,
+        int k) {
+    size_t nfound = 0;
+    for (size_t i = 0; i < I.size(); i += k) {
+        std::set<faiss::idx_t> ref(I_ref.begin() + i, I_ref.begin() + i + k);
+        for (int j = 0; j < k; j++) {
+            nfound += ref.count(I[i + j]);
+        }
+    }
+    return nfound / float(I.size());
+}
+
+// on integer data the SQ index must match an IndexFlat exactly, with float
+// and with int8 queries
+void test_int8_exact(
+        faiss::MetricType metric,
+        int nq,
+        int k,
+        faiss::ScalarQuantizer::QueryQuantization qq =
+                faiss::ScalarQuantizer::QQ_int8) {
+    std::vector<float> xb = make_int8_data(nb, 1);
+    std::vector<float> xq = make_int8_data(nq, 2);
+
+    faiss::IndexScalarQuantizer index(
+            d, faiss::ScalarQuantizer::QT_8bit_direct_signed, metric);
+    index.sq.query_quantization = qq;
+    index.add(nb, xb.data());
+    faiss::IndexFlat ref(d, metric);
+    ref.add(nb, xb.data());
+
+    std::vector<faiss::idx_t> I(nq * k), I_ref(nq * k);
+    std::vector<float> D(nq * k), D_ref(nq * k);
+    index.search(nq, xq.data(), k, D.data(), I.data());
+    ref.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+    EXPECT_EQ(D, D_ref);
+
+    std::unique_ptr<faiss::DistanceComputer> dc(index.get_distance_computer());
+    dc->set_query(xq.data());
+    for (int j = 0; j < k; j++) {
+        EXPECT_EQ((*dc)(I[j]), D[j]);
+    }
+    std::vector<float> y(d);
+    ref.reconstruct(I[0], y.data());
+    float sym = metric == faiss::METRIC_L2
+            ? faiss::fvec_L2sqr(y.data(), xb.data() + 3 * d, d)
+            : faiss::fvec_inner_product(y.data(), xb.data() + 3 * d, d);
+    EXPECT_EQ(dc->symmetric_dis(I[0], 3), sym);
+}
+
+} // namespace
+
+TEST(Int8SQ, exact_L2) {
+    test_int8_exact(faiss::METRIC_L2, 5, 10);
+    test_int8_exact(faiss::METRIC_L2, 3, 10);
+    test_int8_exact(faiss::METRIC_L2, 200, 10);
+    test_int8_exact(
+            faiss::METRIC_L2, 5, 10, faiss::ScalarQuantizer::QQ_none);
+}
+
+TEST(Int8SQ, exact_IP) {
+    test_int8_exact(faiss::METRIC_INNER_PRODUCT, 5, 10);
+    test_int8_exact(faiss::METRIC_INNER_PRODUCT, 200, 10);
+    test_int8_exact(
+            faiss::METRIC_INNER_PRODUCT,
+            5,
+            10,
+            faiss::ScalarQuantizer::QQ_none);
+}
+
+// float queries are quantized only when query_quantization is set, the
+// distances are then approximate
+TEST(Int8SQ, float_queries) {
+    int nq = 50;
+    std::vector<float> xb = make_int8_data(nb, 1);
+    std::vector<float> xq(nq * d);
+    faiss::float_randn(xq.data(), xq.size(), 3);
+    for (auto& v : xq) {
+        v *= 20;
+    }
+
+    for (auto metric : {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        faiss::IndexScalarQuantizer index(
+                d, faiss::ScalarQuantizer::QT_8bit_direct_signed, metric);
+        index.add(nb, xb.data());
+        std::unique_ptr<faiss::DistanceComputer> dc_float(
+                index.get_distance_computer());
+        index.sq.query_quantization = faiss::ScalarQuantizer::QQ_int8;
+        std::unique_ptr<faiss::DistanceComputer> dc(
+                index.get_distance_computer());
+        faiss::IndexFlat ref(d, metric);
+        ref.add(nb, xb.data());
+        std::unique_ptr<faiss::DistanceComputer> dc_ref(
+                ref.get_distance_computer());
+
+        for (int i = 0; i < nq; i++) {
+            dc->set_query(xq.data() + i * d);
+            dc_float->set_query(xq.data() + i * d);
+            dc_ref->set_query(xq.data() + i * d);
+            for (int j = 0; j < 20; j++) {
+                float dis_ref = (*dc_ref)(j);
+                // by default the query is not quantized
+                EXPECT_NEAR(
+                        (*dc_float)(j),
+                        dis_ref,
+                        1e-5 * std::fabs(dis_ref) + 0.1);
+                // quantization error of the query: at most scale / 2 per
+                // component, times |y| <= 128
+                EXPECT_NEAR(
+                        (*dc)(j), dis_ref, 0.01 * std::fabs(dis_ref) + 1e3);
+            }
+        }
+
+        // the batched and the one-query search should agree
+        int k = 5;
+        std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+        std::vector<float> D1(nq * k), D2(nq * k);
+        index.search(nq, xq.data(), k, D1.data(), I1.data());
+        for (int i = 0; i < nq; i++) {
+            index.search(
+                    1,
+                    xq.data() + i * d,
+                    k,
+                    D2.data() + i * k,
+                    I2.data() + i * k);
+        }
+        EXPECT_EQ(D1, D2);
+    }
+}
+
+TEST(Int8SQ, ivf_scanner) {
+    int nq = 20, k = 10;
+    std::vector<float> xb = make_int8_data(nb, 1);
+    std::vector<float> xq = make_int8_data(nq, 2);
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFScalarQuantizer index(
+            &quantizer,
+            d,
+            16,
+            faiss::ScalarQuantizer::QT_8bit_direct_signed,
+            faiss::METRIC_L2,
+            false);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    index.nprobe = 16;
+
+    faiss::IndexFlatL2 ref(d);
+    ref.add(nb, xb.data());
+
+    std::vector<faiss::idx_t> I(nq * k), I_ref(nq * k);
+    std::vector<float> D(nq * k), D_ref(nq * k);
+    ref.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+    for (auto qq :
+         {faiss::ScalarQuantizer::QQ_none, faiss::ScalarQuantizer::QQ_int8}) {
+        index.sq.query_quantization = qq;
+        index.search(nq, xq.data(), k, D.data(), I.data());
+        EXPECT_EQ(D, D_ref);
+    }
+}
+
+// QT_8bit and QT_8bit_uniform distances computed on a quantized query
+TEST(Int8SQ, quantized_query) {
+    int nq = 50, k = 10;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_randn(xb.data(), xb.size(), 1);
+    faiss::float_randn(xq.data(), xq.size(), 2);
+
+    for (auto qtype :
+         {faiss::ScalarQuantizer::QT_8bit,
+          faiss::ScalarQuantizer::QT_8bit_uniform}) {
+        for (auto metric : {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+            faiss::IndexScalarQuantizer index(d, qtype, metric);
+            index.train(nb, xb.data());
+            index.add(nb, xb.data());
+
+            std::vector<faiss::idx_t> I_ref(nq * k);
+            std::vector<float> D_ref(nq * k);
+            index.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+
+            for (auto qq :
+                 {faiss::ScalarQuantizer::QQ_int16,
+                  faiss::ScalarQuantizer::QQ_int8}) {
+                index.sq.query_quantization = qq;
+                std::vector<faiss::idx_t> I(nq * k);
+                std::vector<float> D(nq * k);
+                index.search(nq, xq.data(), k, D.data(), I.data());
+
+                // the 7-bit weights are about 100x less accurate
+                bool int16 = qq == faiss::ScalarQuantizer::QQ_int16;
+                float tol = int16 ? 1e-3 : 2e-2;
+                for (int i = 0; i < nq * k; i++) {
+                    EXPECT_NEAR(
+                            D[i], D_ref[i], tol * (std::fabs(D_ref[i]) + 1));
+                }
+                EXPECT_GE(recall(I, I_ref, k), int16 ? 0.98 : 0.9);
+            }
+        }
+    }
+}
+
+TEST(Int8SQ, quantized_query_ivf) {
+    int nq = 50, k = 10;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_randn(xb.data(), xb.size(), 1);
+    faiss::float_randn(xq.data(), xq.size(), 2);
+
+    for (auto metric : {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        faiss::IndexFlat quantizer(d, metric);
+        faiss::IndexIVFScalarQuantizer index(
+                &quantizer, d, 16, faiss::ScalarQuantizer::QT_8bit, metric);
+        index.train(nb, xb.data());
+        index.add(nb, xb.data());
+        index.nprobe = 4;
+
+        std::vector<faiss::idx_t> I_ref(nq * k), I(nq * k);
+        std::vector<float> D_ref(nq * k), D(nq * k);
+        index.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+        index.sq.query_quantization = faiss::ScalarQuantizer::QQ_int16;
+        index.search(nq, xq.data(), k, D.data(), I.data());
+        for (int i = 0; i < nq * k; i++) {
+            EXPECT_NEAR(D[i], D_ref[i], 1e-3 * (std::fabs(D_ref[i]) + 1));
+        }
+        EXPECT_GE(recall(I, I_ref, k), 0.95);
+    }
+}
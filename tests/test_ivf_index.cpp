@@ -7,11 +7,13 @@
 
 #include <omp.h>
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <random>
 #include <set>
 
@@ -20,6 +22,8 @@
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexIVFFlat.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/index_factory.h>
 #include <faiss/index_io.h>
 
 namespace {
@@ -242,3 +246,139 @@ TEST(IVF, list_context) {
                 << "should return the query vector";
     }
 }
+
+TEST(IVF, cached_invlists) {
+    int d = 16, nlist = 50, nb = 10000, nq = 200, k = 10;
+
+    std::mt19937 rng;
+    std::uniform_real_distribution<> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& x : xb) {
+        x = distrib(rng);
+    }
+    for (auto& x : xq) {
+        x = distrib(rng);
+    }
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFFlat index(&quantizer, d, nlist);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    index.nprobe = 4;
+
+    std::vector<float> ref_D(nq * k), D(nq * k);
+    std::vector<faiss::idx_t> ref_I(nq * k), I(nq * k);
+    index.search(nq, xq.data(), k, ref_D.data(), ref_I.data());
+
+    std::unique_ptr<faiss::InvertedLists> il(index.invlists);
+    index.own_invlists = false;
+    size_t total_bytes = nb * (index.code_size + sizeof(faiss::idx_t));
+
+    // large enough for all lists, a fraction of the lists, no list
+    for (size_t max_bytes : {total_bytes, total_bytes / 4, size_t(0)}) {
+        faiss::CachedInvertedLists cached(il.get(), max_bytes);
+        index.replace_invlists(&cached, false);
+        for (int run = 0; run < 2; run++) {
+            index.search(nq, xq.data(), k, D.data(), I.data());
+            EXPECT_EQ(ref_I, I);
+            EXPECT_EQ(ref_D, D);
+        }
+        EXPECT_LE(cached.cached_bytes(), max_bytes);
+        if (max_bytes == total_bytes) {
+            // the second run is served from the cache
+            EXPECT_EQ(cached.nevict, 0);
+            EXPECT_GE(cached.nhit, cached.nmiss);
+        } else if (max_bytes == 0) {
+            EXPECT_EQ(cached.nhit, 0);
+        } else {
+            EXPECT_GT(cached.nevict, 0);
+        }
+        cached.clear_cache();
+        EXPECT_EQ(cached.cached_bytes(), 0);
+        index.replace_invlists(il.get(), false);
+    }
+}
+
+namespace {
+
+void test_list_major(
+        const char* factory_string,
+        bool with_selector,
+        int nprobe = 8,
+        faiss::MetricType metric = faiss::METRIC_L2) {
+    int d = 32, nb = 20000, nq = 300, k = 10;
+
+    std::mt19937 rng(123);
+    std::uniform_real_distribution<> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& x : xb) {
+        x = distrib(rng);
+    }
+    for (auto& x : xq) {
+        x = distrib(rng);
+    }
+
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, factory_string, metric));
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    auto ivf = dynamic_cast<faiss::IndexIVF*>(index.get());
+    ASSERT_TRUE(ivf);
+
+    faiss::IDSelectorRange sel(1000, 15000, true);
+    faiss::SearchParametersIVF params;
+    params.nprobe = nprobe;
+    params.sel = with_selector ? &sel : nullptr;
+
+    std::vector<float> ref_D(nq * k), D(nq * k);
+    std::vector<faiss::idx_t> ref_I(nq * k), I(nq * k);
+    ivf->parallel_mode = 0;
+    index->search(nq, xq.data(), k, ref_D.data(), ref_I.data(), &params);
+    ivf->parallel_mode = 4;
+    index->search(nq, xq.data(), k, D.data(), I.data(), &params);
+
+    // the distances are computed by the same code (up to the
+    // accumulation order of the PQ tables), only the order of ties can
+    // differ
+    for (size_t i = 0; i < ref_D.size(); i++) {
+        EXPECT_NEAR(ref_D[i], D[i], 1e-5 * std::abs(ref_D[i]));
+    }
+    size_t ndiff = 0;
+    for (size_t i = 0; i < ref_I.size(); i++) {
+        ndiff += ref_I[i] != I[i];
+    }
+    EXPECT_LE(ndiff, ref_I.size() / 100);
+}
+
+} // namespace
+
+TEST(IVF, list_major_Flat) {
+    test_list_major("IVF32,Flat", false);
+}
+
+TEST(IVF, list_major_SQ8) {
+    test_list_major("IVF32,SQ8", false);
+}
+
+TEST(IVF, list_major_PQ) {
+    test_list_major("IVF32,PQ8x4np", false);
+}
+
+TEST(IVF, list_major_selector) {
+    test_list_major("IVF32,Flat", true);
+}
+
+TEST(IVF, list_major_tiles) {
+    // lists of about 5000 * 128 bytes, scanned in 3 tiles by groups of
+    // queries
+    test_list_major("IVF4,Flat", false, 2);
+    test_list_major("IVF4,SQ8", true, 2);
+}
+
+TEST(IVF, list_major_IP) {
+    // the inner product adds the coarse distance to the residual IVFSQ
+    // distances
+    test_list_major("IVF32,Flat", false, 8, faiss::METRIC_INNER_PRODUCT);
+    test_list_major("IVF32,SQ8", false, 8, faiss::METRIC_INNER_PRODUCT);
+    test_list_major("IVF4,SQ8", true, 2, faiss::METRIC_INNER_PRODUCT);
+}
@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/index_factory.h>
+
+/* Searching with the look-up tables computed by batches of queries
+ * (IndexIVFPQ::lut_batch_size) gives the same results as with the tables
+ * computed per query, up to float rounding. */
+
+namespace {
+
+int d = 32;
+size_t nb = 2000;
+size_t nq = 100;
+int k = 10;
+
+std::vector<float> make_data(size_t n, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+std::unique_ptr<faiss::IndexIVFPQ> make_index(
+        const char* factory_string,
+        faiss::MetricType metric = faiss::METRIC_L2) {
+    std::unique_ptr<faiss::IndexIVFPQ> index(dynamic_cast<faiss::IndexIVFPQ*>(
+            faiss::index_factory(d, factory_string, metric)));
+    std::vector<float> xb = make_data(nb, 123);
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    index->nprobe = 4;
+    return index;
+}
+
+void compare_batched(faiss::IndexIVFPQ& index) {
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+
+    for (int pmode : {0, 4}) {
+        index.parallel_mode = pmode;
+        index.lut_batch_size = 0;
+        index.search(nq, xq.data(), k, D1.data(), I1.data());
+        // not a divisor of nq
+        index.lut_batch_size = 32;
+        index.search(nq, xq.data(), k, D2.data(), I2.data());
+
+        size_t ndiff = 0;
+        for (size_t i = 0; i < nq * k; i++) {
+            EXPECT_NEAR(D1[i], D2[i], 1e-5 * std::abs(D1[i]) + 1e-5);
+            ndiff += I1[i] != I2[i];
+        }
+        EXPECT_LT(ndiff, nq * k / 100);
+    }
+}
+
+} // namespace
+
+TEST(TestIVFPQBatchLUT, L2_residual) {
+    // dsub = 4 and 16, the latter computes the tables with GEMMs
+    for (const char* factory_string : {"IVF16,PQ8x4", "IVF16,PQ2x4"}) {
+        auto index = make_index(factory_string);
+        EXPECT_EQ(index->use_precomputed_table, 1);
+        compare_batched(*index);
+
+        // the list tables are shared between the queries of the batches
+        index->use_precomputed_table = -1;
+        compare_batched(*index);
+    }
+}
+
+TEST(TestIVFPQBatchLUT, L2_no_residual) {
+    auto index = make_index("IVF16,PQ8x4");
+    index->by_residual = false;
+    index->reset();
+    std::vector<float> xb = make_data(nb, 123);
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    compare_batched(*index);
+}
+
+TEST(TestIVFPQBatchLUT, IP) {
+    auto index = make_index("IVF16,PQ8x4", faiss::METRIC_INNER_PRODUCT);
+    compare_batched(*index);
+}
+
+// the coarse distances are inner products, they cannot be reused in the
+// L2 distance tables
+TEST(TestIVFPQBatchLUT, L2_IP_quantizer) {
+    faiss::IndexFlatIP quantizer(d);
+    faiss::IndexIVFPQ index(&quantizer, d, 16, 8, 4);
+    std::vector<float> xb = make_data(nb, 123);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    index.nprobe = 4;
+    compare_batched(index);
+
+    index.use_precomputed_table = -1;
+    compare_batched(index);
+}
+
+// polysemous filtering set in the search parameters disables the batched
+// tables, as when it is set in the index
+TEST(TestIVFPQBatchLUT, polysemous_params) {
+    auto index = make_index("IVF16,PQ4np");
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+
+    faiss::IVFPQSearchParameters params;
+    params.nprobe = 4;
+    params.polysemous_ht = 12;
+
+    faiss::indexIVFPQ_stats.reset();
+    index->search(nq, xq.data(), k, D1.data(), I1.data(), &params);
+    size_t n_hamming_pass = faiss::indexIVFPQ_stats.n_hamming_pass;
+    EXPECT_GT(n_hamming_pass, 0);
+
+    index->lut_batch_size = 32;
+    faiss::indexIVFPQ_stats.reset();
+    index->search(nq, xq.data(), k, D2.data(), I2.data(), &params);
+    EXPECT_EQ(faiss::indexIVFPQ_stats.n_hamming_pass, n_hamming_pass);
+    EXPECT_EQ(D1, D2);
+    EXPECT_EQ(I1, I2);
+}
+
+TEST(TestIVFPQBatchLUT, stats) {
+    auto index = make_index("IVF16,PQ8x4");
+    index->use_precomputed_table = -1;
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> D(nq * k);
+    std::vector<faiss::idx_t> I(nq * k);
+
+    faiss::indexIVF_stats.reset();
+    index->search(nq, xq.data(), k, D.data(), I.data());
+    faiss::IndexIVFStats stats_ref = faiss::indexIVF_stats;
+
+    faiss::indexIVF_stats.reset();
+    index->lut_batch_size = 32;
+    index->search(nq, xq.data(), k, D.data(), I.data());
+    EXPECT_EQ(faiss::indexIVF_stats.nq, stats_ref.nq);
+    EXPECT_EQ(faiss::indexIVF_stats.nlist, stats_ref.nlist);
+    EXPECT_EQ(faiss::indexIVF_stats.ndis, stats_ref.ndis);
+}
@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexPQ.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+
+#include "test_util.h"
+
+namespace {
+
+pthread_mutex_t temp_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+std::vector<float> make_data(size_t n, size_t d, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+// search the index read normally and with mmap, results should be identical
+void test_mmap_read(const char* factory_string, const char* tmpname) {
+    Tempfilename fname(&temp_file_mutex, tmpname);
+    int d = 32, nb = 1000, nq = 20, k = 10;
+    std::vector<float> xb = make_data(nb, d, 123);
+    std::vector<float> xq = make_data(nq, d, 456);
+
+    {
+        std::unique_ptr<faiss::Index> index(
+                faiss::index_factory(d, factory_string));
+        index->train(nb, xb.data());
+        index->add(nb, xb.data());
+        faiss::write_index(index.get(), fname.c_str());
+    }
+
+    std::unique_ptr<faiss::Index> index1(faiss::read_index(fname.c_str()));
+    std::unique_ptr<faiss::Index> index2(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC));
+
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    index1->search(nq, xq.data(), k, D1.data(), I1.data());
+    index2->search(nq, xq.data(), k, D2.data(), I2.data());
+
+    EXPECT_EQ(I1, I2);
+    EXPECT_EQ(D1, D2);
+}
+
+} // namespace
+
+TEST(MMAP, flat) {
+    test_mmap_read("Flat", "/tmp/faiss_test_mmap_flat");
+}
+
+TEST(MMAP, pq) {
+    test_mmap_read("PQ8x4np", "/tmp/faiss_test_mmap_pq");
+}
+
+TEST(MMAP, hnsw) {
+    test_mmap_read("HNSW16,Flat", "/tmp/faiss_test_mmap_hnsw");
+}
+
+TEST(MMAP, fields_are_views) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_test_mmap_views");
+    int d = 16, nb = 500;
+    std::vector<float> xb = make_data(nb, d, 789);
+    {
+        faiss::IndexHNSWFlat index(d, 8);
+        index.add(nb, xb.data());
+        faiss::write_index(&index, fname.c_str());
+    }
+    std::unique_ptr<faiss::IndexHNSW> index(dynamic_cast<faiss::IndexHNSW*>(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC)));
+    ASSERT_TRUE(index);
+    EXPECT_FALSE(index->hnsw.neighbors.is_owned);
+    EXPECT_FALSE(index->hnsw.offsets.is_owned);
+    EXPECT_FALSE(index->hnsw.levels.is_owned);
+    auto storage = dynamic_cast<faiss::IndexFlat*>(index->storage);
+    ASSERT_TRUE(storage);
+    EXPECT_FALSE(storage->codes.is_owned);
+    EXPECT_EQ(storage->codes.size(), nb * d * sizeof(float));
+
+    // the storage is read-only, but can be turned into an owned copy
+    EXPECT_THROW(index->add(1, xb.data()), faiss::FaissException);
+    storage->codes.to_owned();
+    EXPECT_TRUE(storage->codes.is_owned);
+    EXPECT_EQ(storage->codes.size(), nb * d * sizeof(float));
+}
+
+TEST(MMAP, modify_view_throws) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_test_mmap_modify");
+    int d = 16, nb = 100;
+    std::vector<float> xb = make_data(nb, d, 789);
+    {
+        faiss::IndexFlatL2 index(d);
+        index.add(nb, xb.data());
+        faiss::write_index(&index, fname.c_str());
+    }
+    std::unique_ptr<faiss::IndexFlat> index(dynamic_cast<faiss::IndexFlat*>(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC)));
+    ASSERT_TRUE(index);
+
+    // the mapping is read-only: writes must throw instead of crashing
+    faiss::IDSelectorRange sel(0, 1);
+    EXPECT_THROW(index->remove_ids(sel), faiss::FaissException);
+    EXPECT_THROW(index->get_xb(), faiss::FaissException);
+    EXPECT_EQ(index->ntotal, nb);
+
+    index->codes.to_owned();
+    EXPECT_EQ(index->remove_ids(sel), 1);
+    EXPECT_EQ(index->ntotal, nb - 1);
+}
+
+// permute_entries only reads the viewed tables, it must work on a view
+TEST(MMAP, permute_view) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_test_mmap_permute");
+    int d = 16, nb = 300, nq = 10, k = 5;
+    std::vector<float> xb = make_data(nb, d, 789);
+    std::vector<float> xq = make_data(nq, d, 456);
+    {
+        faiss::IndexHNSWFlat index(d, 8);
+        index.add(nb, xb.data());
+        faiss::write_index(&index, fname.c_str());
+    }
+    std::unique_ptr<faiss::IndexHNSW> index1(dynamic_cast<faiss::IndexHNSW*>(
+            faiss::read_index(fname.c_str())));
+    std::unique_ptr<faiss::IndexHNSW> index2(dynamic_cast<faiss::IndexHNSW*>(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC)));
+    ASSERT_TRUE(index1 && index2);
+
+    std::vector<faiss::idx_t> perm(nb);
+    for (int i = 0; i < nb; i++) {
+        perm[i] = (i * 7) % nb;
+    }
+    index1->permute_entries(perm.data());
+    index2->permute_entries(perm.data());
+    EXPECT_TRUE(index2->hnsw.neighbors.is_owned);
+
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    index1->search(nq, xq.data(), k, D1.data(), I1.data());
+    index2->search(nq, xq.data(), k, D2.data(), I2.data());
+    EXPECT_EQ(I1, I2);
+    EXPECT_EQ(D1, D2);
+}
+
+// the interleaved level 0 is a copy, it can be built from a view
+TEST(MMAP, interleaved_level_0_view) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_test_mmap_interleaved");
+    int d = 16, nb = 300, nq = 10, k = 5;
+    std::vector<float> xb = make_data(nb, d, 789);
+    std::vector<float> xq = make_data(nq, d, 456);
+    {
+        faiss::IndexHNSWFlat index(d, 8);
+        index.add(nb, xb.data());
+        faiss::write_index(&index, fname.c_str());
+    }
+    std::unique_ptr<faiss::IndexHNSW> index(dynamic_cast<faiss::IndexHNSW*>(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC)));
+    ASSERT_TRUE(index);
+
+    std::vector<float> D_ref(nq * k);
+    std::vector<faiss::idx_t> I_ref(nq * k);
+    index->search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+    for (bool with_codes : {false, true}) {
+        index->set_interleaved_level_0(with_codes);
+        EXPECT_FALSE(index->hnsw.neighbors.is_owned);
+        std::vector<float> D(nq * k);
+        std::vector<faiss::idx_t> I(nq * k);
+        index->search(nq, xq.data(), k, D.data(), I.data());
+        EXPECT_EQ(I, I_ref);
+        EXPECT_EQ(D, D_ref);
+    }
+}
+
+// repairing writes the graph: it throws on a view, and works once the
+// neighbors are owned
+TEST(MMAP, repair_deleted_view) {
+    Tempfilename fname(&temp_file_mutex, "/tmp/faiss_test_mmap_repair");
+    int d = 16, nb = 300;
+    std::vector<float> xb = make_data(nb, d, 789);
+    {
+        faiss::IndexHNSWFlat index(d, 8);
+        index.add(nb, xb.data());
+        faiss::write_index(&index, fname.c_str());
+    }
+    std::unique_ptr<faiss::IndexHNSW> index(dynamic_cast<faiss::IndexHNSW*>(
+            faiss::read_index(fname.c_str(), faiss::IO_FLAG_MMAP_IFC)));
+    ASSERT_TRUE(index);
+
+    faiss::IDSelectorRange sel(0, 30);
+    EXPECT_EQ(index->mark_deleted(sel), 30);
+    EXPECT_THROW(index->repair_deleted(), faiss::FaissException);
+    index->hnsw.neighbors.to_owned();
+    EXPECT_FALSE(index->hnsw.offsets.is_owned);
+    EXPECT_EQ(index->repair_deleted(), 30);
+}
@@ -7,6 +7,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <random>
 
 #include <omp.h>
@@ -205,3 +206,118 @@ TEST(ONDISK, make_invlists_threaded) {
     }
     EXPECT_EQ(ntot, nadd);
 }
+
+TEST(ONDISK, async_reads) {
+    int d = 8;
+    int nlist = 30, nq = 200, nb = 1500, k = 10;
+    faiss::IndexFlatL2 quantizer(d);
+    {
+        std::vector<float> x(d * nlist);
+        faiss::float_rand(x.data(), d * nlist, 12345);
+        quantizer.add(nlist, x.data());
+    }
+    std::vector<float> xb(d * nb);
+    faiss::float_rand(xb.data(), d * nb, 23456);
+
+    faiss::IndexIVFFlat index(&quantizer, d, nlist);
+    index.nprobe = 5;
+    index.add(nb, xb.data());
+
+    std::vector<float> xq(d * nq);
+    faiss::float_rand(xq.data(), d * nq, 34567);
+
+    std::vector<float> ref_D(nq * k);
+    std::vector<faiss::idx_t> ref_I(nq * k);
+    index.search(nq, xq.data(), k, ref_D.data(), ref_I.data());
+
+    Tempfilename filename;
+
+    faiss::IndexIVFFlat index2(&quantizer, d, nlist);
+    index2.nprobe = 5;
+    faiss::OnDiskInvertedLists ivf(
+            index.nlist, index.code_size, filename.c_str());
+    index2.replace_invlists(&ivf);
+    index2.add(nb, xb.data());
+
+    // list 0 is served from the buffer pool after a prefetch
+    ivf.async_buffer_size = 1 << 20;
+    faiss::idx_t list_no = 0;
+    ivf.prefetch_lists(&list_no, 1);
+    {
+        faiss::InvertedLists::ScopedCodes codes(&ivf, 0);
+        faiss::InvertedLists::ScopedIds ids(&ivf, 0);
+        EXPECT_TRUE(
+                codes.get() < ivf.ptr ||
+                codes.get() >= ivf.ptr + ivf.totsize);
+        size_t n = ivf.list_size(0);
+        EXPECT_EQ(
+                memcmp(codes.get(), ivf.mmap_codes(0), n * ivf.code_size), 0);
+        EXPECT_EQ(
+                memcmp(ids.get(), ivf.mmap_ids(0), n * sizeof(faiss::idx_t)),
+                0);
+    }
+
+    // the fetched lists are not evicted before they are scanned, the
+    // lists that do not fit are read from the mmap
+    auto nbytes = [&](int l) {
+        return ivf.lists[l].capacity * (ivf.code_size + sizeof(faiss::idx_t));
+    };
+    auto in_pool = [&](const uint8_t* p) {
+        return p < ivf.ptr || p >= ivf.ptr + ivf.totsize;
+    };
+    ivf.async_buffer_size = nbytes(0) + nbytes(1);
+    std::vector<faiss::idx_t> list_nos = {0, 1, 2};
+    ivf.prefetch_lists(list_nos.data(), list_nos.size());
+    for (int l : {0, 1, 2}) {
+        faiss::InvertedLists::ScopedCodes codes(&ivf, l);
+        EXPECT_EQ(in_pool(codes.get()), l < 2);
+    }
+
+    // the buffer pool can hold all, a few or none of the lists, on a fresh
+    // index for each number of I/O threads
+    size_t list_nbytes =
+            ivf.lists[0].capacity * (ivf.code_size + sizeof(faiss::idx_t));
+    for (int nt : {0, 4}) {
+        Tempfilename filename3;
+        faiss::IndexIVFFlat index3(&quantizer, d, nlist);
+        index3.nprobe = 5;
+        faiss::OnDiskInvertedLists ivf3(
+                index.nlist, index.code_size, filename3.c_str());
+        ivf3.async_nthread = nt;
+        index3.replace_invlists(&ivf3);
+        index3.add(nb, xb.data());
+
+        for (size_t bs : {size_t(1) << 20, 4 * list_nbytes, size_t(1)}) {
+            ivf3.async_buffer_size = bs;
+
+            std::vector<float> new_D(nq * k);
+            std::vector<faiss::idx_t> new_I(nq * k);
+            index3.search(nq, xq.data(), k, new_D.data(), new_I.data());
+
+            EXPECT_EQ(ref_D, new_D);
+            EXPECT_EQ(ref_I, new_I);
+        }
+    }
+
+    // a change of the number of I/O threads takes effect at the next
+    // prefetch
+    ivf.async_buffer_size = 1 << 20;
+    for (int nt : {4, 0, 2}) {
+        ivf.async_nthread = nt;
+        std::vector<float> new_D(nq * k);
+        std::vector<faiss::idx_t> new_I(nq * k);
+        index2.search(nq, xq.data(), k, new_D.data(), new_I.data());
+        EXPECT_EQ(ref_D, new_D);
+        EXPECT_EQ(ref_I, new_I);
+    }
+
+    // modifying a list drops it from the buffer pool
+    ivf.async_buffer_size = 1 << 20;
+    ivf.prefetch_lists(&list_no, 1);
+    std::vector<uint8_t> code(ivf.code_size, 7);
+    ivf.add_entry(0, 12345, code.data());
+    {
+        faiss::InvertedLists::ScopedIds ids(&ivf, 0);
+        EXPECT_EQ(ids[ivf.list_size(0) - 1], 12345);
+    }
+}
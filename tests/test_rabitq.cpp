@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVFRaBitQ.h>
+#include <faiss/IndexPreTransform.h>
+#include <faiss/IndexRaBitQ.h>
+#include <faiss/IndexRefine.h>
+#include <faiss/impl/RaBitQuantizer.h>
+#include <faiss/impl/SearchTrace.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+#include <faiss/utils/distances.h>
+
+namespace {
+
+int d = 64;
+size_t nb = 5000;
+size_t nq = 50;
+
+/// clustered data, so that the bounds can separate the neighbors
+std::vector<float> make_data(size_t n, int seed) {
+    int nc = 50;
+    std::vector<float> centers(nc * d);
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> g;
+    for (auto& v : centers) {
+        v = g(rng);
+    }
+    std::vector<float> x(n * d);
+    rng.seed(seed);
+    for (size_t i = 0; i < n; i++) {
+        const float* c = centers.data() + rng() % nc * d;
+        for (int j = 0; j < d; j++) {
+            x[i * d + j] = c[j] + 0.3 * g(rng);
+        }
+    }
+    return x;
+}
+
+std::unique_ptr<faiss::Index> make_index(
+        const char* factory_string,
+        faiss::MetricType metric = faiss::METRIC_L2) {
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, factory_string, metric));
+    std::vector<float> xb = make_data(nb, 123);
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    return index;
+}
+
+/// fraction of the exact 10-NN found in the first k results
+double recall_10_at(
+        const faiss::Index* index,
+        int k,
+        const faiss::SearchParameters* params = nullptr) {
+    faiss::IndexFlat ref(d, index->metric_type);
+    std::vector<float> xb = make_data(nb, 123);
+    ref.add(nb, xb.data());
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> Dref(nq * 10), D(nq * k);
+    std::vector<faiss::idx_t> Iref(nq * 10), I(nq * k);
+    ref.search(nq, xq.data(), 10, Dref.data(), Iref.data());
+    index->search(nq, xq.data(), k, D.data(), I.data(), params);
+    size_t nfound = 0;
+    for (size_t i = 0; i < nq; i++) {
+        std::set<faiss::idx_t> res(I.begin() + i * k, I.begin() + (i + 1) * k);
+        for (int j = 0; j < 10; j++) {
+            nfound += res.count(Iref[i * 10 + j]);
+        }
+    }
+    return nfound / double(nq * 10);
+}
+
+} // namespace
+
+TEST(RaBitQ, recall) {
+    for (auto metric : {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        auto index = make_index("RR,RaBitQ", metric);
+        EXPECT_GT(recall_10_at(index.get(), 100), 0.8);
+
+        auto index_ivf = make_index("RR,IVF16,RaBitQ", metric);
+        faiss::SearchParametersIVFRaBitQ params;
+        params.nprobe = 16;
+        EXPECT_GT(recall_10_at(index_ivf.get(), 100, &params), 0.8);
+    }
+}
+
+TEST(RaBitQ, query_bits) {
+    faiss::RaBitQuantizer rq(d);
+    std::vector<float> xb = make_data(nb, 123);
+    std::vector<uint8_t> codes(nb * rq.code_size);
+    rq.compute_codes(xb.data(), codes.data(), nb);
+    std::vector<float> xq = make_data(1, 456);
+
+    // the query quantization error decreases with the nb of bits
+    faiss::RaBitQQuery q0(rq, 0), q4(rq, 4), q8(rq, 8);
+    q0.set_query(xq.data(), nullptr);
+    q4.set_query(xq.data(), nullptr);
+    q8.set_query(xq.data(), nullptr);
+    EXPECT_LT(q8.quant_error, q4.quant_error);
+    // ... and is small w.r.t. the error of the codes
+    double err0 = 0, err4 = 0, err8 = 0;
+    for (size_t i = 0; i < nb; i++) {
+        const uint8_t* code = codes.data() + i * rq.code_size;
+        float ip0 = q0.inner_product(code);
+        float ip = faiss::fvec_inner_product(xb.data() + i * d, xq.data(), d);
+        err0 += std::abs(ip0 - ip);
+        err4 += std::abs(q4.inner_product(code) - ip0);
+        err8 += std::abs(q8.inner_product(code) - ip0);
+    }
+    EXPECT_LT(err8, err4);
+    EXPECT_LT(err4, 0.5 * err0);
+}
+
+TEST(RaBitQ, bounds) {
+    auto index = make_index("RR,RaBitQ");
+    std::vector<float> xb = make_data(nb, 123);
+    std::vector<float> xq = make_data(nq, 456);
+    faiss::SearchParametersRaBitQ params;
+    params.epsilon = 3;
+    std::vector<float> D(nq * nb);
+    std::vector<faiss::idx_t> I(nq * nb);
+    index->search(nq, xq.data(), nb, D.data(), I.data(), &params);
+    size_t nfail = 0;
+    for (size_t i = 0; i < nq * nb; i++) {
+        float dis = faiss::fvec_L2sqr(
+                xq.data() + i / nb * d, xb.data() + I[i] * d, d);
+        nfail += D[i] > dis;
+    }
+    EXPECT_LT(nfail, nq * nb / 1000);
+}
+
+TEST(RaBitQ, refine_with_bounds) {
+    auto base = make_index("RR,RaBitQ");
+    std::vector<float> xb = make_data(nb, 123);
+    faiss::IndexRefineFlat index(base.get(), xb.data());
+    std::vector<float> xq = make_data(nq, 456);
+    int k = 10;
+
+    // the same candidates, ordered by their bounds
+    faiss::SearchParametersRaBitQ base_params;
+    base_params.epsilon = 3;
+    faiss::IndexRefineSearchParameters params;
+    params.k_factor = 50;
+    params.base_index_params = &base_params;
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    index.search(nq, xq.data(), k, D1.data(), I1.data(), &params);
+
+    params.base_distances_are_bounds = true;
+    faiss::SearchTrace trace;
+    params.trace = &trace;
+    index.search(nq, xq.data(), k, D2.data(), I2.data(), &params);
+
+    size_t ndis = 0, ndiff = 0;
+    for (size_t i = 0; i < nq; i++) {
+        ndis += trace.queries[i].ndis;
+        for (int j = 0; j < k; j++) {
+            ndiff += I1[i * k + j] != I2[i * k + j];
+        }
+    }
+    EXPECT_LT(ndiff, nq * k / 100);
+    EXPECT_LT(ndis, nq * k * params.k_factor / 2);
+}
+
+TEST(RaBitQ, io) {
+    for (const char* factory_string : {"RaBitQ", "IVF16,RaBitQ"}) {
+        auto index = make_index(factory_string, faiss::METRIC_INNER_PRODUCT);
+        char fname[] = "/tmp/faiss_test_rabitq_XXXXXX";
+        int fd = mkstemp(fname);
+        close(fd);
+        faiss::write_index(index.get(), fname);
+        std::unique_ptr<faiss::Index> index2(faiss::read_index(fname));
+        remove(fname);
+
+        EXPECT_EQ(index2->metric_type, faiss::METRIC_INNER_PRODUCT);
+        std::vector<float> xq = make_data(nq, 456);
+        std::vector<float> D1(nq * 10), D2(nq * 10);
+        std::vector<faiss::idx_t> I1(nq * 10), I2(nq * 10);
+        index->search(nq, xq.data(), 10, D1.data(), I1.data());
+        index2->search(nq, xq.data(), 10, D2.data(), I2.data());
+        EXPECT_EQ(I1, I2);
+        EXPECT_EQ(D1, D2);
+    }
+}
@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexRefine.h>
+#include <faiss/impl/SearchTrace.h>
+#include <faiss/index_factory.h>
+
+namespace {
+
+int d = 32;
+size_t nb = 5000;
+size_t nq = 100;
+int k = 10;
+
+std::vector<float> make_data(size_t n, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+std::unique_ptr<faiss::Index> make_index(const char* factory_string) {
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, factory_string));
+    std::vector<float> xb = make_data(nb, 123);
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+    return index;
+}
+
+/// search with and without trace, the results should be the same
+void search_traced(
+        const faiss::Index* index,
+        faiss::SearchParameters& params,
+        faiss::SearchTrace& trace) {
+    std::vector<float> xq = make_data(nq, 456);
+    std::vector<float> D1(nq * k), D2(nq * k);
+    std::vector<faiss::idx_t> I1(nq * k), I2(nq * k);
+    index->search(nq, xq.data(), k, D1.data(), I1.data(), &params);
+    params.trace = &trace;
+    index->search(nq, xq.data(), k, D2.data(), I2.data(), &params);
+    EXPECT_EQ(I1, I2);
+    EXPECT_EQ(D1, D2);
+    EXPECT_EQ(trace.queries.size(), nq);
+    EXPECT_EQ(trace.depth, 0);
+}
+
+// no cycle counter on other platforms
+#ifdef __x86_64__
+#define EXPECT_CYCLES(qt, stage) \
+    EXPECT_GT((qt).cycles[faiss::QueryTrace::stage], 0)
+#else
+#define EXPECT_CYCLES(qt, stage)
+#endif
+
+} // namespace
+
+TEST(SearchTrace, ivf) {
+    auto index = make_index("IVF32,SQ8");
+    faiss::SearchParametersIVF params;
+    params.nprobe = 4;
+    faiss::SearchTrace trace;
+    faiss::indexIVF_stats.reset();
+    search_traced(index.get(), params, trace);
+
+    size_t ndis = 0;
+    for (const faiss::QueryTrace& qt : trace.queries) {
+        EXPECT_GT(qt.nlist, 0);
+        EXPECT_LE(qt.nlist, 4);
+        EXPECT_CYCLES(qt, coarse_quantization);
+        EXPECT_CYCLES(qt, lut);
+        EXPECT_CYCLES(qt, scan);
+        EXPECT_CYCLES(qt, heap);
+        EXPECT_EQ(qt.cycles[faiss::QueryTrace::rerank], 0);
+        ndis += qt.ndis;
+    }
+    // the first search is not traced
+    EXPECT_EQ(ndis * 2, faiss::indexIVF_stats.ndis);
+}
+
+TEST(SearchTrace, refine) {
+    auto index = make_index("IVF32,PQ8np,Refine(Flat)");
+    faiss::SearchParametersIVF ivf_params;
+    ivf_params.nprobe = 4;
+    faiss::IndexRefineSearchParameters params;
+    params.k_factor = 4;
+    params.base_index_params = &ivf_params;
+    faiss::SearchTrace trace;
+    ivf_params.trace = &trace;
+    search_traced(index.get(), params, trace);
+
+    for (const faiss::QueryTrace& qt : trace.queries) {
+        EXPECT_GT(qt.nlist, 0);
+        EXPECT_CYCLES(qt, coarse_quantization);
+        EXPECT_CYCLES(qt, scan);
+        EXPECT_CYCLES(qt, rerank);
+    }
+}
+
+TEST(SearchTrace, hnsw_and_fast_scan) {
+    for (const char* factory_string : {"HNSW16", "IVF32,PQ16x4fs"}) {
+        auto index = make_index(factory_string);
+        bool is_hnsw = dynamic_cast<faiss::IndexHNSW*>(index.get());
+        std::unique_ptr<faiss::SearchParameters> params;
+        if (is_hnsw) {
+            params.reset(new faiss::SearchParametersHNSW());
+        } else {
+            params.reset(new faiss::SearchParametersIVF());
+        }
+        faiss::SearchTrace trace;
+        search_traced(index.get(), *params, trace);
+        for (const faiss::QueryTrace& qt : trace.queries) {
+            EXPECT_CYCLES(qt, scan);
+            if (is_hnsw) {
+                EXPECT_GT(qt.nlist, 0);
+                EXPECT_GT(qt.ndis, 0);
+            } else {
+                // fast-scan processes the queries by blocks
+                EXPECT_CYCLES(qt, coarse_quantization);
+            }
+        }
+    }
+}
+
+TEST(SearchTrace, histogram) {
+    faiss::QueryTrace qts[7];
+    faiss::SearchTrace::add_block(qts, 7, faiss::QueryTrace::scan, 100);
+    uint64_t tot = 0;
+    for (int i = 0; i < 7; i++) {
+        EXPECT_GE(qts[i].cycles[faiss::QueryTrace::scan], 14);
+        tot += qts[i].total_cycles();
+    }
+    EXPECT_EQ(tot, 100);
+
+    // query i spends 2^(i % 10) cycles scanning
+    faiss::SearchTrace trace;
+    trace.begin(1000);
+    for (int i = 0; i < 1000; i++) {
+        trace.queries[i].cycles[faiss::QueryTrace::scan] = 1 << (i % 10);
+    }
+    trace.end();
+
+    faiss::SearchTraceHistogram hist, merged;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() { hist.add(trace); });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    EXPECT_EQ(hist.nq, 4000);
+    merged.merge(hist);
+    merged.merge(hist);
+    EXPECT_EQ(merged.nq, 8000);
+
+    int total = faiss::SearchTraceHistogram::total;
+    EXPECT_EQ(merged.quantile(total, 0.5), 31);
+    EXPECT_EQ(merged.quantile(total, 0.99), 1023);
+    EXPECT_EQ(merged.quantile(total, 1.0), 1023);
+    EXPECT_EQ(merged.quantile(faiss::QueryTrace::scan, 0.1), 1);
+    EXPECT_EQ(merged.quantile(faiss::QueryTrace::lut, 0.99), 0);
+
+    std::vector<size_t> slow = trace.slow_queries(512);
+    EXPECT_EQ(slow.size(), 100);
+    for (size_t i : slow) {
+        EXPECT_EQ(i % 10, 9);
+    }
+}
@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexPQ.h>
+#include <faiss/IndexScalarQuantizer.h>
+#include <faiss/index_factory.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/hamming.h>
+#include <faiss/utils/random.h>
+#include <faiss/utils/simd_levels.h>
+
+namespace {
+
+std::vector<faiss::SIMDLevel> available_levels() {
+    std::vector<faiss::SIMDLevel> levels;
+    for (auto level :
+         {faiss::SIMDLevel::NONE,
+          faiss::SIMDLevel::AVX2,
+          faiss::SIMDLevel::AVX512}) {
+        if (faiss::SIMDConfig::is_available(level)) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+// restores the initial level at the end of the test
+struct SIMDLevelGuard {
+    faiss::SIMDLevel level = faiss::SIMDConfig::get_level();
+    ~SIMDLevelGuard() {
+        faiss::SIMDConfig::set_level(level);
+    }
+};
+
+} // namespace
+
+TEST(SIMDLevels, config) {
+    EXPECT_TRUE(faiss::SIMDConfig::is_available(faiss::SIMDLevel::NONE));
+    EXPECT_TRUE(faiss::SIMDConfig::is_available(
+            faiss::SIMDConfig::get_level()));
+    EXPECT_TRUE(faiss::SIMDConfig::is_available(
+            faiss::SIMDConfig::auto_detect()));
+    for (auto level : available_levels()) {
+        std::string name = faiss::SIMDConfig::level_name(level);
+        EXPECT_EQ(faiss::SIMDConfig::level_from_name(name), level);
+    }
+    EXPECT_THROW(
+            faiss::SIMDConfig::level_from_name("SSE9"),
+            faiss::FaissException);
+}
+
+// all the levels compute the same distances and search results
+TEST(SIMDLevels, same_results) {
+    SIMDLevelGuard guard;
+    int d = 37, nb = 1000, nq = 10, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 1);
+    faiss::float_rand(xq.data(), xq.size(), 2);
+
+    faiss::IndexScalarQuantizer index(
+            d, faiss::ScalarQuantizer::QT_8bit, faiss::METRIC_L2);
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+
+    faiss::SIMDConfig::set_level(faiss::SIMDLevel::NONE);
+    float dis_ref = faiss::fvec_L2sqr(xq.data(), xb.data(), d);
+    float ip_ref = faiss::fvec_inner_product(xq.data(), xb.data(), d);
+    std::vector<faiss::idx_t> I_ref(nq * k);
+    std::vector<float> D_ref(nq * k);
+    index.search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+
+    for (auto level : available_levels()) {
+        faiss::SIMDConfig::set_level(level);
+        EXPECT_NEAR(
+                faiss::fvec_L2sqr(xq.data(), xb.data(), d), dis_ref, 1e-4);
+        EXPECT_NEAR(
+                faiss::fvec_inner_product(xq.data(), xb.data(), d),
+                ip_ref,
+                1e-4);
+
+        std::vector<faiss::idx_t> I(nq * k);
+        std::vector<float> D(nq * k);
+        index.search(nq, xq.data(), k, D.data(), I.data());
+        EXPECT_EQ(I, I_ref);
+        for (int i = 0; i < nq * k; i++) {
+            EXPECT_NEAR(D[i], D_ref[i], 1e-4);
+        }
+    }
+}
+
+// the PQ code distances, in the IVFPQ scanners and the IndexPQ distance
+// computer, with the 8-bit and generic decoders
+TEST(SIMDLevels, pq_same_results) {
+    SIMDLevelGuard guard;
+    int d = 32, nb = 2000, nq = 10, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 1);
+    faiss::float_rand(xq.data(), xq.size(), 2);
+    std::vector<faiss::idx_t> ids(nb);
+    for (int i = 0; i < nb; i++) {
+        ids[i] = (i * 7919) % nb;
+    }
+
+    for (const char* key : {"IVF16,PQ8", "IVF16,PQ8x6", "PQ8", "PQ8x6"}) {
+        std::unique_ptr<faiss::Index> index(faiss::index_factory(d, key));
+        index->train(nb, xb.data());
+        index->add(nb, xb.data());
+        if (auto ivf = dynamic_cast<faiss::IndexIVF*>(index.get())) {
+            ivf->nprobe = 4;
+        }
+
+        auto compute = [&](std::vector<faiss::idx_t>& I,
+                           std::vector<float>& D) {
+            I.resize(nq * k);
+            D.resize(nq * k + nb);
+            index->search(nq, xq.data(), k, D.data(), I.data());
+            if (auto index_pq = dynamic_cast<faiss::IndexPQ*>(index.get())) {
+                std::unique_ptr<faiss::DistanceComputer> dc(
+                        index_pq->get_distance_computer());
+                dc->set_query(xq.data());
+                dc->distances_batch(nb, ids.data(), D.data() + nq * k);
+            }
+        };
+
+        faiss::SIMDConfig::set_level(faiss::SIMDLevel::NONE);
+        std::vector<faiss::idx_t> I_ref;
+        std::vector<float> D_ref;
+        compute(I_ref, D_ref);
+
+        for (auto level : available_levels()) {
+            faiss::SIMDConfig::set_level(level);
+            std::vector<faiss::idx_t> I;
+            std::vector<float> D;
+            compute(I, D);
+            EXPECT_EQ(I, I_ref) << key;
+            for (size_t i = 0; i < D.size(); i++) {
+                EXPECT_NEAR(D[i], D_ref[i], 1e-4) << key << " i=" << i;
+            }
+        }
+    }
+}
+
+// the hand-written kernels of distances_simd.cpp, with the dimensions of
+// their special cases
+TEST(SIMDLevels, hand_written_same_results) {
+    SIMDLevelGuard guard;
+    int ny = 101;
+    std::vector<float> x(16), y(16 * ny), y_sqlen(ny);
+    faiss::float_rand(x.data(), x.size(), 1);
+    faiss::float_rand(y.data(), y.size(), 2);
+
+    for (size_t d : {1, 2, 4, 8, 12, 16}) {
+        // y transposed, and its squared norms
+        std::vector<float> yt(d * ny);
+        for (int i = 0; i < ny; i++) {
+            for (size_t j = 0; j < d; j++) {
+                yt[j * ny + i] = y[i * d + j];
+            }
+            y_sqlen[i] = faiss::fvec_norm_L2sqr(y.data() + i * d, d);
+        }
+
+        auto compute = [&](std::vector<float>& res,
+                           std::vector<size_t>& nearest) {
+            res.assign(5 * ny + 2, 0);
+            float* r = res.data();
+            faiss::fvec_L2sqr_ny(r, x.data(), y.data(), d, ny);
+            faiss::fvec_inner_products_ny(r + ny, x.data(), y.data(), d, ny);
+            faiss::fvec_L2sqr_ny_transposed(
+                    r + 2 * ny, x.data(), yt.data(), y_sqlen.data(), d, ny, ny);
+            faiss::fvec_madd(ny, y.data(), 0.5, y.data() + ny, r + 3 * ny);
+            std::vector<float> tmp(ny);
+            nearest = {
+                    faiss::fvec_L2sqr_ny_nearest(
+                            tmp.data(), x.data(), y.data(), d, ny),
+                    faiss::fvec_L2sqr_ny_nearest_y_transposed(
+                            tmp.data(),
+                            x.data(),
+                            yt.data(),
+                            y_sqlen.data(),
+                            d,
+                            ny,
+                            ny),
+                    size_t(faiss::fvec_madd_and_argmin(
+                            ny, y.data(), -2, y.data() + ny, tmp.data()))};
+            faiss::fvec_add(ny, y.data(), y.data() + ny, r + 4 * ny);
+            r[5 * ny] = faiss::fvec_L1(x.data(), y.data(), d);
+            r[5 * ny + 1] = faiss::fvec_Linf(x.data(), y.data(), d);
+        };
+
+        faiss::SIMDConfig::set_level(faiss::SIMDLevel::NONE);
+        std::vector<float> ref;
+        std::vector<size_t> nearest_ref;
+        compute(ref, nearest_ref);
+
+        for (auto level : available_levels()) {
+            faiss::SIMDConfig::set_level(level);
+            std::vector<float> res;
+            std::vector<size_t> nearest;
+            compute(res, nearest);
+            for (size_t i = 0; i < ref.size(); i++) {
+                EXPECT_NEAR(res[i], ref[i], 1e-4) << "d=" << d << " i=" << i;
+            }
+            EXPECT_EQ(nearest, nearest_ref) << "d=" << d;
+        }
+    }
+}
+
+// the Hamming kernels, for the code sizes of the specialized computers
+TEST(SIMDLevels, hamming_same_results) {
+    SIMDLevelGuard guard;
+    size_t nq = 7, nb = 300, k = 5;
+
+    for (size_t code_size : {4, 8, 16, 20, 24, 32, 64}) {
+        std::vector<uint8_t> codes((nq + nb) * code_size);
+        faiss::byte_rand(codes.data(), codes.size(), 123);
+        const uint8_t* q = codes.data();
+        const uint8_t* b = codes.data() + nq * code_size;
+
+        auto compute = [&](std::vector<int32_t>& dis,
+                           std::vector<int64_t>& ids) {
+            dis.resize(3 * nq * k);
+            ids.resize(3 * nq * k);
+            faiss::int_maxheap_array_t ha = {nq, k, ids.data(), dis.data()};
+            faiss::hammings_knn_hc(&ha, q, b, nb, code_size, true);
+            faiss::hammings_knn_mc(
+                    q,
+                    b,
+                    nq,
+                    nb,
+                    k,
+                    code_size,
+                    dis.data() + nq * k,
+                    ids.data() + nq * k);
+            if (code_size % 8 == 0) {
+                faiss::int_maxheap_array_t ha_gen = {
+                        nq,
+                        k,
+                        ids.data() + 2 * nq * k,
+                        dis.data() + 2 * nq * k};
+                faiss::generalized_hammings_knn_hc(
+                        &ha_gen, q, b, nb, code_size, true);
+            }
+        };
+
+        faiss::SIMDConfig::set_level(faiss::SIMDLevel::NONE);
+        std::vector<int32_t> dis_ref;
+        std::vector<int64_t> ids_ref;
+        compute(dis_ref, ids_ref);
+
+        for (auto level : available_levels()) {
+            faiss::SIMDConfig::set_level(level);
+            std::vector<int32_t> dis;
+            std::vector<int64_t> ids;
+            compute(dis, ids);
+            EXPECT_EQ(dis, dis_ref) << "code_size=" << code_size;
+            EXPECT_EQ(ids, ids_ref) << "code_size=" << code_size;
+        }
+    }
+}
+
+// the fast-scan kernels accumulate integer distances, so the results do not
+// depend on the level
+TEST(SIMDLevels, fast_scan_same_results) {
+    SIMDLevelGuard guard;
+    int d = 32, nb = 1000, k = 5;
+    std::vector<float> xb(nb * d), xq(20 * d);
+    faiss::float_rand(xb.data(), xb.size(), 1);
+    faiss::float_rand(xq.data(), xq.size(), 2);
+
+    for (const char* factory_string :
+         {"PQ8x4fs", "RQ4x4fs_Nrq2x4", "IVF8,PQ8x4fs"}) {
+        std::unique_ptr<faiss::Index> index(
+                faiss::index_factory(d, factory_string));
+        index->train(nb, xb.data());
+        index->add(nb, xb.data());
+        if (auto ivf = dynamic_cast<faiss::IndexIVF*>(index.get())) {
+            ivf->nprobe = 4;
+        }
+
+        for (int nq : {1, 5, 20}) {
+            faiss::SIMDConfig::set_level(faiss::SIMDLevel::NONE);
+            std::vector<faiss::idx_t> I_ref(nq * k);
+            std::vector<float> D_ref(nq * k);
+            index->search(nq, xq.data(), k, D_ref.data(), I_ref.data());
+
+            for (auto level : available_levels()) {
+                faiss::SIMDConfig::set_level(level);
+                std::vector<faiss::idx_t> I(nq * k);
+                std::vector<float> D(nq * k);
+                index->search(nq, xq.data(), k, D.data(), I.data());
+                // the look-up tables are computed with the float kernels
+                // of the level, so the distances may differ slightly
+                EXPECT_EQ(I, I_ref) << factory_string << " nq=" << nq;
+                for (int i = 0; i < nq * k; i++) {
+                    EXPECT_NEAR(D[i], D_ref[i], 1e-5);
+                }
+            }
+        }
+    }
+}
+
+// the level can be changed while other threads run the kernels
+TEST(SIMDLevels, set_level_concurrently) {
+    SIMDLevelGuard guard;
+    int d = 37;
+    std::vector<float> x(2 * d);
+    faiss::float_rand(x.data(), x.size(), 1);
+    faiss::SIMDConfig::set_level(faiss::SIMDLevel::NONE);
+    float dis_ref = faiss::fvec_L2sqr(x.data(), x.data() + d, d);
+
+    std::atomic<bool> stop{false};
+    std::thread setter([&] {
+        auto levels = available_levels();
+        for (size_t i = 0; !stop; i++) {
+            faiss::SIMDConfig::set_level(levels[i % levels.size()]);
+        }
+    });
+    for (int i = 0; i < 100000; i++) {
+        float dis = faiss::fvec_L2sqr(x.data(), x.data() + d, d);
+        ASSERT_NEAR(dis, dis_ref, 1e-4);
+    }
+    stop = true;
+    setter.join();
+}
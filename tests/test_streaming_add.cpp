@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <faiss/IVFlib.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/impl/FaissException.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+#include <faiss/invlists/OnDiskInvertedLists.h>
+
+#include "test_util.h"
+
+namespace {
+
+pthread_mutex_t temp_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int d = 32;
+size_t nb = 5000;
+
+std::vector<float> make_data(size_t n, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+/// reads from an array, optionally fails after fail_after vectors
+struct ArrayReader : faiss::ivflib::VectorStreamReader {
+    const std::vector<float>& x;
+    size_t pos = 0;
+    size_t fail_after;
+
+    explicit ArrayReader(const std::vector<float>& x, size_t fail_after = 0)
+            : x(x), fail_after(fail_after) {
+        d = ::d;
+    }
+
+    size_t read(size_t n, float* out) override {
+        if (fail_after > 0 && pos >= fail_after) {
+            FAISS_THROW_MSG("read failure");
+        }
+        n = std::min(n, x.size() / d - pos);
+        memcpy(out, x.data() + pos * d, n * d * sizeof(float));
+        pos += n;
+        return n;
+    }
+};
+
+std::unique_ptr<faiss::Index> make_trained(
+        const char* factory_string,
+        const std::vector<float>& xt) {
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, factory_string));
+    index->train(xt.size() / d, xt.data());
+    return index;
+}
+
+void expect_same_lists(const faiss::Index* index1, const faiss::Index* index2) {
+    const faiss::IndexIVF* ivf1 = faiss::ivflib::extract_index_ivf(index1);
+    const faiss::IndexIVF* ivf2 = faiss::ivflib::extract_index_ivf(index2);
+    ASSERT_EQ(index1->ntotal, index2->ntotal);
+    ASSERT_EQ(ivf1->ntotal, ivf2->ntotal);
+    const faiss::InvertedLists* il1 = ivf1->invlists;
+    const faiss::InvertedLists* il2 = ivf2->invlists;
+    for (size_t l = 0; l < ivf1->nlist; l++) {
+        size_t ls = il1->list_size(l);
+        ASSERT_EQ(ls, il2->list_size(l));
+        faiss::InvertedLists::ScopedIds ids1(il1, l), ids2(il2, l);
+        faiss::InvertedLists::ScopedCodes codes1(il1, l), codes2(il2, l);
+        EXPECT_EQ(0, memcmp(ids1.get(), ids2.get(), ls * sizeof(faiss::idx_t)));
+        EXPECT_EQ(0, memcmp(codes1.get(), codes2.get(), ls * il1->code_size));
+    }
+}
+
+void write_vecs(const char* fname, const std::vector<float>& x, bool bvecs) {
+    FILE* f = fopen(fname, "wb");
+    ASSERT_TRUE(f);
+    int32_t dim = d;
+    for (size_t i = 0; i < x.size() / d; i++) {
+        fwrite(&dim, sizeof(dim), 1, f);
+        if (bvecs) {
+            for (int j = 0; j < d; j++) {
+                uint8_t v = x[i * d + j];
+                fwrite(&v, 1, 1, f);
+            }
+        } else {
+            fwrite(x.data() + i * d, sizeof(float), d, f);
+        }
+    }
+    fclose(f);
+}
+
+} // namespace
+
+TEST(StreamingAdd, same_as_add) {
+    std::vector<float> xb = make_data(nb, 123);
+    auto ref = make_trained("IVF32,PQ8np", xb);
+    // the same trained state
+    faiss::VectorIOWriter w;
+    faiss::write_index(ref.get(), &w);
+    faiss::VectorIOReader r;
+    r.data = w.data;
+    std::unique_ptr<faiss::Index> index(faiss::read_index(&r));
+    ref->add(nb, xb.data());
+
+    ArrayReader reader(xb);
+    faiss::ivflib::StreamingAddParams params;
+    params.batch_size = 700;
+    params.queue_size = 1;
+    EXPECT_EQ(faiss::ivflib::streaming_add(index.get(), reader, params), nb);
+    expect_same_lists(ref.get(), index.get());
+}
+
+TEST(StreamingAdd, vecs_files) {
+    std::vector<float> xb = make_data(nb, 123);
+    for (auto& v : xb) {
+        v = int(v * 255);
+    }
+    for (bool bvecs : {false, true}) {
+        Tempfilename fname(&temp_file_mutex, "/tmp/faiss_vecs_XXXXXX");
+        write_vecs(fname.c_str(), xb, bvecs);
+
+        auto ref = make_trained("PCA16,IVF16,Flat", xb);
+        faiss::VectorIOWriter w;
+        faiss::write_index(ref.get(), &w);
+        faiss::VectorIOReader r;
+        r.data = w.data;
+        std::unique_ptr<faiss::Index> index(faiss::read_index(&r));
+        ref->add(nb, xb.data());
+
+        faiss::ivflib::VecsFileReader reader(fname.c_str(), bvecs);
+        EXPECT_EQ(reader.d, d);
+        faiss::ivflib::StreamingAddParams params;
+        params.batch_size = 1000;
+        faiss::ivflib::streaming_add(index.get(), reader, params);
+        expect_same_lists(ref.get(), index.get());
+    }
+}
+
+TEST(StreamingAdd, shards_and_ondisk) {
+    std::vector<float> xb = make_data(nb, 123);
+    auto ref = make_trained("IVF16,SQ8", xb);
+    faiss::VectorIOWriter w;
+    faiss::write_index(ref.get(), &w);
+    ref->add(nb, xb.data());
+
+    Tempfilename prefix(&temp_file_mutex, "/tmp/faiss_shard_XXXXXX");
+    {
+        faiss::VectorIOReader r;
+        r.data = w.data;
+        std::unique_ptr<faiss::Index> index(faiss::read_index(&r));
+        ArrayReader reader(xb);
+        faiss::ivflib::StreamingAddParams params;
+        params.batch_size = 1000;
+        params.shard_size = 1500;
+        params.shard_prefix = prefix.filename;
+        size_t nadd = faiss::ivflib::streaming_add(index.get(), reader, params);
+        EXPECT_EQ(nadd, nb);
+        EXPECT_EQ(index->ntotal, 0);
+    }
+
+    // merge the shards into an OnDiskInvertedLists
+    Tempfilename ondisk(&temp_file_mutex, "/tmp/faiss_ondisk_XXXXXX");
+    faiss::VectorIOReader r;
+    r.data = w.data;
+    std::unique_ptr<faiss::Index> merged(faiss::read_index(&r));
+    faiss::IndexIVF* ivf = faiss::ivflib::extract_index_ivf(merged.get());
+    std::vector<std::unique_ptr<faiss::Index>> shards;
+    std::vector<const faiss::InvertedLists*> ils;
+    for (int i = 0; i < 4; i++) {
+        std::string fname = prefix.filename + std::to_string(i) + ".index";
+        shards.emplace_back(faiss::read_index(fname.c_str()));
+        EXPECT_EQ(shards.back()->ntotal, i < 3 ? 1500 : 500);
+        ils.push_back(faiss::ivflib::extract_index_ivf(shards.back().get())
+                              ->invlists);
+        remove(fname.c_str());
+    }
+    auto* od = new faiss::OnDiskInvertedLists(
+            ivf->nlist, ivf->code_size, ondisk.c_str());
+    od->merge_from_multiple(ils.data(), ils.size());
+    ivf->replace_invlists(od, true);
+    ivf->ntotal = merged->ntotal = nb;
+    expect_same_lists(ref.get(), merged.get());
+
+    // streaming addition to an OnDiskInvertedLists
+    r.rp = 0;
+    std::unique_ptr<faiss::Index> index(faiss::read_index(&r));
+    ivf = faiss::ivflib::extract_index_ivf(index.get());
+    Tempfilename ondisk2(&temp_file_mutex, "/tmp/faiss_ondisk2_XXXXXX");
+    ivf->replace_invlists(
+            new faiss::OnDiskInvertedLists(
+                    ivf->nlist, ivf->code_size, ondisk2.c_str()),
+            true);
+    ArrayReader reader(xb);
+    faiss::ivflib::streaming_add(index.get(), reader);
+    expect_same_lists(ref.get(), index.get());
+    remove(ondisk.c_str());
+    remove(ondisk2.c_str());
+}
+
+TEST(StreamingAdd, errors) {
+    std::vector<float> xb = make_data(nb, 123);
+    auto index = make_trained("IVF16,Flat", xb);
+    faiss::ivflib::StreamingAddParams params;
+    params.batch_size = 500;
+
+    // the error of a stage is propagated, the pipeline does not hang
+    ArrayReader failing_reader(xb, 2000);
+    EXPECT_THROW(
+            faiss::ivflib::streaming_add(index.get(), failing_reader, params),
+            faiss::FaissException);
+    EXPECT_EQ(index->ntotal, 2000);
+
+    ArrayReader reader(xb);
+    params.max_memory = 1000;
+    EXPECT_THROW(
+            faiss::ivflib::streaming_add(index.get(), reader, params),
+            faiss::FaissException);
+
+    // indexes that need their own add path
+    for (const char* factory_string :
+         {"IVF16,PQ8+8", "IVF16,FlatDedup", "IVF16,PQ8x4fs"}) {
+        std::unique_ptr<faiss::Index> index2(
+                faiss::index_factory(d, factory_string));
+        index2->train(nb, xb.data());
+        EXPECT_THROW(
+                faiss::ivflib::streaming_add(index2.get(), reader, params),
+                faiss::FaissException);
+    }
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/TwoLevelCoarseQuantizer.h>
+#include <faiss/impl/io.h>
+#include <faiss/index_factory.h>
+#include <faiss/index_io.h>
+
+namespace {
+
+int d = 32;
+size_t nb = 4000;
+size_t nq = 50;
+
+std::vector<float> make_data(size_t n, int seed) {
+    std::vector<float> x(n * d);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u;
+    for (auto& v : x) {
+        v = u(rng);
+    }
+    return x;
+}
+
+/// nb of queries whose nearest centroid is found
+size_t count_exact_assign(
+        const faiss::TwoLevelCoarseQuantizer& quantizer,
+        const std::vector<float>& xq) {
+    std::vector<faiss::idx_t> I(nq), Iref(nq);
+    quantizer.assign(nq, xq.data(), I.data());
+    quantizer.sub_centroids.assign(nq, xq.data(), Iref.data());
+    size_t nok = 0;
+    for (size_t i = 0; i < nq; i++) {
+        nok += I[i] == Iref[i];
+    }
+    return nok;
+}
+
+} // namespace
+
+TEST(TwoLevelCoarseQuantizer, train_and_assign) {
+    for (auto metric : {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        faiss::TwoLevelCoarseQuantizer quantizer(d, 8, 16, metric);
+        std::vector<float> xb = make_data(nb, 123);
+        quantizer.train(nb, xb.data());
+        EXPECT_TRUE(quantizer.is_trained);
+        EXPECT_EQ(quantizer.ntotal, 8 * 16);
+
+        std::vector<float> xq = make_data(nq, 456);
+        // visiting all the top-level cells is exhaustive
+        quantizer.nprobe1 = 8;
+        EXPECT_EQ(count_exact_assign(quantizer, xq), nq);
+        quantizer.nprobe1 = 3;
+        EXPECT_GT(count_exact_assign(quantizer, xq), nq * 8 / 10);
+
+        // k results are returned even if k > nprobe1 * nlist2
+        faiss::SearchParametersTwoLevel params;
+        params.nprobe1 = 1;
+        int k = 40;
+        std::vector<float> D(nq * k);
+        std::vector<faiss::idx_t> I(nq * k);
+        quantizer.search(nq, xq.data(), k, D.data(), I.data(), &params);
+        for (size_t i = 0; i < nq * k; i++) {
+            EXPECT_GE(I[i], 0);
+        }
+    }
+}
+
+TEST(TwoLevelCoarseQuantizer, IVF_factory_and_io) {
+    std::unique_ptr<faiss::Index> index(
+            faiss::index_factory(d, "IVF2L_8x16,Flat"));
+    auto index_ivf = dynamic_cast<faiss::IndexIVF*>(index.get());
+    ASSERT_TRUE(index_ivf);
+    EXPECT_EQ(index_ivf->nlist, 8 * 16);
+    EXPECT_EQ(index_ivf->quantizer_trains_alone, 1);
+    auto quantizer =
+            dynamic_cast<faiss::TwoLevelCoarseQuantizer*>(index_ivf->quantizer);
+    ASSERT_TRUE(quantizer);
+
+    std::vector<float> xb = make_data(nb, 123);
+    index->train(nb, xb.data());
+    index->add(nb, xb.data());
+
+    // scanning all the lists gives the exact results
+    faiss::IndexFlatL2 ref(d);
+    ref.add(nb, xb.data());
+    index_ivf->nprobe = index_ivf->nlist;
+    std::vector<float> xq = make_data(nq, 456);
+    int k = 5;
+    std::vector<float> D(nq * k), Dref(nq * k);
+    std::vector<faiss::idx_t> I(nq * k), Iref(nq * k);
+    index->search(nq, xq.data(), k, D.data(), I.data());
+    ref.search(nq, xq.data(), k, Dref.data(), Iref.data());
+    EXPECT_EQ(I, Iref);
+
+    faiss::VectorIOWriter writer;
+    faiss::write_index(index.get(), &writer);
+    faiss::VectorIOReader reader;
+    reader.data = writer.data;
+    std::unique_ptr<faiss::Index> index2(faiss::read_index(&reader));
+    std::vector<float> D2(nq * k);
+    std::vector<faiss::idx_t> I2(nq * k);
+    index_ivf->nprobe = 4;
+    index->search(nq, xq.data(), k, D.data(), I.data());
+    dynamic_cast<faiss::IndexIVF*>(index2.get())->nprobe = 4;
+    index2->search(nq, xq.data(), k, D2.data(), I2.data());
+    EXPECT_EQ(I, I2);
+    EXPECT_EQ(D, D2);
+}